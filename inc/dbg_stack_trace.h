@@ -33,6 +33,37 @@ struct DBGUTIL_API StackEntry {
 /** @typedef A fully resolved stack trace. */
 typedef std::vector<StackEntry> StackTrace;
 
+/**
+ * @brief A fully resolved single stack entry in compact form (see @ref SymbolInfoRef). Copying
+ * this object requires no heap allocation.
+ */
+struct DBGUTIL_API StackEntryRef {
+    /** @brief The stack frame index (required if stack trace is partial or reordered). */
+    uint32_t m_frameIndex;  // zero means innermost
+
+    /** @brief The frame address. */
+    void* m_frameAddress;
+
+    /** @brief Resolved entry debug information. */
+    SymbolInfoRef m_entryInfo;
+
+    StackEntryRef() : m_frameIndex(0), m_frameAddress(nullptr) {}
+    StackEntryRef(const StackEntryRef&) = default;
+    StackEntryRef(StackEntryRef&&) = default;
+    StackEntryRef& operator=(const StackEntryRef&) = default;
+    ~StackEntryRef() {}
+
+    /** @brief Converts to a full stack entry (involves string copies). */
+    void toStackEntry(StackEntry& stackEntry) const {
+        stackEntry.m_frameIndex = m_frameIndex;
+        stackEntry.m_frameAddress = m_frameAddress;
+        m_entryInfo.toSymbolInfo(stackEntry.m_entryInfo);
+    }
+};
+
+/** @typedef A fully resolved stack trace in compact form. */
+typedef std::vector<StackEntryRef> StackTraceRef;
+
 /** @brief Stack entry filter interface. */
 class DBGUTIL_API StackEntryFilter {
 public:
@@ -45,6 +76,14 @@ public:
      */
     virtual bool filterStackEntry(const StackEntry& stackEntry) = 0;
 
+    /**
+     * @brief Filters a compact stack trace entry. The default implementation converts the entry
+     * and calls @ref filterStackEntry(), so filters used on large stack dumps should override it.
+     * @param stackEntry The stack entry.
+     * @return true if the stack entry is to be processed, or false if should be skipped.
+     */
+    virtual bool filterStackEntryRef(const StackEntryRef& stackEntry);
+
 protected:
     StackEntryFilter() {}
     StackEntryFilter(const StackEntryFilter&) = delete;
@@ -64,6 +103,18 @@ public:
      */
     virtual std::string formatStackEntry(const StackEntry& stackEntry) = 0;
 
+    /**
+     * @brief Formats a compact stack trace entry into a caller provided buffer. The default
+     * implementation converts the entry and calls @ref formatStackEntry(), so formatters used on
+     * large stack dumps should override it.
+     * @param stackEntry The stack entry.
+     * @param buffer The buffer receiving the null-terminated formatted string.
+     * @param bufferSize The buffer size. The formatted string is truncated if it does not fit.
+     * @return size_t The length of the formatted string (not including the terminating null).
+     */
+    virtual size_t formatStackEntryRef(const StackEntryRef& stackEntry, char* buffer,
+                                       size_t bufferSize);
+
 protected:
     StackEntryFormatter() {}
     StackEntryFormatter(const StackEntryFormatter&) = delete;
@@ -81,6 +132,9 @@ public:
     ~DefaultStackEntryFormatter() override {}
 
     std::string formatStackEntry(const StackEntry& stackEntry) override;
+
+    size_t formatStackEntryRef(const StackEntryRef& stackEntry, char* buffer,
+                               size_t bufferSize) override;
 };
 
 /** @brief Stack entry printer interface. */
@@ -240,14 +294,53 @@ inline DbgUtilErr getRawStackTrace(RawStackTrace& stackTrace, void* context = nu
     return getStackTraceProvider()->getStackTrace(context, stackTrace);
 }
 
+/**
+ * @brief Captures a raw stack trace into a caller-provided array, without heap allocation, and
+ * stops unwinding once the array is full. On Linux this is async-signal-safe, and so may be used
+ * in signal handlers and allocator hooks (see @ref OsStackTraceProvider::captureRawStack()).
+ * With @ref DBGUTIL_FRAME_POINTER_UNWIND, frame pointers are used only on threads whose stack
+ * bounds are already known (i.e. after @ref getRawStackTrace() was called on the thread), since
+ * querying them may allocate memory. Until then, stacks are unwound by call frame information.
+ * With @ref DBGUTIL_BUILTIN_UNWIND, frames of modules loaded since the last call to
+ * @ref getRawStackTrace() are not unwound, since the loader is not queried.
+ * @param[out] frames The array receiving the frame addresses (innermost first).
+ * @param maxFrames The array capacity.
+ * @param skip The number of innermost frames to skip.
+ * @param context Optional OS-specific thread context. Pass null to capture current thread call
+ * stack. When a signal context is passed, the interrupted instruction address (i.e. the program
+ * counter of the context) is not included, and unwinding starts at the caller of the interrupted
+ * function, so callers that need it should retrieve it from the context and record it first.
+ * @return size_t The number of captured frames.
+ */
+inline size_t captureRawStack(void** frames, size_t maxFrames, size_t skip = 0,
+                              void* context = nullptr) {
+    return getStackTraceProvider()->captureRawStack(frames, maxFrames, skip, context);
+}
+
 /**
  * @brief Converts raw stack frames to resolved stack frames.
  * @param rawStackTrace The raw stack trace.
  * @param[out] stackTrace The resulting resolved stack trace.
+ * @param detail The required symbol level of detail. Passing less detail (e.g. only
+ * @ref DBGUTIL_SYMBOL_DETAIL_MODULE for module and offset) skips the corresponding resolution
+ * stages altogether.
+ * @return DbgUtilErr The operation result.
+ */
+extern DBGUTIL_API DbgUtilErr resolveRawStackTrace(
+    RawStackTrace& rawStackTrace, StackTrace& stackTrace,
+    SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
+
+/**
+ * @brief Converts raw stack frames to resolved stack frames in compact form. Apart from growing the
+ * resulting stack trace, this requires no heap allocation per frame (see @ref SymbolInfoRef).
+ * @param rawStackTrace The raw stack trace.
+ * @param[out] stackTrace The resulting resolved stack trace.
+ * @param detail The required symbol level of detail.
  * @return DbgUtilErr The operation result.
  */
-extern DBGUTIL_API DbgUtilErr resolveRawStackTrace(RawStackTrace& rawStackTrace,
-                                                   StackTrace& stackTrace);
+extern DBGUTIL_API DbgUtilErr resolveRawStackTrace(
+    const RawStackTrace& rawStackTrace, StackTraceRef& stackTrace,
+    SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
 
 /**
  * @brief Retrieves a fully resolved stack trace of a thread by an optional context. Context is
@@ -297,6 +390,40 @@ extern DBGUTIL_API std::string stackTraceToString(const StackTrace& stackTrace,
                                                   StackEntryFormatter* formatter = nullptr,
                                                   os_thread_id_t threadId = 0);
 
+/**
+ * @brief Converts compact resolved stack frames to string form.
+ * @param stackTrace The stack trace.
+ * @param skip Optionally specifies the number of frames to skip (deepest frames).
+ * @param filter Optional stack entry filter. Pass null to allow all frames to be processed
+ * (except for skipped ones).
+ * @param formatter Optional stack entry formatter. Pass null to use default formatting.
+ * @param threadId Optional thread id (for printing purposes only). If not specified, current thread
+ * id will be used.
+ * @return std::string The resulting resolved stack trace string.
+ */
+extern DBGUTIL_API std::string stackTraceToString(const StackTraceRef& stackTrace, int skip = 0,
+                                                  StackEntryFilter* filter = nullptr,
+                                                  StackEntryFormatter* formatter = nullptr,
+                                                  os_thread_id_t threadId = 0);
+
+/**
+ * @brief Prints compact resolved stack frames. Each frame is formatted into a stack buffer, so
+ * with the default formatter no heap allocation takes place.
+ * @param stackTrace The stack trace.
+ * @param skip Optionally specifies the number of frames to skip (deepest frames).
+ * @param filter Optional stack entry filter. Pass null to allow all frames to be processed
+ * (except for skipped ones).
+ * @param formatter Optional stack entry formatter. Pass null to use default formatting.
+ * @param printer Optional stack entry printer. Pass null to print to standard error stream.
+ * @param threadId Optional thread id (for printing purposes only). If not specified, current thread
+ * id will be used.
+ */
+extern DBGUTIL_API void printStackTraceRef(const StackTraceRef& stackTrace, int skip = 0,
+                                           StackEntryFilter* filter = nullptr,
+                                           StackEntryFormatter* formatter = nullptr,
+                                           StackEntryPrinter* printer = nullptr,
+                                           os_thread_id_t threadId = 0);
+
 /**
  * @brief Prints stack trace by a given context. Context is either captured by calling thread, or is
  * passed by OS through an exception/signal handler.
@@ -13,7 +13,57 @@
 /** @brief Specifies whether dbgutil should dump core file when crashing. */
 #define DBGUTIL_EXCEPTION_DUMP_CORE 0x0008
 
-/** @brief Turns on all flags/options. */
-#define DBGUTIL_FLAGS_ALL 0xFFFFFFFF
+/**
+ * @brief Specifies whether dbgutil should cache symbol lookup results by address. The cache
+ * capacity may be specified as well with @ref DBGUTIL_SYMBOL_CACHE_CAPACITY().
+ */
+#define DBGUTIL_CACHE_SYMBOLS 0x0010
+
+/**
+ * @brief Specifies whether stack traces should be captured by following the frame pointer chain
+ * (Linux x86_64/aarch64 only), rather than by DWARF call frame information. This is much faster,
+ * but requires code to be compiled with -fno-omit-frame-pointer, otherwise frames may be missing.
+ * Whenever a frame fails validation, unwinding continues (or restarts) with libunwind, or with the
+ * builtin unwinder (see @ref DBGUTIL_BUILTIN_UNWIND). Raw stack captures (see @ref
+ * captureRawStack()) use frame pointers only on threads that already walked their stack once.
+ */
+#define DBGUTIL_FRAME_POINTER_UNWIND 0x0020
+
+/**
+ * @brief Specifies whether stack traces should be captured by the builtin DWARF unwinder (Linux
+ * x86_64/aarch64 only), rather than by libunwind. The builtin unwinder caches decoded unwind rules
+ * per call site, so repeated captures of the same call paths do not take any locks. Frames it
+ * cannot unwind (e.g. code using DWARF expressions) are unwound by libunwind. This is the default
+ * when dbgutil is built without libunwind. As with frame pointers, raw stack captures use the
+ * builtin unwinder only on threads that already walked their stack once.
+ */
+#define DBGUTIL_BUILTIN_UNWIND 0x0040
+
+/** @brief The bit offset of the symbol cache capacity within the flags. */
+#define DBGUTIL_SYMBOL_CACHE_CAPACITY_SHIFT 24
+
+/** @brief The bit mask of the symbol cache capacity within the flags. */
+#define DBGUTIL_SYMBOL_CACHE_CAPACITY_MASK 0x1F000000
+
+/**
+ * @brief Builds the flags bits specifying the symbol cache capacity, given as log2 of the number
+ * of entries (e.g. 16 means 65536 entries). The value is clamped to the range [8, 20]. If not
+ * specified then the default capacity of 16384 entries is used.
+ */
+#define DBGUTIL_SYMBOL_CACHE_CAPACITY(log2Entries) \
+    ((((uint32_t)(log2Entries)) << DBGUTIL_SYMBOL_CACHE_CAPACITY_SHIFT) & \
+     DBGUTIL_SYMBOL_CACHE_CAPACITY_MASK)
+
+/** @brief Extracts the symbol cache capacity (log2 of the number of entries) from the flags. */
+#define DBGUTIL_GET_SYMBOL_CACHE_CAPACITY(flags) \
+    (((flags) & DBGUTIL_SYMBOL_CACHE_CAPACITY_MASK) >> DBGUTIL_SYMBOL_CACHE_CAPACITY_SHIFT)
+
+/**
+ * @brief Turns on all exception handling options. Symbol caching and stack unwinding options are
+ * opt-in, and are not included.
+ */
+#define DBGUTIL_FLAGS_ALL                                                                \
+    (DBGUTIL_CATCH_EXCEPTIONS | DBGUTIL_SET_TERMINATE_HANDLER | DBGUTIL_LOG_EXCEPTIONS | \
+     DBGUTIL_EXCEPTION_DUMP_CORE)
 
 #endif  // __DBG_UTIL_DEF_H__
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef __OFFLINE_SYMBOLIZER_H__
+#define __OFFLINE_SYMBOLIZER_H__
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "dbg_stack_trace.h"
+#include "dbg_util_def.h"
+#include "dbg_util_err.h"
+#include "raw_stack_record.h"
+
+namespace dbgutil {
+
+struct OfflineModuleData;
+
+/**
+ * @brief Resolves raw stack trace records (see @ref RawStackRecord) from binary images on disk,
+ * possibly on another machine than the one where the stack traces were captured. Each module
+ * referenced by a record is located by its build identifier and path, and is loaded only once, so
+ * resolving many records in bulk amortizes the image and debug information loading cost. Build
+ * identifiers are available only for ELF images, so on other platforms modules are located by path
+ * only.
+ *
+ * For each module, the following locations are searched in order, where the first image having a
+ * matching build identifier (if the module has one) is used:
+ * - For each search directory: the separate debug information file named by the build identifier
+ * (i.e. "<dir>/.build-id/xx/yyyy.debug", as used by GNU debuggers), and then the file having the
+ * same base name as the module ("<dir>/<module base name>").
+ * - The module path as recorded, after applying path prefix mappings.
+ */
+class DBGUTIL_API OfflineSymbolizer {
+public:
+    OfflineSymbolizer();
+    OfflineSymbolizer(const OfflineSymbolizer&) = delete;
+    OfflineSymbolizer(OfflineSymbolizer&&) = delete;
+    OfflineSymbolizer& operator=(const OfflineSymbolizer&) = delete;
+    ~OfflineSymbolizer();
+
+    /** @brief Adds a directory in which module images are searched. */
+    DbgUtilErr addSearchDir(const char* dir);
+
+    /**
+     * @brief Adds a path prefix mapping applied to recorded module paths (e.g. when binaries were
+     * copied from the target machine into a local directory tree).
+     * @param fromPrefix The recorded module path prefix.
+     * @param toPrefix The local path prefix replacing it.
+     */
+    DbgUtilErr addPathMapping(const char* fromPrefix, const char* toPrefix);
+
+    /**
+     * @brief Configures whether modules may be resolved from images with a mismatching build
+     * identifier (disabled by default, since this yields bogus results if the binary changed).
+     */
+    inline void setAllowBuildIdMismatch(bool allow) { m_allowBuildIdMismatch = allow; }
+
+    /**
+     * @brief Resolves a raw stack trace record. Frames of modules that could not be located are
+     * resolved only up to module name and offset.
+     * @param record The record to resolve.
+     * @param[out] stackTrace The resulting stack trace. Frame addresses and module base addresses
+     * are those of the capturing process.
+     * @param detail The required symbol level of detail.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr resolveRecord(const RawStackRecord& record, StackTrace& stackTrace,
+                             SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
+
+    /** @brief Releases all loaded module images. */
+    void clear();
+
+private:
+    std::vector<std::string> m_searchDirs;
+    std::vector<std::pair<std::string, std::string>> m_pathMappings;
+    bool m_allowBuildIdMismatch;
+
+    // loaded modules, keyed by build identifier (or path, if there is none)
+    typedef std::unordered_map<std::string, OfflineModuleData*> ModuleMap;
+    ModuleMap m_moduleMap;
+
+    OfflineModuleData* getModuleData(const RawStackModule& module);
+    OfflineModuleData* loadModuleData(const RawStackModule& module);
+    bool searchModuleImage(OfflineModuleData* modData, const RawStackModule& module);
+    bool openModuleImage(OfflineModuleData* modData, const std::string& path,
+                         const RawStackModule& module);
+};
+
+}  // namespace dbgutil
+
+#endif  // __OFFLINE_SYMBOLIZER_H__
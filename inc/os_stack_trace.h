@@ -1,6 +1,7 @@
 #ifndef __OS_STACK_TRACE_H__
 #define __OS_STACK_TRACE_H__
 
+#include <cstddef>
 #include <vector>
 
 #include "dbg_util_def.h"
@@ -57,6 +58,22 @@ public:
      */
     DbgUtilErr getStackTrace(void* context, RawStackTrace& stackTrace);
 
+    /**
+     * @brief Captures a raw stack trace into a caller-provided array, without heap allocation.
+     * Unwinding stops as soon as the array is full, so capturing only the innermost frames of a
+     * deep call stack is cheap. The default implementation walks the entire stack through @ref
+     * walkStack(). Providers that can unwind without allocating memory (i.e. the Linux provider)
+     * override it, in which case it is safe for use in signal handlers and allocator hooks.
+     * @param[out] frames The array receiving the frame addresses (innermost first).
+     * @param maxFrames The array capacity.
+     * @param skip The number of innermost frames to skip (not counting the caller).
+     * @param context The call context. Pass null to capture current thread call stack. The program
+     * counter of a passed context is not captured, as unwinding starts at its caller.
+     * @return size_t The number of captured frames.
+     */
+    virtual size_t captureRawStack(void** frames, size_t maxFrames, size_t skip = 0,
+                                   void* context = nullptr);
+
 protected:
     OsStackTraceProvider() {}
 
@@ -2,6 +2,7 @@
 #define __OS_SYMBOL_ENGINE_H__
 
 #include <cinttypes>
+#include <future>
 #include <list>
 #include <string>
 
@@ -10,6 +11,32 @@
 
 namespace dbgutil {
 
+/** @brief Resolve the containing module name (base address is always resolved). */
+#define DBGUTIL_SYMBOL_DETAIL_MODULE 0x0001
+
+/** @brief Resolve the symbol name, start address, size and byte offset. */
+#define DBGUTIL_SYMBOL_DETAIL_FUNCTION 0x0002
+
+/** @brief Demangle the symbol name (applicable only with @ref DBGUTIL_SYMBOL_DETAIL_FUNCTION). */
+#define DBGUTIL_SYMBOL_DETAIL_DEMANGLE 0x0004
+
+/** @brief Resolve the source file name and line number (requires debug information). */
+#define DBGUTIL_SYMBOL_DETAIL_FILE_LINE 0x0008
+
+/** @brief Resolve the source column index (requires debug information). */
+#define DBGUTIL_SYMBOL_DETAIL_COLUMN 0x0010
+
+/** @brief Resolve all symbol details (the default). */
+#define DBGUTIL_SYMBOL_DETAIL_ALL 0x001F
+
+/**
+ * @typedef Symbol resolution level of detail, a bitmask of DBGUTIL_SYMBOL_DETAIL_XXX flags. Each
+ * resolution stage that is not requested is skipped entirely, so for instance module and offset
+ * can be resolved without touching debug information at all. Symbol engines may still return more
+ * detail than requested.
+ */
+typedef uint32_t SymbolDetail;
+
 /** @brief Symbol infomation. */
 struct DBGUTIL_API SymbolInfo {
     /** @brief The containing module's base address in memory. */
@@ -44,7 +71,8 @@ struct DBGUTIL_API SymbolInfo {
           m_startAddress(nullptr),
           m_byteOffset(0),
           m_lineNumber(0),
-          m_columnIndex(0) {}
+          m_columnIndex(0),
+          m_symbolSize(0) {}
 
     SymbolInfo(const SymbolInfo&) = default;
     SymbolInfo(SymbolInfo&&) = default;
@@ -79,6 +107,96 @@ struct DBGUTIL_API SymbolInfo {
     }
 };
 
+/**
+ * @brief Compact symbol information. Unlike @ref SymbolInfo, all names point into interned string
+ * pools owned by the symbol engine, which live as long as the symbol engine, so copying this
+ * object or resolving a symbol into it requires no heap allocation. Names are never null, and are
+ * empty when not available.
+ */
+struct DBGUTIL_API SymbolInfoRef {
+    /** @brief The containing module's base address in memory. */
+    void* m_moduleBaseAddress;
+
+    /** @brief The start address of the symbol. */
+    void* m_startAddress;
+
+    /** @brief The bytes offset of the symbol address from the start of the symbol. */
+    uint32_t m_byteOffset;
+
+    /** @brief The line number of the symbol. */
+    uint32_t m_lineNumber;
+
+    /** @brief The column index of the symbol (Dwarf only). */
+    uint32_t m_columnIndex;
+
+    /** @brief Size of symbol in bytes. */
+    uint32_t m_symbolSize;
+
+    /** @brief The name of the symbol. */
+    const char* m_symbolName;
+
+    /** @brief The name of the file containing the symbol. */
+    const char* m_fileName;
+
+    /** @brief The name of the module containing the symbol. */
+    const char* m_moduleName;
+
+    SymbolInfoRef()
+        : m_moduleBaseAddress(nullptr),
+          m_startAddress(nullptr),
+          m_byteOffset(0),
+          m_lineNumber(0),
+          m_columnIndex(0),
+          m_symbolSize(0),
+          m_symbolName(""),
+          m_fileName(""),
+          m_moduleName("") {}
+
+    /** @brief Converts to full symbol information (involves string copies). */
+    void toSymbolInfo(SymbolInfo& symbolInfo) const {
+        symbolInfo.m_moduleBaseAddress = m_moduleBaseAddress;
+        symbolInfo.m_startAddress = m_startAddress;
+        symbolInfo.m_byteOffset = m_byteOffset;
+        symbolInfo.m_lineNumber = m_lineNumber;
+        symbolInfo.m_columnIndex = m_columnIndex;
+        symbolInfo.m_symbolSize = m_symbolSize;
+        symbolInfo.m_symbolName = m_symbolName;
+        symbolInfo.m_fileName = m_fileName;
+        symbolInfo.m_moduleName = m_moduleName;
+    }
+};
+
+/** @brief Symbol lookup result cache statistics. */
+struct DBGUTIL_API SymbolCacheStats {
+    /** @brief The maximum number of entries the cache can hold. */
+    uint64_t m_capacity;
+
+    /** @brief The number of entries currently held by the cache. */
+    uint64_t m_entryCount;
+
+    /** @brief The number of lookups served from the cache. */
+    uint64_t m_hitCount;
+
+    /** @brief The number of lookups not found in the cache. */
+    uint64_t m_missCount;
+
+    SymbolCacheStats() : m_capacity(0), m_entryCount(0), m_hitCount(0), m_missCount(0) {}
+};
+
+/** @brief Symbol engine prewarm progress counters. */
+struct DBGUTIL_API SymbolPrewarmProgress {
+    /** @brief The number of modules selected for prewarming. */
+    uint32_t m_moduleCount;
+
+    /** @brief The number of modules prepared so far (including modules that were ready). */
+    uint32_t m_preparedCount;
+
+    /** @brief Specifies whether prewarming is currently in progress. */
+    bool m_inProgress;
+
+    SymbolPrewarmProgress() : m_moduleCount(0), m_preparedCount(0), m_inProgress(false) {}
+};
+
 /** @class Symbol info visitor for traversing symbols. */
 class DBGUTIL_API SymbolInfoVisitor {
 public:
@@ -112,9 +230,55 @@ public:
      * @brief Retrieves symbol debug information by symbol address (platform independent API).
      * @param symAddress The symbol address.
      * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail.
      * @return Operation's result.
      */
-    virtual DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo) = 0;
+    virtual DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo,
+                                     SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) = 0;
+
+    /**
+     * @brief Retrieves symbol debug information for a batch of addresses (platform independent
+     * API). This is considerably faster than calling @ref getSymbolInfo() for each address, when
+     * many addresses are involved (e.g. when resolving stack traces of all threads), since
+     * addresses are deduplicated and grouped by module and compilation unit before being resolved.
+     * @param addrs The symbol addresses.
+     * @param count The number of addresses.
+     * @param[out] symbolInfos The resulting symbol information array. Must have room for at least
+     * count default constructed entries. Addresses that could not be resolved are left partially
+     * or entirely empty.
+     * @param detail The required level of detail.
+     * @return DbgUtilErr The operation result. Failure to resolve a single address is not
+     * considered an error.
+     */
+    virtual DbgUtilErr getSymbolInfoBatch(const void* const* addrs, size_t count,
+                                          SymbolInfo* symbolInfos,
+                                          SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
+
+    /**
+     * @brief Retrieves compact symbol debug information by symbol address (platform independent
+     * API). Once the containing module is loaded, this call does not allocate heap memory.
+     * @param symAddress The symbol address.
+     * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail.
+     * @return Operation's result.
+     */
+    virtual DbgUtilErr getSymbolInfoRef(void* symAddress, SymbolInfoRef& symbolInfo,
+                                        SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
+
+    /**
+     * @brief Retrieves compact symbol debug information for a batch of addresses (platform
+     * independent API). This is the compact variant of @ref getSymbolInfoBatch().
+     * @param addrs The symbol addresses.
+     * @param count The number of addresses.
+     * @param[out] symbolInfos The resulting symbol information array. Must have room for at least
+     * count default constructed entries.
+     * @param detail The required level of detail.
+     * @return DbgUtilErr The operation result. Failure to resolve a single address is not
+     * considered an error.
+     */
+    virtual DbgUtilErr getSymbolInfoRefBatch(const void* const* addrs, size_t count,
+                                             SymbolInfoRef* symbolInfos,
+                                             SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
 
     /**
      * @brief Retrieves symbol debug information by symbol name (platform independent API).
@@ -136,6 +300,7 @@ public:
      * @param moduleNameRegex Regular expression for limiting the searched modules.
      * @param[out] symbolInfoList The resulting list of matching symbol information.
      * @param maxSymbolCount Optional limit on number of modules to return.
+     * @param detail The required level of detail of each resulting symbol.
      * @return Operation's result.
      *
      * @note Unless the module regular expression is specified, this call will cause all modules to
@@ -144,16 +309,58 @@ public:
      */
     virtual DbgUtilErr searchSymbols(const char* symbolRegex, const char* moduleNameRegex,
                                      std::list<SymbolInfo>& symbolInfoList,
-                                     size_t maxSymbolCount = SIZE_MAX);
+                                     size_t maxSymbolCount = SIZE_MAX,
+                                     SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
 
     /**
      * @brief Traverses all symbols having a name that matches a regular expression. This variant
-     * can be used if @ref searchSymbols() may yield too many symbols at once.
+     * can be used if @ref searchSymbols() may yield too many symbols at once. Both mangled and
+     * demangled names are matched. Regular expressions that consist only of literals, "." and ".*"
+     * are evaluated without std::regex, and any literal prefix (e.g. "ns::Class::.*") is looked up
+     * in a sorted name index, so such searches are much faster than arbitrary expressions.
+     * @param symbolRegex Regular expression for selecting symbols by name.
+     * @param moduleNameRegex Regular expression for limiting the searched modules (null denotes
+     * all modules).
      * @param visitor The thread visitor.
+     * @param detail The required level of detail of each visited symbol. Listing symbols by name
+     * only (without @ref DBGUTIL_SYMBOL_DETAIL_FILE_LINE) is considerably faster.
      * @return The operation result.
      */
     virtual DbgUtilErr visitSymbols(const char* symbolRegex, const char* moduleNameRegex,
-                                    SymbolInfoVisitor* visitor) = 0;
+                                    SymbolInfoVisitor* visitor,
+                                    SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) = 0;
+
+    /**
+     * @brief Retrieves symbol lookup result cache statistics. The cache is enabled by passing
+     * @ref DBGUTIL_CACHE_SYMBOLS to @ref initDbgUtil().
+     * @param[out] stats The cache statistics.
+     * @return DbgUtilErr The operation result. If the symbol cache is not enabled, then
+     * DBGUTIL_ERR_INVALID_STATE is returned. If the symbol engine does not support caching, then
+     * DBGUTIL_ERR_NOT_IMPLEMENTED is returned.
+     */
+    virtual DbgUtilErr getSymbolCacheStats(SymbolCacheStats& stats);
+
+    /**
+     * @brief Prepares symbol data of loaded modules ahead of time, so that the first symbol lookup
+     * in each module (typically when reporting a crash or an error) does not have to parse the
+     * module image and debug information.
+     * @param moduleRegex Regular expression for limiting the prepared modules. Pass null or empty
+     * string to prepare all loaded modules.
+     * @param threads The number of worker threads to use. Pass zero to select a default.
+     * @param async Specifies whether to return immediately and prepare modules in the background.
+     * @return A future holding the prewarm operation result, which is ready when all selected
+     * modules have been prepared. If prewarming is already in progress, then the resulting
+     * future holds DBGUTIL_ERR_RESOURCE_BUSY. If the symbol engine does not support prewarming,
+     * then the resulting future holds DBGUTIL_ERR_NOT_IMPLEMENTED.
+     */
+    virtual std::shared_future<DbgUtilErr> prewarm(const char* moduleRegex, unsigned threads,
+                                                   bool async);
+
+    /**
+     * @brief Retrieves the progress of the last (or current) prewarm operation.
+     * @param[out] progress The prewarm progress counters.
+     */
+    virtual void getPrewarmProgress(SymbolPrewarmProgress& progress);
 
 protected:
     OsSymbolEngine() {}
@@ -162,9 +369,39 @@ protected:
 /** @brief Retrieves the installed symbol engine implementation. */
 extern DBGUTIL_API OsSymbolEngine* getSymbolEngine();
 
+/**
+ * @brief Configures the memory budget of the decoded line program cache (DWARF only). Decoded
+ * line programs are kept per module, and are evicted in least recently used order when the budget
+ * is exceeded. The budget applies to each module separately.
+ * @param budgetBytes The memory budget in bytes. Pass zero to disable line program caching.
+ */
+extern DBGUTIL_API void setLineCacheBudget(size_t budgetBytes);
+
+/**
+ * @brief Prepares symbol data of loaded modules ahead of time (see @ref OsSymbolEngine::prewarm()).
+ * @param moduleRegex Regular expression for limiting the prepared modules (null for all modules).
+ * @param threads The number of worker threads to use. Pass zero to select a default.
+ * @param async Specifies whether to return immediately and prepare modules in the background.
+ * @return A future holding the prewarm operation result.
+ */
+extern DBGUTIL_API std::shared_future<DbgUtilErr> prewarmSymbolEngine(const char* moduleRegex,
+                                                                      unsigned threads,
+                                                                      bool async);
+
+/**
+ * @brief Configures the directory of the persistent symbol index (Linux only). When configured,
+ * the symbol table, symbol names and compilation unit address ranges of each module having a build
+ * id are written into an index file named after the build id, and on subsequent runs the index file
+ * is mapped into memory instead of parsing the module image again. Index files are written by a
+ * background thread, so symbol lookups do not wait for them.
+ * @param indexDir The index directory (created if missing). Pass null to disable (the default).
+ */
+extern DBGUTIL_API void setSymbolIndexDir(const char* indexDir);
+
 /** @brief Utility API for lambda syntax. */
 template <typename F>
-inline DbgUtilErr forEachSymbol(const char* symbolRegex, const char* moduleNameRegex, F f) {
+inline DbgUtilErr forEachSymbol(const char* symbolRegex, const char* moduleNameRegex, F f,
+                                SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) {
     struct Visitor final : public SymbolInfoVisitor {
         Visitor(F f) : m_f(f) {}
         Visitor() = delete;
@@ -178,7 +415,7 @@ inline DbgUtilErr forEachSymbol(const char* symbolRegex, const char* moduleNameR
         F m_f;
     };
     Visitor visitor(f);
-    return getSymbolEngine()->visitSymbols(symbolRegex, moduleNameRegex, &visitor);
+    return getSymbolEngine()->visitSymbols(symbolRegex, moduleNameRegex, &visitor, detail);
 }
 
 }  // namespace dbgutil
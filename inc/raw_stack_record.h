@@ -0,0 +1,129 @@
+#ifndef __RAW_STACK_RECORD_H__
+#define __RAW_STACK_RECORD_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dbg_util_def.h"
+#include "dbg_util_err.h"
+#include "os_stack_trace.h"
+
+/** @def Module index of a frame that could not be matched with any loaded module. */
+#define DBGUTIL_RAW_FRAME_NO_MODULE ((uint32_t)-1)
+
+namespace dbgutil {
+
+/** @brief A module referenced by a raw stack trace record. */
+struct DBGUTIL_API RawStackModule {
+    /** @var The full module path on disk (on the machine where the stack trace was captured). */
+    std::string m_modulePath;
+
+    /** @var The module build identifier as hex string (empty if there is none). */
+    std::string m_buildId;
+
+    /** @var The load address of the module in the capturing process. */
+    uint64_t m_loadAddress;
+
+    RawStackModule() : m_loadAddress(0) {}
+    RawStackModule(const RawStackModule&) = default;
+    RawStackModule(RawStackModule&&) = default;
+    RawStackModule& operator=(const RawStackModule&) = default;
+    RawStackModule& operator=(RawStackModule&&) = default;
+    ~RawStackModule() {}
+};
+
+/** @brief A single frame of a raw stack trace record. */
+struct DBGUTIL_API RawStackFrame {
+    /**
+     * @var The index of the containing module in the module table of the record, or @ref
+     * DBGUTIL_RAW_FRAME_NO_MODULE if the frame address could not be matched with any module.
+     */
+    uint32_t m_moduleIndex;
+
+    /** @var The frame offset relative to the module load address (or absolute, if no module). */
+    uint64_t m_offset;
+};
+
+/**
+ * @brief A raw stack trace in a self-contained form, suitable for deferred symbolization on another
+ * machine. Frame addresses are kept relative to their containing module, and each module is
+ * identified by its path and build identifier, so that the matching binaries can be located later
+ * (see @ref OfflineSymbolizer). Building a record requires no symbol resolution at all.
+ */
+struct DBGUTIL_API RawStackRecord {
+    /** @var The thread whose stack trace was captured. */
+    os_thread_id_t m_threadId;
+
+    /** @var The module table (only modules referenced by at least one frame). */
+    std::vector<RawStackModule> m_modules;
+
+    /** @var The stack frames (innermost first). */
+    std::vector<RawStackFrame> m_frames;
+
+    RawStackRecord() : m_threadId(0) {}
+    RawStackRecord(const RawStackRecord&) = default;
+    RawStackRecord(RawStackRecord&&) = default;
+    RawStackRecord& operator=(const RawStackRecord&) = default;
+    RawStackRecord& operator=(RawStackRecord&&) = default;
+    ~RawStackRecord() {}
+
+    /** @brief Clears all object members. */
+    inline void clear() {
+        m_threadId = 0;
+        m_modules.clear();
+        m_frames.clear();
+    }
+};
+
+/**
+ * @brief Builds a raw stack trace record from a raw stack trace captured in the current process.
+ * @param rawStackTrace The raw stack trace.
+ * @param[out] record The resulting record.
+ * @param threadId Optional identifier of the thread whose stack trace was captured. If not
+ * specified, the current thread id is used.
+ * @return DbgUtilErr The operation result.
+ */
+extern DBGUTIL_API DbgUtilErr buildRawStackRecord(const RawStackTrace& rawStackTrace,
+                                                  RawStackRecord& record,
+                                                  os_thread_id_t threadId = 0);
+
+/**
+ * @brief Serializes a raw stack trace record in compact binary form. Records may be concatenated
+ * into a single buffer or file, and read back one by one (see @ref deserializeRawStackRecord()).
+ * @param record The record to serialize.
+ * @param[out] buffer The buffer to which the serialized record is appended.
+ * @return DbgUtilErr The operation result.
+ */
+extern DBGUTIL_API DbgUtilErr serializeRawStackRecord(const RawStackRecord& record,
+                                                      std::vector<char>& buffer);
+
+/**
+ * @brief Deserializes a raw stack trace record.
+ * @param buffer The buffer holding the serialized record.
+ * @param length The buffer length.
+ * @param[out] record The resulting record.
+ * @param[out] bytesRead The number of bytes consumed by the record.
+ * @return E_OK If a record was deserialized.
+ * @return E_END_OF_STREAM If the buffer ends before the record does.
+ * @return E_DATA_CORRUPT If the buffer does not contain a valid record.
+ */
+extern DBGUTIL_API DbgUtilErr deserializeRawStackRecord(const char* buffer, size_t length,
+                                                        RawStackRecord& record, size_t& bytesRead);
+
+/**
+ * @brief Builds a raw stack trace record from a raw stack trace captured in the current process,
+ * and serializes it (see @ref buildRawStackRecord() and @ref serializeRawStackRecord()).
+ * @param rawStackTrace The raw stack trace.
+ * @param[out] buffer The buffer to which the serialized record is appended.
+ * @param threadId Optional identifier of the thread whose stack trace was captured. If not
+ * specified, the current thread id is used.
+ * @return DbgUtilErr The operation result.
+ */
+extern DBGUTIL_API DbgUtilErr serializeRawStackTrace(const RawStackTrace& rawStackTrace,
+                                                     std::vector<char>& buffer,
+                                                     os_thread_id_t threadId = 0);
+
+}  // namespace dbgutil
+
+#endif  // __RAW_STACK_RECORD_H__
@@ -0,0 +1,169 @@
+#ifndef __SAMPLING_PROFILER_H__
+#define __SAMPLING_PROFILER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "dbg_stack_trace.h"
+#include "dbg_util_def.h"
+#include "dbg_util_err.h"
+
+/** @def The default sampling rate of the profiler (samples per second of thread CPU time). */
+#define DBGUTIL_PROFILER_DEFAULT_RATE 100
+
+/** @def The default maximum number of frames captured per sample. */
+#define DBGUTIL_PROFILER_DEFAULT_MAX_FRAMES 64
+
+/** @def The default maximum number of concurrently sampled threads. */
+#define DBGUTIL_PROFILER_DEFAULT_MAX_THREADS 256
+
+namespace dbgutil {
+
+// a sampled thread (opaque)
+struct ProfilerThreadSlot;
+
+/** @brief The number of samples taken with a single stack. */
+struct DBGUTIL_API ProfileStackCount {
+    /** @var The stack identifier in the global stack depot (see @ref getStackDepot()). */
+    uint32_t m_stackId;
+
+    /** @var The number of samples taken with this stack. */
+    uint64_t m_sampleCount;
+};
+
+/** @brief A snapshot of the samples aggregated by the profiler. */
+struct DBGUTIL_API ProfileSnapshot {
+    /** @var Sample counts per stack, ordered by descending sample count. */
+    std::vector<ProfileStackCount> m_stacks;
+
+    /** @var The total number of aggregated samples. */
+    uint64_t m_sampleCount;
+
+    /** @var The number of samples lost (sample buffer or stack depot full). */
+    uint64_t m_droppedCount;
+
+    /** @var The number of threads currently being sampled. */
+    uint32_t m_threadCount;
+
+    ProfileSnapshot() : m_sampleCount(0), m_droppedCount(0), m_threadCount(0) {}
+};
+
+/**
+ * @brief An in-process sampling CPU profiler (Linux only). Each thread in the process is sampled
+ * by a timer on its own CPU-time clock, so threads are sampled in proportion to the CPU time they
+ * consume. The timer signal handler captures a raw stack trace of the interrupted thread into a
+ * per-thread lock-free buffer, and a collector thread interns captured stacks in the global stack
+ * depot and aggregates sample counts per stack. Symbolization takes place only when a report is
+ * formatted. Threads created after the profiler is started are picked up by the collector thread
+ * periodically. Stack traces are captured by the stack trace provider, so the
+ * @ref DBGUTIL_FRAME_POINTER_UNWIND and @ref DBGUTIL_BUILTIN_UNWIND flags apply to sampling too.
+ * The profiler uses the SIGPROF signal, so only one profiler instance may run at a time, and it
+ * cannot be used along with other profilers that use this signal.
+ */
+class DBGUTIL_API SamplingProfiler {
+public:
+    SamplingProfiler();
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler(SamplingProfiler&&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    /** @brief Destructor. Stops the profiler if still running. */
+    ~SamplingProfiler();
+
+    /**
+     * @brief Starts sampling all threads in the process.
+     * @param samplingRate The number of samples per second of thread CPU time (up to 10000,
+     * although the effective rate is bounded by the kernel tick rate).
+     * @param maxFrames The maximum number of frames captured per sample.
+     * @param maxThreads The maximum number of concurrently sampled threads (excess threads are not
+     * sampled).
+     * @return E_OK If sampling started.
+     * @return E_INVALID_ARGUMENT If any of the parameters is out of range.
+     * @return E_INVALID_STATE If this or another profiler instance is already running.
+     * @return E_NOT_IMPLEMENTED If sampling is not supported on this platform.
+     * @return DbgUtilErr Any other error code if starting failed.
+     */
+    DbgUtilErr start(uint32_t samplingRate = DBGUTIL_PROFILER_DEFAULT_RATE,
+                     uint32_t maxFrames = DBGUTIL_PROFILER_DEFAULT_MAX_FRAMES,
+                     uint32_t maxThreads = DBGUTIL_PROFILER_DEFAULT_MAX_THREADS);
+
+    /**
+     * @brief Stops sampling. Samples already captured are aggregated before this call returns, and
+     * remain available through @ref getSnapshot() until reset, or until the profiler is started
+     * again.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr stop();
+
+    /** @brief Queries whether the profiler is running. */
+    bool isRunning();
+
+    /**
+     * @brief Retrieves the samples aggregated so far (samples captured during the last collection
+     * period may not be included yet).
+     * @param[out] snapshot The resulting snapshot.
+     * @param reset Specifies whether to reset all sample counts after taking the snapshot.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr getSnapshot(ProfileSnapshot& snapshot, bool reset = false);
+
+    /**
+     * @brief Formats a profile snapshot as a report of the most frequently sampled stacks, each
+     * with its sample count and share of all samples, followed by the resolved stack trace.
+     * @param snapshot The profile snapshot.
+     * @param[out] report The resulting report.
+     * @param maxStacks The maximum number of stacks to report. Pass zero to report all stacks.
+     * @param formatter Optional stack entry formatter. Pass null to use default formatting.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr formatReport(const ProfileSnapshot& snapshot, std::string& report,
+                            uint32_t maxStacks = 0, StackEntryFormatter* formatter = nullptr);
+
+private:
+    // serializes start/stop
+    std::mutex m_stateLock;
+    bool m_running;
+
+    // sampled threads, accessed by the collector thread and by the signal handler
+    ProfilerThreadSlot* m_slots;
+    uint32_t m_maxThreads;
+    uint32_t m_maxFrames;
+    uint64_t m_samplingPeriodNanos;
+    uint32_t m_ringSize;
+    std::unordered_map<os_thread_id_t, uint32_t> m_threadSlotMap;
+    uint32_t m_generation;
+
+    // collector thread
+    std::thread m_collector;
+    os_thread_id_t m_collectorThreadId;
+    bool m_stopRequested;
+
+    // aggregated samples (protected by lock)
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    std::unordered_map<uint32_t, uint64_t> m_stackCounts;
+    uint64_t m_sampleCount;
+    uint64_t m_droppedCount;
+    uint32_t m_threadCount;
+
+    void collectorLoop();
+    void scanThreads();
+    bool startThreadSampling(os_thread_id_t threadId);
+    void stopThreadSampling(uint32_t slotIndex);
+    void collectSamples();
+    void collectSlotSamples(ProfilerThreadSlot& slot);
+    static uint32_t getRingSize(uint32_t samplingRate);
+    void releaseSlots();
+};
+
+/** @brief Retrieves the global sampling profiler (available after @ref initDbgUtil()). */
+extern DBGUTIL_API SamplingProfiler* getSamplingProfiler();
+
+}  // namespace dbgutil
+
+#endif  // __SAMPLING_PROFILER_H__
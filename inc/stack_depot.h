@@ -0,0 +1,160 @@
+#ifndef __STACK_DEPOT_H__
+#define __STACK_DEPOT_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "dbg_util_def.h"
+#include "dbg_util_err.h"
+#include "os_stack_trace.h"
+
+/** @def Stack identifier denoting no stack (returned when a stack could not be stored). */
+#define DBGUTIL_INVALID_STACK_ID ((uint32_t)0)
+
+/** @def The default number of hash buckets in a stack depot. */
+#define DBGUTIL_STACK_DEPOT_DEFAULT_BUCKETS (1u << 16)
+
+/** @def The default maximum number of unique stacks in a stack depot. */
+#define DBGUTIL_STACK_DEPOT_DEFAULT_MAX_STACKS (1u << 20)
+
+namespace dbgutil {
+
+/** @brief Stack depot occupancy statistics. */
+struct DBGUTIL_API StackDepotStats {
+    /** @var The number of unique stacks stored in the depot. */
+    uint64_t m_stackCount;
+
+    /** @var The total number of frames in all unique stacks. */
+    uint64_t m_frameCount;
+
+    /** @var The number of stacks that could not be stored (depot full or out of memory). */
+    uint64_t m_droppedCount;
+
+    /** @var The number of hash buckets. */
+    uint64_t m_bucketCount;
+
+    /** @var The number of non-empty hash buckets. */
+    uint64_t m_usedBucketCount;
+
+    /** @var The length of the longest hash bucket chain. */
+    uint64_t m_maxChainLength;
+
+    /** @var The total size in bytes of memory allocated for the stack arena. */
+    uint64_t m_arenaBytes;
+
+    /** @var The size in bytes of arena memory used by stored stacks. */
+    uint64_t m_usedArenaBytes;
+
+    StackDepotStats()
+        : m_stackCount(0),
+          m_frameCount(0),
+          m_droppedCount(0),
+          m_bucketCount(0),
+          m_usedBucketCount(0),
+          m_maxChainLength(0),
+          m_arenaBytes(0),
+          m_usedArenaBytes(0) {}
+};
+
+/**
+ * @brief A deduplicating store of raw stack traces. Each unique stack is stored once, and is
+ * identified by a stable 32-bit identifier, so that frequently captured stack traces (e.g. on
+ * errors, allocations or lock waits) can be kept as a 4-byte handle rather than as a vector of
+ * frames. Stacks are kept in an append-only arena, and are never removed, so frames returned by
+ * @ref getStack() remain valid as long as the depot exists. The hash table is lock-free: looking up
+ * an existing stack takes no locks and does not allocate memory, and concurrent insertions are
+ * resolved by compare-and-swap on the bucket head. Memory is allocated on first use.
+ */
+class DBGUTIL_API StackDepot {
+public:
+    /**
+     * @brief Constructor.
+     * @param bucketCount The number of hash buckets (rounded up to a power of two).
+     * @param maxStacks The maximum number of unique stacks.
+     */
+    StackDepot(uint32_t bucketCount = DBGUTIL_STACK_DEPOT_DEFAULT_BUCKETS,
+               uint32_t maxStacks = DBGUTIL_STACK_DEPOT_DEFAULT_MAX_STACKS);
+    StackDepot(const StackDepot&) = delete;
+    StackDepot(StackDepot&&) = delete;
+    StackDepot& operator=(const StackDepot&) = delete;
+    ~StackDepot();
+
+    /**
+     * @brief Stores a stack in the depot, unless an identical stack is already stored.
+     * @param frames The stack frame addresses (innermost first).
+     * @param frameCount The number of frames.
+     * @return uint32_t The identifier of the stack, or @ref DBGUTIL_INVALID_STACK_ID if the stack
+     * could not be stored (depot full or out of memory).
+     */
+    uint32_t putStack(void* const* frames, size_t frameCount);
+
+    /**
+     * @brief Stores a raw stack trace in the depot (see @ref putStack()).
+     * @param rawStackTrace The raw stack trace.
+     * @return uint32_t The identifier of the stack, or @ref DBGUTIL_INVALID_STACK_ID.
+     */
+    inline uint32_t putStack(const RawStackTrace& rawStackTrace) {
+        return putStack(rawStackTrace.data(), rawStackTrace.size());
+    }
+
+    /**
+     * @brief Retrieves a stored stack without copying it. Takes no locks.
+     * @param stackId The stack identifier.
+     * @param[out] frames The stored frame addresses (valid as long as the depot exists).
+     * @param[out] frameCount The number of frames.
+     * @return True if the stack was found, otherwise false.
+     */
+    bool getStack(uint32_t stackId, void* const*& frames, size_t& frameCount) const;
+
+    /**
+     * @brief Retrieves a copy of a stored stack.
+     * @param stackId The stack identifier.
+     * @param[out] rawStackTrace The resulting raw stack trace.
+     * @return E_OK If the stack was found.
+     * @return E_NOT_FOUND If no stack with the given identifier is stored.
+     * @return E_NOMEM If the stack could not be copied.
+     */
+    DbgUtilErr getStack(uint32_t stackId, RawStackTrace& rawStackTrace) const;
+
+    /**
+     * @brief Retrieves depot occupancy statistics. This scans the entire hash table, and is
+     * intended for diagnostics only.
+     * @param[out] stats The resulting statistics.
+     */
+    void getStats(StackDepotStats& stats) const;
+
+private:
+    struct StackNode;
+    struct ArenaBlock;
+
+    uint32_t m_bucketCount;
+    uint32_t m_maxStacks;
+    uint32_t m_pageCount;
+
+    std::atomic<bool> m_initialized;
+    std::mutex m_initLock;
+    std::atomic<StackNode*>* m_buckets;
+    std::atomic<std::atomic<StackNode*>*>* m_nodePages;
+    std::atomic<ArenaBlock*> m_currBlock;
+
+    std::atomic<uint32_t> m_nextStackId;
+    std::atomic<uint64_t> m_discardedCount;
+    std::atomic<uint64_t> m_frameCount;
+    std::atomic<uint64_t> m_droppedCount;
+    std::atomic<uint64_t> m_arenaBytes;
+
+    bool ensureInitialized();
+    bool setNode(uint32_t stackId, StackNode* node);
+    const StackNode* getNode(uint32_t stackId) const;
+    StackNode* allocNode(size_t frameCount);
+    void onDropped(const char* reason);
+};
+
+/** @brief Retrieves the global stack depot (available after @ref initDbgUtil()). */
+extern DBGUTIL_API StackDepot* getStackDepot();
+
+}  // namespace dbgutil
+
+#endif  // __STACK_DEPOT_H__
@@ -0,0 +1,200 @@
+#ifndef __SYMBOLIZATION_SERVICE_H__
+#define __SYMBOLIZATION_SERVICE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dbg_stack_trace.h"
+#include "dbg_util_def.h"
+#include "dbg_util_err.h"
+
+/** @def The default number of symbolization worker threads. */
+#define DBGUTIL_SYMBOLIZATION_DEFAULT_THREADS 1
+
+/** @def The default capacity of the symbolization request queue. */
+#define DBGUTIL_SYMBOLIZATION_DEFAULT_QUEUE_SIZE 256
+
+namespace dbgutil {
+
+/** @enum Policy applied when submitting a stack trace while the request queue is full. */
+enum class SymbolizationOverflowPolicy : uint32_t {
+    /** @var The request is dropped, and submission fails with resource limit error. */
+    SOP_DROP,
+
+    /** @var The submitting thread blocks until there is room in the queue. */
+    SOP_BLOCK,
+
+    /** @var The stack trace is symbolized by the submitting thread before submission returns. */
+    SOP_INLINE
+};
+
+/** @brief The result of symbolizing a single raw stack trace. */
+struct DBGUTIL_API SymbolizedStackTrace {
+    /** @var The symbolization result. */
+    DbgUtilErr m_result;
+
+    /** @var The thread whose stack trace was captured (as passed during submission). */
+    os_thread_id_t m_threadId;
+
+    /** @var The resolved stack trace. */
+    StackTrace m_stackTrace;
+
+    /** @var The formatted stack trace (empty if symbolization failed). */
+    std::string m_text;
+
+    SymbolizedStackTrace() : m_result(DBGUTIL_ERR_OK), m_threadId(0) {}
+    SymbolizedStackTrace(const SymbolizedStackTrace&) = default;
+    SymbolizedStackTrace(SymbolizedStackTrace&&) = default;
+    SymbolizedStackTrace& operator=(const SymbolizedStackTrace&) = default;
+    SymbolizedStackTrace& operator=(SymbolizedStackTrace&&) = default;
+    ~SymbolizedStackTrace() {}
+};
+
+/** @brief Listener receiving asynchronously symbolized stack traces. */
+class DBGUTIL_API SymbolizationListener {
+public:
+    virtual ~SymbolizationListener() {}
+
+    /**
+     * @brief Notifies that a submitted stack trace was symbolized. Called by a worker thread of the
+     * symbolization service (or by the submitting thread, if the inline overflow policy is used),
+     * so the implementation must be thread-safe if the service uses several worker threads.
+     * @param result The symbolized stack trace. The listener may move out its contents.
+     */
+    virtual void onStackTraceSymbolized(SymbolizedStackTrace& result) = 0;
+
+protected:
+    SymbolizationListener() {}
+    SymbolizationListener(const SymbolizationListener&) = delete;
+    SymbolizationListener(SymbolizationListener&&) = delete;
+    SymbolizationListener& operator=(SymbolizationListener&) = delete;
+};
+
+/**
+ * @brief Resolves and formats raw stack traces in a small pool of worker threads, so that hot
+ * threads only pay for capturing a raw stack trace (see @ref getRawStackTrace()), while symbol
+ * resolution and formatting take place off the critical path. Submitted stack traces are queued in
+ * a bounded queue, and submitting to a full queue is handled according to the configured overflow
+ * policy. Once the service is started, submission to a listener requires no heap allocation, since
+ * raw stack trace buffers are recycled between the submitting threads and the request queue.
+ */
+class DBGUTIL_API SymbolizationService {
+public:
+    SymbolizationService();
+    SymbolizationService(const SymbolizationService&) = delete;
+    SymbolizationService(SymbolizationService&&) = delete;
+    SymbolizationService& operator=(const SymbolizationService&) = delete;
+
+    /** @brief Destructor. Stops the service if still running. */
+    ~SymbolizationService();
+
+    /**
+     * @brief Starts the symbolization service.
+     * @param threadCount The number of worker threads.
+     * @param queueSize The maximum number of pending requests.
+     * @param overflowPolicy The policy applied when submitting to a full queue.
+     * @param skip Optionally specifies the number of frames to skip (deepest frames) when
+     * formatting.
+     * @param filter Optional stack entry filter used for formatting (must be thread-safe if more
+     * than one worker thread is used). Pass null to format all frames.
+     * @param formatter Optional stack entry formatter (must be thread-safe if more than one worker
+     * thread is used). Pass null to use default formatting.
+     * @param detail The required symbol level of detail.
+     * @return E_OK If the service started.
+     * @return E_INVALID_STATE If the service is running, or is still being stopped.
+     * @return DbgUtilErr Any other error code if starting failed.
+     */
+    DbgUtilErr start(
+        uint32_t threadCount = DBGUTIL_SYMBOLIZATION_DEFAULT_THREADS,
+        uint32_t queueSize = DBGUTIL_SYMBOLIZATION_DEFAULT_QUEUE_SIZE,
+        SymbolizationOverflowPolicy overflowPolicy = SymbolizationOverflowPolicy::SOP_BLOCK,
+        int skip = 0, StackEntryFilter* filter = nullptr, StackEntryFormatter* formatter = nullptr,
+        SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL);
+
+    /**
+     * @brief Stops the symbolization service. All pending requests are processed before the
+     * worker threads exit, and submission is rejected from this point onward.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr stop();
+
+    /**
+     * @brief Submits a raw stack trace for symbolization, to be reported to a listener.
+     * @param rawStackTrace The raw stack trace. Its contents are moved into the request queue, and
+     * it is left empty, possibly with a recycled buffer that can be used for the next capture.
+     * @param listener The listener receiving the symbolized stack trace.
+     * @param threadId Optional identifier of the thread whose stack trace was captured (for
+     * formatting purposes only). If not specified, the submitting thread id is used.
+     * @return E_OK If the request was queued (or processed inline).
+     * @return E_RESOURCE_LIMIT If the queue is full and the drop policy is used.
+     * @return E_INVALID_STATE If the service is not running.
+     */
+    DbgUtilErr submit(RawStackTrace& rawStackTrace, SymbolizationListener* listener,
+                      os_thread_id_t threadId = 0);
+
+    /**
+     * @brief Submits a raw stack trace for symbolization, to be reported through a future.
+     * @param rawStackTrace The raw stack trace (see the listener variant).
+     * @param[out] result The future receiving the symbolized stack trace (valid only if submission
+     * succeeded).
+     * @param threadId Optional identifier of the thread whose stack trace was captured (for
+     * formatting purposes only). If not specified, the submitting thread id is used.
+     * @return DbgUtilErr The operation result (see the listener variant).
+     */
+    DbgUtilErr submit(RawStackTrace& rawStackTrace, std::future<SymbolizedStackTrace>& result,
+                      os_thread_id_t threadId = 0);
+
+    /** @brief Retrieves the number of requests dropped due to queue overflow. */
+    inline uint64_t getDroppedCount() const {
+        return m_droppedCount.load(std::memory_order_relaxed);
+    }
+
+    /** @brief Retrieves the number of requests processed inline due to queue overflow. */
+    inline uint64_t getInlineCount() const { return m_inlineCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Request {
+        RawStackTrace m_rawStackTrace;
+        os_thread_id_t m_threadId;
+        SymbolizationListener* m_listener;
+        std::promise<SymbolizedStackTrace> m_promise;
+        bool m_hasPromise;
+    };
+
+    // bounded request queue (fixed ring buffer of requests, allocated on start)
+    std::vector<Request> m_queue;
+    size_t m_queueHead;
+    size_t m_queueCount;
+    std::mutex m_lock;
+    std::condition_variable m_notEmptyCV;
+    std::condition_variable m_notFullCV;
+    bool m_running;
+    // set by stop() until workers are joined and the queue is cleared (start() is rejected)
+    bool m_stopping;
+
+    std::vector<std::thread> m_workers;
+    SymbolizationOverflowPolicy m_overflowPolicy;
+    int m_skip;
+    StackEntryFilter* m_filter;
+    StackEntryFormatter* m_formatter;
+    SymbolDetail m_detail;
+    std::atomic<uint64_t> m_droppedCount;
+    std::atomic<uint64_t> m_inlineCount;
+
+    DbgUtilErr submitRequest(RawStackTrace& rawStackTrace, os_thread_id_t threadId,
+                             SymbolizationListener* listener,
+                             std::promise<SymbolizedStackTrace>* promise);
+    void symbolize(RawStackTrace& rawStackTrace, os_thread_id_t threadId,
+                   SymbolizationListener* listener, std::promise<SymbolizedStackTrace>* promise);
+    void workerLoop();
+};
+
+}  // namespace dbgutil
+
+#endif  // __SYMBOLIZATION_SERVICE_H__
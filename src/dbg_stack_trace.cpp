@@ -1,5 +1,9 @@
 #include "dbg_stack_trace.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
@@ -18,6 +22,46 @@ namespace dbgutil {
 #define FILE_ALIGN 40
 // #define LIB_ALIGN 30
 
+// size of the stack buffer used for formatting compact stack entries
+#define STACK_ENTRY_BUF_SIZE 1024
+
+// number of compact stack entries resolved in a stack buffer
+#define STACK_ENTRY_REF_BATCH_SIZE 128
+
+bool StackEntryFilter::filterStackEntryRef(const StackEntryRef& stackEntryRef) {
+    StackEntry stackEntry;
+    stackEntryRef.toStackEntry(stackEntry);
+    return filterStackEntry(stackEntry);
+}
+
+size_t StackEntryFormatter::formatStackEntryRef(const StackEntryRef& stackEntryRef, char* buffer,
+                                                size_t bufferSize) {
+    if (bufferSize == 0) {
+        return 0;
+    }
+    StackEntry stackEntry;
+    stackEntryRef.toStackEntry(stackEntry);
+    std::string entry = formatStackEntry(stackEntry);
+    size_t length = std::min(entry.length(), bufferSize - 1);
+    memcpy(buffer, entry.c_str(), length);
+    buffer[length] = 0;
+    return length;
+}
+
+// appends formatted text to a fixed size buffer, silently truncating text that does not fit
+static void appendFormat(char* buffer, size_t bufferSize, size_t& pos, const char* fmt, ...) {
+    if (pos + 1 >= bufferSize) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int res = vsnprintf(buffer + pos, bufferSize - pos, fmt, args);
+    va_end(args);
+    if (res > 0) {
+        pos = std::min(pos + (size_t)res, bufferSize - 1);
+    }
+}
+
 std::string DefaultStackEntryFormatter::formatStackEntry(const StackEntry& stackEntry) {
     // format frame address
     std::stringstream s;
@@ -79,6 +123,62 @@ std::string DefaultStackEntryFormatter::formatStackEntry(const StackEntry& stack
     return s.str();
 }
 
+size_t DefaultStackEntryFormatter::formatStackEntryRef(const StackEntryRef& stackEntry,
+                                                       char* buffer, size_t bufferSize) {
+    // NOTE: output is identical to formatStackEntry(), but no memory is allocated
+    if (bufferSize == 0) {
+        return 0;
+    }
+    buffer[0] = 0;
+    size_t pos = 0;
+
+    // format frame address
+    if (stackEntry.m_frameAddress == nullptr) {
+        appendFormat(buffer, bufferSize, pos, "%*u# 0 ", SYM_ALIGN,
+                     (unsigned)stackEntry.m_frameIndex);
+    } else {
+        appendFormat(buffer, bufferSize, pos, "%*u# 0x%" PRIxPTR " ", SYM_ALIGN,
+                     (unsigned)stackEntry.m_frameIndex, (uintptr_t)stackEntry.m_frameAddress);
+    }
+
+    // format function name if available
+    const SymbolInfoRef& symbolInfo = stackEntry.m_entryInfo;
+    if (*symbolInfo.m_symbolName == 0) {
+        appendFormat(buffer, bufferSize, pos, "%-*s", FILE_ALIGN, "N/A");
+    } else {
+        // strip parameters if found (more readable)
+        size_t startPos = pos;
+        const char* openParen = strchr(symbolInfo.m_symbolName, '(');
+        int nameLength = (openParen != nullptr) ? (int)(openParen - symbolInfo.m_symbolName)
+                                                : (int)strlen(symbolInfo.m_symbolName);
+        appendFormat(buffer, bufferSize, pos, "%.*s()", nameLength, symbolInfo.m_symbolName);
+        if (symbolInfo.m_byteOffset != 0) {
+            appendFormat(buffer, bufferSize, pos, " +%u", (unsigned)symbolInfo.m_byteOffset);
+        }
+        if (pos - startPos < FILE_ALIGN) {
+            appendFormat(buffer, bufferSize, pos, "%*s", (int)(FILE_ALIGN - (pos - startPos)), "");
+        }
+    }
+
+    // format file and line if available
+    if (*symbolInfo.m_fileName == 0) {
+        appendFormat(buffer, bufferSize, pos, " at <N/A> ");
+    } else {
+        appendFormat(buffer, bufferSize, pos, " at %s",
+                     PathParser::getFileNameRef(symbolInfo.m_fileName));
+        if (symbolInfo.m_lineNumber != 0) {
+            appendFormat(buffer, bufferSize, pos, ":%u", (unsigned)symbolInfo.m_lineNumber);
+        }
+    }
+
+    // format module name
+    if (*symbolInfo.m_moduleName != 0) {
+        appendFormat(buffer, bufferSize, pos, " (%s)",
+                     PathParser::getFileNameRef(symbolInfo.m_moduleName));
+    }
+    return pos;
+}
+
 class PrintFrameListener : public StackFrameListener {
 public:
     PrintFrameListener(int skip, StackEntryFilter* filter, StackEntryFormatter* formatter,
@@ -126,14 +226,122 @@ private:
     uint32_t m_frameIndex;
 };
 
-DbgUtilErr resolveRawStackTrace(RawStackTrace& rawStackTrace, StackTrace& stackTrace) {
-    uint32_t frameIndex = 0;
-    for (void* frameAddress : rawStackTrace) {
-        StackEntry stackEntry;
-        stackEntry.m_frameIndex = frameIndex++;
-        stackEntry.m_frameAddress = frameAddress;
-        (void)getSymbolEngine()->getSymbolInfo(frameAddress, stackEntry.m_entryInfo);
-        stackTrace.emplace_back(stackEntry);
+// resolves several raw stack traces with a single batch symbol lookup (skipped frames are not
+// resolved at all), so that frames shared by many stack traces are resolved only once
+static DbgUtilErr resolveRawStackTraces(const std::vector<const RawStackTrace*>& rawStackTraces,
+                                        int skip, std::vector<StackTrace>& stackTraces,
+                                        SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) {
+    size_t skipCount = skip > 0 ? (size_t)skip : 0;
+    std::vector<const void*> addrs;
+    for (const RawStackTrace* rawStackTrace : rawStackTraces) {
+        if (rawStackTrace->size() > skipCount) {
+            addrs.insert(addrs.end(), rawStackTrace->begin() + skipCount, rawStackTrace->end());
+        }
+    }
+
+    std::vector<SymbolInfo> symbolInfos(addrs.size());
+    DbgUtilErr rc = getSymbolEngine()->getSymbolInfoBatch(addrs.data(), addrs.size(),
+                                                          symbolInfos.data(), detail);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    stackTraces.resize(rawStackTraces.size());
+    size_t symbolIndex = 0;
+    for (size_t i = 0; i < rawStackTraces.size(); ++i) {
+        const RawStackTrace& rawStackTrace = *rawStackTraces[i];
+        StackTrace& stackTrace = stackTraces[i];
+        for (size_t j = skipCount; j < rawStackTrace.size(); ++j) {
+            StackEntry stackEntry;
+            stackEntry.m_frameIndex = (uint32_t)(j - skipCount);
+            stackEntry.m_frameAddress = rawStackTrace[j];
+            stackEntry.m_entryInfo = std::move(symbolInfos[symbolIndex++]);
+            stackTrace.emplace_back(std::move(stackEntry));
+        }
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+static void printStackEntries(const StackTrace& stackTrace, int skip, StackEntryFilter* filter,
+                              StackEntryFormatter* formatter, StackEntryPrinter* printer) {
+    for (const StackEntry& stackEntry : stackTrace) {
+        // skip required number of frames
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+
+        // check for special filter
+        if (filter != nullptr && !filter->filterStackEntry(stackEntry)) {
+            continue;
+        }
+
+        std::string entry = formatter->formatStackEntry(stackEntry);
+        printer->onStackEntry(entry.c_str());
+    }
+}
+
+static void printStackEntries(const StackTraceRef& stackTrace, int skip, StackEntryFilter* filter,
+                              StackEntryFormatter* formatter, StackEntryPrinter* printer) {
+    char buffer[STACK_ENTRY_BUF_SIZE];
+    for (const StackEntryRef& stackEntry : stackTrace) {
+        // skip required number of frames
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+
+        // check for special filter
+        if (filter != nullptr && !filter->filterStackEntryRef(stackEntry)) {
+            continue;
+        }
+
+        (void)formatter->formatStackEntryRef(stackEntry, buffer, sizeof(buffer));
+        printer->onStackEntry(buffer);
+    }
+}
+
+DbgUtilErr resolveRawStackTrace(RawStackTrace& rawStackTrace, StackTrace& stackTrace,
+                                SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    std::vector<StackTrace> stackTraces;
+    DbgUtilErr rc = resolveRawStackTraces({&rawStackTrace}, 0, stackTraces, detail);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    for (StackEntry& stackEntry : stackTraces[0]) {
+        stackTrace.emplace_back(std::move(stackEntry));
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr resolveRawStackTrace(const RawStackTrace& rawStackTrace, StackTraceRef& stackTrace,
+                                SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    // resolve directly into the resulting stack trace, so that no intermediate copies take place
+    size_t firstIndex = stackTrace.size();
+    stackTrace.resize(firstIndex + rawStackTrace.size());
+    StackEntryRef* stackEntries = stackTrace.data() + firstIndex;
+    for (size_t i = 0; i < rawStackTrace.size(); ++i) {
+        stackEntries[i].m_frameIndex = (uint32_t)i;
+        stackEntries[i].m_frameAddress = rawStackTrace[i];
+    }
+
+    // resolve into a stack buffer (unless the stack trace is exceptionally deep), since the batch
+    // lookup requires contiguous arrays of addresses and results
+    std::vector<SymbolInfoRef> symbolInfos;
+    SymbolInfoRef symbolInfoBuf[STACK_ENTRY_REF_BATCH_SIZE];
+    SymbolInfoRef* symbolInfoPtr = symbolInfoBuf;
+    if (rawStackTrace.size() > STACK_ENTRY_REF_BATCH_SIZE) {
+        symbolInfos.resize(rawStackTrace.size());
+        symbolInfoPtr = symbolInfos.data();
+    }
+    DbgUtilErr rc = getSymbolEngine()->getSymbolInfoRefBatch(
+        (const void* const*)rawStackTrace.data(), rawStackTrace.size(), symbolInfoPtr, detail);
+    if (rc != DBGUTIL_ERR_OK) {
+        stackTrace.resize(firstIndex);
+        return rc;
+    }
+    for (size_t i = 0; i < rawStackTrace.size(); ++i) {
+        stackEntries[i].m_entryInfo = symbolInfoPtr[i];
     }
     return DBGUTIL_ERR_OK;
 }
@@ -142,6 +350,17 @@ std::string rawStackTraceToString(const RawStackTrace& stackTrace, int skip /* =
                                   StackEntryFilter* filter /* = nullptr */,
                                   StackEntryFormatter* formatter /* = nullptr */,
                                   os_thread_id_t threadId /* = 0 */) {
+    std::vector<StackTrace> stackTraces;
+    if (resolveRawStackTraces({&stackTrace}, skip, stackTraces) != DBGUTIL_ERR_OK) {
+        return "";
+    }
+    return stackTraceToString(stackTraces[0], 0, filter, formatter, threadId);
+}
+
+std::string stackTraceToString(const StackTrace& stackTrace, int skip /* = 0 */,
+                               StackEntryFilter* filter /* = nullptr */,
+                               StackEntryFormatter* formatter /* = nullptr */,
+                               os_thread_id_t threadId /* = 0 */) {
     StringStackEntryPrinter printer;
     DefaultStackEntryFormatter defaultFormatter;
     if (formatter == nullptr) {
@@ -152,20 +371,31 @@ std::string rawStackTraceToString(const RawStackTrace& stackTrace, int skip /* =
         threadId = OsUtil::getCurrentThreadId();
     }
     printer.onBeginStackTrace(threadId);
-    PrintFrameListener listener(skip, filter, formatter, &printer);
-    for (void* frameAddress : stackTrace) {
-        listener.onStackFrame(frameAddress);
-    }
+    printStackEntries(stackTrace, skip, filter, formatter, &printer);
     printer.onEndStackTrace();
     return printer.getStackTrace();
 }
 
-std::string stackTraceToString(const StackTrace& stackTrace, int skip /* = 0 */,
+std::string stackTraceToString(const StackTraceRef& stackTrace, int skip /* = 0 */,
                                StackEntryFilter* filter /* = nullptr */,
                                StackEntryFormatter* formatter /* = nullptr */,
                                os_thread_id_t threadId /* = 0 */) {
     StringStackEntryPrinter printer;
+    printStackTraceRef(stackTrace, skip, filter, formatter, &printer, threadId);
+    return printer.getStackTrace();
+}
+
+void printStackTraceRef(const StackTraceRef& stackTrace, int skip /* = 0 */,
+                        StackEntryFilter* filter /* = nullptr */,
+                        StackEntryFormatter* formatter /* = nullptr */,
+                        StackEntryPrinter* printer /* = nullptr */,
+                        os_thread_id_t threadId /* = 0 */) {
+    // setup defaults if needed
+    StderrStackEntryPrinter defaultPrinter;
     DefaultStackEntryFormatter defaultFormatter;
+    if (printer == nullptr) {
+        printer = &defaultPrinter;
+    }
     if (formatter == nullptr) {
         formatter = &defaultFormatter;
     }
@@ -173,24 +403,9 @@ std::string stackTraceToString(const StackTrace& stackTrace, int skip /* = 0 */,
     if (threadId == 0) {
         threadId = OsUtil::getCurrentThreadId();
     }
-    printer.onBeginStackTrace(threadId);
-    for (const StackEntry& stackEntry : stackTrace) {
-        // skip required number of frames
-        if (skip > 0) {
-            --skip;
-            continue;
-        }
-
-        // check for special filter
-        if (filter != nullptr && !filter->filterStackEntry(stackEntry)) {
-            continue;
-        }
-
-        std::string entry = formatter->formatStackEntry(stackEntry);
-        printer.onStackEntry(entry.c_str());
-    }
-    printer.onEndStackTrace();
-    return printer.getStackTrace();
+    printer->onBeginStackTrace(threadId);
+    printStackEntries(stackTrace, skip, filter, formatter, printer);
+    printer->onEndStackTrace();
 }
 
 void printStackTraceContext(void* context /* = nullptr */, int skip /* = 0 */,
@@ -252,9 +467,19 @@ DbgUtilErr getAppRawStackTrace(AppRawStackTrace& appStackTrace) {
 std::string appRawStackTraceToString(const AppRawStackTrace& appStackTrace, int skip /* = 0 */,
                                      StackEntryFilter* filter /* = nullptr */,
                                      StackEntryFormatter* formatter /* = nullptr */) {
-    std::stringstream res;
+    // resolve all threads at once (most frames are shared among threads)
+    std::vector<const RawStackTrace*> rawStackTraces;
     for (auto& stackTrace : appStackTrace) {
-        res << rawStackTraceToString(stackTrace.second, skip, filter, formatter, stackTrace.first);
+        rawStackTraces.push_back(&stackTrace.second);
+    }
+    std::vector<StackTrace> stackTraces;
+    if (resolveRawStackTraces(rawStackTraces, skip, stackTraces) != DBGUTIL_ERR_OK) {
+        return "";
+    }
+
+    std::stringstream res;
+    for (size_t i = 0; i < appStackTrace.size(); ++i) {
+        res << stackTraceToString(stackTraces[i], 0, filter, formatter, appStackTrace[i].first);
         res << std::endl;
     }
     return res.str();
@@ -265,6 +490,16 @@ void printAppStackTrace(int skip /* = 0 */, StackEntryFilter* filter /* = nullpt
                         StackEntryPrinter* printer /* = nullptr */) {
     AppRawStackTrace appStackTrace;
     if (getAppRawStackTrace(appStackTrace) == DBGUTIL_ERR_OK) {
+        // resolve all threads at once (most frames are shared among threads)
+        std::vector<const RawStackTrace*> rawStackTraces;
+        for (auto& stackTrace : appStackTrace) {
+            rawStackTraces.push_back(&stackTrace.second);
+        }
+        std::vector<StackTrace> stackTraces;
+        if (resolveRawStackTraces(rawStackTraces, skip, stackTraces) != DBGUTIL_ERR_OK) {
+            return;
+        }
+
         // setup defaults if needed
         StderrStackEntryPrinter defaultPrinter;
         DefaultStackEntryFormatter defaultFormatter;
@@ -275,12 +510,9 @@ void printAppStackTrace(int skip /* = 0 */, StackEntryFilter* filter /* = nullpt
             formatter = &defaultFormatter;
         }
 
-        for (auto& stackTrace : appStackTrace) {
-            printer->onBeginStackTrace(stackTrace.first);
-            PrintFrameListener listener(skip, filter, formatter, printer);
-            for (void* frame : stackTrace.second) {
-                listener.onStackFrame(frame);
-            }
+        for (size_t i = 0; i < appStackTrace.size(); ++i) {
+            printer->onBeginStackTrace(appStackTrace[i].first);
+            printStackEntries(stackTraces[i], 0, filter, formatter, printer);
             printer->onEndStackTrace();
         }
     }
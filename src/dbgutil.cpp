@@ -19,6 +19,7 @@
 #include "win32_symbol_engine.h"
 #include "win32_thread_manager.h"
 #else
+#include "dwarf_unwinder.h"
 #include "elf_reader.h"
 #include "linux_exception_handler.h"
 #include "linux_life_sign_manager.h"
@@ -35,9 +36,15 @@
 #include "dwarf_line_util.h"
 #include "dwarf_util.h"
 #include "elf_reader.h"
+#include "module_symbol_data.h"
+#include "offline_symbolizer_internal.h"
 #include "os_image_reader.h"
 #include "os_util.h"
 #include "path_parser.h"
+#include "sampling_profiler_internal.h"
+#include "stack_depot_internal.h"
+#include "symbol_index.h"
+#include "symbolization_service_internal.h"
 #include "win32_pe_reader.h"
 
 namespace dbgutil {
@@ -91,8 +98,14 @@ DbgUtilErr initDbgUtil(OsExceptionListener* exceptionListener /* = nullptr */,
     DirScanner::initLogger();
     DwarfLineUtil::initLogger();
     DwarfUtil::initLogger();
+    ModuleSymbolData::initLogger();
     OsImageReader::initLogger();
     OsUtil::initLogger();
+    SymbolIndex::initLogger();
+    EXEC_CHECK_OP(initSymbolizationService);
+    EXEC_CHECK_OP(initOfflineSymbolizer);
+    EXEC_CHECK_OP(initStackDepot);
+    EXEC_CHECK_OP(initSamplingProfiler);
 
     sIsInitialized = true;
     return DBGUTIL_ERR_OK;
@@ -107,8 +120,14 @@ DbgUtilErr termDbgUtil() {
     DirScanner::termLogger();
     DwarfLineUtil::termLogger();
     DwarfUtil::termLogger();
+    ModuleSymbolData::termLogger();
     OsImageReader::termLogger();
     OsUtil::termLogger();
+    SymbolIndex::termLogger();
+    EXEC_CHECK_OP(termSymbolizationService);
+    EXEC_CHECK_OP(termOfflineSymbolizer);
+    EXEC_CHECK_OP(termSamplingProfiler);
+    EXEC_CHECK_OP(termStackDepot);
 
 #ifndef DBGUTIL_MSVC
     EXEC_CHECK_OP(termLinuxDbgUtil);
@@ -148,6 +167,9 @@ DbgUtilErr initLinuxDbgUtil() {
 #endif
     EXEC_CHECK_OP(initLinuxSymbolEngine);
     EXEC_CHECK_OP(initLinuxThreadManager);
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    EXEC_CHECK_OP(initDwarfUnwinder);
+#endif
     EXEC_CHECK_OP(initLinuxStackTrace);
 #ifdef DBGUTIL_LINUX
     EXEC_CHECK_OP(initElfReader);
@@ -177,6 +199,9 @@ DbgUtilErr termLinuxDbgUtil() {
     EXEC_CHECK_OP(termElfReader);
 #endif
     EXEC_CHECK_OP(termLinuxStackTrace);
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    EXEC_CHECK_OP(termDwarfUnwinder);
+#endif
     EXEC_CHECK_OP(termLinuxThreadManager);
     EXEC_CHECK_OP(termLinuxSymbolEngine);
 #ifdef DBGUTIL_LINUX
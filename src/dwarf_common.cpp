@@ -7,11 +7,11 @@ namespace dbgutil {
 DbgUtilErr dwarfReadInitialLength(InputStream& is, uint64_t& len, bool& is64Bit) {
     uint32_t lenPrefix = 0;
     DBGUTIL_DESERIALIZE_INT32(is, lenPrefix);
-    if (len < 0xffffff00) {
+    if (lenPrefix < 0xfffffff0) {
         len = lenPrefix;
         is64Bit = false;
     } else {
-        if (len != 0xffffffff) {
+        if (lenPrefix != 0xffffffff) {
             return DBGUTIL_ERR_DATA_CORRUPT;
         }
         DBGUTIL_DESERIALIZE_INT64(is, len);
@@ -97,7 +97,7 @@ DbgUtilErr dwarfReadSLEB128(InputStream& is, int64_t& result) {
 
     // check for sign extension
     if ((shift < size) && signBitSet) {
-        result |= -(1 << shift);
+        result |= (int64_t)(~0ull << shift);
     }
     return DBGUTIL_ERR_OK;
 }
@@ -133,13 +133,17 @@ DbgUtilErr dwarfReadString(InputStream& is, uint64_t form, bool is64Bit, DwarfDa
 }
 
 bool DwarfData::checkDebugSections() {
-    return getSection(".debug_info", m_debugInfo) &&
-           getSection(".debug_aranges", m_debugAddrRanges) &&
-           getSection(".debug_line", m_debugLine) && getSection(".debug_str", m_debugStr) &&
-           getSection(".debug_line_str", m_debugLineStr) &&
-           getSection(".debug_abbrev", m_debugAbbrev) &&
-           getSection(".debug_rnglists",
-                      m_debugRngLists) /*&& getSection(".debug_addr", m_debugAddr)*/;
+    // optional sections (left empty if missing)
+    getSection(".debug_aranges", m_debugAddrRanges);
+    getSection(".debug_str", m_debugStr);
+    getSection(".debug_line_str", m_debugLineStr);
+    getSection(".debug_rnglists", m_debugRngLists);
+    getSection(".debug_addr", m_debugAddr);
+    getSection(".debug_ranges", m_debugRanges);
+
+    // mandatory sections
+    return getSection(".debug_info", m_debugInfo) && getSection(".debug_line", m_debugLine) &&
+           getSection(".debug_abbrev", m_debugAbbrev);
 }
 
 }  // namespace dbgutil
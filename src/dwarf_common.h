@@ -2,6 +2,7 @@
 #define __DWARF_COMMON_H__
 
 #include <unordered_map>
+#include <vector>
 
 #include "dbgutil_common.h"
 #include "input_stream.h"
@@ -28,6 +29,12 @@ public:
         m_sectionMap.insert(SectionMap::value_type(name, section));
     }
 
+    /**
+     * @brief Collects the debug section references required for symbol search.
+     * @note Only .debug_info, .debug_line and .debug_abbrev are mandatory. When .debug_aranges is
+     * missing, the compilation unit address index is built from .debug_info instead.
+     * @return True if all mandatory sections are present.
+     */
     bool checkDebugSections();
 
     inline bool getSection(const char* name, DwarfSection& section) const {
@@ -41,12 +48,14 @@ public:
 
     inline const DwarfSection& getDebugInfo() const { return m_debugInfo; }
     inline const DwarfSection& getDebugAddrRanges() const { return m_debugAddrRanges; }
+    inline bool hasDebugAddrRanges() const { return m_debugAddrRanges.m_size > 0; }
     inline const DwarfSection& getDebugLine() const { return m_debugLine; }
     inline const DwarfSection& getDebugStr() const { return m_debugStr; }
     inline const DwarfSection& getDebugLineStr() const { return m_debugLineStr; }
     inline const DwarfSection& getDebugAbbrev() const { return m_debugAbbrev; }
     inline const DwarfSection& getDebugRngLists() const { return m_debugRngLists; }
-    // inline const DwarfSection& getDebugAddr() const { return m_debugAddr; }
+    inline const DwarfSection& getDebugAddr() const { return m_debugAddr; }
+    inline const DwarfSection& getDebugRanges() const { return m_debugRanges; }
 
 private:
     typedef std::unordered_map<std::string, DwarfSection> SectionMap;
@@ -59,7 +68,8 @@ private:
     DwarfSection m_debugLineStr;
     DwarfSection m_debugAbbrev;
     DwarfSection m_debugRngLists;
-    // DwarfSection m_debugAddr;
+    DwarfSection m_debugAddr;
+    DwarfSection m_debugRanges;
 };
 
 struct DwarfSearchData {
@@ -78,6 +88,35 @@ extern DbgUtilErr dwarfReadSLEB128(InputStream& is, int64_t& result);
 extern DbgUtilErr dwarfReadString(InputStream& is, uint64_t form, bool is64Bit,
                                   DwarfData& dwarfData, std::string& result);
 
+/** @brief Appends an unsigned LEB128 encoded value to a byte buffer. */
+template <typename T>
+inline void dwarfWriteULEB128(std::vector<T>& buffer, uint64_t value) {
+    do {
+        T byte = (T)(value & 0x7F);
+        value >>= 7;
+        if (value != 0) {
+            byte |= (T)0x80;
+        }
+        buffer.push_back(byte);
+    } while (value != 0);
+}
+
+/** @brief Appends a signed LEB128 encoded value to a byte buffer. */
+template <typename T>
+inline void dwarfWriteSLEB128(std::vector<T>& buffer, int64_t value) {
+    bool more = true;
+    while (more) {
+        T byte = (T)(value & 0x7F);
+        value >>= 7;  // arithmetic shift
+        if ((value == 0 && (byte & 0x40) == 0) || (value == -1 && (byte & 0x40) != 0)) {
+            more = false;
+        } else {
+            byte |= (T)0x80;
+        }
+        buffer.push_back(byte);
+    }
+}
+
 #define DWARF_READ_INIT_LEN(is, len, is64Bit)                          \
     {                                                                  \
         DbgUtilErr rcLocal = dwarfReadInitialLength(is, len, is64Bit); \
@@ -0,0 +1,455 @@
+#ifndef __DWARF_CURSOR_H__
+#define __DWARF_CURSOR_H__
+
+#include <cstdint>
+#include <cstring>
+
+#include "dbgutil_common.h"
+#include "dwarf_common.h"
+#include "dwarf_def.h"
+
+#ifdef DBGUTIL_MSVC
+#include <intrin.h>
+#endif
+
+namespace dbgutil {
+
+// the multi-byte LEB128 fast path loads 8 encoded bytes as a single little endian word
+#if defined(DBGUTIL_MSVC) || \
+    (defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+#define DWARF_CURSOR_FAST_LEB128
+#endif
+
+/**
+ * @brief A non-virtual, header-only reader over a DWARF section buffer. Unlike the stream based
+ * DWARF_READ_* macros, each read returns the value directly. Bounds are still checked on every
+ * read, but errors are sticky: once a read fails, all subsequent reads return zero, so callers can
+ * check for errors once per decoded record (via @ref isValid() or @ref getResult()) rather than
+ * once per field. Fixed size values are read in host byte order.
+ */
+class DwarfCursor {
+public:
+    DwarfCursor() : m_start(nullptr), m_pos(nullptr), m_end(nullptr), m_result(DBGUTIL_ERR_OK) {}
+    DwarfCursor(const char* start, uint64_t size)
+        : m_start((const uint8_t*)start),
+          m_pos((const uint8_t*)start),
+          m_end((const uint8_t*)start + size),
+          m_result(DBGUTIL_ERR_OK) {}
+    DwarfCursor(const DwarfCursor&) = default;
+    DwarfCursor(DwarfCursor&&) = delete;
+    DwarfCursor& operator=(const DwarfCursor&) = default;
+    ~DwarfCursor() {}
+
+    /** @brief Queries whether all reads so far succeeded. */
+    inline bool isValid() const { return m_result == DBGUTIL_ERR_OK; }
+
+    /** @brief Retrieves the result of the first failed read (or success). */
+    inline DbgUtilErr getResult() const { return m_result; }
+
+    /** @brief Marks the cursor as failed with the given error. The first error is kept. */
+    inline void fail(DbgUtilErr rc) {
+        if (m_result == DBGUTIL_ERR_OK) {
+            m_result = rc;
+        }
+        m_pos = m_end;
+    }
+
+    /** @brief Retrieves the current offset relative to the start of the buffer. */
+    inline uint64_t getOffset() const { return (uint64_t)(m_pos - m_start); }
+
+    /** @brief Retrieves the number of bytes left to read. */
+    inline uint64_t getBytesLeft() const { return (uint64_t)(m_end - m_pos); }
+
+    /** @brief Queries whether all bytes were read. */
+    inline bool empty() const { return m_pos >= m_end; }
+
+    /** @brief Moves the cursor to the given offset relative to the start of the buffer. */
+    inline void seek(uint64_t offset) {
+        if (offset > (uint64_t)(m_end - m_start)) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+        } else {
+            m_pos = m_start + offset;
+        }
+    }
+
+    /** @brief Skips the given amount of bytes. */
+    inline void skip(uint64_t length) {
+        if (length > getBytesLeft()) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+        } else {
+            m_pos += length;
+        }
+    }
+
+    inline uint8_t readU8() {
+        if (m_pos >= m_end) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+            return 0;
+        }
+        return *m_pos++;
+    }
+
+    inline uint16_t readU16() { return readFixed<uint16_t>(); }
+    inline uint32_t readU32() { return readFixed<uint32_t>(); }
+    inline uint64_t readU64() { return readFixed<uint64_t>(); }
+
+    /** @brief Reads an unsigned LEB128 encoded value. */
+    inline uint64_t readULEB128() {
+        // single byte values are by far the most common case
+        if (m_pos < m_end && *m_pos < 0x80) {
+            return *m_pos++;
+        }
+#ifdef DWARF_CURSOR_FAST_LEB128
+        if (getBytesLeft() >= 8) {
+            uint64_t word = 0;
+            memcpy(&word, m_pos, sizeof(uint64_t));
+            uint64_t stopBits = ~word & 0x8080808080808080ull;
+            if (stopBits != 0) {
+                uint32_t byteCount = (countTrailingZeros(stopBits) >> 3) + 1;
+                m_pos += byteCount;
+                return compactLEB128(word, stopBits);
+            }
+        }
+#endif
+        uint32_t shift = 0;
+        return readLEB128Slow(shift);
+    }
+
+    /** @brief Reads a signed LEB128 encoded value. */
+    inline int64_t readSLEB128() {
+        if (m_pos < m_end && *m_pos < 0x80) {
+            // sign extend from bit 6
+            return ((int64_t)(int8_t)(*m_pos++ << 1)) >> 1;
+        }
+        uint64_t result = 0;
+        uint32_t shift = 0;
+#ifdef DWARF_CURSOR_FAST_LEB128
+        if (getBytesLeft() >= 8) {
+            uint64_t word = 0;
+            memcpy(&word, m_pos, sizeof(uint64_t));
+            uint64_t stopBits = ~word & 0x8080808080808080ull;
+            if (stopBits != 0) {
+                uint32_t byteCount = (countTrailingZeros(stopBits) >> 3) + 1;
+                m_pos += byteCount;
+                result = compactLEB128(word, stopBits);
+                shift = byteCount * 7;
+            }
+        }
+        if (shift == 0) {
+            result = readLEB128Slow(shift);
+        }
+#else
+        result = readLEB128Slow(shift);
+#endif
+        // sign bit is the high order bit of the last 7-bit group
+        if (shift > 0 && shift < 64 && (result & (1ull << (shift - 1))) != 0) {
+            result |= ~0ull << shift;
+        }
+        return (int64_t)result;
+    }
+
+    /** @brief Reads a DWARF initial length field, and determines the DWARF format (32/64 bit). */
+    inline uint64_t readInitialLength(bool& is64Bit) {
+        uint32_t lenPrefix = readU32();
+        if (lenPrefix < 0xfffffff0) {
+            is64Bit = false;
+            return lenPrefix;
+        }
+        if (lenPrefix != 0xffffffff) {
+            // reserved values
+            fail(DBGUTIL_ERR_DATA_CORRUPT);
+            return 0;
+        }
+        is64Bit = true;
+        return readU64();
+    }
+
+    /** @brief Reads a section offset of a 32 or 64 bit DWARF format. */
+    template <bool Is64Bit>
+    inline uint64_t readOffset() {
+        return Is64Bit ? readU64() : readU32();
+    }
+
+    inline uint64_t readOffset(bool is64Bit) {
+        return is64Bit ? readOffset<true>() : readOffset<false>();
+    }
+
+    /** @brief Reads a target address of the given size. */
+    template <unsigned AddressSize>
+    inline uint64_t readAddress() {
+        static_assert(AddressSize == 4 || AddressSize == 8, "Unsupported address size");
+        return AddressSize == 8 ? readU64() : readU32();
+    }
+
+    inline uint64_t readAddress(unsigned addressSize) {
+        if (addressSize == 8) {
+            return readAddress<8>();
+        } else if (addressSize == 4) {
+            return readAddress<4>();
+        }
+        fail(DBGUTIL_ERR_NOT_IMPLEMENTED);
+        return 0;
+    }
+
+    /**
+     * @brief Reads a block of bytes embedded in the buffer.
+     * @return The block start, pointing into the buffer, or null if failed.
+     */
+    inline const char* readBlock(uint64_t length) {
+        if (length > getBytesLeft()) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+            return nullptr;
+        }
+        const char* res = (const char*)m_pos;
+        m_pos += length;
+        return res;
+    }
+
+    /**
+     * @brief Reads a null-terminated string embedded in the buffer.
+     * @return The string, pointing into the buffer, or empty string if failed.
+     */
+    inline const char* readCString() {
+        const uint8_t* nullPos = (const uint8_t*)memchr(m_pos, 0, getBytesLeft());
+        if (nullPos == nullptr) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+            return "";
+        }
+        const char* res = (const char*)m_pos;
+        m_pos = nullPos + 1;
+        return res;
+    }
+
+    /**
+     * @brief Reads a string attribute value of the given form (inline, or offset into .debug_str
+     * or .debug_line_str).
+     * @return The string, pointing into the section data, or empty string if failed.
+     */
+    inline const char* readString(uint64_t form, bool is64Bit, const DwarfData& dwarfData) {
+        if (form == DW_FORM_string) {
+            return readCString();
+        }
+        const DwarfSection* section = nullptr;
+        if (form == DW_FORM_strp) {
+            section = &dwarfData.getDebugStr();
+        } else if (form == DW_FORM_line_strp) {
+            section = &dwarfData.getDebugLineStr();
+        } else {
+            fail(DBGUTIL_ERR_NOT_IMPLEMENTED);
+            return "";
+        }
+        uint64_t strOffset = readOffset(is64Bit);
+        if (!isValid()) {
+            return "";
+        }
+        if (strOffset >= section->m_size) {
+            fail(DBGUTIL_ERR_DATA_CORRUPT);
+            return "";
+        }
+        return section->m_start + strOffset;
+    }
+
+    /** @brief Reads an unsigned constant attribute value of the given form. */
+    inline uint64_t readConst(uint64_t form) {
+        switch (form) {
+            case DW_FORM_data1:
+                return readU8();
+            case DW_FORM_data2:
+                return readU16();
+            case DW_FORM_data4:
+                return readU32();
+            case DW_FORM_data8:
+                return readU64();
+            case DW_FORM_udata:
+                return readULEB128();
+            default:
+                fail(DBGUTIL_ERR_NOT_IMPLEMENTED);
+                return 0;
+        }
+    }
+
+    /** @brief Queries whether a form denotes an index into the .debug_addr section. */
+    inline static bool isAddrIndexForm(uint64_t form) {
+        return form == DW_FORM_addrx || (form >= DW_FORM_addrx1 && form <= DW_FORM_addrx4);
+    }
+
+    /** @brief Reads an index into the .debug_addr section, of the given form. */
+    inline uint64_t readAddrIndex(uint64_t form) {
+        switch (form) {
+            case DW_FORM_addrx:
+                return readULEB128();
+            case DW_FORM_addrx1:
+                return readU8();
+            case DW_FORM_addrx2:
+                return readU16();
+            case DW_FORM_addrx3: {
+                uint64_t low = readU16();
+                return low | (((uint64_t)readU8()) << 16);
+            }
+            case DW_FORM_addrx4:
+                return readU32();
+            default:
+                fail(DBGUTIL_ERR_NOT_IMPLEMENTED);
+                return 0;
+        }
+    }
+
+    /**
+     * @brief Skips an attribute value of the given form.
+     * @return True if the form is supported, otherwise false (the cursor is not modified).
+     */
+    inline bool skipForm(uint64_t form, bool is64Bit, unsigned addressSize) {
+        switch (form) {
+            case DW_FORM_flag_present:
+            case DW_FORM_implicit_const:
+                // no data in entry
+                break;
+            case DW_FORM_string:
+                readCString();
+                break;
+            case DW_FORM_data1:
+            case DW_FORM_ref1:
+            case DW_FORM_flag:
+            case DW_FORM_strx1:
+            case DW_FORM_addrx1:
+                skip(1);
+                break;
+            case DW_FORM_data2:
+            case DW_FORM_ref2:
+            case DW_FORM_strx2:
+            case DW_FORM_addrx2:
+                skip(2);
+                break;
+            case DW_FORM_strx3:
+            case DW_FORM_addrx3:
+                skip(3);
+                break;
+            case DW_FORM_data4:
+            case DW_FORM_ref4:
+            case DW_FORM_ref_sup4:
+            case DW_FORM_strx4:
+            case DW_FORM_addrx4:
+                skip(4);
+                break;
+            case DW_FORM_data8:
+            case DW_FORM_ref8:
+            case DW_FORM_ref_sig8:
+            case DW_FORM_ref_sup8:
+                skip(8);
+                break;
+            case DW_FORM_data16:
+                skip(16);
+                break;
+            case DW_FORM_strp:
+            case DW_FORM_line_strp:
+            case DW_FORM_sec_offset:
+            case DW_FORM_ref_addr:
+            case DW_FORM_strp_sup:
+                skip(is64Bit ? 8 : 4);
+                break;
+            case DW_FORM_addr:
+                skip(addressSize);
+                break;
+            case DW_FORM_udata:
+            case DW_FORM_ref_udata:
+            case DW_FORM_strx:
+            case DW_FORM_addrx:
+            case DW_FORM_loclistx:
+            case DW_FORM_rnglistx:
+                readULEB128();
+                break;
+            case DW_FORM_sdata:
+                readSLEB128();
+                break;
+            case DW_FORM_block1:
+                skip(readU8());
+                break;
+            case DW_FORM_block2:
+                skip(readU16());
+                break;
+            case DW_FORM_block4:
+                skip(readU32());
+                break;
+            case DW_FORM_block:
+            case DW_FORM_exprloc:
+                skip(readULEB128());
+                break;
+            case DW_FORM_indirect: {
+                // actual form precedes the value
+                DwarfCursor saved = *this;
+                if (!skipForm(readULEB128(), is64Bit, addressSize)) {
+                    *this = saved;
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* m_start;
+    const uint8_t* m_pos;
+    const uint8_t* m_end;
+    DbgUtilErr m_result;
+
+    template <typename T>
+    inline T readFixed() {
+        if (getBytesLeft() < sizeof(T)) {
+            fail(DBGUTIL_ERR_END_OF_STREAM);
+            return 0;
+        }
+        T value;
+        memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    inline uint64_t readLEB128Slow(uint32_t& shift) {
+        uint64_t result = 0;
+        for (;;) {
+            if (m_pos >= m_end) {
+                fail(DBGUTIL_ERR_END_OF_STREAM);
+                return 0;
+            }
+            uint8_t byte = *m_pos++;
+            // bits beyond 64 bit are silently dropped
+            if (shift < 64) {
+                result |= ((uint64_t)(byte & 0x7F)) << shift;
+            }
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                return result;
+            }
+        }
+    }
+
+#ifdef DWARF_CURSOR_FAST_LEB128
+    inline static uint32_t countTrailingZeros(uint64_t value) {
+#ifdef DBGUTIL_MSVC
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return (uint32_t)index;
+#else
+        return (uint32_t)__builtin_ctzll(value);
+#endif
+    }
+
+    // compacts up to 8 encoded 7-bit groups (terminated by the lowest stop bit) into a value
+    inline static uint64_t compactLEB128(uint64_t word, uint64_t stopBits) {
+        // keep only the encoded bytes (all bits up to and including the lowest stop bit)
+        word &= (stopBits ^ (stopBits - 1)) & 0x7F7F7F7F7F7F7F7Full;
+        // merge adjacent groups: 7 bits in 8 -> 14 bits in 16 -> 28 bits in 32 -> 56 bits
+        word = (word & 0x007F007F007F007Full) | ((word & 0x7F007F007F007F00ull) >> 1);
+        word = (word & 0x00003FFF00003FFFull) | ((word & 0x3FFF00003FFF0000ull) >> 2);
+        word = (word & 0x000000000FFFFFFFull) | ((word & 0x0FFFFFFF00000000ull) >> 4);
+        return word;
+    }
+#endif
+};
+
+}  // namespace dbgutil
+
+#endif  // __DWARF_CURSOR_H__
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cinttypes>
 #include <climits>
+#include <new>
 #include <iomanip>
 #include <sstream>
 
@@ -14,6 +15,9 @@ namespace dbgutil {
 
 static Logger sLogger;
 
+// estimated average size in bytes of a compressed line table row
+#define DBGUTIL_LINE_ROW_EST_SIZE 5
+
 void DwarfLineUtil::initLogger() { registerLogger(sLogger, "dwarf_line_util"); }
 void DwarfLineUtil::termLogger() { unregisterLogger(sLogger); }
 
@@ -24,13 +28,37 @@ std::string DwarfLineStateMachine::toString() const {
     return s.str();
 }
 
-DwarfLineUtil::DwarfLineUtil() {}
+DwarfLineUtil::DwarfLineUtil()
+    : m_addressSize(0),
+      m_minInstLen(0),
+      m_maxOpsPerInst(0),
+      m_defaultIsStmt(0),
+      m_lineBase(0),
+      m_lineRange(0),
+      m_opCodeBase(0),
+      m_startProgramOffset(0),
+      m_endProgramOffset(0),
+      m_lineProgram(nullptr),
+      m_rowCount(0),
+      m_lineMatrix(nullptr),
+      m_seqStartOffset(0),
+      m_seqLowAddress(0),
+      m_seqRowCount(0) {}
+
+DwarfLineUtil::~DwarfLineUtil() {
+    if (m_sequenceRows) {
+        for (size_t i = 0; i < m_sequences.size(); ++i) {
+            delete m_sequenceRows[i].load(std::memory_order_relaxed);
+        }
+    }
+}
 
 DbgUtilErr DwarfLineUtil::getLineInfo(DwarfData& dwarfData, const DwarfSearchData& searchData,
-                                      FixedInputStream& is, SymbolInfo& symbolInfo) {
-    // build line matrix on-demand
-    if (m_lineMatrix.empty()) {
-        DbgUtilErr rc = buildLineMatrix(dwarfData, is);
+                                      FixedInputStream& is, uint8_t defaultAddressSize,
+                                      SymbolInfo& symbolInfo) {
+    // build sequence index on-demand
+    if (m_lineProgram == nullptr) {
+        DbgUtilErr rc = buildLineMatrix(dwarfData, is, defaultAddressSize);
         if (rc != DBGUTIL_ERR_OK) {
             return rc;
         }
@@ -40,81 +68,290 @@ DbgUtilErr DwarfLineUtil::getLineInfo(DwarfData& dwarfData, const DwarfSearchDat
     return searchLineMatrix(searchData, symbolInfo);
 }
 
-DbgUtilErr DwarfLineUtil::buildLineMatrix(DwarfData& dwarfData, FixedInputStream& is) {
-    DbgUtilErr rc = readHeader(is, dwarfData);
+DbgUtilErr DwarfLineUtil::buildLineMatrix(DwarfData& dwarfData, FixedInputStream& is,
+                                          uint8_t defaultAddressSize) {
+    DbgUtilErr rc = readHeader(is, dwarfData, defaultAddressSize);
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
     }
 
+    // the line program is decoded directly from the section buffer
+    uint64_t offset = is.getOffset();
+    if (offset > m_startProgramOffset) {
+        // exceeded expected start of program line offset
+        return DBGUTIL_ERR_INTERNAL_ERROR;
+    }
+    uint64_t streamSize = offset + is.size();
+    if (m_endProgramOffset > streamSize) {
+        LOG_ERROR(sLogger, "Line program end offset %" PRIu64 " exceeds section bounds",
+                  m_endProgramOffset);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    if (m_addressSize != 8 && m_addressSize != 4) {
+        LOG_DEBUG(sLogger, "ERROR: Line program address size %u not supported",
+                  (unsigned)m_addressSize);
+        return DBGUTIL_ERR_NOT_IMPLEMENTED;
+    }
+    DwarfCursor cursor(is.getBuffer(), m_endProgramOffset);
+    cursor.seek(m_startProgramOffset);
+
+    // first pass: scan the entire program, but only record sequence bounds, without keeping rows
+    m_seqStartOffset = m_startProgramOffset;
+    m_seqLowAddress = 0;
+    m_seqRowCount = 0;
     m_stateMachine.reset(m_defaultIsStmt ? true : false);
-    return execLineProgram(is);
+    rc = execLineProgram(cursor, false);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    // sequences are searched by address
+    std::sort(m_sequences.begin(), m_sequences.end());
+    m_sequences.shrink_to_fit();
+    m_sequenceRows.reset(new (std::nothrow) std::atomic<LineTable*>[m_sequences.size()]);
+    if (!m_sequenceRows) {
+        LOG_ERROR(sLogger, "Failed to allocate line sequence table, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    for (size_t i = 0; i < m_sequences.size(); ++i) {
+        m_sequenceRows[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_lineProgram = is.getBuffer();
+    LOG_DEBUG(sLogger, "Line program contains %zu sequences, %" PRIu64 " rows",
+              m_sequences.size(), m_rowCount);
+    return DBGUTIL_ERR_OK;
+}
+
+size_t DwarfLineUtil::getMemoryUsage() const {
+    size_t memoryUsage = sizeof(DwarfLineUtil);
+    memoryUsage += m_stdOpsLen.capacity();
+    memoryUsage += m_sequences.capacity() * (sizeof(LineSequence) + sizeof(void*));
+    // each compressed row takes a few bytes (typically 4-5), and each block adds a head
+    size_t blockCount = m_sequences.size() + m_rowCount / DBGUTIL_LINE_BLOCK_ROWS;
+    memoryUsage += m_sequences.size() * sizeof(LineTable) + blockCount * sizeof(LineBlock) +
+                   m_rowCount * DBGUTIL_LINE_ROW_EST_SIZE;
+    memoryUsage += m_dirs.capacity() * sizeof(std::string);
+    for (const std::string& dir : m_dirs) {
+        memoryUsage += dir.capacity();
+    }
+    memoryUsage += m_files.capacity() * sizeof(FileInfo);
+    for (const FileInfo& fileInfo : m_files) {
+        memoryUsage += fileInfo.m_name.capacity() + fileInfo.m_path.capacity();
+    }
+    return memoryUsage;
 }
 
 DbgUtilErr DwarfLineUtil::searchLineMatrix(const DwarfSearchData& searchData,
                                            SymbolInfo& symbolInfo) {
-    // search relocated address (translated to debug info base) line in matrix
-    // NOTE: we search for the first entry whose address >= search address, special care required,
-    // see below for more explanation
-    LOG_DEBUG(sLogger, "Searching for relocated address %p", (void*)searchData.m_relocatedAddress)
-    LineMatrix::iterator itr =
-        std::lower_bound(m_lineMatrix.begin(), m_lineMatrix.end(), searchData.m_relocatedAddress,
-                         [](const LineInfo& lineInfo, uint64_t relocSymAddr) {
-                             return lineInfo.m_address < relocSymAddr;
-                         });
+    const char* filePath = nullptr;
+    DbgUtilErr rc = findLineInfo(searchData.m_relocatedAddress, filePath, symbolInfo.m_lineNumber,
+                                 symbolInfo.m_columnIndex);
+    if (rc == DBGUTIL_ERR_OK) {
+        symbolInfo.m_fileName = filePath;
+    }
+    return rc;
+}
 
-    // NOTE: we get the first iterator for which the predicate is false, or end(),
-    // so end() means all addresses are less than searched address.
-    if (itr == m_lineMatrix.end()) {
+DbgUtilErr DwarfLineUtil::findLineInfo(uint64_t relocSymAddr, const char*& filePath,
+                                       uint32_t& lineNumber, uint32_t& columnIndex) {
+    // find the sequence containing the relocated address (last sequence starting at or before it)
+    LOG_DEBUG(sLogger, "Searching for relocated address %p", (void*)relocSymAddr)
+    std::vector<LineSequence>::const_iterator seqItr = std::upper_bound(
+        m_sequences.begin(), m_sequences.end(), relocSymAddr,
+        [](uint64_t searchAddr, const LineSequence& sequence) {
+            return searchAddr < sequence.m_lowAddress;
+        });
+    if (seqItr == m_sequences.begin()) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    --seqItr;
+    if (relocSymAddr >= seqItr->m_highAddress) {
         return DBGUTIL_ERR_NOT_FOUND;
     }
 
-    // NOTE: since we passed strict less operator "<", then if the last address equals the searched
-    // address, then we would get a valid iterator pointing to the last valid element (not end()).
-    // if we get the begin() iterator it means that either the address equals the first element (so
-    // strict "<" return false), or that the searched address is lower than the first address.
-    // in simpler words: first check that the current iterator points to an address equal to the
-    // searched address, and if so return it, otherwise check for the previous iterator (unless this
-    // is begin iterator), which will definitely return true for "<".
-    bool found = false;
-    if (itr->m_address == searchData.m_relocatedAddress) {
-        found = true;
-    } else if (itr != m_lineMatrix.begin()) {
-        --itr;
-        if (itr->m_address <= searchData.m_relocatedAddress) {
-            found = true;
-        }
+    // decode only the rows of this sequence (if not decoded yet)
+    const LineTable* lineTable = nullptr;
+    DbgUtilErr rc = getSequenceRows(seqItr - m_sequences.begin(), lineTable);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    LineInfo lineInfo = {};
+    rc = searchLineTable(*lineTable, relocSymAddr, lineInfo);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
     }
 
-    if (found) {
-        // at this point it is possible to have several entries with the searched address, so we
-        // prefer to choose the one which has the main file, rather that STL or libstdc stuff
-        LineMatrix::iterator itr2 = itr;
-        while (itr2 != m_lineMatrix.end() && itr2->m_address == itr->m_address &&
-               m_files[itr->m_fileIndex].m_name.compare(m_files[0].m_name) != 0) {
-            ++itr2;
+    // NOTE: symbol start address is extracted from symbol table
+    filePath = m_files[lineInfo.m_fileIndex].m_path.c_str();
+    lineNumber = lineInfo.m_lineNumber;
+    columnIndex = lineInfo.m_columnIndex;
+    LOG_DEBUG(sLogger, "Relocated address %p found at %p, file %s, line %u", (void*)relocSymAddr,
+              (void*)lineInfo.m_address, filePath, lineNumber);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfLineUtil::searchLineTable(const LineTable& lineTable, uint64_t relocSymAddr,
+                                          LineInfo& lineInfo) const {
+    // find the last block starting at or before the searched address
+    std::vector<LineBlock>::const_iterator blockItr =
+        std::upper_bound(lineTable.m_blocks.begin(), lineTable.m_blocks.end(), relocSymAddr,
+                         [](uint64_t searchAddr, const LineBlock& block) {
+                             return searchAddr < block.m_baseAddress;
+                         });
+    if (blockItr == lineTable.m_blocks.begin()) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    --blockItr;
+    size_t dataEnd = (blockItr + 1 == lineTable.m_blocks.end()) ? lineTable.m_data.size()
+                                                                  : (blockItr + 1)->m_dataOffset;
+
+    // decode block rows until passing the searched address
+    // at this point it is possible to have several entries with the searched address, so we
+    // prefer to choose the one which has the main file, rather that STL or libstdc stuff
+    // NOTE: the last row takes precedence, unless it does not point to the main file
+    DwarfCursor cursor((const char*)lineTable.m_data.data(), dataEnd);
+    cursor.seek(blockItr->m_dataOffset);
+    LineInfo row = {blockItr->m_baseAddress, 0, blockItr->m_baseLine, 0, 0};
+    row.m_fileIndex = (uint32_t)cursor.readULEB128();
+    row.m_columnIndex = (uint32_t)cursor.readULEB128();
+    bool isMainFile = false;
+    for (;;) {
+        if (!cursor.isValid() || row.m_fileIndex >= m_files.size()) {
+            LOG_ERROR(sLogger, "Compressed line table is corrupt");
+            return DBGUTIL_ERR_INTERNAL_ERROR;
+        }
+        bool rowIsMainFile = m_files[row.m_fileIndex].m_isMainFile;
+        if (row.m_address != lineInfo.m_address || rowIsMainFile || !isMainFile) {
+            lineInfo = row;
+            isMainFile = rowIsMainFile;
+        }
+        if (cursor.empty()) {
+            break;
         }
-        if (itr2 != m_lineMatrix.end()) {
-            // we found an entry with the same address but pointing to main file of CU, so take it
-            itr = itr2;
+        uint64_t addressDelta = cursor.readULEB128();
+        if (row.m_address + addressDelta > relocSymAddr) {
+            break;
         }
+        row.m_address += addressDelta;
+        row.m_lineNumber += (uint32_t)cursor.readSLEB128();
+        row.m_columnIndex += (uint32_t)cursor.readSLEB128();
+        row.m_fileIndex += (uint32_t)cursor.readSLEB128();
+    }
+    return DBGUTIL_ERR_OK;
+}
 
-        LineInfo& lineInfo = *itr;
-        FileInfo& fileInfo = m_files[lineInfo.m_fileIndex];
-        // NOTE: symbol start address is extracted from symbol table
-        std::string dir = m_dirs[fileInfo.m_dirIndex];
-        symbolInfo.m_fileName = dir + "/" + fileInfo.m_name;
-        symbolInfo.m_lineNumber = lineInfo.m_lineNumber;
-        symbolInfo.m_columnIndex = lineInfo.m_columnIndex;
-        LOG_DEBUG(sLogger, "Relocated address %p found at %p, file %s, line %u",
-                  (void*)searchData.m_relocatedAddress, (void*)lineInfo.m_address,
-                  symbolInfo.m_fileName.c_str(), symbolInfo.m_lineNumber);
+DbgUtilErr DwarfLineUtil::getSequenceRows(size_t seqIndex, const LineTable*& lineTable) {
+    // fast path: sequence already decoded
+    lineTable = m_sequenceRows[seqIndex].load(std::memory_order_acquire);
+    if (lineTable != nullptr) {
         return DBGUTIL_ERR_OK;
     }
 
-    return DBGUTIL_ERR_NOT_FOUND;
+    // decode under lock, since the state machine is shared
+    std::unique_lock<std::mutex> lock(m_decodeLock);
+    lineTable = m_sequenceRows[seqIndex].load(std::memory_order_acquire);
+    if (lineTable != nullptr) {
+        return DBGUTIL_ERR_OK;
+    }
+    LineTable* newLineTable = new (std::nothrow) LineTable();
+    if (newLineTable == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate line sequence rows, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    DbgUtilErr rc = DBGUTIL_ERR_OK;
+    try {
+        // rows are fully decoded first, since they need to be sorted before compression
+        LineMatrix lineMatrix;
+        rc = decodeSequence(m_sequences[seqIndex], lineMatrix);
+        if (rc == DBGUTIL_ERR_OK) {
+            rc = compressLineMatrix(lineMatrix, *newLineTable);
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to decode line sequence rows, out of memory");
+        rc = DBGUTIL_ERR_NOMEM;
+    }
+    m_lineMatrix = nullptr;
+    if (rc != DBGUTIL_ERR_OK) {
+        delete newLineTable;
+        return rc;
+    }
+    m_sequenceRows[seqIndex].store(newLineTable, std::memory_order_release);
+    lineTable = newLineTable;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfLineUtil::compressLineMatrix(const LineMatrix& lineMatrix, LineTable& lineTable) {
+    lineTable.m_blocks.reserve(lineMatrix.size() / DBGUTIL_LINE_BLOCK_ROWS + 1);
+    lineTable.m_data.reserve(lineMatrix.size() * DBGUTIL_LINE_ROW_EST_SIZE);
+    size_t blockRows = 0;
+    const LineInfo* prevRow = nullptr;
+    for (const LineInfo& row : lineMatrix) {
+        if (row.m_fileIndex >= m_files.size()) {
+            LOG_ERROR(sLogger, "Invalid file index %u in line program", row.m_fileIndex);
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        // start a new block when the current one is full, but never split rows of the same address
+        if (prevRow == nullptr ||
+            (blockRows >= DBGUTIL_LINE_BLOCK_ROWS && row.m_address != prevRow->m_address)) {
+            if (lineTable.m_data.size() > UINT32_MAX) {
+                return DBGUTIL_ERR_RESOURCE_LIMIT;
+            }
+            lineTable.m_blocks.push_back(
+                {row.m_address, row.m_lineNumber, (uint32_t)lineTable.m_data.size()});
+            dwarfWriteULEB128(lineTable.m_data, row.m_fileIndex);
+            dwarfWriteULEB128(lineTable.m_data, row.m_columnIndex);
+            blockRows = 1;
+        } else {
+            std::vector<uint8_t>& data = lineTable.m_data;
+            dwarfWriteULEB128(data, row.m_address - prevRow->m_address);
+            dwarfWriteSLEB128(data, (int64_t)row.m_lineNumber - prevRow->m_lineNumber);
+            dwarfWriteSLEB128(data, (int64_t)row.m_columnIndex - prevRow->m_columnIndex);
+            dwarfWriteSLEB128(data, (int64_t)row.m_fileIndex - prevRow->m_fileIndex);
+            ++blockRows;
+        }
+        prevRow = &row;
+    }
+    lineTable.m_blocks.shrink_to_fit();
+    lineTable.m_data.shrink_to_fit();
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfLineUtil::decodeSequence(const LineSequence& sequence, LineMatrix& lineMatrix) {
+    // the state machine is reset at the beginning of each sequence, so decoding can start directly
+    // from the sequence offset
+    DwarfCursor cursor(m_lineProgram, m_endProgramOffset);
+    cursor.seek(sequence.m_startOffset);
+    lineMatrix.reserve(sequence.m_rowCount);
+    m_lineMatrix = &lineMatrix;
+    m_stateMachine.reset(m_defaultIsStmt ? true : false);
+    DbgUtilErr rc = execLineProgram(cursor, true);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    // sort matrix for quick search
+    // NOTE: since a single address may be associated with several files/lines (especially in
+    // release builds), we would like to preserve original order as it appears in the line program,
+    // therefore we use here stable_sort(), rather than sort().
+    std::stable_sort(lineMatrix.begin(), lineMatrix.end());
+
+    // print matrix
+    if (canLog(sLogger, LS_DEBUG)) {
+        LOG_DEBUG(sLogger, "ADDR   LINE FILE");
+        for (uint32_t i = 0; i < lineMatrix.size(); ++i) {
+            LineInfo& li = lineMatrix[i];
+            const char* fileName =
+                li.m_fileIndex < m_files.size() ? m_files[li.m_fileIndex].m_name.c_str() : "";
+            LOG_DEBUG(sLogger, "%0.6p %0.4u %u --> %s", (void*)li.m_address,
+                      (unsigned)li.m_lineNumber, (unsigned)li.m_fileIndex, fileName);
+        }
+    }
+    return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfLineUtil::readHeader(FixedInputStream& is, DwarfData& dwarfData) {
+DbgUtilErr DwarfLineUtil::readHeader(FixedInputStream& is, DwarfData& dwarfData,
+                                     uint8_t defaultAddressSize) {
     uint64_t len = 0;
     bool is64Bit = false;
     DWARF_READ_INIT_LEN(is, len, is64Bit);
@@ -122,21 +359,31 @@ DbgUtilErr DwarfLineUtil::readHeader(FixedInputStream& is, DwarfData& dwarfData)
 
     uint16_t version = 0;
     DBGUTIL_DESERIALIZE_INT16(is, version);
-    if (version != 5) {
+    if (version < 2 || version > 5) {
+        LOG_DEBUG(sLogger, "ERROR: Line program version %u not supported", (unsigned)version);
         return DBGUTIL_ERR_NOT_IMPLEMENTED;
     }
 
-    DBGUTIL_DESERIALIZE_INT8(is, m_addressSize);
-
-    uint8_t segmentSelector = 0;
-    DBGUTIL_DESERIALIZE_INT8(is, segmentSelector);
+    // the address size and segment selector size were added in DWARF 5
+    if (version >= 5) {
+        DBGUTIL_DESERIALIZE_INT8(is, m_addressSize);
+        uint8_t segmentSelector = 0;
+        DBGUTIL_DESERIALIZE_INT8(is, segmentSelector);
+    } else {
+        m_addressSize = defaultAddressSize;
+    }
 
     uint64_t headerLength = 0;
     DWARF_READ_OFFSET(is, headerLength, is64Bit);
     m_startProgramOffset = is.getOffset() + headerLength;
 
+    // maximum operations per instruction was added in DWARF 4
     DBGUTIL_DESERIALIZE_INT8(is, m_minInstLen);
-    DBGUTIL_DESERIALIZE_INT8(is, m_maxOpsPerInst);
+    if (version >= 4) {
+        DBGUTIL_DESERIALIZE_INT8(is, m_maxOpsPerInst);
+    } else {
+        m_maxOpsPerInst = 1;
+    }
     DBGUTIL_DESERIALIZE_INT8(is, m_defaultIsStmt);
     DBGUTIL_DESERIALIZE_INT8(is, m_lineBase);
     DBGUTIL_DESERIALIZE_INT8(is, m_lineRange);
@@ -151,18 +398,32 @@ DbgUtilErr DwarfLineUtil::readHeader(FixedInputStream& is, DwarfData& dwarfData)
     }
 
     // read dir array
-    DbgUtilErr rc = readDirList(is, dwarfData, is64Bit);
+    DbgUtilErr rc = (version >= 5) ? readDirList(is, dwarfData, is64Bit) : readDirListV4(is);
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
     }
-    rc = readFileList(is, dwarfData, is64Bit);
+    rc = (version >= 5) ? readFileList(is, dwarfData, is64Bit) : readFileListV4(is);
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
     }
 
+    buildFilePaths();
     return DBGUTIL_ERR_OK;
 }
 
+void DwarfLineUtil::buildFilePaths() {
+    // full paths are composed once per file, rather than on each search
+    for (FileInfo& fileInfo : m_files) {
+        if (fileInfo.m_dirIndex < m_dirs.size() && !m_dirs[fileInfo.m_dirIndex].empty() &&
+            fileInfo.m_name[0] != '/') {
+            fileInfo.m_path = m_dirs[fileInfo.m_dirIndex] + "/" + fileInfo.m_name;
+        } else {
+            fileInfo.m_path = fileInfo.m_name;
+        }
+        fileInfo.m_isMainFile = (fileInfo.m_name.compare(m_files[0].m_name) == 0);
+    }
+}
+
 DbgUtilErr DwarfLineUtil::readFormatList(FixedInputStream& is,
                                          std::vector<DirEntryFmtDesc>& entryFmt) {
     uint8_t fmtCount = 0;
@@ -294,41 +555,93 @@ DbgUtilErr DwarfLineUtil::readFileList(FixedInputStream& is, DwarfData& dwarfDat
     return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfLineUtil::execLineProgram(FixedInputStream& is) {
-    // skip bytes according to header length
-    uint64_t offset = is.getOffset();
-    if (offset > m_startProgramOffset) {
-        // exceeded expected start of program line offset
-        return DBGUTIL_ERR_INTERNAL_ERROR;
+DbgUtilErr DwarfLineUtil::readDirListV4(FixedInputStream& is) {
+    // directory zero is the compilation directory, which is not recorded in the line program
+    // header, so file names in that directory are used as is
+    m_dirs.push_back("");
+
+    // the include directory list is terminated by an empty name
+    for (;;) {
+        std::string name;
+        DBGUTIL_DESERIALIZE_NT_STRING(is, name);
+        if (name.empty()) {
+            break;
+        }
+        LOG_DEBUG(sLogger, "Read line program dir: %s", name.c_str());
+        m_dirs.push_back(name);
     }
-    if (offset < m_startProgramOffset) {
-        size_t bytesSkiped = 0;
-        DbgUtilErr rc = is.skipBytes(m_startProgramOffset - offset, bytesSkiped);
-        if (rc != DBGUTIL_ERR_OK) {
-            return rc;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfLineUtil::readFileListV4(FixedInputStream& is) {
+    // file indices are 1-based prior to DWARF 5, so the first entry is reserved, and later set to
+    // the primary source file, as in DWARF 5
+    m_files.push_back(FileInfo());
+
+    // the file name list is terminated by an empty name
+    for (;;) {
+        std::string name;
+        DBGUTIL_DESERIALIZE_NT_STRING(is, name);
+        if (name.empty()) {
+            break;
         }
-        if (bytesSkiped != (m_startProgramOffset - offset)) {
-            return DBGUTIL_ERR_INTERNAL_ERROR;
+        uint64_t dirIndex = 0;
+        uint64_t timestamp = 0;
+        uint64_t size = 0;
+        DWARF_READ_ULEB128(is, dirIndex);
+        DWARF_READ_ULEB128(is, timestamp);
+        DWARF_READ_ULEB128(is, size);
+        if (dirIndex >= UINT32_MAX) {
+            LOG_ERROR(sLogger, "Invalid directory index %" PRIu64 " in line program", dirIndex);
+            return DBGUTIL_ERR_DATA_CORRUPT;
         }
+        LOG_DEBUG(sLogger, "Read line program file: %s (dir index %u)", name.c_str(),
+                  (unsigned)dirIndex);
+        m_files.push_back(FileInfo(name.c_str(), (uint32_t)dirIndex, timestamp, size));
+    }
+    if (m_files.size() > 1) {
+        m_files[0] = m_files[1];
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfLineUtil::execLineProgram(DwarfCursor& cursor, bool singleSequence) {
+    // address size is fixed for the entire program, so dispatch once
+    if (m_addressSize == 8) {
+        return execLineProgram<8>(cursor, singleSequence);
     }
+    return execLineProgram<4>(cursor, singleSequence);
+}
 
-    // read as many bytes as in unit length
-    while (is.getOffset() < m_endProgramOffset) {
+template <unsigned AddressSize>
+DbgUtilErr DwarfLineUtil::execLineProgram(DwarfCursor& cursor, bool singleSequence) {
+    // read until end of unit (cursor is limited to the unit length)
+    // NOTE: cursor errors are sticky (a failed read also exhausts the cursor), so read errors are
+    // checked only once when the loop ends
+    while (!cursor.empty()) {
         // read instruction op-code byte
-        uint8_t opCode = 0;
-        DBGUTIL_DESERIALIZE_INT8(is, opCode);
+        uint8_t opCode = cursor.readU8();
         if (opCode == 0) {
             // extended op-code
-            uint64_t instSizeBytes = 0;
-            DWARF_READ_ULEB128(is, instSizeBytes);
-            DBGUTIL_DESERIALIZE_INT8(is, opCode);
-            DbgUtilErr rc = execExtendedOpCode(opCode, is);
+            cursor.readULEB128();  // instruction size
+            opCode = cursor.readU8();
+            if (!cursor.isValid()) {
+                return cursor.getResult();
+            }
+            DbgUtilErr rc = execExtendedOpCode<AddressSize>(opCode, cursor);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
             }
+            if (opCode == DW_LNE_end_sequence) {
+                // next sequence starts right after this one
+                m_seqStartOffset = cursor.getOffset();
+                if (singleSequence) {
+                    break;
+                }
+            }
         } else if (opCode < m_opCodeBase) {
             // standard op-code
-            DbgUtilErr rc = execStandardOpCode(opCode, is);
+            DbgUtilErr rc = execStandardOpCode(opCode, cursor);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
             }
@@ -338,34 +651,38 @@ DbgUtilErr DwarfLineUtil::execLineProgram(FixedInputStream& is) {
         }
         LOG_DEBUG(sLogger, "%s", m_stateMachine.toString().c_str());
     }
-
-    // sort matrix for quick search
-    // NOTE: since a single address may be associated with several files/lines (especially in
-    // release builds), we would like to preserve original order as it appears in the line program,
-    // therefore we use here stable_sort(), rather than sort().
-    std::stable_sort(m_lineMatrix.begin(), m_lineMatrix.end());
-
-    // print matrix
-    if (canLog(sLogger, LS_DEBUG)) {
-        LOG_DEBUG(sLogger, "ADDR   LINE FILE");
-        for (uint32_t i = 0; i < m_lineMatrix.size(); ++i) {
-            LineInfo& li = m_lineMatrix[i];
-            const char* fileName =
-                li.m_fileIndex < m_files.size() ? m_files[li.m_fileIndex].m_name.c_str() : "";
-            LOG_DEBUG(sLogger, "%0.6p %0.4u %u --> %s", (void*)li.m_address,
-                      (unsigned)li.m_lineNumber, (unsigned)li.m_fileIndex, fileName);
-        }
+    if (!cursor.isValid()) {
+        return cursor.getResult();
     }
-
     return DBGUTIL_ERR_OK;
 }
 
 void DwarfLineUtil::appendLineMatrix() {
-    m_lineMatrix.push_back({m_stateMachine.m_address, m_stateMachine.m_fileIndex,
-                            m_stateMachine.m_lineNumber, m_stateMachine.m_columnIndex, 0});
+    // when decoding a sequence, rows are kept
+    if (m_lineMatrix != nullptr) {
+        m_lineMatrix->push_back({m_stateMachine.m_address, m_stateMachine.m_fileIndex,
+                                 m_stateMachine.m_lineNumber, m_stateMachine.m_columnIndex, 0});
+        return;
+    }
+
+    // otherwise the program is being scanned, so only sequence bounds are recorded
+    if (m_seqRowCount == 0 || m_stateMachine.m_address < m_seqLowAddress) {
+        m_seqLowAddress = m_stateMachine.m_address;
+    }
+    ++m_seqRowCount;
+    if (m_stateMachine.m_isEndSequence) {
+        // sequences of functions discarded by the linker start at zero, and are useless for search
+        if (m_seqLowAddress != 0 && m_stateMachine.m_address > m_seqLowAddress) {
+            m_sequences.push_back({m_seqLowAddress, m_stateMachine.m_address, m_seqStartOffset,
+                                   m_seqRowCount});
+            m_rowCount += m_seqRowCount;
+        }
+        m_seqLowAddress = 0;
+        m_seqRowCount = 0;
+    }
 }
 
-DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& is) {
+DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, DwarfCursor& cursor) {
     switch (opCode) {
         case DW_LNS_copy:
             // copy row to matrix
@@ -378,8 +695,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
             break;
 
         case DW_LNS_advance_pc: {
-            uint64_t opAdvance = 0;
-            DWARF_READ_ULEB128(is, opAdvance);
+            uint64_t opAdvance = cursor.readULEB128();
             advanceAddress(opAdvance);
             LOG_DEBUG(sLogger, "Executed DW_LNS_advance_pc: %" PRIu64 " --> %s", opAdvance,
                       m_stateMachine.toString().c_str());
@@ -387,8 +703,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
         }
 
         case DW_LNS_advance_line: {
-            int64_t advance = 0;
-            DWARF_READ_SLEB128(is, advance);
+            int64_t advance = cursor.readSLEB128();
             // the advance is never expected to be too large, so we check for bounds
             if (advance >= INT32_MAX || advance <= INT32_MIN) {
                 LOG_ERROR(sLogger, "Invalid line advance value %" PRId64 " in line program",
@@ -417,8 +732,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
         }
 
         case DW_LNS_set_file: {
-            uint64_t fileIndex = 0;
-            DWARF_READ_ULEB128(is, fileIndex);
+            uint64_t fileIndex = cursor.readULEB128();
             LOG_DEBUG(sLogger, "Executed DW_LNS_set_file: %" PRIu64 " --> %s", fileIndex,
                       m_stateMachine.toString().c_str());
             // file index is never expected to be too large
@@ -432,8 +746,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
         }
 
         case DW_LNS_set_column: {
-            uint64_t columnIndex = 0;
-            DWARF_READ_ULEB128(is, columnIndex);
+            uint64_t columnIndex = cursor.readULEB128();
             // file index is never expected to be too large
             if (columnIndex >= UINT32_MAX) {
                 LOG_ERROR(sLogger, "Invalid column index %" PRIu64 " in line program", columnIndex);
@@ -463,8 +776,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
             break;
 
         case DW_LNS_fixed_advance_pc: {
-            uint16_t advance = 0;
-            DBGUTIL_DESERIALIZE_INT16(is, advance);
+            uint16_t advance = cursor.readU16();
             m_stateMachine.m_address += advance;
             m_stateMachine.m_opIndex = 0;
             LOG_DEBUG(sLogger, "Executed DW_LNS_fixed_advance_pc: %u --> %s", (unsigned)advance,
@@ -483,8 +795,7 @@ DbgUtilErr DwarfLineUtil::execStandardOpCode(uint8_t opCode, FixedInputStream& i
             break;
 
         case DW_LNS_set_isa: {
-            uint64_t value = 0;
-            DWARF_READ_ULEB128(is, value);
+            uint64_t value = cursor.readULEB128();
             if (value > UINT_MAX) {
                 return DBGUTIL_ERR_INTERNAL_ERROR;
             }
@@ -559,7 +870,8 @@ void DwarfLineUtil::advanceAddress(uint64_t opAdvance) {
     m_stateMachine.m_opIndex = (m_stateMachine.m_opIndex + opAdvance) % m_maxOpsPerInst;
 }
 
-DbgUtilErr DwarfLineUtil::execExtendedOpCode(uint64_t opCode, FixedInputStream& is) {
+template <unsigned AddressSize>
+DbgUtilErr DwarfLineUtil::execExtendedOpCode(uint64_t opCode, DwarfCursor& cursor) {
     switch (opCode) {
         case DW_LNE_end_sequence:
             m_stateMachine.m_isEndSequence = true;
@@ -571,8 +883,7 @@ DbgUtilErr DwarfLineUtil::execExtendedOpCode(uint64_t opCode, FixedInputStream&
 
         case DW_LNE_set_address: {
             // NOTE: address is relocatable, should check this carefully
-            uint64_t address = 0;
-            DWARF_READ_ADDRESS(is, address, m_addressSize);
+            uint64_t address = cursor.readAddress<AddressSize>();
             m_stateMachine.m_address = address;
             m_stateMachine.m_opIndex = 0;
             LOG_DEBUG(sLogger, "Executed DW_LNE_set_address: %p --> %s", (void*)address,
@@ -581,8 +892,7 @@ DbgUtilErr DwarfLineUtil::execExtendedOpCode(uint64_t opCode, FixedInputStream&
         }
 
         case DW_LNE_set_discriminator: {
-            uint64_t value = 0;
-            DWARF_READ_ULEB128(is, value);
+            uint64_t value = cursor.readULEB128();
             // not sure what range of values is expected here, for now we restrict to uint32_t
             if (value >= UINT32_MAX) {
                 LOG_ERROR(sLogger, "Invalid discriminator value %" PRIu64 " in line program",
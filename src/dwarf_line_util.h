@@ -1,15 +1,22 @@
 #ifndef __DWARF_LINE_UTIL_H__
 #define __DWARF_LINE_UTIL_H__
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "dbgutil_common.h"
 #include "dwarf_common.h"
+#include "dwarf_cursor.h"
 #include "fixed_input_stream.h"
 #include "os_symbol_engine.h"
 
 namespace dbgutil {
 
+/** @def The number of rows in each delta-compressed block of a decoded line table. */
+#define DBGUTIL_LINE_BLOCK_ROWS 64
+
 struct DwarfLineStateMachine {
     uint64_t m_address;
     uint32_t m_opIndex;
@@ -63,17 +70,64 @@ struct DwarfLineStateMachine {
 class DwarfLineUtil {
 public:
     DwarfLineUtil();
-    ~DwarfLineUtil() {}
+    DwarfLineUtil(const DwarfLineUtil&) = delete;
+    DwarfLineUtil(DwarfLineUtil&&) = delete;
+    DwarfLineUtil& operator=(const DwarfLineUtil&) = delete;
+    ~DwarfLineUtil();
 
     static void initLogger();
     static void termLogger();
 
     DbgUtilErr getLineInfo(DwarfData& dwarfData, const DwarfSearchData& searchData,
-                           FixedInputStream& is, SymbolInfo& symbolInfo);
+                           FixedInputStream& is, uint8_t defaultAddressSize,
+                           SymbolInfo& symbolInfo);
+
+    /**
+     * @brief Reads the line program header, and builds the sequence index of the line program.
+     * Rows of the line matrix are not kept at this point, but rather each sequence is decoded into
+     * rows only when first searched. Once built, the line matrix may be searched concurrently by
+     * multiple threads. Line programs of DWARF versions 2 to 5 are supported.
+     * @param dwarfData The DWARF debug sections.
+     * @param is The input stream positioned at the start of the line program. The underlying
+     * buffer must remain valid as long as this object exists.
+     * @param defaultAddressSize The address size of the module, used by line programs prior to
+     * DWARF 5, whose header does not specify the address size.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr buildLineMatrix(DwarfData& dwarfData, FixedInputStream& is,
+                               uint8_t defaultAddressSize);
+
+    /**
+     * @brief Searches the line matrix for the line information of a relocated address.
+     * @param searchData The search data.
+     * @param[out] symbolInfo The resulting symbol information (file name, line and column).
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr searchLineMatrix(const DwarfSearchData& searchData, SymbolInfo& symbolInfo);
+
+    /**
+     * @brief Searches the line matrix for the line information of a relocated address, without
+     * copying the file path. The resulting path points into this object.
+     * @param relocSymAddr The relocated address.
+     * @param[out] filePath The full path of the file containing the address.
+     * @param[out] lineNumber The line number.
+     * @param[out] columnIndex The column index.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr findLineInfo(uint64_t relocSymAddr, const char*& filePath, uint32_t& lineNumber,
+                            uint32_t& columnIndex);
+
+    /**
+     * @brief Retrieves the approximate memory usage (in bytes) of the decoded line program, as if
+     * all sequences were decoded.
+     */
+    size_t getMemoryUsage() const;
 
 private:
     struct FileInfo {
         std::string m_name;
+        std::string m_path;  // full path, composed once after the header is read
+        bool m_isMainFile;
         uint32_t m_dirIndex;
         uint64_t m_timestamp;
         uint64_t m_size;
@@ -86,7 +140,11 @@ private:
 
         FileInfo(const char* name = "", uint32_t dirIndex = 0, uint64_t timestamp = 0,
                  uint64_t size = 0)
-            : m_name(name), m_dirIndex(dirIndex), m_timestamp(timestamp), m_size(size) {}
+            : m_name(name),
+              m_isMainFile(false),
+              m_dirIndex(dirIndex),
+              m_timestamp(timestamp),
+              m_size(size) {}
     };
 
     // important line program header information
@@ -103,6 +161,9 @@ private:
     uint64_t m_startProgramOffset;
     uint64_t m_endProgramOffset;
 
+    // the line program buffer (points into the .debug_line section)
+    const char* m_lineProgram;
+
     struct LineInfo {
         uint64_t m_address;      // relocatable address
         uint32_t m_fileIndex;    // 0-based index to file list
@@ -115,20 +176,57 @@ private:
         }
     };
     typedef std::vector<LineInfo> LineMatrix;
-    LineMatrix m_lineMatrix;
 
+    // decoded rows are kept delta-compressed in blocks of (about) DBGUTIL_LINE_BLOCK_ROWS rows,
+    // such that only the block heads are binary searched, and a single block is then scanned
+    // linearly. The block head holds the absolute address and line of its first row, followed in
+    // the data array by the first row's file and column (ULEB128), and then each subsequent row is
+    // encoded as address delta (ULEB128), and line, column and file deltas (SLEB128). Rows sharing
+    // the same address are never split between blocks.
+    struct LineBlock {
+        uint64_t m_baseAddress;
+        uint32_t m_baseLine;
+        uint32_t m_dataOffset;
+    };
+    struct LineTable {
+        std::vector<LineBlock> m_blocks;
+        std::vector<uint8_t> m_data;
+    };
+
+    // a sequence is a run of rows ending with DW_LNE_end_sequence, covering a contiguous address
+    // range, and since the state machine is reset at the beginning of each sequence, it can be
+    // decoded independently of all other sequences, starting from its offset in the line program
+    struct LineSequence {
+        uint64_t m_lowAddress;
+        uint64_t m_highAddress;  // address of the end_sequence row (exclusive)
+        uint64_t m_startOffset;  // line program offset of the first op-code of the sequence
+        uint64_t m_rowCount;
+
+        inline bool operator<(const LineSequence& sequence) const {
+            return m_lowAddress < sequence.m_lowAddress;
+        }
+    };
+    std::vector<LineSequence> m_sequences;
+    uint64_t m_rowCount;
+
+    // decoded sequence rows (parallel to m_sequences), where null denotes a sequence not decoded
+    // yet, and decoded rows are immutable until this object is destroyed
+    std::unique_ptr<std::atomic<LineTable*>[]> m_sequenceRows;
+    std::mutex m_decodeLock;
+
+    // state of the sequence being scanned or decoded (protected by decode lock after build)
     DwarfLineStateMachine m_stateMachine;
+    LineMatrix* m_lineMatrix;
+    uint64_t m_seqStartOffset;
+    uint64_t m_seqLowAddress;
+    uint64_t m_seqRowCount;
 
     struct DirEntryFmtDesc {
         uint64_t m_contentType;
         uint64_t m_form;
     };
 
-    DbgUtilErr buildLineMatrix(DwarfData& dwarfData, FixedInputStream& is);
-
-    DbgUtilErr searchLineMatrix(const DwarfSearchData& searchData, SymbolInfo& symbolInfo);
-
-    DbgUtilErr readHeader(FixedInputStream& is, DwarfData& dwarfData);
+    DbgUtilErr readHeader(FixedInputStream& is, DwarfData& dwarfData, uint8_t defaultAddressSize);
 
     DbgUtilErr readFormatList(FixedInputStream& is, std::vector<DirEntryFmtDesc>& entryFmt);
 
@@ -136,14 +234,31 @@ private:
 
     DbgUtilErr readFileList(FixedInputStream& is, DwarfData& dwarfData, bool is64Bit);
 
-    DbgUtilErr execLineProgram(FixedInputStream& is);
+    // directory and file tables of line programs prior to DWARF 5
+    DbgUtilErr readDirListV4(FixedInputStream& is);
 
-    DbgUtilErr execStandardOpCode(uint8_t opCode, FixedInputStream& is);
+    DbgUtilErr readFileListV4(FixedInputStream& is);
+
+    DbgUtilErr execLineProgram(DwarfCursor& cursor, bool singleSequence);
+
+    template <unsigned AddressSize>
+    DbgUtilErr execLineProgram(DwarfCursor& cursor, bool singleSequence);
+
+    DbgUtilErr execStandardOpCode(uint8_t opCode, DwarfCursor& cursor);
     void execSpecialOpCode(uint8_t opCode);
     void advancePC(uint8_t opCode, bool advanceLine = true);
     void advanceAddress(uint64_t opAdvance);
-    DbgUtilErr execExtendedOpCode(uint64_t opCode, FixedInputStream& is);
+    template <unsigned AddressSize>
+    DbgUtilErr execExtendedOpCode(uint64_t opCode, DwarfCursor& cursor);
     void appendLineMatrix();
+
+    void buildFilePaths();
+
+    DbgUtilErr getSequenceRows(size_t seqIndex, const LineTable*& lineTable);
+    DbgUtilErr decodeSequence(const LineSequence& sequence, LineMatrix& lineMatrix);
+    DbgUtilErr compressLineMatrix(const LineMatrix& lineMatrix, LineTable& lineTable);
+    DbgUtilErr searchLineTable(const LineTable& lineTable, uint64_t relocSymAddr,
+                               LineInfo& lineInfo) const;
 };
 
 }  // namespace dbgutil
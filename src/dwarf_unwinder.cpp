@@ -0,0 +1,1010 @@
+#include "dwarf_unwinder.h"
+
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+
+#include <link.h>
+#include <signal.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#include "dbg_util_flags.h"
+#include "dbgutil_common.h"
+#include "dbgutil_log_imp.h"
+#include "dwarf_cursor.h"
+#include "dwarf_def.h"
+
+// registers whose rules are kept in the row cache (callee-saved registers and the return address
+// column), since other registers do not take part in computing the call frame address of outer
+// frames
+#if defined(__x86_64__)
+#define DWARF_UNWIND_SAVED_REG_COUNT 7
+static const uint8_t sSavedRegs[DWARF_UNWIND_SAVED_REG_COUNT] = {3, 6, 12, 13, 14, 15, 16};
+#else
+#define DWARF_UNWIND_SAVED_REG_COUNT 12
+static const uint8_t sSavedRegs[DWARF_UNWIND_SAVED_REG_COUNT] = {19, 20, 21, 22, 23, 24,
+                                                                 25, 26, 27, 28, 29, 30};
+#endif
+
+// the index of the return address column within the saved registers
+#define DWARF_UNWIND_RA_INDEX (DWARF_UNWIND_SAVED_REG_COUNT - 1)
+
+// row cache size (must be a power of 2)
+#define DWARF_UNWIND_ROW_CACHE_BITS 12
+#define DWARF_UNWIND_ROW_CACHE_SIZE (1u << DWARF_UNWIND_ROW_CACHE_BITS)
+
+// row cache slots are selected by address granules, so that all addresses of a row (which usually
+// spans several instructions) map to the same few slots
+#define DWARF_UNWIND_ROW_GRANULE_BITS 4
+
+// maximum nesting of DW_CFA_remember_state
+#define DWARF_UNWIND_STATE_STACK_DEPTH 4
+
+// CFA register value denoting a row that cannot be used for unwinding
+#define DWARF_UNWIND_INVALID_CFA_REG 0xFF
+
+// the capture macros store the instruction pointer right after the registers
+static_assert(offsetof(dbgutil::DwarfUnwindContext, m_ip) == DWARF_UNWIND_REG_COUNT * 8,
+              "Unexpected unwinding context layout");
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+DwarfUnwinder* DwarfUnwinder::sInstance = nullptr;
+
+enum DwarfRuleType : uint8_t {
+    DRT_SAME_VALUE,
+    DRT_UNDEFINED,
+    DRT_OFFSET,
+    DRT_VAL_OFFSET,
+    DRT_REGISTER,
+    DRT_UNSUPPORTED
+};
+
+struct DwarfRule {
+    uint8_t m_type;
+    uint8_t m_reg;
+    int32_t m_offset;
+};
+
+// the rule row of a single instruction pointer, as computed by the call frame program (all tracked
+// registers)
+struct DwarfFullRow {
+    uint32_t m_cfaReg;
+    int64_t m_cfaOffset;
+    bool m_cfaIsExpr;
+    bool m_raSigned;
+    DwarfRule m_rules[DWARF_UNWIND_REG_COUNT];
+};
+
+struct DwarfUnwindRow {
+    uint8_t m_cfaReg;
+    bool m_raSigned;
+    int32_t m_cfaOffset;
+    DwarfRule m_rules[DWARF_UNWIND_SAVED_REG_COUNT];
+};
+
+// each slot holds the packed row words of an address range with identical rules (first word is the
+// CFA rule, followed by one word per saved register rule), all accessed atomically, so that readers
+// never block, and simply miss if the slot is being written concurrently
+#define DWARF_UNWIND_ROW_WORDS (DWARF_UNWIND_SAVED_REG_COUNT + 1)
+
+struct DwarfUnwindRowSlot {
+    std::atomic<uint64_t> m_seq;
+    std::atomic<uint64_t> m_start;
+    std::atomic<uint64_t> m_end;
+    std::atomic<uint64_t> m_generation;
+    std::atomic<uint64_t> m_words[DWARF_UNWIND_ROW_WORDS];
+};
+
+// common information entry fields required for executing frame description entries
+struct DwarfCieInfo {
+    uint64_t m_codeAlign;
+    int64_t m_dataAlign;
+    uint64_t m_raReg;
+    uint8_t m_fdeEncoding;
+    bool m_hasAugData;
+    const char* m_instructions;
+    const char* m_instructionsEnd;
+};
+
+static inline uint64_t packRule(const DwarfRule& rule) {
+    return (uint64_t)rule.m_type | ((uint64_t)rule.m_reg << 8) |
+           ((uint64_t)(uint32_t)rule.m_offset << 32);
+}
+
+static inline void unpackRule(uint64_t word, DwarfRule& rule) {
+    rule.m_type = (uint8_t)(word & 0xFF);
+    rule.m_reg = (uint8_t)((word >> 8) & 0xFF);
+    rule.m_offset = (int32_t)(uint32_t)(word >> 32);
+}
+
+static inline uint32_t getSlotIndex(uintptr_t pc) {
+    uint64_t granule = (uint64_t)pc >> DWARF_UNWIND_ROW_GRANULE_BITS;
+    return (uint32_t)((granule * 0x9E3779B97F4A7C15ull) >> (64 - DWARF_UNWIND_ROW_CACHE_BITS));
+}
+
+// reads a pointer encoded by DW_EH_PE_* rules, where the cursor is positioned at the given address
+static bool readEncodedPointer(DwarfCursor& cursor, uintptr_t cursorBase, uint8_t encoding,
+                               uintptr_t dataRelBase, uint64_t& value, bool deref = true) {
+    if (encoding == DW_EH_PE_omit) {
+        value = 0;
+        return true;
+    }
+    uintptr_t pos = cursorBase + (uintptr_t)cursor.getOffset();
+    switch (encoding & 0x0F) {
+        case DW_EH_PE_absptr:
+            value = cursor.readU64();
+            break;
+        case DW_EH_PE_uleb128:
+            value = cursor.readULEB128();
+            break;
+        case DW_EH_PE_udata2:
+            value = cursor.readU16();
+            break;
+        case DW_EH_PE_udata4:
+            value = cursor.readU32();
+            break;
+        case DW_EH_PE_udata8:
+            value = cursor.readU64();
+            break;
+        case DW_EH_PE_sleb128:
+            value = (uint64_t)cursor.readSLEB128();
+            break;
+        case DW_EH_PE_sdata2:
+            value = (uint64_t)(int64_t)(int16_t)cursor.readU16();
+            break;
+        case DW_EH_PE_sdata4:
+            value = (uint64_t)(int64_t)(int32_t)cursor.readU32();
+            break;
+        case DW_EH_PE_sdata8:
+            value = cursor.readU64();
+            break;
+        default:
+            return false;
+    }
+    switch (encoding & 0x70) {
+        case DW_EH_PE_absptr:
+            break;
+        case DW_EH_PE_pcrel:
+            value += pos;
+            break;
+        case DW_EH_PE_datarel:
+            value += dataRelBase;
+            break;
+        default:
+            return false;
+    }
+    if (!cursor.isValid()) {
+        return false;
+    }
+    if ((encoding & DW_EH_PE_indirect) && deref) {
+        value = *(const uint64_t*)(uintptr_t)value;
+    }
+    return true;
+}
+
+// reads the length of a CIE/FDE record, and sets up a cursor over its contents
+static bool openRecord(const char* record, DwarfCursor& cursor, const char*& contents) {
+    DwarfCursor lenCursor(record, 12);
+    bool is64Bit = false;
+    uint64_t length = lenCursor.readInitialLength(is64Bit);
+    if (!lenCursor.isValid() || length == 0) {
+        return false;
+    }
+    contents = record + lenCursor.getOffset();
+    cursor = DwarfCursor(contents, length);
+    return true;
+}
+
+static bool parseCie(const char* cie, DwarfCieInfo& cieInfo) {
+    DwarfCursor cursor;
+    const char* contents = nullptr;
+    if (!openRecord(cie, cursor, contents)) {
+        return false;
+    }
+    // CIE identifier in .eh_frame is zero
+    if (cursor.readU32() != 0) {
+        return false;
+    }
+    uint8_t version = cursor.readU8();
+    if (version != 1 && version != 3 && version != 4) {
+        return false;
+    }
+    const char* augmentation = cursor.readCString();
+    if (!cursor.isValid() || strstr(augmentation, "eh") != nullptr) {
+        return false;
+    }
+    if (version == 4) {
+        // address size and segment selector size
+        cursor.skip(2);
+    }
+    cieInfo.m_codeAlign = cursor.readULEB128();
+    cieInfo.m_dataAlign = cursor.readSLEB128();
+    cieInfo.m_raReg = (version == 1) ? cursor.readU8() : cursor.readULEB128();
+    cieInfo.m_fdeEncoding = DW_EH_PE_absptr;
+    cieInfo.m_hasAugData = (augmentation[0] == 'z');
+    if (cieInfo.m_hasAugData) {
+        uint64_t augLength = cursor.readULEB128();
+        uint64_t augEnd = cursor.getOffset() + augLength;
+        for (const char* aug = augmentation + 1; *aug != 0 && cursor.isValid(); ++aug) {
+            if (*aug == 'R') {
+                cieInfo.m_fdeEncoding = cursor.readU8();
+            } else if (*aug == 'L') {
+                cursor.readU8();
+            } else if (*aug == 'P') {
+                // personality routine is not needed, so it is not dereferenced
+                uint8_t encoding = cursor.readU8();
+                uint64_t personality = 0;
+                if (!readEncodedPointer(cursor, (uintptr_t)contents, encoding, 0, personality,
+                                        false)) {
+                    return false;
+                }
+            } else if (*aug != 'S' && *aug != 'B' && *aug != 'G') {
+                return false;
+            }
+        }
+        cursor.seek(augEnd);
+    } else if (augmentation[0] != 0) {
+        return false;
+    }
+    if (!cursor.isValid()) {
+        return false;
+    }
+    cieInfo.m_instructions = contents + cursor.getOffset();
+    cieInfo.m_instructionsEnd = contents + cursor.getOffset() + cursor.getBytesLeft();
+    return true;
+}
+
+static inline void setRule(DwarfFullRow& row, uint64_t reg, uint8_t type, int64_t offset = 0,
+                           uint64_t srcReg = 0) {
+    if (reg < DWARF_UNWIND_REG_COUNT) {
+        DwarfRule& rule = row.m_rules[reg];
+        rule.m_type = type;
+        rule.m_reg = (uint8_t)srcReg;
+        rule.m_offset = (int32_t)offset;
+        // register rules referring to untracked registers, and offsets that do not fit in the
+        // cached row, are not supported
+        if ((type == DRT_REGISTER && srcReg >= DWARF_UNWIND_REG_COUNT) ||
+            offset != (int64_t)rule.m_offset) {
+            rule.m_type = DRT_UNSUPPORTED;
+        }
+    }
+}
+
+// executes call frame instructions up to (and including) the given target address, and reports the
+// address range [rowStart, rowEnd) in which the resulting row applies (rowEnd is UINT64_MAX if the
+// row applies up to the end of the FDE)
+static bool execCfaProgram(const char* start, const char* end, const DwarfCieInfo& cieInfo,
+                           uint64_t loc, uint64_t targetPc, DwarfFullRow& row,
+                           const DwarfFullRow& initialRow, uint64_t& rowStart, uint64_t& rowEnd) {
+    rowStart = loc;
+    rowEnd = UINT64_MAX;
+    DwarfFullRow stateStack[DWARF_UNWIND_STATE_STACK_DEPTH];
+    uint32_t stateDepth = 0;
+    DwarfCursor cursor(start, (uint64_t)(end - start));
+    while (!cursor.empty()) {
+        uint8_t op = cursor.readU8();
+        uint8_t operand = op & 0x3F;
+        switch (op & 0xC0) {
+            case DW_CFA_advance_loc:
+                loc += operand * cieInfo.m_codeAlign;
+                if (loc > targetPc) {
+                    rowEnd = loc;
+                    return true;
+                }
+                rowStart = loc;
+                continue;
+            case DW_CFA_offset:
+                setRule(row, operand,
+                        DRT_OFFSET, (int64_t)cursor.readULEB128() * cieInfo.m_dataAlign);
+                continue;
+            case DW_CFA_restore:
+                if (operand < DWARF_UNWIND_REG_COUNT) {
+                    row.m_rules[operand] = initialRow.m_rules[operand];
+                }
+                continue;
+            default:
+                break;
+        }
+
+        uint64_t reg = 0;
+        uint64_t delta = 0;
+        switch (op) {
+            case DW_CFA_nop:
+                break;
+            case DW_CFA_set_loc:
+                if (!readEncodedPointer(cursor, (uintptr_t)start, cieInfo.m_fdeEncoding, 0, loc)) {
+                    return false;
+                }
+                if (loc > targetPc) {
+                    rowEnd = loc;
+                    return true;
+                }
+                rowStart = loc;
+                break;
+            case DW_CFA_advance_loc1:
+            case DW_CFA_advance_loc2:
+            case DW_CFA_advance_loc4:
+                delta = (op == DW_CFA_advance_loc1)   ? cursor.readU8()
+                        : (op == DW_CFA_advance_loc2) ? cursor.readU16()
+                                                      : cursor.readU32();
+                loc += delta * cieInfo.m_codeAlign;
+                if (loc > targetPc) {
+                    rowEnd = loc;
+                    return cursor.isValid();
+                }
+                rowStart = loc;
+                break;
+            case DW_CFA_offset_extended:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_OFFSET,
+                        (int64_t)cursor.readULEB128() * cieInfo.m_dataAlign);
+                break;
+            case DW_CFA_restore_extended:
+                reg = cursor.readULEB128();
+                if (reg < DWARF_UNWIND_REG_COUNT) {
+                    row.m_rules[reg] = initialRow.m_rules[reg];
+                }
+                break;
+            case DW_CFA_undefined:
+                setRule(row, cursor.readULEB128(), DRT_UNDEFINED);
+                break;
+            case DW_CFA_same_value:
+                setRule(row, cursor.readULEB128(), DRT_SAME_VALUE);
+                break;
+            case DW_CFA_register:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_REGISTER, 0, cursor.readULEB128());
+                break;
+            case DW_CFA_remember_state:
+                if (stateDepth == DWARF_UNWIND_STATE_STACK_DEPTH) {
+                    return false;
+                }
+                stateStack[stateDepth++] = row;
+                break;
+            case DW_CFA_restore_state:
+                if (stateDepth == 0) {
+                    return false;
+                }
+                row = stateStack[--stateDepth];
+                break;
+            case DW_CFA_def_cfa:
+                row.m_cfaReg = (uint32_t)cursor.readULEB128();
+                row.m_cfaOffset = (int64_t)cursor.readULEB128();
+                row.m_cfaIsExpr = false;
+                break;
+            case DW_CFA_def_cfa_sf:
+                row.m_cfaReg = (uint32_t)cursor.readULEB128();
+                row.m_cfaOffset = cursor.readSLEB128() * cieInfo.m_dataAlign;
+                row.m_cfaIsExpr = false;
+                break;
+            case DW_CFA_def_cfa_register:
+                row.m_cfaReg = (uint32_t)cursor.readULEB128();
+                row.m_cfaIsExpr = false;
+                break;
+            case DW_CFA_def_cfa_offset:
+                row.m_cfaOffset = (int64_t)cursor.readULEB128();
+                break;
+            case DW_CFA_def_cfa_offset_sf:
+                row.m_cfaOffset = cursor.readSLEB128() * cieInfo.m_dataAlign;
+                break;
+            case DW_CFA_def_cfa_expression:
+                cursor.skip(cursor.readULEB128());
+                row.m_cfaIsExpr = true;
+                break;
+            case DW_CFA_expression:
+            case DW_CFA_val_expression:
+                reg = cursor.readULEB128();
+                cursor.skip(cursor.readULEB128());
+                setRule(row, reg, DRT_UNSUPPORTED);
+                break;
+            case DW_CFA_offset_extended_sf:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_OFFSET, cursor.readSLEB128() * cieInfo.m_dataAlign);
+                break;
+            case DW_CFA_val_offset:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_VAL_OFFSET,
+                        (int64_t)cursor.readULEB128() * cieInfo.m_dataAlign);
+                break;
+            case DW_CFA_val_offset_sf:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_VAL_OFFSET, cursor.readSLEB128() * cieInfo.m_dataAlign);
+                break;
+            case DW_CFA_GNU_args_size:
+                cursor.readULEB128();
+                break;
+            case DW_CFA_GNU_negative_offset_extended:
+                reg = cursor.readULEB128();
+                setRule(row, reg, DRT_OFFSET,
+                        -(int64_t)cursor.readULEB128() * cieInfo.m_dataAlign);
+                break;
+#if defined(__aarch64__)
+            case DW_CFA_GNU_window_save:
+                // on aarch64 this is DW_CFA_AARCH64_negate_ra_state (return address signing)
+                row.m_raSigned = !row.m_raSigned;
+                break;
+#endif
+            default:
+                return false;
+        }
+        if (!cursor.isValid()) {
+            return false;
+        }
+    }
+    return cursor.isValid();
+}
+
+// searches the .eh_frame_hdr table of a module for the FDE covering the given address, and decodes
+// the rule row of the address, along with the address range [rowStart, rowEnd) sharing that row
+static bool decodeRow(const DwarfUnwindModule& module, uintptr_t pc, DwarfUnwindRow& result,
+                      uint64_t& rowStart, uint64_t& rowEnd) {
+    // binary search for the last table entry whose initial location is not above the address
+    // (entries are pairs of 4 byte signed offsets relative to the start of .eh_frame_hdr)
+    const int32_t* table = (const int32_t*)module.m_fdeTable;
+    uintptr_t hdr = (uintptr_t)module.m_ehFrameHdr;
+    uint64_t low = 0;
+    uint64_t high = module.m_fdeCount;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (hdr + (intptr_t)table[2 * mid] <= pc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return false;
+    }
+    const char* fde = (const char*)(hdr + (intptr_t)table[2 * (low - 1) + 1]);
+
+    DwarfCursor cursor;
+    const char* contents = nullptr;
+    if (!openRecord(fde, cursor, contents)) {
+        return false;
+    }
+    // CIE pointer is relative to its own location
+    uint32_t ciePointer = cursor.readU32();
+    if (ciePointer == 0) {
+        return false;
+    }
+    DwarfCieInfo cieInfo;
+    if (!parseCie(contents - ciePointer, cieInfo)) {
+        return false;
+    }
+    uint64_t pcBegin = 0;
+    uint64_t pcRange = 0;
+    if (!readEncodedPointer(cursor, (uintptr_t)contents, cieInfo.m_fdeEncoding, hdr, pcBegin) ||
+        !readEncodedPointer(cursor, (uintptr_t)contents, cieInfo.m_fdeEncoding & 0x0F, 0,
+                            pcRange)) {
+        return false;
+    }
+    if (pc < pcBegin || pc >= pcBegin + pcRange) {
+        return false;
+    }
+    if (cieInfo.m_hasAugData) {
+        cursor.skip(cursor.readULEB128());
+    }
+    if (!cursor.isValid()) {
+        return false;
+    }
+    const char* instructions = contents + cursor.getOffset();
+    const char* instructionsEnd = instructions + cursor.getBytesLeft();
+
+    // initial rules are defined by the CIE, and all registers not mentioned are preserved
+    DwarfFullRow row = {};
+    row.m_cfaReg = DWARF_UNWIND_INVALID_CFA_REG;
+    for (uint32_t i = 0; i < DWARF_UNWIND_REG_COUNT; ++i) {
+        row.m_rules[i].m_type = DRT_SAME_VALUE;
+    }
+    DwarfFullRow initialRow = row;
+    if (!execCfaProgram(cieInfo.m_instructions, cieInfo.m_instructionsEnd, cieInfo, 0, UINT64_MAX,
+                        row, initialRow, rowStart, rowEnd)) {
+        return false;
+    }
+    initialRow = row;
+    if (!execCfaProgram(instructions, instructionsEnd, cieInfo, pcBegin, pc, row, initialRow,
+                        rowStart, rowEnd)) {
+        return false;
+    }
+    if (rowStart > pc || rowStart < pcBegin) {
+        rowStart = pc;
+    }
+    if (rowEnd <= pc || rowEnd > pcBegin + pcRange) {
+        rowEnd = pcBegin + pcRange;
+    }
+
+    // convert to compact form
+    if (row.m_cfaIsExpr || row.m_cfaReg >= DWARF_UNWIND_REG_COUNT ||
+        row.m_cfaOffset != (int64_t)(int32_t)row.m_cfaOffset ||
+        cieInfo.m_raReg != DWARF_UNWIND_RA_REG) {
+        return false;
+    }
+    result.m_cfaReg = (uint8_t)row.m_cfaReg;
+    result.m_cfaOffset = (int32_t)row.m_cfaOffset;
+    result.m_raSigned = row.m_raSigned;
+    for (uint32_t i = 0; i < DWARF_UNWIND_SAVED_REG_COUNT; ++i) {
+        result.m_rules[i] = row.m_rules[sSavedRegs[i]];
+        if (result.m_rules[i].m_type == DRT_UNSUPPORTED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// parses the .eh_frame_hdr header, locating the binary search table
+static bool parseEhFrameHdr(DwarfUnwindModule& module) {
+    const char* hdr = module.m_ehFrameHdr;
+    uint8_t version = (uint8_t)hdr[0];
+    uint8_t ehFramePtrEncoding = (uint8_t)hdr[1];
+    uint8_t fdeCountEncoding = (uint8_t)hdr[2];
+    uint8_t tableEncoding = (uint8_t)hdr[3];
+    if (version != 1 || tableEncoding != (DW_EH_PE_datarel | DW_EH_PE_sdata4)) {
+        return false;
+    }
+    DwarfCursor cursor(hdr + 4, 32);
+    uint64_t ehFramePtr = 0;
+    uint64_t fdeCount = 0;
+    if (!readEncodedPointer(cursor, (uintptr_t)hdr + 4, ehFramePtrEncoding, (uintptr_t)hdr,
+                            ehFramePtr) ||
+        !readEncodedPointer(cursor, (uintptr_t)hdr + 4, fdeCountEncoding, (uintptr_t)hdr,
+                            fdeCount)) {
+        return false;
+    }
+    module.m_fdeTable = hdr + 4 + cursor.getOffset();
+    module.m_fdeCount = fdeCount;
+    return true;
+}
+
+struct ModuleCollector {
+    std::vector<DwarfUnwindModule>* m_modules;
+    unsigned long long m_dlAdds;
+    unsigned long long m_dlSubs;
+};
+
+// collects the executable segments of each loaded module (segments of the same module are listed
+// separately, so unlike module listing, no segment merging takes place here)
+static int collectModule(struct dl_phdr_info* info, size_t size, void* data) {
+    ModuleCollector* collector = (ModuleCollector*)data;
+    if (size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+        collector->m_dlAdds = info->dlpi_adds;
+        collector->m_dlSubs = info->dlpi_subs;
+    }
+    if (collector->m_modules == nullptr) {
+        // only counters are queried
+        return 1;
+    }
+    const char* ehFrameHdr = nullptr;
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+        if (info->dlpi_phdr[i].p_type == PT_GNU_EH_FRAME) {
+            ehFrameHdr = (const char*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+        }
+    }
+    if (ehFrameHdr == nullptr) {
+        return 0;
+    }
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+        if (phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X)) {
+            DwarfUnwindModule module = {};
+            module.m_start = info->dlpi_addr + phdr.p_vaddr;
+            module.m_end = module.m_start + phdr.p_memsz;
+            module.m_ehFrameHdr = ehFrameHdr;
+            if (parseEhFrameHdr(module)) {
+                collector->m_modules->push_back(module);
+            }
+        }
+    }
+    return 0;
+}
+
+// checks whether any module was loaded or unloaded since the table was built. This does not
+// allocate memory, so it may be called in signal handlers (as libunwind does when locating unwind
+// information), although it briefly takes the loader lock.
+static bool isModuleTableCurrent(const DwarfUnwindModuleTable* table) {
+    ModuleCollector counters = {nullptr, 0, 0};
+    dl_iterate_phdr(collectModule, &counters);
+    return counters.m_dlAdds == table->m_dlAdds && counters.m_dlSubs == table->m_dlSubs;
+}
+
+DbgUtilErr DwarfUnwinder::createInstance() {
+    assert(sInstance == nullptr);
+    sInstance = new (std::nothrow) DwarfUnwinder();
+    if (sInstance == nullptr) {
+        LOG_ERROR(sLogger, "Failed to create DWARF unwinder, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    sInstance->m_rowCache = new (std::nothrow) DwarfUnwindRowSlot[DWARF_UNWIND_ROW_CACHE_SIZE]();
+    if (sInstance->m_rowCache == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate DWARF unwind row cache, out of memory");
+        destroyInstance();
+        return DBGUTIL_ERR_NOMEM;
+    }
+    DbgUtilErr rc = sInstance->refreshModuleTable(true);
+    if (rc != DBGUTIL_ERR_OK) {
+        destroyInstance();
+        return rc;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DwarfUnwinder* DwarfUnwinder::getInstance() {
+    assert(sInstance != nullptr);
+    return sInstance;
+}
+
+void DwarfUnwinder::destroyInstance() {
+    assert(sInstance != nullptr);
+    delete sInstance;
+    sInstance = nullptr;
+}
+
+DwarfUnwinder::DwarfUnwinder() : m_moduleTable(nullptr), m_rowCache(nullptr) {}
+
+DwarfUnwinder::~DwarfUnwinder() {
+    delete m_moduleTable.load(std::memory_order_relaxed);
+    for (DwarfUnwindModuleTable* table : m_retiredTables) {
+        delete table;
+    }
+    m_retiredTables.clear();
+    if (m_rowCache != nullptr) {
+        delete[] m_rowCache;
+        m_rowCache = nullptr;
+    }
+}
+
+void DwarfUnwinder::initContext(DwarfUnwindContext& context, void* signalContext) {
+    const ucontext_t* uc = (const ucontext_t*)signalContext;
+#if defined(__x86_64__)
+    // DWARF register order differs from the kernel's register order
+    static const int sGregIndex[16] = {REG_RAX, REG_RDX, REG_RCX, REG_RBX, REG_RSI, REG_RDI,
+                                       REG_RBP, REG_RSP, REG_R8,  REG_R9,  REG_R10, REG_R11,
+                                       REG_R12, REG_R13, REG_R14, REG_R15};
+    for (uint32_t i = 0; i < 16; ++i) {
+        context.m_regs[i] = (uint64_t)uc->uc_mcontext.gregs[sGregIndex[i]];
+    }
+    context.m_regs[DWARF_UNWIND_RA_REG] = 0;
+    context.m_ip = (uint64_t)uc->uc_mcontext.gregs[REG_RIP];
+    context.m_validRegs = 0xFFFF;
+#else
+    for (uint32_t i = 0; i < 31; ++i) {
+        context.m_regs[i] = uc->uc_mcontext.regs[i];
+    }
+    context.m_regs[DWARF_UNWIND_SP_REG] = uc->uc_mcontext.sp;
+    context.m_ip = uc->uc_mcontext.pc;
+    context.m_validRegs = 0xFFFFFFFF;
+#endif
+    context.m_stackLow = 0;
+    context.m_stackHigh = 0;
+    context.m_exactIp = true;
+}
+
+void DwarfUnwinder::initContext(DwarfUnwindContext& context, uint64_t ip, uint64_t sp,
+                                uint64_t fp) {
+    memset(context.m_regs, 0, sizeof(context.m_regs));
+    context.m_regs[DWARF_UNWIND_SP_REG] = sp;
+    context.m_regs[DWARF_UNWIND_FP_REG] = fp;
+    context.m_ip = ip;
+    context.m_stackLow = 0;
+    context.m_stackHigh = 0;
+    context.m_validRegs = (1u << DWARF_UNWIND_SP_REG) | (1u << DWARF_UNWIND_FP_REG);
+    context.m_exactIp = false;
+}
+
+DwarfUnwindResult DwarfUnwinder::step(DwarfUnwindContext& context, bool allowRefresh) {
+    if (context.m_ip == 0) {
+        return DwarfUnwindResult::DUR_END;
+    }
+    // a return address may point past the end of the calling function (if the call is its last
+    // instruction), so the call instruction itself is looked up
+    uintptr_t pc = (uintptr_t)(context.m_exactIp ? context.m_ip : context.m_ip - 1);
+    DwarfUnwindRow row;
+    if (!getRow(pc, row, allowRefresh) || !(context.m_validRegs & (1u << row.m_cfaReg))) {
+        return stepSignalFrame(context, allowRefresh) ? DwarfUnwindResult::DUR_OK
+                                                      : DwarfUnwindResult::DUR_FAILED;
+    }
+    if (row.m_rules[DWARF_UNWIND_RA_INDEX].m_type == DRT_UNDEFINED) {
+        // outermost frame
+        return DwarfUnwindResult::DUR_END;
+    }
+
+    uint64_t cfa = context.m_regs[row.m_cfaReg] + (int64_t)row.m_cfaOffset;
+    uint64_t values[DWARF_UNWIND_SAVED_REG_COUNT];
+    uint32_t validRegs = 0;
+    for (uint32_t i = 0; i < DWARF_UNWIND_SAVED_REG_COUNT; ++i) {
+        const DwarfRule& rule = row.m_rules[i];
+        uint32_t reg = sSavedRegs[i];
+        switch (rule.m_type) {
+            case DRT_SAME_VALUE:
+                if (context.m_validRegs & (1u << reg)) {
+                    values[i] = context.m_regs[reg];
+                    validRegs |= (1u << reg);
+                }
+                break;
+            case DRT_OFFSET: {
+                // saved registers are read only from within the stack, since unwind information
+                // may be wrong (e.g. hand-written assembly), or stale (see getRow())
+                uint64_t addr = cfa + (int64_t)rule.m_offset;
+                if (addr < context.m_stackLow || addr >= context.m_stackHigh ||
+                    context.m_stackHigh - addr < sizeof(uint64_t)) {
+                    return DwarfUnwindResult::DUR_FAILED;
+                }
+                values[i] = *(const uint64_t*)(uintptr_t)addr;
+                validRegs |= (1u << reg);
+                break;
+            }
+            case DRT_VAL_OFFSET:
+                values[i] = cfa + (int64_t)rule.m_offset;
+                validRegs |= (1u << reg);
+                break;
+            case DRT_REGISTER:
+                if (context.m_validRegs & (1u << rule.m_reg)) {
+                    values[i] = context.m_regs[rule.m_reg];
+                    validRegs |= (1u << reg);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (!(validRegs & (1u << DWARF_UNWIND_RA_REG))) {
+        return DwarfUnwindResult::DUR_FAILED;
+    }
+    uint64_t ip = values[DWARF_UNWIND_RA_INDEX];
+#if defined(__aarch64__)
+    if (row.m_raSigned) {
+        // strip pointer authentication code (xpaclri is a no-op on processors without it)
+        register uint64_t lr asm("x30") = ip;
+        asm("hint #7" : "+r"(lr));
+        ip = lr;
+    }
+#endif
+    // the stack must unwind towards its base, otherwise unwinding might never end
+    uint64_t sp = context.m_regs[DWARF_UNWIND_SP_REG];
+    if ((context.m_validRegs & (1u << DWARF_UNWIND_SP_REG)) &&
+        (cfa < sp || (cfa == sp && ip == context.m_ip))) {
+        return DwarfUnwindResult::DUR_FAILED;
+    }
+    if (ip == 0) {
+        return DwarfUnwindResult::DUR_END;
+    }
+
+    for (uint32_t i = 0; i < DWARF_UNWIND_SAVED_REG_COUNT; ++i) {
+        context.m_regs[sSavedRegs[i]] = values[i];
+    }
+    context.m_regs[DWARF_UNWIND_SP_REG] = cfa;
+    context.m_validRegs = validRegs | (1u << DWARF_UNWIND_SP_REG);
+    context.m_ip = ip;
+    context.m_exactIp = false;
+    return DwarfUnwindResult::DUR_OK;
+}
+
+bool DwarfUnwinder::stepSignalFrame(DwarfUnwindContext& context, bool allowRefresh) {
+    // the unwind information of the signal return trampoline (if any) is expressed with DWARF
+    // expressions, so the trampoline is recognized by its code instead (as libunwind does), and the
+    // interrupted register state is taken from the signal frame found at the stack pointer
+#if defined(__x86_64__)
+    // mov $15, %rax; syscall (rt_sigreturn)
+    static const unsigned char sTrampolineCode[] = {0x48, 0xc7, 0xc0, 0x0f, 0x00,
+                                                    0x00, 0x00, 0x0f, 0x05};
+    const uint64_t ucontextOffset = 0;
+#else
+    // mov x8, #139; svc #0 (rt_sigreturn)
+    static const unsigned char sTrampolineCode[] = {0x68, 0x11, 0x80, 0xd2, 0x01, 0x00, 0x00, 0xd4};
+    // the signal frame starts with the signal information, followed by the signal context
+    const uint64_t ucontextOffset = sizeof(siginfo_t);
+#endif
+    // the code is read only if it lies within an executable segment of a module that is still
+    // loaded, and the signal frame is read only if it lies within the stack
+    uintptr_t ip = (uintptr_t)context.m_ip;
+    if (context.m_exactIp || !(context.m_validRegs & (1u << DWARF_UNWIND_SP_REG))) {
+        return false;
+    }
+    const DwarfUnwindModuleTable* table = getModuleTable(allowRefresh);
+    if (table == nullptr) {
+        return false;
+    }
+    const DwarfUnwindModule* module = findModule(table, ip);
+    if (module == nullptr || module->m_end - ip < sizeof(sTrampolineCode) ||
+        memcmp((const void*)ip, sTrampolineCode, sizeof(sTrampolineCode)) != 0) {
+        return false;
+    }
+    uint64_t stackLow = context.m_stackLow;
+    uint64_t stackHigh = context.m_stackHigh;
+    uint64_t signalContext = context.m_regs[DWARF_UNWIND_SP_REG] + ucontextOffset;
+    if (signalContext < stackLow || signalContext >= stackHigh ||
+        stackHigh - signalContext < sizeof(ucontext_t)) {
+        return false;
+    }
+    initContext(context, (void*)(uintptr_t)signalContext);
+    context.m_stackLow = stackLow;
+    context.m_stackHigh = stackHigh;
+    return context.m_ip != 0;
+}
+
+DbgUtilErr DwarfUnwinder::refreshModuleTable(bool force) {
+    std::unique_lock<std::mutex> lock(m_refreshLock);
+    DwarfUnwindModuleTable* currTable = m_moduleTable.load(std::memory_order_relaxed);
+    if (!force && currTable != nullptr) {
+        // nothing to do if no module was loaded or unloaded since the table was built
+        if (isModuleTableCurrent(currTable)) {
+            return DBGUTIL_ERR_OK;
+        }
+    }
+
+    DwarfUnwindModuleTable* table = new (std::nothrow) DwarfUnwindModuleTable();
+    if (table == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate DWARF unwind module table, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    try {
+        // retired tables are kept, since concurrent unwinding may still be using them
+        if (currTable != nullptr) {
+            m_retiredTables.push_back(currTable);
+        }
+        ModuleCollector collector = {&table->m_modules, 0, 0};
+        dl_iterate_phdr(collectModule, &collector);
+        std::sort(table->m_modules.begin(), table->m_modules.end(),
+                  [](const DwarfUnwindModule& lhs, const DwarfUnwindModule& rhs) {
+                      return lhs.m_start < rhs.m_start;
+                  });
+        table->m_dlAdds = collector.m_dlAdds;
+        table->m_dlSubs = collector.m_dlSubs;
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to build DWARF unwind module table, out of memory");
+        if (currTable != nullptr && !m_retiredTables.empty() &&
+            m_retiredTables.back() == currTable) {
+            m_retiredTables.pop_back();
+        }
+        delete table;
+        return DBGUTIL_ERR_NOMEM;
+    }
+    // row cache entries of previous tables are discarded by generation, since a module may have
+    // been replaced by another module at the same address
+    table->m_generation = (currTable != nullptr) ? currTable->m_generation + 1 : 1;
+    m_moduleTable.store(table, std::memory_order_release);
+    LOG_DEBUG(sLogger, "DWARF unwind module table refreshed, %zu executable segments",
+              table->m_modules.size());
+    return DBGUTIL_ERR_OK;
+}
+
+const DwarfUnwindModule* DwarfUnwinder::findModule(const DwarfUnwindModuleTable* table,
+                                                   uintptr_t pc) {
+    const std::vector<DwarfUnwindModule>& modules = table->m_modules;
+    std::vector<DwarfUnwindModule>::const_iterator itr = std::upper_bound(
+        modules.begin(), modules.end(), pc,
+        [](uintptr_t value, const DwarfUnwindModule& module) { return value < module.m_start; });
+    if (itr != modules.begin() && pc < (--itr)->m_end) {
+        return &(*itr);
+    }
+    return nullptr;
+}
+
+const DwarfUnwindModuleTable* DwarfUnwinder::getModuleTable(bool allowRefresh) {
+    const DwarfUnwindModuleTable* table = m_moduleTable.load(std::memory_order_acquire);
+    if (isModuleTableCurrent(table)) {
+        return table;
+    }
+    if (!allowRefresh || refreshModuleTable(false) != DBGUTIL_ERR_OK) {
+        return nullptr;
+    }
+    return m_moduleTable.load(std::memory_order_acquire);
+}
+
+bool DwarfUnwinder::getRow(uintptr_t pc, DwarfUnwindRow& row, bool allowRefresh) {
+    const DwarfUnwindModuleTable* table = m_moduleTable.load(std::memory_order_acquire);
+    if (lookupRow(pc, table->m_generation, row)) {
+        return row.m_cfaReg != DWARF_UNWIND_INVALID_CFA_REG;
+    }
+
+    // the module table is verified to be up to date before decoding, since the address may belong
+    // to a module loaded since the table was built, possibly in place of an unloaded module (whose
+    // unwind information is no longer mapped). When refreshing is disallowed (i.e. in signal
+    // handlers), a stale table is not used, and it is up to the caller to keep the table current
+    // by calling syncModuleTable() from a regular thread
+    table = getModuleTable(allowRefresh);
+    if (table == nullptr) {
+        return false;
+    }
+    const DwarfUnwindModule* module = findModule(table, pc);
+    if (module == nullptr) {
+        return false;
+    }
+
+    // failures are cached as well (for the failing address only), so that unsupported frames are
+    // not decoded again
+    uint64_t rowStart = pc;
+    uint64_t rowEnd = pc + 1;
+    if (!decodeRow(*module, pc, row, rowStart, rowEnd)) {
+        row.m_cfaReg = DWARF_UNWIND_INVALID_CFA_REG;
+        row.m_cfaOffset = 0;
+        row.m_raSigned = false;
+        memset(row.m_rules, 0, sizeof(row.m_rules));
+        rowStart = pc;
+        rowEnd = pc + 1;
+    }
+    storeRow(pc, rowStart, rowEnd, table->m_generation, row);
+    return row.m_cfaReg != DWARF_UNWIND_INVALID_CFA_REG;
+}
+
+bool DwarfUnwinder::lookupRow(uintptr_t pc, uint64_t generation, DwarfUnwindRow& row) {
+    DwarfUnwindRowSlot& slot = m_rowCache[getSlotIndex(pc)];
+    uint64_t seq = slot.m_seq.load(std::memory_order_acquire);
+    if ((seq & 1) != 0 || slot.m_start.load(std::memory_order_relaxed) > pc ||
+        slot.m_end.load(std::memory_order_relaxed) <= pc ||
+        slot.m_generation.load(std::memory_order_relaxed) != generation) {
+        return false;
+    }
+    uint64_t words[DWARF_UNWIND_ROW_WORDS];
+    for (uint32_t i = 0; i < DWARF_UNWIND_ROW_WORDS; ++i) {
+        words[i] = slot.m_words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.m_seq.load(std::memory_order_relaxed) != seq) {
+        return false;
+    }
+    row.m_cfaReg = (uint8_t)(words[0] & 0xFF);
+    row.m_raSigned = ((words[0] >> 8) & 1) != 0;
+    row.m_cfaOffset = (int32_t)(uint32_t)(words[0] >> 32);
+    for (uint32_t i = 0; i < DWARF_UNWIND_SAVED_REG_COUNT; ++i) {
+        unpackRule(words[i + 1], row.m_rules[i]);
+    }
+    return true;
+}
+
+void DwarfUnwinder::storeRow(uintptr_t pc, uint64_t rowStart, uint64_t rowEnd, uint64_t generation,
+                             const DwarfUnwindRow& row) {
+    // if the slot is being written by another thread (or by an interrupted context of this thread)
+    // the row is simply not cached
+    DwarfUnwindRowSlot& slot = m_rowCache[getSlotIndex(pc)];
+    uint64_t seq = slot.m_seq.load(std::memory_order_relaxed);
+    if ((seq & 1) != 0 ||
+        !slot.m_seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.m_start.store(rowStart, std::memory_order_relaxed);
+    slot.m_end.store(rowEnd, std::memory_order_relaxed);
+    slot.m_generation.store(generation, std::memory_order_relaxed);
+    slot.m_words[0].store((uint64_t)row.m_cfaReg | ((uint64_t)(row.m_raSigned ? 1 : 0) << 8) |
+                              ((uint64_t)(uint32_t)row.m_cfaOffset << 32),
+                          std::memory_order_relaxed);
+    for (uint32_t i = 0; i < DWARF_UNWIND_SAVED_REG_COUNT; ++i) {
+        slot.m_words[i + 1].store(packRule(row.m_rules[i]), std::memory_order_relaxed);
+    }
+    slot.m_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool isDwarfUnwindEnabled() {
+#ifdef DBGUTIL_NO_LIBUNWIND
+    return true;
+#else
+    return (getGlobalFlags() & DBGUTIL_BUILTIN_UNWIND) != 0;
+#endif
+}
+
+DbgUtilErr initDwarfUnwinder() {
+    registerLogger(sLogger, "dwarf_unwinder");
+    if (isDwarfUnwindEnabled()) {
+        return DwarfUnwinder::createInstance();
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr termDwarfUnwinder() {
+    if (isDwarfUnwindEnabled()) {
+        DwarfUnwinder::destroyInstance();
+    }
+    unregisterLogger(sLogger);
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
+
+#endif  // DBGUTIL_DWARF_UNWIND_SUPPORTED
@@ -0,0 +1,240 @@
+#ifndef __DWARF_UNWINDER_H__
+#define __DWARF_UNWINDER_H__
+
+#include "dbg_util_def.h"
+
+#if defined(DBGUTIL_LINUX) && (defined(__x86_64__) || defined(__aarch64__))
+#define DBGUTIL_DWARF_UNWIND_SUPPORTED
+#endif
+
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "dbg_util_err.h"
+
+/** @def The number of DWARF registers tracked during unwinding (including return address). */
+#if defined(__x86_64__)
+#define DWARF_UNWIND_REG_COUNT 17
+#define DWARF_UNWIND_SP_REG 7
+#define DWARF_UNWIND_FP_REG 6
+#define DWARF_UNWIND_RA_REG 16
+#else
+#define DWARF_UNWIND_REG_COUNT 32
+#define DWARF_UNWIND_SP_REG 31
+#define DWARF_UNWIND_FP_REG 29
+#define DWARF_UNWIND_RA_REG 30
+#endif
+
+namespace dbgutil {
+
+/** @brief The register state of a single frame during unwinding, indexed by DWARF number. */
+struct DwarfUnwindContext {
+    /** @var Register values (only callee-saved registers and the stack pointer are relevant). */
+    uint64_t m_regs[DWARF_UNWIND_REG_COUNT];
+
+    /** @var The instruction pointer of the frame. */
+    uint64_t m_ip;
+
+    /**
+     * @var The bounds of the stack being unwound. Saved registers are read only if they lie within
+     * these bounds (set by the caller before stepping, an empty range disallows all such reads).
+     */
+    uint64_t m_stackLow;
+    uint64_t m_stackHigh;
+
+    /** @var Bit mask of registers whose values are known. */
+    uint32_t m_validRegs;
+
+    /**
+     * @var Specifies whether the instruction pointer is exact (innermost frame, or interrupted
+     * frame), rather than a return address pointing past the call instruction.
+     */
+    bool m_exactIp;
+};
+
+/**
+ * @def Captures the current register state into an unwinding context, such that the context
+ * describes the calling function at the point of capture (callee-saved registers, stack pointer and
+ * instruction pointer only). This must be expanded in the function from which unwinding starts.
+ */
+#if defined(__x86_64__)
+#define DWARF_UNWIND_CAPTURE_CONTEXT(context)                                                   \
+    asm volatile(                                                                               \
+        "movq %%rbx, 24(%0)\n\t"                                                                \
+        "movq %%rbp, 48(%0)\n\t"                                                                \
+        "movq %%rsp, 56(%0)\n\t"                                                                \
+        "movq %%r12, 96(%0)\n\t"                                                                \
+        "movq %%r13, 104(%0)\n\t"                                                               \
+        "movq %%r14, 112(%0)\n\t"                                                               \
+        "movq %%r15, 120(%0)\n\t"                                                               \
+        "leaq 1f(%%rip), %%rax\n\t"                                                             \
+        "movq %%rax, 136(%0)\n\t"                                                               \
+        "1:\n\t"                                                                                \
+        :                                                                                       \
+        : "r"((context).m_regs)                                                                 \
+        : "rax", "memory");                                                                     \
+    (context).m_validRegs = 0xF0C8;                                                             \
+    (context).m_exactIp = true
+#else
+#define DWARF_UNWIND_CAPTURE_CONTEXT(context)                                                   \
+    asm volatile(                                                                               \
+        "stp x19, x20, [%0, #152]\n\t"                                                          \
+        "stp x21, x22, [%0, #168]\n\t"                                                          \
+        "stp x23, x24, [%0, #184]\n\t"                                                          \
+        "stp x25, x26, [%0, #200]\n\t"                                                          \
+        "stp x27, x28, [%0, #216]\n\t"                                                          \
+        "stp x29, x30, [%0, #232]\n\t"                                                          \
+        "mov x9, sp\n\t"                                                                        \
+        "str x9, [%0, #248]\n\t"                                                                \
+        "adr x9, 1f\n\t"                                                                        \
+        "str x9, [%0, #256]\n\t"                                                                \
+        "1:\n\t"                                                                                \
+        :                                                                                       \
+        : "r"((context).m_regs)                                                                 \
+        : "x9", "memory");                                                                      \
+    (context).m_validRegs = 0xFFF80000;                                                         \
+    (context).m_exactIp = true
+#endif
+
+/** @brief The result of a single unwinding step. */
+enum class DwarfUnwindResult : uint32_t {
+    /** @var The context now describes the calling frame. */
+    DUR_OK,
+
+    /** @var The outermost frame was reached. */
+    DUR_END,
+
+    /**
+     * @var The calling frame could not be computed (no unwind information for the instruction
+     * pointer, or unsupported unwind rules), so unwinding should continue by other means.
+     */
+    DUR_FAILED
+};
+
+// a module executable segment along with its .eh_frame_hdr lookup table
+struct DwarfUnwindModule {
+    uintptr_t m_start;
+    uintptr_t m_end;
+    const char* m_ehFrameHdr;
+    const char* m_fdeTable;
+    uint64_t m_fdeCount;
+};
+
+// an immutable snapshot of all loaded modules, sorted by segment address
+struct DwarfUnwindModuleTable {
+    uint64_t m_generation;
+    unsigned long long m_dlAdds;
+    unsigned long long m_dlSubs;
+    std::vector<DwarfUnwindModule> m_modules;
+};
+
+// a decoded unwind rule row, in the compact form kept by the row cache
+struct DwarfUnwindRow;
+
+// a row cache slot, guarded by a sequence counter (odd while being written)
+struct DwarfUnwindRowSlot;
+
+/**
+ * @brief A local DWARF call frame information unwinder, used as an alternative to libunwind.
+ * Unwind information is located by binary search in the .eh_frame_hdr table of the module
+ * containing the instruction pointer, and each decoded rule row is kept, along with the address
+ * range it applies to, in a lock-free direct-mapped cache, so that repeated unwinding of the same
+ * code costs a few memory loads per frame. The module table is an immutable snapshot that is
+ * replaced when modules are loaded or unloaded. When refreshing is disallowed (see @ref step()),
+ * stepping does not allocate memory, and the table is used as last refreshed, only as long as the
+ * loader reports that no module was loaded or unloaded since then.
+ * Only CFA rules of the form "register + offset", and register rules of the forms undefined,
+ * same value, offset(N), val_offset(N) and register(R) are supported. Frames that require other
+ * rules (e.g. DWARF expressions in PLT entries) fail to unwind, except for signal trampolines,
+ * which are recognized by their code.
+ */
+class DwarfUnwinder {
+public:
+    /** @brief Creates the singleton instance of the unwinder. */
+    static DbgUtilErr createInstance();
+
+    /** @brief Retrieves a reference to the single instance of the unwinder. */
+    static DwarfUnwinder* getInstance();
+
+    /** @brief Destroys the singleton instance of the unwinder. */
+    static void destroyInstance();
+
+    /**
+     * @brief Initializes an unwinding context from a signal context (ucontext_t).
+     * @param[out] context The resulting unwinding context.
+     * @param signalContext The signal context.
+     */
+    static void initContext(DwarfUnwindContext& context, void* signalContext);
+
+    /**
+     * @brief Initializes an unwinding context describing a frame whose register state is known
+     * only partially (i.e. after frame pointer unwinding).
+     * @param[out] context The resulting unwinding context.
+     * @param ip The frame return address.
+     * @param sp The frame stack pointer.
+     * @param fp The frame pointer register value.
+     */
+    static void initContext(DwarfUnwindContext& context, uint64_t ip, uint64_t sp, uint64_t fp);
+
+    /**
+     * @brief Moves the unwinding context to the calling frame.
+     * @param[in,out] context The unwinding context.
+     * @param allowRefresh Specifies whether the module table may be refreshed when modules were
+     * loaded or unloaded since it was built. Refreshing allocates memory, so it should be
+     * disallowed in signal handlers, in which case the table is used as last refreshed (see @ref
+     * syncModuleTable()), and frames whose unwinding requires reading module memory fail to unwind
+     * if modules were loaded or unloaded since then.
+     * @return DwarfUnwindResult The step result.
+     */
+    DwarfUnwindResult step(DwarfUnwindContext& context, bool allowRefresh);
+
+    /**
+     * @brief Refreshes the module table if modules were loaded or unloaded since it was built.
+     * Components unwinding in signal handlers (where refreshing is disallowed) may call this
+     * periodically from a regular thread, so that frames of newly loaded modules can be unwound.
+     * @return DbgUtilErr The operation result.
+     */
+    inline DbgUtilErr syncModuleTable() { return refreshModuleTable(false); }
+
+private:
+    DwarfUnwinder();
+    DwarfUnwinder(const DwarfUnwinder&) = delete;
+    DwarfUnwinder(DwarfUnwinder&&) = delete;
+    DwarfUnwinder& operator=(const DwarfUnwinder&) = delete;
+    ~DwarfUnwinder();
+
+    static DwarfUnwinder* sInstance;
+
+    std::atomic<DwarfUnwindModuleTable*> m_moduleTable;
+    std::vector<DwarfUnwindModuleTable*> m_retiredTables;
+    std::mutex m_refreshLock;
+    DwarfUnwindRowSlot* m_rowCache;
+
+    bool stepSignalFrame(DwarfUnwindContext& context, bool allowRefresh);
+    const DwarfUnwindModuleTable* getModuleTable(bool allowRefresh);
+    DbgUtilErr refreshModuleTable(bool force);
+    static const DwarfUnwindModule* findModule(const DwarfUnwindModuleTable* table, uintptr_t pc);
+    bool getRow(uintptr_t pc, DwarfUnwindRow& row, bool allowRefresh);
+    bool lookupRow(uintptr_t pc, uint64_t generation, DwarfUnwindRow& row);
+    void storeRow(uintptr_t pc, uint64_t rowStart, uint64_t rowEnd, uint64_t generation,
+                  const DwarfUnwindRow& row);
+};
+
+/**
+ * @brief Queries whether the builtin unwinder is used (i.e. when requested by the @ref
+ * DBGUTIL_BUILTIN_UNWIND flag, or when libunwind is not available).
+ */
+extern bool isDwarfUnwindEnabled();
+
+extern DbgUtilErr initDwarfUnwinder();
+extern DbgUtilErr termDwarfUnwinder();
+
+}  // namespace dbgutil
+
+#endif  // DBGUTIL_DWARF_UNWIND_SUPPORTED
+
+#endif  // __DWARF_UNWINDER_H__
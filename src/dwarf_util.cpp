@@ -1,7 +1,12 @@
 #include "dwarf_util.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <thread>
 
 #include "dbgutil_log_imp.h"
 #include "dwarf_def.h"
@@ -12,36 +17,54 @@ namespace dbgutil {
 
 static Logger sLogger;
 
+// maximum number of threads used for scanning compilation units when .debug_aranges is missing
+#define DBGUTIL_CU_SCAN_THREADS 4u
+
+// number of compilation units each scan thread picks at a time
+#define DBGUTIL_CU_SCAN_BATCH_SIZE ((size_t)64)
+
+static std::atomic<size_t> sLineCacheBudget(DBGUTIL_DEFAULT_LINE_CACHE_BUDGET);
+
 void DwarfUtil::initLogger() { registerLogger(sLogger, "dwarf_util"); }
 void DwarfUtil::termLogger() { unregisterLogger(sLogger); }
 
-DwarfUtil::DwarfUtil() {}
+void DwarfUtil::setLineCacheBudget(size_t budgetBytes) {
+    sLineCacheBudget.store(budgetBytes, std::memory_order_relaxed);
+}
+
+size_t DwarfUtil::getLineCacheBudget() { return sLineCacheBudget.load(std::memory_order_relaxed); }
 
-DbgUtilErr DwarfUtil::readAddrRangeHeader(InputStream& is, uint64_t& len, bool& is64Bit,
+DwarfUtil::DwarfUtil() : m_lineCacheMemoryUsage(0) {}
+
+DwarfUtil::~DwarfUtil() {}
+
+DbgUtilErr DwarfUtil::readAddrRangeHeader(DwarfCursor& cursor, uint64_t& len, bool& is64Bit,
                                           uint64_t& offset, uint8_t& addressSize) {
     // read initial length
     is64Bit = false;
-    DWARF_READ_INIT_LEN(is, len, is64Bit);
+    len = cursor.readInitialLength(is64Bit);
 
     // read version (uhalf - unsigned, 2-byte integer)
-    // currently only version 3 is supported
-    uint16_t version = 0;
-    DBGUTIL_DESERIALIZE_INT16(is, version);
-    if (version != 2) {
-        LOG_DEBUG(sLogger, "ERROR: Address range header version %u not supported",
-                  (unsigned)version);
-        return DBGUTIL_ERR_NOT_IMPLEMENTED;
-    }
+    // currently only version 2 is supported
+    uint16_t version = cursor.readU16();
 
     // offset into debug info
-    DWARF_READ_OFFSET(is, offset, is64Bit);
+    offset = cursor.readOffset(is64Bit);
 
     // address size (ubyte - unsigned, 1-byte integer)
-    DBGUTIL_DESERIALIZE_INT8(is, addressSize);
+    addressSize = cursor.readU8();
 
     // segment size (ubyte - unsigned, 1-byte integer)
-    uint8_t segmentSize = 0;
-    DBGUTIL_DESERIALIZE_INT8(is, segmentSize);
+    uint8_t segmentSize = cursor.readU8();
+    if (!cursor.isValid()) {
+        return cursor.getResult();
+    }
+
+    if (version != 2) {
+        LOG_DEBUG(sLogger, "ERROR: Address range header version %u not supported",
+                  (unsigned)version);
+        return DBGUTIL_ERR_NOT_IMPLEMENTED;
+    }
     if (segmentSize != 0) {
         LOG_DEBUG(sLogger, "ERROR: Segmented address (segment size %u) not supported",
                   (unsigned)segmentSize);
@@ -50,59 +73,77 @@ DbgUtilErr DwarfUtil::readAddrRangeHeader(InputStream& is, uint64_t& len, bool&
     return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfUtil::readCUHeader(InputStream& is, uint64_t& len, uint64_t& abbrevOffset,
-                                   uint8_t& addressSize, bool& is64Bit) {
+DbgUtilErr DwarfUtil::readCUHeader(DwarfCursor& cursor, uint64_t& len, uint64_t& abbrevOffset,
+                                   uint8_t& addressSize, bool& is64Bit, uint16_t& version) {
     // read initial length
-    len = 0;
     is64Bit = false;
-    DWARF_READ_INIT_LEN(is, len, is64Bit);
+    len = cursor.readInitialLength(is64Bit);
 
     // read version (uhalf - unsigned, 2-byte integer)
-    // currently only version 3 is supported
-    uint16_t version = 0;
-    DBGUTIL_DESERIALIZE_INT16(is, version);
+    // currently versions 3 to 5 are supported
+    version = cursor.readU16();
+    if (!cursor.isValid()) {
+        return cursor.getResult();
+    }
     if (version < 3) {
         LOG_DEBUG(sLogger, "ERROR: Compilation unit header version %u not supported",
                   (unsigned)version);
         return DBGUTIL_ERR_NOT_IMPLEMENTED;
     }
 
-    if (version == 3) {
+    if (version == 3 || version == 4) {
         // offset into debug abbrev
-        DWARF_READ_OFFSET(is, abbrevOffset, is64Bit);
+        abbrevOffset = cursor.readOffset(is64Bit);
 
         // address size (ubyte - unsigned, 1-byte integer)
-        DBGUTIL_DESERIALIZE_INT8(is, addressSize);
+        addressSize = cursor.readU8();
     } else if (version == 5) {
-        uint8_t unitType = 0;
-        DBGUTIL_DESERIALIZE_INT8(is, unitType);
+        uint8_t unitType = cursor.readU8();
         if (unitType != DW_UT_compile) {
-            return DBGUTIL_ERR_DATA_CORRUPT;
+            return cursor.isValid() ? DBGUTIL_ERR_DATA_CORRUPT : cursor.getResult();
         }
 
         // address size (ubyte - unsigned, 1-byte integer)
-        DBGUTIL_DESERIALIZE_INT8(is, addressSize);
+        addressSize = cursor.readU8();
 
         // offset into debug abbrev
-        DWARF_READ_OFFSET(is, abbrevOffset, is64Bit);
+        abbrevOffset = cursor.readOffset(is64Bit);
     } else {
-        // version 4 not supported yet
-        LOG_DEBUG(sLogger, "ERROR: Compilation unit header version 4 not supported");
+        LOG_DEBUG(sLogger, "ERROR: Compilation unit header version %u not supported",
+                  (unsigned)version);
         return DBGUTIL_ERR_NOT_IMPLEMENTED;
     }
-    return DBGUTIL_ERR_OK;
+    return cursor.getResult();
 }
 
 DbgUtilErr DwarfUtil::open(const DwarfData& dwarfData, void* moduleBase, bool is664Bit,
-                           bool isExe) {
+                           bool isExe, const SymbolIndex* symbolIndex /* = nullptr */) {
     m_dwarfData = dwarfData;
     m_moduleBase = moduleBase;
     m_is64Bit = is664Bit;
     m_isExe = isExe;
+    if (symbolIndex != nullptr && symbolIndex->hasCURanges()) {
+        loadRangeCuMap(*symbolIndex);
+        return DBGUTIL_ERR_OK;
+    }
+    if (!m_dwarfData.hasDebugAddrRanges()) {
+        // no address range table (e.g. clang default output), so scan compilation units instead
+        return buildRangeCuMapFromInfo();
+    }
     return buildRangeCuMap();
 }
 
-DbgUtilErr DwarfUtil::searchSymbol(void* symAddress, SymbolInfo& symbolInfo, void* relocationBase) {
+void DwarfUtil::exportCURanges(SymbolIndexBuilder& builder) const {
+    for (size_t i = 0; i < m_rangeCUIndex.size(); ++i) {
+        builder.addCURange(m_rangeCUIndex.getRangeStart(i), m_rangeCUIndex.getRangeSize(i),
+                           m_rangeCUOffsets[i]);
+    }
+    builder.setHasCURanges();
+}
+
+DbgUtilErr DwarfUtil::searchSymbol(void* symAddress, SymbolInfo& symbolInfo,
+                                   void* relocationBase /* = nullptr */,
+                                   SearchCache* searchCache /* = nullptr */) {
     // for executable images the address is already ok, but for shared objects it needs to be
     // translated to offset
     uint64_t symOff = (uint64_t)symAddress - (uint64_t)m_moduleBase;
@@ -110,47 +151,140 @@ DbgUtilErr DwarfUtil::searchSymbol(void* symAddress, SymbolInfo& symbolInfo, voi
     DwarfSearchData searchData = {symAddress, symbolInfo.m_moduleBaseAddress, symOff,
                                   relocationBase, relocSymAddr};
 
+    std::shared_ptr<DwarfLineUtil> lineUtil;
+    DbgUtilErr rc = findLineUtil(relocSymAddr, searchCache, lineUtil);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    return lineUtil->searchLineMatrix(searchData, symbolInfo);
+}
+
+DbgUtilErr DwarfUtil::searchSymbol(void* symAddress, SymbolInfoRef& symbolInfo,
+                                   StringPool& stringPool, void* relocationBase /* = nullptr */,
+                                   SearchCache* searchCache /* = nullptr */) {
+    uint64_t symOff = (uint64_t)symAddress - (uint64_t)m_moduleBase;
+    uint64_t relocSymAddr = ((uint64_t)relocationBase) + symOff;
+
+    std::shared_ptr<DwarfLineUtil> lineUtil;
+    DbgUtilErr rc = findLineUtil(relocSymAddr, searchCache, lineUtil);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    const char* filePath = nullptr;
+    rc = lineUtil->findLineInfo(relocSymAddr, filePath, symbolInfo.m_lineNumber,
+                                symbolInfo.m_columnIndex);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    // the line program may be evicted from the cache, so the file path must be interned
+    const char* path = stringPool.intern(filePath);
+    if (path == nullptr) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    symbolInfo.m_fileName = path;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfUtil::findLineUtil(uint64_t relocSymAddr, SearchCache* searchCache,
+                                   std::shared_ptr<DwarfLineUtil>& lineUtil) {
+    // check first whether the previous search hit the same compilation unit
+    if (searchCache != nullptr && searchCache->contains(relocSymAddr)) {
+        lineUtil = searchCache->m_lineUtil;
+        return DBGUTIL_ERR_OK;
+    }
+
     // now search in range map the relocated address (as it appears when debug info was prepared)
     LOG_DEBUG(sLogger, "Searching for relocated address: %p", (void*)relocSymAddr);
-    RangeCuSet::iterator itr = m_rangeCUSet.lower_bound(relocSymAddr);
-    if (itr == m_rangeCUSet.end()) {
+    size_t rangeIndex = m_rangeCUIndex.findRange(relocSymAddr);
+    if (rangeIndex == DBGUTIL_RANGE_NOT_FOUND) {
         return DBGUTIL_ERR_NOT_FOUND;
     }
 
-    const AddrRange& rangeData = *itr;
-    if (rangeData.contains((uint64_t)relocSymAddr)) {
-        return searchSymbolInCU(searchData, rangeData.m_debugInfoOffset, symbolInfo);
+    // get line program of compilation unit
+    uint64_t lineProgOffset = 0;
+    DbgUtilErr rc = getLineProgOffset(m_rangeCUOffsets[rangeIndex], lineProgOffset);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
     }
-    return DBGUTIL_ERR_NOT_FOUND;
+    rc = getLineUtil(lineProgOffset, lineUtil);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    if (searchCache != nullptr) {
+        searchCache->m_rangeFrom = m_rangeCUIndex.getRangeStart(rangeIndex);
+        searchCache->m_rangeTo =
+            searchCache->m_rangeFrom + m_rangeCUIndex.getRangeSize(rangeIndex);
+        searchCache->m_lineUtil = lineUtil;
+    }
+    return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfUtil::readCUData(uint64_t offset, CUData& cuData) {
+DbgUtilErr DwarfUtil::getLineProgOffset(uint64_t debugInfoOffset, uint64_t& lineProgOffset) {
+    // compilation unit data is read once, and only the line program offset is remembered
+    {
+        std::unique_lock<std::mutex> lock(m_lineCacheLock);
+        LineProgOffsetMap::iterator itr = m_lineProgOffsetMap.find(debugInfoOffset);
+        if (itr != m_lineProgOffsetMap.end()) {
+            lineProgOffset = itr->second;
+            return DBGUTIL_ERR_OK;
+        }
+    }
+
+    CUData cuData;
+    DbgUtilErr rc = readCUData(debugInfoOffset, cuData);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    lineProgOffset = cuData.m_lineProgOffset;
+
+    std::unique_lock<std::mutex> lock(m_lineCacheLock);
+    try {
+        m_lineProgOffsetMap.insert(LineProgOffsetMap::value_type(debugInfoOffset, lineProgOffset));
+    } catch (std::bad_alloc&) {
+        // not remembered, this is harmless
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfUtil::readCUData(uint64_t offset, CUData& cuData,
+                                 std::vector<AddrRange>* ranges /* = nullptr */) {
     const DwarfSection& debugInfoSection = m_dwarfData.getDebugInfo();
-    FixedInputStream is(debugInfoSection.m_start + offset, debugInfoSection.m_size - offset);
+    if (offset >= debugInfoSection.m_size) {
+        LOG_ERROR(sLogger, "Invalid compilation unit offset %" PRIu64 " (section size %" PRIu64
+                  ")", offset, debugInfoSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    DwarfCursor cursor(debugInfoSection.m_start + offset, debugInfoSection.m_size - offset);
 
     // read CU header
     uint64_t len = 0;
     uint64_t abbrevOffset = 0;
-    bool is64Bit = false;
-    uint8_t addressSize = 0;
-    DbgUtilErr rc = readCUHeader(is, len, abbrevOffset, addressSize, is64Bit);
+    DbgUtilErr rc = readCUHeader(cursor, len, abbrevOffset, cuData.m_addressSize,
+                                 cuData.m_is64Bit, cuData.m_version);
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
     }
+    cuData.m_debugInfoOffset = offset;
+    bool is64Bit = cuData.m_is64Bit;
+    uint8_t addressSize = cuData.m_addressSize;
 
     // we don't read entire CU debug entry tree, but only top level CU tag
     // first read abbreviation code
-    uint64_t abbrevCode = 0;
-    DWARF_READ_ULEB128(is, abbrevCode);
-
-    // now read entry descriptor from abbreviation table
-    uint64_t tag = 0;
-    bool hasChildren = false;
-    AttrList attrs;
-    rc = readAbbrevDecl(abbrevOffset, abbrevCode, tag, hasChildren, attrs);
+    uint64_t abbrevCode = cursor.readULEB128();
+    if (!cursor.isValid()) {
+        return cursor.getResult();
+    }
+
+    // now get entry descriptor from (decoded) abbreviation table
+    const AbbrevDecl* abbrevDecl = nullptr;
+    const Attr* attrs = nullptr;
+    rc = getAbbrevDecl(abbrevOffset, abbrevCode, abbrevDecl, attrs);
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
     }
+    uint64_t tag = abbrevDecl->m_tag;
 
     // tag is not expected to be very large
     if (tag >= UINT32_MAX) {
@@ -167,27 +301,42 @@ DbgUtilErr DwarfUtil::readCUData(uint64_t offset, CUData& cuData) {
         return DBGUTIL_ERR_NOT_IMPLEMENTED;
     }
 
+    // when attributes are not specified, the unit's tables in .debug_addr and .debug_rnglists
+    // follow the section header
+    cuData.m_addrBase = is64Bit ? 16 : 8;
+    cuData.m_rngListBase = is64Bit ? 20 : 12;
+
     // read attribute values, according to spec in abbrev
-    // we stop when we have name and stmt list
-    for (Attr& attr : attrs) {
-        if (attr.m_name == DW_AT_name) {
-            rc = dwarfReadString(is, attr.m_form, is64Bit, m_dwarfData, cuData.m_fileName);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
+    // NOTE: address related attributes may refer to other attributes that appear later (e.g.
+    // DW_AT_low_pc of form DW_FORM_addrx requires DW_AT_addr_base), so they are first collected,
+    // and resolved only after all attributes are read
+    // NOTE: cursor errors are sticky, so they are checked only once when all attributes are read
+    uint64_t lowPcForm = 0;
+    uint64_t lowPc = 0;
+    uint64_t highPcForm = 0;
+    uint64_t highPc = 0;
+    uint64_t rangesForm = 0;
+    uint64_t rangesValue = 0;
+    for (uint32_t i = 0; i < abbrevDecl->m_attrCount; ++i) {
+        const Attr& attr = attrs[i];
+        if (attr.m_name == DW_AT_name && attr.m_form != DW_FORM_strx &&
+            (attr.m_form < DW_FORM_strx1 || attr.m_form > DW_FORM_strx4)) {
+            // NOTE: string offset table is not supported, the name is only informative anyway
+            cuData.m_fileName = cursor.readString(attr.m_form, is64Bit, m_dwarfData);
         }
 
         // check for line offset
         else if (attr.m_name == DW_AT_stmt_list) {
-            DWARF_READ_OFFSET(is, cuData.m_lineProgOffset, is64Bit);
+            cuData.m_lineProgOffset = cursor.readOffset(is64Bit);
         }
 
         // check for low PC
         else if (attr.m_name == DW_AT_low_pc) {
-            uint64_t addr = 0;
-            DWARF_READ_ADDRESS(is, addr, addressSize);
-            if (addr != 0) {
-                cuData.m_rangeLow = addr;
+            lowPcForm = attr.m_form;
+            if (DwarfCursor::isAddrIndexForm(attr.m_form)) {
+                lowPc = cursor.readAddrIndex(attr.m_form);
+            } else {
+                lowPc = cursor.readAddress(addressSize);
             }
         }
 
@@ -195,281 +344,458 @@ DbgUtilErr DwarfUtil::readCUData(uint64_t offset, CUData& cuData) {
         else if (attr.m_name == DW_AT_high_pc) {
             // check the form, if it is constant, then we have a size, if it is of address class
             // then we have an address
-            if (addressSize == 8) {
-                if (attr.m_form == DW_FORM_addr) {
-                    DWARF_READ_ADDRESS(is, cuData.m_rangeHigh, addressSize);
-                } else if (attr.m_form == DW_FORM_implicit_const) {
-                    cuData.m_rangeHigh = cuData.m_rangeLow + attr.m_implicitValue;
-                } else {
-                    uint64_t rangeSize = 0;
-                    DWARF_READ_CONST(is, rangeSize, attr.m_form);
-                    cuData.m_rangeHigh = cuData.m_rangeLow + rangeSize;
-                }
+            highPcForm = attr.m_form;
+            if (attr.m_form == DW_FORM_addr) {
+                highPc = cursor.readAddress(addressSize);
+            } else if (DwarfCursor::isAddrIndexForm(attr.m_form)) {
+                highPc = cursor.readAddrIndex(attr.m_form);
+            } else if (attr.m_form == DW_FORM_implicit_const) {
+                highPc = attr.m_implicitValue;
+            } else {
+                highPc = cursor.readConst(attr.m_form);
             }
         }
 
-        // check for CU base address (used by range list)
+        // check for the unit's entries in .debug_addr
         else if (attr.m_name == DW_AT_addr_base) {
-            // read offset into .debug_addr section
-            uint64_t secOffset = 0;
-            DWARF_READ_OFFSET(is, secOffset, is64Bit);
-            // TODO: is this right? does the first entry contain the base address?
-            rc = readAddr(secOffset, cuData.m_baseAddress, addressSize);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
+            cuData.m_addrBase = cursor.readOffset(is64Bit);
+        }
+
+        // check for the unit's range list offset table in .debug_rnglists
+        else if (attr.m_name == DW_AT_rnglists_base) {
+            cuData.m_rngListBase = cursor.readOffset(is64Bit);
         }
 
         // check for ranges
         else if (attr.m_name == DW_AT_ranges) {
-            uint64_t rngOffset = 0;
+            rangesForm = attr.m_form;
             if (attr.m_form == DW_FORM_rnglistx) {
-                DWARF_READ_ULEB128(is, rngOffset);
+                rangesValue = cursor.readULEB128();
             } else if (attr.m_form == DW_FORM_sec_offset) {
-                DWARF_READ_OFFSET(is, rngOffset, is64Bit);
+                rangesValue = cursor.readOffset(is64Bit);
+            } else if (attr.m_form == DW_FORM_data4 || attr.m_form == DW_FORM_data8) {
+                // pre DWARF 4 units use constant class for section offsets
+                rangesValue = cursor.readConst(attr.m_form);
             } else {
                 LOG_DEBUG(sLogger, "ERROR: CU Attribute form %s not supported",
                           getDwarfFormName((unsigned)attr.m_form));
                 return DBGUTIL_ERR_NOT_IMPLEMENTED;
             }
-            // read range list from debug section .debug_rnglists
-            rc = readRangeListBounds(rngOffset, cuData.m_baseAddress, is64Bit, addressSize,
-                                     cuData.m_rangeLow, cuData.m_rangeHigh);
+        }
+
+        // otherwise skip attribute
+        else if (!cursor.skipForm(attr.m_form, is64Bit, addressSize)) {
+            LOG_DEBUG(sLogger, "ERROR: CU Attribute form %s not supported",
+                      getDwarfFormName((unsigned)attr.m_form));
+            return DBGUTIL_ERR_NOT_IMPLEMENTED;
+        }
+    }
+    if (!cursor.isValid()) {
+        return cursor.getResult();
+    }
+
+    // resolve unit base address
+    if (DwarfCursor::isAddrIndexForm(lowPcForm)) {
+        rc = readAddrEntry(cuData, lowPc, cuData.m_lowPc);
+        if (rc != DBGUTIL_ERR_OK) {
+            return rc;
+        }
+    } else {
+        cuData.m_lowPc = lowPc;
+    }
+    if (ranges == nullptr) {
+        return DBGUTIL_ERR_OK;
+    }
+
+    // collect all address ranges of the unit, either from the range list, or from low/high pc
+    if (rangesForm != 0) {
+        uint64_t listOffset = rangesValue;
+        if (rangesForm == DW_FORM_rnglistx) {
+            rc = readRangeListOffset(cuData, rangesValue, listOffset);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
             }
         }
-
-        // otherwise skip attribute
-        else {
-            if (attr.m_form == DW_FORM_string) {
-                std::string strVal;
-                DBGUTIL_DESERIALIZE_NT_STRING(is, strVal);
-            } else if (attr.m_form == DW_FORM_data1) {
-                uint8_t val;
-                DBGUTIL_DESERIALIZE_INT8(is, val);
-            } else if (attr.m_form == DW_FORM_data2) {
-                uint16_t val;
-                DBGUTIL_DESERIALIZE_INT16(is, val);
-            } else if (attr.m_form == DW_FORM_data4) {
-                uint32_t val;
-                DBGUTIL_DESERIALIZE_INT32(is, val);
-            } else if (attr.m_form == DW_FORM_data8) {
-                uint64_t val;
-                DBGUTIL_DESERIALIZE_INT64(is, val);
-            } else if (attr.m_form == DW_FORM_strp) {
-                uint64_t strOffset = 0;
-                DWARF_READ_OFFSET(is, strOffset, is64Bit);
-            } else if (attr.m_form == DW_FORM_line_strp) {
-                uint64_t strOffset = 0;
-                DWARF_READ_OFFSET(is, strOffset, is64Bit);
-            } else if (attr.m_form == DW_FORM_addr) {
-                uint64_t addr;
-                DWARF_READ_ADDRESS(is, addr, addressSize);
-            } else if (attr.m_form == DW_FORM_sec_offset) {
-                uint64_t secOffset;
-                DWARF_READ_OFFSET(is, secOffset, is64Bit);
-            } else {
-                LOG_DEBUG(sLogger, "ERROR: CU Attribute form %s not supported",
-                          getDwarfFormName((unsigned)attr.m_form));
-                return DBGUTIL_ERR_NOT_IMPLEMENTED;
+        if (cuData.m_version >= 5) {
+            return readRangeList(cuData, listOffset, *ranges);
+        }
+        return readRangeListV4(cuData, listOffset, *ranges);
+    }
+    if (lowPcForm != 0 && highPcForm != 0) {
+        uint64_t endAddress = 0;
+        if (highPcForm == DW_FORM_addr) {
+            endAddress = highPc;
+        } else if (DwarfCursor::isAddrIndexForm(highPcForm)) {
+            rc = readAddrEntry(cuData, highPc, endAddress);
+            if (rc != DBGUTIL_ERR_OK) {
+                return rc;
             }
+        } else {
+            endAddress = cuData.m_lowPc + highPc;
         }
+        addCURange(cuData, cuData.m_lowPc, endAddress, *ranges);
     }
     return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfUtil::readAbbrevDecl(uint64_t offset, uint64_t abbrevCode, uint64_t& tag,
-                                     bool& hasChildren, AttrList& attrs) const {
-    FixedInputStream is(m_dwarfData.getDebugAbbrev().m_start + offset,
-                        m_dwarfData.getDebugAbbrev().m_size - offset);
+const DwarfUtil::AbbrevDecl* DwarfUtil::AbbrevTable::findDecl(uint64_t abbrevCode) const {
+    if (m_isDense) {
+        if (abbrevCode == 0 || abbrevCode > m_decls.size()) {
+            return nullptr;
+        }
+        return &m_decls[abbrevCode - 1];
+    }
+    std::vector<AbbrevDecl>::const_iterator itr = std::lower_bound(
+        m_decls.begin(), m_decls.end(), abbrevCode,
+        [](const AbbrevDecl& decl, uint64_t code) { return decl.m_code < code; });
+    if (itr == m_decls.end() || itr->m_code != abbrevCode) {
+        return nullptr;
+    }
+    return &(*itr);
+}
 
-    // read abbreviation code, it should be the same as th input
-    uint64_t currAbbrevCode = 0;
-    do {
-        DWARF_READ_ULEB128(is, currAbbrevCode);
-        if (currAbbrevCode == 0) {
-            // reached end of table
-            return DBGUTIL_ERR_NOT_FOUND;
+DbgUtilErr DwarfUtil::getAbbrevTable(uint64_t offset, const AbbrevTable*& abbrevTable) {
+    {
+        std::unique_lock<std::mutex> lock(m_abbrevLock);
+        AbbrevTableMap::iterator itr = m_abbrevTableMap.find(offset);
+        if (itr != m_abbrevTableMap.end()) {
+            abbrevTable = itr->second.get();
+            return DBGUTIL_ERR_OK;
         }
+    }
+
+    // decode table outside of lock
+    // NOTE: two threads may decode the same table concurrently, but only the first one is kept
+    std::unique_ptr<AbbrevTable> newTable(new (std::nothrow) AbbrevTable());
+    if (!newTable) {
+        LOG_ERROR(sLogger, "Failed to allocate abbreviation table, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    DbgUtilErr rc = readAbbrevTable(offset, *newTable);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    std::unique_lock<std::mutex> lock(m_abbrevLock);
+    std::pair<AbbrevTableMap::iterator, bool> res =
+        m_abbrevTableMap.insert(AbbrevTableMap::value_type(offset, nullptr));
+    if (res.second) {
+        res.first->second = std::move(newTable);
+    }
+    abbrevTable = res.first->second.get();
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfUtil::readAbbrevTable(uint64_t offset, AbbrevTable& abbrevTable) const {
+    const DwarfSection& debugAbbrevSection = m_dwarfData.getDebugAbbrev();
+    if (offset >= debugAbbrevSection.m_size) {
+        LOG_ERROR(sLogger, "Invalid abbreviation table offset %" PRIu64 " (section size %" PRIu64
+                  ")", offset, debugAbbrevSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    FixedInputStream is(debugAbbrevSection.m_start + offset, debugAbbrevSection.m_size - offset);
 
-        // NOTE: even if there is no match, we need to continue reading the entire abbrev
-        // declaration, because entry size is variable, and we don't have a direct offset
+    // read all declarations until reaching the null entry (or end of section)
+    while (!is.empty()) {
+        AbbrevDecl decl = {};
+        DWARF_READ_ULEB128(is, decl.m_code);
+        if (decl.m_code == 0) {
+            // reached end of table
+            break;
+        }
 
         // read tag
-        DWARF_READ_ULEB128(is, tag);
+        DWARF_READ_ULEB128(is, decl.m_tag);
 
         // read has children (1 byte flag, not LEB128!)
         uint8_t childrenValue = 0;
         DBGUTIL_DESERIALIZE_INT8(is, childrenValue);
-        hasChildren = (childrenValue == DW_CHILDREN_yes);
+        decl.m_hasChildren = (childrenValue == DW_CHILDREN_yes);
 
         // read attributes
-        bool done = false;
-        while (!done) {
+        decl.m_attrStart = (uint32_t)abbrevTable.m_attrs.size();
+        for (;;) {
             uint64_t name = 0;
             uint64_t form = 0;
             DWARF_READ_ULEB128(is, name);
             DWARF_READ_ULEB128(is, form);
             if (name == 0 && form == 0) {
+                break;
+            }
+            if (name > UINT32_MAX || form > UINT32_MAX) {
+                LOG_ERROR(sLogger, "Invalid attribute specification at abbreviation table %" PRIu64,
+                          offset);
+                return DBGUTIL_ERR_DATA_CORRUPT;
+            }
+            int64_t val = 0;
+            if (form == DW_FORM_implicit_const) {
                 // special case: implicit const specifies attr value in abbrev entry
-                done = true;
-            } else {
-                uint64_t val = 0;
-                if (form == DW_FORM_implicit_const) {
-                    // read one more LEB128 for the attribute value
-                    DWARF_READ_ULEB128(is, val);
-                }
-                // push only when we reach the entry
-                if (currAbbrevCode == abbrevCode) {
-                    attrs.push_back({name, form, val});
-                }
+                DWARF_READ_SLEB128(is, val);
             }
+            abbrevTable.m_attrs.push_back({(uint32_t)name, (uint32_t)form, (uint64_t)val});
         }
-    } while (currAbbrevCode < abbrevCode);
+        decl.m_attrCount = (uint32_t)abbrevTable.m_attrs.size() - decl.m_attrStart;
 
-    if (currAbbrevCode == abbrevCode) {
-        return DBGUTIL_ERR_OK;
+        // codes are usually consecutive starting from 1, so they can be used directly as index
+        if (decl.m_code != abbrevTable.m_decls.size() + 1) {
+            abbrevTable.m_isDense = false;
+        }
+        abbrevTable.m_decls.push_back(decl);
+    }
+
+    if (!abbrevTable.m_isDense) {
+        std::sort(abbrevTable.m_decls.begin(), abbrevTable.m_decls.end(),
+                  [](const AbbrevDecl& lhs, const AbbrevDecl& rhs) {
+                      return lhs.m_code < rhs.m_code;
+                  });
+    }
+    abbrevTable.m_decls.shrink_to_fit();
+    abbrevTable.m_attrs.shrink_to_fit();
+    LOG_DEBUG(sLogger, "Decoded abbreviation table at offset %" PRIu64 ": %zu declarations",
+              offset, abbrevTable.m_decls.size());
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfUtil::getAbbrevDecl(uint64_t offset, uint64_t abbrevCode,
+                                    const AbbrevDecl*& abbrevDecl, const Attr*& attrs) {
+    const AbbrevTable* abbrevTable = nullptr;
+    DbgUtilErr rc = getAbbrevTable(offset, abbrevTable);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
     }
-    return DBGUTIL_ERR_NOT_FOUND;
+    abbrevDecl = abbrevTable->findDecl(abbrevCode);
+    if (abbrevDecl == nullptr) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    attrs = abbrevTable->getAttrs(*abbrevDecl);
+    return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfUtil::readRangeListBounds(uint64_t rngOffset, uint64_t cuBaseAddr,
-                                          bool /* is64Bit */, uint8_t addressSize,
-                                          uint64_t& rangeLow, uint64_t& rangeHigh) {
+DbgUtilErr DwarfUtil::readRangeList(const CUData& cuData, uint64_t listOffset,
+                                    std::vector<AddrRange>& ranges) {
     const DwarfSection& debugSection = m_dwarfData.getDebugRngLists();
-    FixedInputStream is(debugSection.m_start + rngOffset, debugSection.m_size - rngOffset);
+    if (listOffset >= debugSection.m_size) {
+        LOG_DEBUG(sLogger,
+                  "ERROR: Invalid range list offset %" PRIu64 " (section size %" PRIu64 ")",
+                  listOffset, debugSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    DwarfCursor cursor(debugSection.m_start + listOffset, debugSection.m_size - listOffset);
 
-    // read entries
-    bool done = false;
-    rangeLow = (uint64_t)-1;
-    rangeHigh = (uint64_t)-1;
-    do {
+    // read entries until end of list
+    // NOTE: cursor errors are sticky, and an exhausted cursor reads as end of list
+    uint64_t baseAddress = cuData.m_lowPc;
+    for (;;) {
         uint64_t startAddress = 0;
         uint64_t endAddress = 0;
-        uint8_t kind = 0;
-        DBGUTIL_DESERIALIZE_INT8(is, kind);
+        uint8_t kind = cursor.readU8();
         if (kind == DW_RLE_end_of_list) {
-            done = true;
+            break;
         } else if (kind == DW_RLE_base_addressx) {
-            LOG_DEBUG(sLogger, "ERROR: Range list kind not supported");
-            return DBGUTIL_ERR_NOT_IMPLEMENTED;
-            /*// read the index operand
-            uint64_t index = 0;
-            DWARF_READ_ULEB128(is, index);
-            // now read the address
-            DbgUtilErr rc = readAddr(index, cuBaseAddr, addressSize);
+            // base address given as index into .debug_addr
+            DbgUtilErr rc = readAddrEntry(cuData, cursor.readULEB128(), baseAddress);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
             }
-            continue;*/
+            continue;
         } else if (kind == DW_RLE_startx_endx) {
-            LOG_DEBUG(sLogger, "ERROR: Range list kind not supported");
-            return DBGUTIL_ERR_NOT_IMPLEMENTED;
-            /*// read bounded range indices into .debug_addr
-            uint64_t startIndex = 0;
-            uint64_t endIndex = 0;
-            DWARF_READ_ULEB128(is, startIndex);
-            DWARF_READ_ULEB128(is, endIndex);
-            // now read bounded range addresses
-            DbgUtilErr rc = readAddr(startIndex, startAddress, addressSize);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
+            // bounded range with both bounds given as indices into .debug_addr
+            uint64_t startIndex = cursor.readULEB128();
+            uint64_t endIndex = cursor.readULEB128();
+            DbgUtilErr rc = readAddrEntry(cuData, startIndex, startAddress);
+            if (rc == DBGUTIL_ERR_OK) {
+                rc = readAddrEntry(cuData, endIndex, endAddress);
             }
-            rc = readAddr(endIndex, endAddress, addressSize);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
-            }*/
+            }
         } else if (kind == DW_RLE_startx_length) {
-            LOG_DEBUG(sLogger, "ERROR: Range list kind not supported");
-            return DBGUTIL_ERR_NOT_IMPLEMENTED;
-            /*// bounded range with start as index, and then range length
-            uint64_t startIndex = 0;
-            uint64_t length = 0;
-            DWARF_READ_ULEB128(is, startIndex);
-            DWARF_READ_ULEB128(is, length);
-            // now read bounded range addresses
-            DbgUtilErr rc = readAddr(startIndex, startAddress, addressSize);
+            // bounded range with start as index, and then range length
+            uint64_t startIndex = cursor.readULEB128();
+            uint64_t length = cursor.readULEB128();
+            DbgUtilErr rc = readAddrEntry(cuData, startIndex, startAddress);
             if (rc != DBGUTIL_ERR_OK) {
                 return rc;
             }
-            endAddress = startAddress + length;*/
+            endAddress = startAddress + length;
         } else if (kind == DW_RLE_offset_pair) {
-            LOG_DEBUG(sLogger, "ERROR: Range list kind not supported");
-            return DBGUTIL_ERR_NOT_IMPLEMENTED;
-            /*// must be related to a base address, either specifically specified by a prior
-            // DW_RLE_base_addressx
-            uint64_t startOffset = 0;
-            uint64_t endOffset = 0;
-            DWARF_READ_ULEB128(is, startOffset);
-            DWARF_READ_ULEB128(is, endOffset);
-            startAddress = cuBaseAddr + startOffset;
-            endAddress = cuBaseAddr + endOffset;*/
+            // offsets relative to the current base address (unit base address unless specified
+            // by a prior base address entry)
+            uint64_t startOffset = cursor.readULEB128();
+            uint64_t endOffset = cursor.readULEB128();
+            startAddress = baseAddress + startOffset;
+            endAddress = baseAddress + endOffset;
         } else if (kind == DW_RLE_base_address) {
-            // base address
-            DWARF_READ_ADDRESS(is, cuBaseAddr, addressSize);
+            baseAddress = cursor.readAddress(cuData.m_addressSize);
             continue;
         } else if (kind == DW_RLE_start_end) {
-            // read bounded range addresses
-            DWARF_READ_ADDRESS(is, startAddress, addressSize);
-            DWARF_READ_ADDRESS(is, endAddress, addressSize);
+            startAddress = cursor.readAddress(cuData.m_addressSize);
+            endAddress = cursor.readAddress(cuData.m_addressSize);
         } else if (kind == DW_RLE_start_length) {
-            // bounded range with start address, and then range length
-            uint64_t length = 0;
-            DWARF_READ_ADDRESS(is, startAddress, addressSize);
-            DWARF_READ_ULEB128(is, length);
-            endAddress = startAddress + length;
+            startAddress = cursor.readAddress(cuData.m_addressSize);
+            endAddress = startAddress + cursor.readULEB128();
         } else {
-            LOG_DEBUG(sLogger, "ERROR: unexpected range list king %u", (unsigned)kind);
+            LOG_DEBUG(sLogger, "ERROR: unexpected range list kind %u", (unsigned)kind);
             return DBGUTIL_ERR_NOT_IMPLEMENTED;
         }
+        if (!cursor.isValid()) {
+            break;
+        }
+        addCURange(cuData, startAddress, endAddress, ranges);
+    }
+    return cursor.getResult();
+}
 
-        // check for end of range set
-        if (startAddress == 0 && endAddress == 0) {
-            done = true;
+DbgUtilErr DwarfUtil::readRangeListV4(const CUData& cuData, uint64_t listOffset,
+                                      std::vector<AddrRange>& ranges) {
+    const DwarfSection& debugSection = m_dwarfData.getDebugRanges();
+    if (listOffset >= debugSection.m_size) {
+        LOG_DEBUG(sLogger,
+                  "ERROR: Invalid range list offset %" PRIu64 " (section size %" PRIu64 ")",
+                  listOffset, debugSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    DwarfCursor cursor(debugSection.m_start + listOffset, debugSection.m_size - listOffset);
+
+    // entries are pairs of offsets relative to the base address, terminated by a null pair, where
+    // a pair starting with the largest address value selects a new base address
+    uint64_t maxAddress = cuData.m_addressSize == 8 ? UINT64_MAX : UINT32_MAX;
+    uint64_t baseAddress = cuData.m_lowPc;
+    for (;;) {
+        uint64_t startOffset = cursor.readAddress(cuData.m_addressSize);
+        uint64_t endOffset = cursor.readAddress(cuData.m_addressSize);
+        if (!cursor.isValid() || (startOffset == 0 && endOffset == 0)) {
+            break;
+        }
+        if (startOffset == maxAddress) {
+            baseAddress = endOffset;
         } else {
-            LOG_DEBUG(sLogger, "Read range in CU header: %p - %p", (void*)startAddress,
-                      (void*)endAddress);
-            // skip this weird case (why is this happening?)
-            if (startAddress == 0) {
-                continue;
-            }
-            // update total range bound
-            if (rangeLow == ((uint64_t)-1) || startAddress < rangeLow) {
-                rangeLow = startAddress;
-            }
-            if (rangeHigh == ((uint64_t)-1) || endAddress > rangeHigh) {
-                rangeHigh = endAddress;
-            }
+            addCURange(cuData, baseAddress + startOffset, baseAddress + endOffset, ranges);
         }
+    }
+    return cursor.getResult();
+}
+
+DbgUtilErr DwarfUtil::readRangeListOffset(const CUData& cuData, uint64_t index,
+                                          uint64_t& listOffset) {
+    // the offset table entries are relative to the table start
+    const DwarfSection& debugSection = m_dwarfData.getDebugRngLists();
+    uint64_t entrySize = cuData.m_is64Bit ? 8 : 4;
+    uint64_t entryOffset = cuData.m_rngListBase + index * entrySize;
+    if (entryOffset + entrySize > debugSection.m_size) {
+        LOG_DEBUG(sLogger, "ERROR: Invalid range list index %" PRIu64, index);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    DwarfCursor cursor(debugSection.m_start + entryOffset, entrySize);
+    listOffset = cuData.m_rngListBase + cursor.readOffset(cuData.m_is64Bit);
+    return cursor.getResult();
+}
 
-    } while (!done);
+DbgUtilErr DwarfUtil::readAddrEntry(const CUData& cuData, uint64_t index, uint64_t& address) {
+    const DwarfSection& debugSection = m_dwarfData.getDebugAddr();
+    uint64_t entryOffset = cuData.m_addrBase + index * cuData.m_addressSize;
+    if (entryOffset + cuData.m_addressSize > debugSection.m_size) {
+        LOG_DEBUG(sLogger,
+                  "ERROR: Invalid address index %" PRIu64 " (section .debug_addr size %" PRIu64 ")",
+                  index, debugSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    DwarfCursor cursor(debugSection.m_start + entryOffset, cuData.m_addressSize);
+    address = cursor.readAddress(cuData.m_addressSize);
+    return cursor.getResult();
+}
 
-    return DBGUTIL_ERR_OK;
+void DwarfUtil::addCURange(const CUData& cuData, uint64_t startAddress, uint64_t endAddress,
+                           std::vector<AddrRange>& ranges) {
+    // skip empty ranges, and ranges of discarded code (resolved by the linker to zero)
+    if (startAddress == 0 || endAddress <= startAddress) {
+        return;
+    }
+    LOG_DEBUG(sLogger, "Read range of CU at offset %" PRIu64 ": %p - %p", cuData.m_debugInfoOffset,
+              (void*)startAddress, (void*)endAddress);
+    ranges.emplace_back(startAddress, endAddress - startAddress, cuData.m_debugInfoOffset);
 }
 
-DbgUtilErr DwarfUtil::readAddr(uint64_t offset, uint64_t& address, uint8_t addressSize) {
-    DwarfSection section = {};
-    if (m_dwarfData.getSection(".debug_addr", section)) {
-        FixedInputStream is(section.m_start + offset, section.m_size - offset);
-        DWARF_READ_ADDRESS(is, address, addressSize);
-        return DBGUTIL_ERR_OK;
+void DwarfUtil::loadRangeCuMap(const SymbolIndex& symbolIndex) {
+    // ranges are stored in order, so they can be added directly
+    uint32_t rangeCount = symbolIndex.getCURangeCount();
+    m_rangeCUIndex.reserve(rangeCount);
+    m_rangeCUOffsets.reserve(rangeCount);
+    for (uint32_t i = 0; i < rangeCount; ++i) {
+        const SymbolIndex::CURange& range = symbolIndex.getCURange(i);
+        m_rangeCUIndex.addRange(range.m_from, range.m_size);
+        m_rangeCUOffsets.push_back(range.m_debugInfoOffset);
     }
-    LOG_DEBUG(sLogger, "ERROR: Section .debug_addr not found");
-    return DBGUTIL_ERR_NOT_IMPLEMENTED;
+    LOG_DEBUG(sLogger, "Loaded %u address ranges from symbol index", rangeCount);
+}
+
+template <unsigned AddressSize>
+DbgUtilErr DwarfUtil::readAddrRangeSet(DwarfCursor& cursor, uint64_t len, bool is64Bit,
+                                       uint64_t debugInfoOffset, std::vector<AddrRange>& ranges) {
+    // we would like to make sure we don't read past the range set, so we compute the set limit
+    // reduce partial header size (version, offset, address size and segment size), but do not
+    // include length field
+    uint64_t rawSetSize = len - (2 + (is64Bit ? 8 : 4) + 2);
+    uint64_t setLimit = cursor.getOffset() + rawSetSize;
+    LOG_DEBUG(sLogger, "Address range len=%u, CU offset=%u, raw-set-size=%u", (unsigned)len,
+              (unsigned)debugInfoOffset, (unsigned)rawSetSize);
+
+    // the entry set must be aligned to a tuple size, which is addr size + range size
+    // in case of address size 8 this means 16, and address size 4 requires alignment 8.
+    const uint32_t align = AddressSize * 2;
+    uint32_t alignDiff = cursor.getOffset() % align;
+    if (alignDiff != 0) {
+        LOG_DEBUG(sLogger, "Set start at offset %u is not aligned to %u, skipping %u bytes",
+                  (unsigned)cursor.getOffset(), align, align - alignDiff);
+        cursor.skip(align - alignDiff);
+        if (!cursor.isValid()) {
+            LOG_DEBUG(sLogger, "ERROR: Failed to skip %u bytes to first range pair: end of stream",
+                      align - alignDiff);
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+    }
+
+    // now read address ranges (pairs of address, size, terminated by null pair)
+    for (;;) {
+        uint64_t addr = cursor.readAddress<AddressSize>();
+        uint64_t size = cursor.readAddress<AddressSize>();
+        if (!cursor.isValid()) {
+            return cursor.getResult();
+        }
+        if (cursor.getOffset() > setLimit) {
+            LOG_DEBUG(sLogger, "ERROR: range set exceeded limit, no end set zero record pair seen");
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        if (addr == 0 && size == 0) {
+            if (cursor.getOffset() != setLimit) {
+                LOG_DEBUG(sLogger, "ERROR: range set reached limit but offset is incorrect");
+                return DBGUTIL_ERR_DATA_CORRUPT;
+            }
+            LOG_DEBUG(sLogger, "End of range set found exactly on correct input stream offset");
+            break;
+        }
+        if (addr == 0) {
+            // should not happen
+            LOG_DEBUG(sLogger, "WARN: invalid zero based range skipped");
+            continue;
+        }
+        ranges.emplace_back(addr, size, debugInfoOffset);
+    }
+    return DBGUTIL_ERR_OK;
 }
 
 DbgUtilErr DwarfUtil::buildRangeCuMap() {
-    FixedInputStream is(m_dwarfData.getDebugAddrRanges().m_start,
-                        m_dwarfData.getDebugAddrRanges().m_size);
+    DwarfCursor cursor(m_dwarfData.getDebugAddrRanges().m_start,
+                       m_dwarfData.getDebugAddrRanges().m_size);
+    std::vector<AddrRange> ranges;
 
-    while (!is.empty()) {
+    while (!cursor.empty()) {
         // read next address range set header
         uint64_t len = 0;
         bool is64Bit = false;
         uint64_t offset = 0;
         uint8_t addressSize = 0;
-        DbgUtilErr rc = readAddrRangeHeader(is, len, is64Bit, offset, addressSize);
+        DbgUtilErr rc = readAddrRangeHeader(cursor, len, is64Bit, offset, addressSize);
         if (rc != DBGUTIL_ERR_OK) {
             LOG_DEBUG(sLogger, "ERROR: failed to range range set header: %s", errorToString(rc));
             return rc;
@@ -477,101 +803,232 @@ DbgUtilErr DwarfUtil::buildRangeCuMap() {
         LOG_DEBUG(sLogger, "Read address range header: len=%u, CU offset: %u, address-size=%u",
                   (unsigned)len, (unsigned)offset, (unsigned)addressSize);
 
-        // we would like to make sure we don't read past the range set, so we limit the input stream
-        uint64_t rawSetSize = len - 8;  // reduce partial header size, do not include length field
-        uint64_t isOffset = is.getOffset();
-        uint64_t setLimit = isOffset + rawSetSize;
-        LOG_DEBUG(sLogger, "Address range len=%u, CU offset=%u, raw-set-size=%u", (unsigned)len,
-                  (unsigned)offset, (unsigned)rawSetSize);
-
-        // the entry set must be aligned to a tuple size, which is addr size + range size
-        // in case of address size 8 this means 16, and address size 4 requires alignment 8.
-        uint32_t align = ((uint32_t)addressSize) * 2;
-        uint32_t alignDiff = is.getOffset() % align;
-        if (alignDiff != 0) {
-            LOG_DEBUG(sLogger, "Set start at offset %u is not aligned to %u, skipping %u bytes",
-                      is.getOffset(), align, align - alignDiff);
-            size_t bytesSkipped = 0;
-            rc = is.skipBytes(align - alignDiff, bytesSkipped);
-            if (rc != DBGUTIL_ERR_OK) {
-                LOG_DEBUG(sLogger, "ERROR: Failed to skip %u bytes to first range pair: %s",
-                          align - alignDiff, errorToString(rc));
-                return rc;
-            }
-            if (bytesSkipped != (align - alignDiff)) {
-                LOG_DEBUG(sLogger,
-                          "ERROR: Failed to skip %u bytes to first range pair: end of stream",
-                          align - alignDiff);
-                return DBGUTIL_ERR_DATA_CORRUPT;
-            }
+        // address size is fixed for the entire set, so dispatch once
+        if (addressSize == 8) {
+            rc = readAddrRangeSet<8>(cursor, len, is64Bit, offset, ranges);
+        } else if (addressSize == 4) {
+            rc = readAddrRangeSet<4>(cursor, len, is64Bit, offset, ranges);
+        } else {
+            LOG_DEBUG(sLogger, "ERROR: Address range set address size %u not supported",
+                      (unsigned)addressSize);
+            rc = DBGUTIL_ERR_NOT_IMPLEMENTED;
         }
-        uint64_t setSize = setLimit - is.getOffset();
-        LOG_DEBUG(sLogger, "Address range len=%u, CU offset=%u, set-size=%u", (unsigned)len,
-                  (unsigned)offset, (unsigned)setSize);
-
-        // now read address ranges (pairs of address, size, terminated by null pair)
-        bool done = false;
-        while (!done) {
-            uint64_t addr = 0;
-            uint64_t size = 0;
-            DWARF_READ_ADDRESS(is, addr, addressSize);
-            DWARF_READ_ADDRESS(is, size, addressSize);
-            if (is.getOffset() > setLimit) {
-                LOG_DEBUG(sLogger,
-                          "ERROR: range set exceeded limit, no end set zero record pair seen");
-                return DBGUTIL_ERR_DATA_CORRUPT;
+        if (rc != DBGUTIL_ERR_OK) {
+            return rc;
+        }
+    }
+
+    buildRangeIndex(ranges);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr DwarfUtil::buildRangeCuMapFromInfo() {
+    // walking the unit headers is cheap, so first collect all compilation unit offsets
+    const DwarfSection& debugInfoSection = m_dwarfData.getDebugInfo();
+    DwarfCursor cursor(debugInfoSection.m_start, debugInfoSection.m_size);
+    std::vector<uint64_t> cuOffsets;
+    while (!cursor.empty()) {
+        uint64_t cuOffset = cursor.getOffset();
+        bool is64Bit = false;
+        uint64_t len = cursor.readInitialLength(is64Bit);
+        cursor.skip(len);
+        if (!cursor.isValid()) {
+            LOG_DEBUG(sLogger, "ERROR: Invalid compilation unit header at offset %" PRIu64,
+                      cuOffset);
+            return cursor.getResult();
+        }
+        cuOffsets.push_back(cuOffset);
+    }
+
+    // now read the top level entry of each unit, with units distributed among worker threads
+    size_t cuCount = cuOffsets.size();
+    unsigned threads = std::min(std::thread::hardware_concurrency(), DBGUTIL_CU_SCAN_THREADS);
+    threads = (unsigned)std::min((size_t)std::max(threads, 1u),
+                                 (cuCount + DBGUTIL_CU_SCAN_BATCH_SIZE - 1) /
+                                     DBGUTIL_CU_SCAN_BATCH_SIZE);
+    threads = std::max(threads, 1u);
+    std::vector<std::vector<AddrRange>> threadRanges(threads);
+    std::atomic<size_t> nextCU(0);
+    std::atomic<DbgUtilErr> result(DBGUTIL_ERR_OK);
+    auto worker = [this, cuCount, &cuOffsets, &threadRanges, &nextCU, &result](unsigned id) {
+        std::vector<AddrRange>& ranges = threadRanges[id];
+        for (;;) {
+            size_t start = nextCU.fetch_add(DBGUTIL_CU_SCAN_BATCH_SIZE, std::memory_order_relaxed);
+            if (start >= cuCount) {
+                break;
             }
-            if (addr == 0 && size == 0) {
-                if (is.getOffset() != setLimit) {
-                    LOG_DEBUG(sLogger, "ERROR: range set reached limit but offset is incorrect");
-                    return DBGUTIL_ERR_DATA_CORRUPT;
-                }
-                done = true;
-                LOG_DEBUG(sLogger, "End of range set found exactly on correct input stream offset");
-            } else {
-                if (addr == 0 && size != 0) {
-                    // should not happen
-                    LOG_DEBUG(sLogger, "WARN: invalid zero based range skipped");
-                    // return DBGUTIL_ERR_DATA_CORRUPT;
-                    continue;
+            size_t end = std::min(start + DBGUTIL_CU_SCAN_BATCH_SIZE, cuCount);
+            for (size_t i = start; i < end; ++i) {
+                // units that cannot be read (e.g. type units) are skipped
+                size_t rangeCount = ranges.size();
+                CUData cuData;
+                DbgUtilErr rc = DBGUTIL_ERR_OK;
+                try {
+                    rc = readCUData(cuOffsets[i], cuData, &ranges);
+                } catch (std::bad_alloc&) {
+                    result.store(DBGUTIL_ERR_NOMEM, std::memory_order_relaxed);
+                    return;
                 }
-                if (!m_rangeCUSet.insert(AddrRange(addr, size, offset)).second) {
-                    LOG_DEBUG(sLogger, "ERROR: Duplicate offset %u for range %p - %p",
-                              (unsigned)offset, (void*)addr, (void*)(addr + size));
+                if (rc != DBGUTIL_ERR_OK) {
+                    LOG_DEBUG(sLogger, "Skipping compilation unit at offset %" PRIu64 ": %s",
+                              cuOffsets[i], errorToString(rc));
+                    ranges.erase(ranges.begin() + rangeCount, ranges.end());
                 }
             }
         }
-    }
+    };
 
-    // debug print
-    if (canLog(sLogger, LS_DEBUG)) {
-        for (const AddrRange& range : m_rangeCUSet) {
-            LOG_DEBUG(sLogger, "Added range: 0x%p - 0x%p [%u]", (void*)range.m_from,
-                      (void*)(range.m_from + range.m_size), (unsigned)range.m_debugInfoOffset);
+    // the calling thread participates as one of the workers
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        try {
+            workers.emplace_back(worker, i);
+        } catch (std::system_error& e) {
+            LOG_DEBUG(sLogger, "Failed to start unit scan thread, continuing with %zu: %s",
+                      workers.size() + 1, e.what());
+            break;
         }
     }
+    worker(0);
+    for (std::thread& workerThread : workers) {
+        workerThread.join();
+    }
+    if (result.load(std::memory_order_relaxed) != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Failed to build address range index, out of memory");
+        return result.load(std::memory_order_relaxed);
+    }
+
+    // merge in thread order, so that the result does not depend on scheduling
+    std::vector<AddrRange> ranges;
+    for (std::vector<AddrRange>& threadRangeList : threadRanges) {
+        ranges.insert(ranges.end(), threadRangeList.begin(), threadRangeList.end());
+        std::vector<AddrRange>().swap(threadRangeList);
+    }
+    LOG_DEBUG(sLogger, "Scanned %zu compilation units using %zu threads, found %zu ranges",
+              cuCount, workers.size() + 1, ranges.size());
+    buildRangeIndex(ranges);
     return DBGUTIL_ERR_OK;
 }
 
-DbgUtilErr DwarfUtil::searchLineProg(const DwarfSearchData& searchData, uint64_t lineProgOffset,
-                                     SymbolInfo& symbolInfo) {
+void DwarfUtil::buildRangeIndex(std::vector<AddrRange>& ranges) {
+    // build the flat range index, ordered by range start
+    // NOTE: stable sort is used so that when ranges overlap, the one seen first wins
+    std::stable_sort(ranges.begin(), ranges.end());
+    m_rangeCUIndex.reserve(ranges.size());
+    m_rangeCUOffsets.reserve(ranges.size());
+    uint64_t prevEnd = 0;
+    for (const AddrRange& range : ranges) {
+        // the index requires disjoint ranges, so overlapping parts are trimmed
+        uint64_t from = range.m_from;
+        uint64_t end = range.m_from + range.m_size;
+        if (from < prevEnd) {
+            LOG_DEBUG(sLogger, "Range %p - %p of CU at offset %u overlaps previous range",
+                      (void*)range.m_from, (void*)end, (unsigned)range.m_debugInfoOffset);
+            if (end <= prevEnd) {
+                continue;
+            }
+            from = prevEnd;
+        }
+        m_rangeCUIndex.addRange(from, end - from);
+        m_rangeCUOffsets.push_back(range.m_debugInfoOffset);
+        prevEnd = end;
+        LOG_DEBUG(sLogger, "Added range: 0x%p - 0x%p [%u]", (void*)from, (void*)end,
+                  (unsigned)range.m_debugInfoOffset);
+    }
+    m_rangeCUIndex.shrinkToFit();
+    m_rangeCUOffsets.shrink_to_fit();
+}
+
+DbgUtilErr DwarfUtil::getLineUtil(uint64_t lineProgOffset,
+                                  std::shared_ptr<DwarfLineUtil>& lineUtil) {
+    // search first in cache
+    lineUtil = lookupLineCache(lineProgOffset);
+    if (lineUtil) {
+        return DBGUTIL_ERR_OK;
+    }
+
+    // decode line program outside of the cache lock
+    // NOTE: two threads may decode the same line program concurrently, but only the first one
+    // will be kept in the cache
     const DwarfSection& debugLineSection = m_dwarfData.getDebugLine();
+    if (lineProgOffset >= debugLineSection.m_size) {
+        LOG_ERROR(sLogger, "Invalid line program offset %" PRIu64 " (section size %" PRIu64 ")",
+                  lineProgOffset, debugLineSection.m_size);
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
     FixedInputStream is(debugLineSection.m_start + lineProgOffset,
                         debugLineSection.m_size - lineProgOffset);
 
-    DwarfLineUtil lineUtil;
-    return lineUtil.getLineInfo(m_dwarfData, searchData, is, symbolInfo);
-}
-
-DbgUtilErr DwarfUtil::searchSymbolInCU(const DwarfSearchData& searchData, uint64_t cuOffset,
-                                       SymbolInfo& symbolInfo) {
-    CUData cuData;
-    DbgUtilErr rc = readCUData(cuOffset, cuData);
+    lineUtil.reset(new (std::nothrow) DwarfLineUtil());
+    if (!lineUtil) {
+        LOG_ERROR(sLogger, "Failed to allocate line program decoder, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    DbgUtilErr rc = lineUtil->buildLineMatrix(m_dwarfData, is, m_is64Bit ? 8 : 4);
     if (rc != DBGUTIL_ERR_OK) {
+        lineUtil.reset();
         return rc;
     }
 
-    return searchLineProg(searchData, cuData.m_lineProgOffset, symbolInfo);
+    insertLineCache(lineProgOffset, lineUtil);
+    return DBGUTIL_ERR_OK;
+}
+
+std::shared_ptr<DwarfLineUtil> DwarfUtil::lookupLineCache(uint64_t lineProgOffset) {
+    std::unique_lock<std::mutex> lock(m_lineCacheLock);
+    LineCacheMap::iterator itr = m_lineCacheMap.find(lineProgOffset);
+    if (itr == m_lineCacheMap.end()) {
+        return nullptr;
+    }
+
+    // move to front of LRU list
+    if (itr->second != m_lineCacheList.begin()) {
+        m_lineCacheList.splice(m_lineCacheList.begin(), m_lineCacheList, itr->second);
+    }
+    return itr->second->m_lineUtil;
+}
+
+void DwarfUtil::insertLineCache(uint64_t lineProgOffset,
+                                std::shared_ptr<DwarfLineUtil>& lineUtil) {
+    size_t budget = getLineCacheBudget();
+    size_t memoryUsage = lineUtil->getMemoryUsage();
+    std::unique_lock<std::mutex> lock(m_lineCacheLock);
+
+    // check whether another thread got here first, and if so use its copy
+    LineCacheMap::iterator itr = m_lineCacheMap.find(lineProgOffset);
+    if (itr != m_lineCacheMap.end()) {
+        lineUtil = itr->second->m_lineUtil;
+        return;
+    }
+
+    // an entry larger than the entire budget is not cached at all
+    if (memoryUsage > budget) {
+        return;
+    }
+
+    // evict least recently used entries until new entry fits in budget
+    while (!m_lineCacheList.empty() && m_lineCacheMemoryUsage + memoryUsage > budget) {
+        LineCacheEntry& entry = m_lineCacheList.back();
+        LOG_DEBUG(sLogger, "Evicting line program at offset %" PRIu64 " from cache",
+                  entry.m_lineProgOffset);
+        m_lineCacheMemoryUsage -= entry.m_memoryUsage;
+        m_lineCacheMap.erase(entry.m_lineProgOffset);
+        m_lineCacheList.pop_back();
+    }
+
+    // if out of memory the line program is simply not cached (the caller still holds it)
+    try {
+        m_lineCacheList.push_front({lineProgOffset, lineUtil, memoryUsage});
+    } catch (std::bad_alloc&) {
+        return;
+    }
+    try {
+        m_lineCacheMap.insert(LineCacheMap::value_type(lineProgOffset, m_lineCacheList.begin()));
+    } catch (std::bad_alloc&) {
+        m_lineCacheList.pop_front();
+        return;
+    }
+    m_lineCacheMemoryUsage += memoryUsage;
 }
 
 }  // namespace dbgutil
@@ -1,33 +1,105 @@
 #ifndef __DWARF_UTIL_H__
 #define __DWARF_UTIL_H__
 
-#include <set>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "dbgutil_common.h"
 #include "dwarf_common.h"
+#include "dwarf_cursor.h"
 #include "input_stream.h"
 #include "os_symbol_engine.h"
+#include "range_index.h"
+#include "string_pool.h"
+#include "symbol_index.h"
 
 namespace dbgutil {
 
+/** @def Default memory budget (in bytes) of the per-module decoded line program cache. */
+#define DBGUTIL_DEFAULT_LINE_CACHE_BUDGET (16 * 1024 * 1024)
+
+class DwarfLineUtil;
+
 class DwarfUtil {
 public:
     DwarfUtil();
     DwarfUtil(const DwarfUtil&) = delete;
     DwarfUtil(DwarfUtil&&) = delete;
     DwarfUtil& operator=(const DwarfUtil&) = delete;
-    ~DwarfUtil() {}
+    ~DwarfUtil();
 
     static void initLogger();
     static void termLogger();
 
-    DbgUtilErr open(const DwarfData& dwarfData, void* moduleBase, bool is664Bit, bool isExe);
+    /**
+     * @brief Opens the DWARF data of a module.
+     * @param dwarfData The debug sections of the module.
+     * @param moduleBase The module load address.
+     * @param is664Bit Specifies whether this is a 64 bit module.
+     * @param isExe Specifies whether this is an executable module.
+     * @param symbolIndex Optional persistent symbol index of the module. If the index contains the
+     * compilation unit address range table, it is used instead of scanning .debug_aranges (or
+     * .debug_info when .debug_aranges is missing).
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr open(const DwarfData& dwarfData, void* moduleBase, bool is664Bit, bool isExe,
+                    const SymbolIndex* symbolIndex = nullptr);
+
+    /** @brief Adds the compilation unit address range table to a symbol index. */
+    void exportCURanges(SymbolIndexBuilder& builder) const;
+
+    /**
+     * @brief Search state kept between consecutive searches in the same module. When searching
+     * sorted addresses, consecutive addresses usually fall in the same compilation unit, in which
+     * case the compilation unit lookup and line program cache access can be skipped.
+     */
+    struct SearchCache {
+        uint64_t m_rangeFrom;
+        uint64_t m_rangeTo;
+        std::shared_ptr<DwarfLineUtil> m_lineUtil;
+
+        SearchCache() : m_rangeFrom(0), m_rangeTo(0) {}
+
+        inline bool contains(uint64_t relocSymAddr) const {
+            return m_lineUtil && relocSymAddr >= m_rangeFrom && relocSymAddr < m_rangeTo;
+        }
+
+        inline void reset() {
+            m_rangeFrom = 0;
+            m_rangeTo = 0;
+            m_lineUtil.reset();
+        }
+    };
 
     DbgUtilErr searchSymbol(void* symAddress, SymbolInfo& symbolInfo,
-                            void* relocationBase = nullptr);
+                            void* relocationBase = nullptr, SearchCache* searchCache = nullptr);
+
+    /**
+     * @brief Searches for the source file and line of an address, in compact form. Once the line
+     * program of the containing compilation unit is cached, this call does not allocate heap
+     * memory, unless the source file path is seen for the first time.
+     * @param symAddress The symbol address.
+     * @param[out] symbolInfo The resulting symbol information (file name, line and column).
+     * @param stringPool The string pool used for interning the source file path.
+     * @param relocationBase The relocation base of the module.
+     * @param searchCache Optional search state kept between consecutive searches.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr searchSymbol(void* symAddress, SymbolInfoRef& symbolInfo, StringPool& stringPool,
+                            void* relocationBase = nullptr, SearchCache* searchCache = nullptr);
+
+    /**
+     * @brief Sets the memory budget of the decoded line program cache. The budget applies to each
+     * module separately. Zero disables line program caching.
+     */
+    static void setLineCacheBudget(size_t budgetBytes);
+
+    /** @brief Retrieves the memory budget of the decoded line program cache. */
+    static size_t getLineCacheBudget();
 
 private:
     DwarfData m_dwarfData;
@@ -43,66 +115,136 @@ private:
         AddrRange(uint64_t from, uint64_t size, uint64_t debugInfoOffset)
             : m_from(from), m_size(size), m_debugInfoOffset(debugInfoOffset) {}
 
-        inline bool operator==(const AddrRange& addrRange) const {
-            return m_from == addrRange.m_from && m_size == addrRange.m_size;
-        }
-
         inline bool operator<(const AddrRange& addrRange) const {
             return m_from < addrRange.m_from;
         }
-
-        inline bool operator<(uint64_t symOffset) const { return m_from + m_size <= symOffset; }
-
-        inline bool contains(uint64_t offset) const {
-            return offset >= m_from && offset < m_from + m_size;
-        }
     };
 
     typedef std::unordered_set<uint64_t> OffsetSet;
-    // NOTE: using transparent comparator template version of map.lower_bound
-    typedef std::set<AddrRange, std::less<>> RangeCuSet;
-    RangeCuSet m_rangeCUSet;
+
+    // compilation unit address ranges, and the matching .debug_info offset of each range
+    RangeIndex m_rangeCUIndex;
+    std::vector<uint64_t> m_rangeCUOffsets;
 
     struct CUData {
         std::string m_fileName;
+        uint64_t m_debugInfoOffset;
         uint64_t m_lineProgOffset;
-        uint64_t m_baseAddress;
-        uint64_t m_rangeLow;
-        uint64_t m_rangeHigh;
-
-        CUData() : m_lineProgOffset(0), m_baseAddress(0), m_rangeLow(0), m_rangeHigh(0) {}
-
-        inline bool operator<(const CUData& cuData) const { return m_rangeLow < cuData.m_rangeLow; }
-
-        inline bool contains(uint64_t offset) const {
-            return offset >= m_rangeLow && offset < m_rangeHigh;
-        }
+        uint64_t m_lowPc;        // unit base address (default base address of range lists)
+        uint64_t m_addrBase;     // offset of the unit's entries in .debug_addr
+        uint64_t m_rngListBase;  // offset of the unit's offset table in .debug_rnglists
+        uint16_t m_version;
+        uint8_t m_addressSize;
+        bool m_is64Bit;
+
+        CUData()
+            : m_debugInfoOffset(0),
+              m_lineProgOffset(0),
+              m_lowPc(0),
+              m_addrBase(0),
+              m_rngListBase(0),
+              m_version(0),
+              m_addressSize(0),
+              m_is64Bit(false) {}
     };
 
-    DbgUtilErr readCUData(uint64_t offset, CUData& cuData);
+    /**
+     * @brief Reads the top level entry of a compilation unit.
+     * @param offset The compilation unit offset in .debug_info.
+     * @param[out] cuData The compilation unit data.
+     * @param[out] ranges Optionally receives all address ranges of the compilation unit.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr readCUData(uint64_t offset, CUData& cuData,
+                          std::vector<AddrRange>* ranges = nullptr);
     DbgUtilErr buildRangeCuMap();
+    DbgUtilErr buildRangeCuMapFromInfo();
+    void buildRangeIndex(std::vector<AddrRange>& ranges);
+    void loadRangeCuMap(const SymbolIndex& symbolIndex);
 
-    DbgUtilErr searchLineProg(const DwarfSearchData& searchData, uint64_t lineProgOffset,
-                              SymbolInfo& symbolInfo);
-    DbgUtilErr searchSymbolInCU(const DwarfSearchData& searchData, uint64_t cuOffset,
-                                SymbolInfo& symbolInfo);
+
+    // decoded line programs, keyed by line program offset, evicted in LRU order
+    // NOTE: entries are shared, so that eviction does not affect a concurrent search
+    struct LineCacheEntry {
+        uint64_t m_lineProgOffset;
+        std::shared_ptr<DwarfLineUtil> m_lineUtil;
+        size_t m_memoryUsage;
+    };
+    typedef std::list<LineCacheEntry> LineCacheList;
+    typedef std::unordered_map<uint64_t, LineCacheList::iterator> LineCacheMap;
+    LineCacheList m_lineCacheList;
+    LineCacheMap m_lineCacheMap;
+    size_t m_lineCacheMemoryUsage;
+    std::mutex m_lineCacheLock;
+
+    // line program offset of each compilation unit searched so far (guarded by line cache lock)
+    typedef std::unordered_map<uint64_t, uint64_t> LineProgOffsetMap;
+    LineProgOffsetMap m_lineProgOffsetMap;
+
+    DbgUtilErr findLineUtil(uint64_t relocSymAddr, SearchCache* searchCache,
+                            std::shared_ptr<DwarfLineUtil>& lineUtil);
+    DbgUtilErr getLineProgOffset(uint64_t debugInfoOffset, uint64_t& lineProgOffset);
+    DbgUtilErr getLineUtil(uint64_t lineProgOffset, std::shared_ptr<DwarfLineUtil>& lineUtil);
+    std::shared_ptr<DwarfLineUtil> lookupLineCache(uint64_t lineProgOffset);
+    void insertLineCache(uint64_t lineProgOffset, std::shared_ptr<DwarfLineUtil>& lineUtil);
 
     struct Attr {
-        uint64_t m_name;
-        uint64_t m_form;
+        uint32_t m_name;
+        uint32_t m_form;
         uint64_t m_implicitValue;
     };
-    typedef std::vector<Attr> AttrList;
-
-    DbgUtilErr readAddrRangeHeader(InputStream& is, uint64_t& len, bool& is64Bit, uint64_t& offset,
-                                   uint8_t& addressSize);
-    DbgUtilErr readCUHeader(InputStream& is, uint64_t& len, uint64_t& abbrevOffset,
-                            uint8_t& addressSize, bool& is64Bit);
-    DbgUtilErr readAbbrevDecl(uint64_t offset, uint64_t abbrevCode, uint64_t& tag,
-                              bool& hasChildren, AttrList& attrs) const;
-    DbgUtilErr readRangeListBounds(uint64_t rngOffset, uint64_t cuBaseAddr, bool is64Bit,
-                                   uint8_t addressSize, uint64_t& rangeLow, uint64_t& rangeHigh);
-    DbgUtilErr readAddr(uint64_t offset, uint64_t& address, uint8_t addressSize);
+
+    // a decoded abbreviation declaration, whose attribute specifications are stored contiguously
+    // in the attribute array of the containing table
+    struct AbbrevDecl {
+        uint64_t m_code;
+        uint64_t m_tag;
+        uint32_t m_attrStart;
+        uint32_t m_attrCount;
+        bool m_hasChildren;
+    };
+
+    // a decoded abbreviation table. when abbreviation codes are consecutive starting from 1 (which
+    // is almost always the case), declarations are indexed directly by code, otherwise they are
+    // sorted by code and searched
+    struct AbbrevTable {
+        std::vector<AbbrevDecl> m_decls;
+        std::vector<Attr> m_attrs;
+        bool m_isDense;
+
+        AbbrevTable() : m_isDense(true) {}
+
+        const AbbrevDecl* findDecl(uint64_t abbrevCode) const;
+        inline const Attr* getAttrs(const AbbrevDecl& decl) const {
+            return m_attrs.data() + decl.m_attrStart;
+        }
+    };
+
+    // decoded abbreviation tables keyed by .debug_abbrev offset (never evicted, since tables are
+    // immutable once decoded, and only tables of searched compilation units are decoded)
+    typedef std::unordered_map<uint64_t, std::unique_ptr<AbbrevTable>> AbbrevTableMap;
+    AbbrevTableMap m_abbrevTableMap;
+    std::mutex m_abbrevLock;
+
+    DbgUtilErr readAddrRangeHeader(DwarfCursor& cursor, uint64_t& len, bool& is64Bit,
+                                   uint64_t& offset, uint8_t& addressSize);
+    template <unsigned AddressSize>
+    DbgUtilErr readAddrRangeSet(DwarfCursor& cursor, uint64_t len, bool is64Bit,
+                                uint64_t debugInfoOffset, std::vector<AddrRange>& ranges);
+    DbgUtilErr readCUHeader(DwarfCursor& cursor, uint64_t& len, uint64_t& abbrevOffset,
+                            uint8_t& addressSize, bool& is64Bit, uint16_t& version);
+    DbgUtilErr getAbbrevTable(uint64_t offset, const AbbrevTable*& abbrevTable);
+    DbgUtilErr readAbbrevTable(uint64_t offset, AbbrevTable& abbrevTable) const;
+    DbgUtilErr getAbbrevDecl(uint64_t offset, uint64_t abbrevCode, const AbbrevDecl*& abbrevDecl,
+                             const Attr*& attrs);
+    DbgUtilErr readRangeList(const CUData& cuData, uint64_t listOffset,
+                             std::vector<AddrRange>& ranges);
+    DbgUtilErr readRangeListV4(const CUData& cuData, uint64_t listOffset,
+                               std::vector<AddrRange>& ranges);
+    DbgUtilErr readRangeListOffset(const CUData& cuData, uint64_t index, uint64_t& listOffset);
+    DbgUtilErr readAddrEntry(const CUData& cuData, uint64_t index, uint64_t& address);
+    void addCURange(const CUData& cuData, uint64_t startAddress, uint64_t endAddress,
+                    std::vector<AddrRange>& ranges);
 };
 
 }  // namespace dbgutil
@@ -2,8 +2,6 @@
 
 #ifdef DBGUTIL_LINUX
 
-#include <cxxabi.h>
-
 #include <algorithm>
 #include <cassert>
 #include <cinttypes>
@@ -16,11 +14,26 @@ namespace dbgutil {
 
 static Logger sLogger;
 
-ElfReader::ElfReader() : m_symTabSize(0), m_symEntrySize(0) {}
+ElfReader::ElfReader()
+    : m_shStrTabStart(nullptr),
+      m_shStrTabSize(0),
+      m_strTabStart(nullptr),
+      m_strTabSize(0),
+      m_symTabStart(nullptr),
+      m_symTabSize(0),
+      m_symEntrySize(0) {}
 
 void ElfReader::resetData() {
+    m_shStrTabStart = nullptr;
+    m_shStrTabSize = 0;
+    m_strTabStart = nullptr;
+    m_strTabSize = 0;
+    m_symTabStart = nullptr;
     m_symTabSize = 0;
     m_symEntrySize = 0;
+    m_shStrTab.clear();
+    m_strTab.clear();
+    m_symTab.clear();
 }
 
 DbgUtilErr ElfReader::readImage() {
@@ -47,6 +60,13 @@ DbgUtilErr ElfReader::readImage() {
         return rc;
     }
 
+    // if a persistent symbol index exists for this image, then there is no need to parse and sort
+    // the symbol table
+    readBuildId();
+    if (loadSymbolIndex() == DBGUTIL_ERR_OK) {
+        return DBGUTIL_ERR_OK;
+    }
+
     rc = getStrTab();
     if (rc != DBGUTIL_ERR_OK) {
         return rc;
@@ -62,8 +82,10 @@ DbgUtilErr ElfReader::readImage() {
         return rc;
     }
 
-    buildSymInfoMap();
+    // NOTE: the name map is built on first search by name
     m_symTab.clear();
+    m_symTab.shrink_to_fit();
+    m_symTabStart = nullptr;
     return rc;
 }
 
@@ -179,7 +201,11 @@ DbgUtilErr ElfReader::buildSectionMap32(Elf32_Ehdr* hdr) {
         if (rc != DBGUTIL_ERR_OK) {
             return rc;
         }
-        char* secName = &m_shStrTab[secHdr.sh_name];
+        if (secHdr.sh_name >= m_shStrTabSize) {
+            LOG_ERROR(sLogger, "Invalid section name index %u", (unsigned)secHdr.sh_name);
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        char* secName = m_shStrTabStart + secHdr.sh_name;
         uint64_t secOffset = secHdr.sh_offset;
         LOG_DEBUG(sLogger, "Adding section %p - %p %s", (void*)secOffset,
                   (void*)(secOffset + secHdr.sh_size), secName);
@@ -207,7 +233,11 @@ DbgUtilErr ElfReader::buildSectionMap64(Elf64_Ehdr* hdr) {
         if (rc != DBGUTIL_ERR_OK) {
             return rc;
         }
-        char* secName = &m_shStrTab[secHdr.sh_name];
+        if (secHdr.sh_name >= m_shStrTabSize) {
+            LOG_ERROR(sLogger, "Invalid section name index %u", (unsigned)secHdr.sh_name);
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        char* secName = m_shStrTabStart + secHdr.sh_name;
         uint64_t secOffset = secHdr.sh_offset;
         LOG_DEBUG(sLogger, "Adding section %p - %p %s", (void*)secOffset,
                   (void*)(secOffset + secHdr.sh_size), secName);
@@ -245,13 +275,9 @@ DbgUtilErr ElfReader::getSectionHeaderStrTab32(Elf32_Ehdr* hdr) {
         return DBGUTIL_ERR_DATA_CORRUPT;
     }
 
-    // seek to offset and read entire section
-    rc = m_fileReader.seek(secHdr.sh_offset);
-    if (rc != DBGUTIL_ERR_OK) {
-        return rc;
-    }
-    m_shStrTab.resize(secHdr.sh_size);
-    return m_fileReader.readFull(&m_shStrTab[0], secHdr.sh_size);
+    // get entire section
+    m_shStrTabSize = secHdr.sh_size;
+    return getRegion(secHdr.sh_offset, secHdr.sh_size, m_shStrTab, m_shStrTabStart);
 }
 
 DbgUtilErr ElfReader::getSectionHeaderStrTab64(Elf64_Ehdr* hdr) {
@@ -272,13 +298,9 @@ DbgUtilErr ElfReader::getSectionHeaderStrTab64(Elf64_Ehdr* hdr) {
         return DBGUTIL_ERR_DATA_CORRUPT;
     }
 
-    // seek to offset and read entire section
-    rc = m_fileReader.seek(secHdr.sh_offset);
-    if (rc != DBGUTIL_ERR_OK) {
-        return rc;
-    }
-    m_shStrTab.resize(secHdr.sh_size);
-    return m_fileReader.readFull(&m_shStrTab[0], secHdr.sh_size);
+    // get entire section
+    m_shStrTabSize = secHdr.sh_size;
+    return getRegion(secHdr.sh_offset, secHdr.sh_size, m_shStrTab, m_shStrTabStart);
 }
 
 DbgUtilErr ElfReader::getStrTab() {
@@ -300,13 +322,10 @@ DbgUtilErr ElfReader::getStrTab32(Elf32_Ehdr* hdr) {
         }
 
         // check especially for correct section name
-        if (secHdr.sh_type == SHT_STRTAB && strcmp(&m_shStrTab[secHdr.sh_name], ".strtab") == 0) {
-            rc = m_fileReader.seek(secHdr.sh_offset);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
-            m_strTab.resize(secHdr.sh_size);
-            return m_fileReader.readFull(&m_strTab[0], secHdr.sh_size);
+        if (secHdr.sh_type == SHT_STRTAB && secHdr.sh_name < m_shStrTabSize &&
+            strcmp(m_shStrTabStart + secHdr.sh_name, ".strtab") == 0) {
+            m_strTabSize = secHdr.sh_size;
+            return getRegion(secHdr.sh_offset, secHdr.sh_size, m_strTab, m_strTabStart, true);
         }
     }
     return DBGUTIL_ERR_NOT_FOUND;
@@ -327,13 +346,10 @@ DbgUtilErr ElfReader::getStrTab64(Elf64_Ehdr* hdr) {
         }
 
         // check especially for correct section name
-        if (secHdr.sh_type == SHT_STRTAB && strcmp(&m_shStrTab[secHdr.sh_name], ".strtab") == 0) {
-            rc = m_fileReader.seek(secHdr.sh_offset);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
-            m_strTab.resize(secHdr.sh_size);
-            return m_fileReader.readFull(&m_strTab[0], secHdr.sh_size);
+        if (secHdr.sh_type == SHT_STRTAB && secHdr.sh_name < m_shStrTabSize &&
+            strcmp(m_shStrTabStart + secHdr.sh_name, ".strtab") == 0) {
+            m_strTabSize = secHdr.sh_size;
+            return getRegion(secHdr.sh_offset, secHdr.sh_size, m_strTab, m_strTabStart, true);
         }
     }
     return DBGUTIL_ERR_NOT_FOUND;
@@ -361,13 +377,8 @@ DbgUtilErr ElfReader::getSymTab32(Elf32_Ehdr* hdr) {
             m_symTabSize = secHdr.sh_size;
             m_symEntrySize = secHdr.sh_entsize;
 
-            // seek to symbol table offset and read entire table into buffer
-            rc = m_fileReader.seek(secHdr.sh_offset);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
-            m_symTab.resize(secHdr.sh_size);
-            return m_fileReader.readFull(&m_symTab[0], secHdr.sh_size);
+            // get entire symbol table
+            return getRegion(secHdr.sh_offset, secHdr.sh_size, m_symTab, m_symTabStart, true);
         }
     }
     return DBGUTIL_ERR_NOT_FOUND;
@@ -391,24 +402,23 @@ DbgUtilErr ElfReader::getSymTab64(Elf64_Ehdr* hdr) {
             m_symTabSize = secHdr.sh_size;
             m_symEntrySize = secHdr.sh_entsize;
 
-            // seek to symbol table offset and read entire table into buffer
-            rc = m_fileReader.seek(secHdr.sh_offset);
-            if (rc != DBGUTIL_ERR_OK) {
-                return rc;
-            }
-            m_symTab.resize(secHdr.sh_size);
-            return m_fileReader.readFull(&m_symTab[0], secHdr.sh_size);
+            // get entire symbol table
+            return getRegion(secHdr.sh_offset, secHdr.sh_size, m_symTab, m_symTabStart, true);
         }
     }
     return DBGUTIL_ERR_NOT_FOUND;
 }
 
 DbgUtilErr ElfReader::buildSymInfoSet() {
+    if (m_symEntrySize == 0) {
+        LOG_ERROR(sLogger, "Invalid zero symbol table entry size");
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
     return m_is64Bit ? buildSymInfoSet64(&m_hdr.m_hdr64) : buildSymInfoSet32(&m_hdr.m_hdr32);
 }
 
 DbgUtilErr ElfReader::buildSymInfoSet32(Elf32_Ehdr* hdr) {
-    char* symTabStart = &m_symTab[0];
+    char* symTabStart = m_symTabStart;
     char* symSecEndPos = symTabStart + m_symTabSize;
     char* symPos = symTabStart;
     uint32_t srcFileIndex = 0;
@@ -420,7 +430,12 @@ DbgUtilErr ElfReader::buildSymInfoSet32(Elf32_Ehdr* hdr) {
         }
 
         // we save only functions, but we remember the source file if possible
-        const char* symName = &m_strTab[symInfo->st_name];
+        if (symInfo->st_name >= m_strTabSize) {
+            LOG_DEBUG(sLogger, "Skipping symbol with invalid name index %u",
+                      (unsigned)symInfo->st_name);
+            continue;
+        }
+        const char* symName = m_strTabStart + symInfo->st_name;
         int type = ELF32_ST_TYPE(symInfo->st_info);
         if (type == STT_FILE) {
             srcFileIndex = (uint32_t)m_srcFileNames.size();
@@ -443,7 +458,7 @@ DbgUtilErr ElfReader::buildSymInfoSet32(Elf32_Ehdr* hdr) {
 }
 
 DbgUtilErr ElfReader::buildSymInfoSet64(Elf64_Ehdr* hdr) {
-    char* symTabStart = &m_symTab[0];
+    char* symTabStart = m_symTabStart;
     char* symSecEndPos = symTabStart + m_symTabSize;
     char* symPos = symTabStart;
     uint32_t srcFileIndex = 0;
@@ -455,7 +470,12 @@ DbgUtilErr ElfReader::buildSymInfoSet64(Elf64_Ehdr* hdr) {
         }
 
         // we save only functions, but we remember the source file if possible
-        const char* symName = &m_strTab[symInfo->st_name];
+        if (symInfo->st_name >= m_strTabSize) {
+            LOG_DEBUG(sLogger, "Skipping symbol with invalid name index %u",
+                      (unsigned)symInfo->st_name);
+            continue;
+        }
+        const char* symName = m_strTabStart + symInfo->st_name;
         int type = ELF64_ST_TYPE(symInfo->st_info);
         if (type == STT_FILE) {
             srcFileIndex = (uint32_t)m_srcFileNames.size();
@@ -479,16 +499,44 @@ DbgUtilErr ElfReader::buildSymInfoSet64(Elf64_Ehdr* hdr) {
     return DBGUTIL_ERR_OK;
 }
 
-void ElfReader::buildSymInfoMap() {
-    for (OsSymbolInfo& symbolInfo : m_symInfoSet) {
-        // we attempt to insert the demangled name, so user can search more easily
-        int status;
-        char* demangledName = abi::__cxa_demangle(symbolInfo.m_name.c_str(), nullptr, 0, &status);
-        if (status == 0 && demangledName != nullptr) {
-            m_symInfoMap.insert(SymInfoMap::value_type(demangledName, &symbolInfo));
-        } else {
-            m_symInfoMap.insert(SymInfoMap::value_type(symbolInfo.m_name, &symbolInfo));
+void ElfReader::readBuildId() {
+    // the build id note is normally found in a dedicated section
+    OsSectionMap::iterator itr = m_sectionMap.find(".note.gnu.build-id");
+    if (itr == m_sectionMap.end()) {
+        LOG_DEBUG(sLogger, "Image %s has no build id", m_imagePath.c_str());
+        return;
+    }
+    std::vector<char> buffer;
+    char* noteStart = nullptr;
+    uint64_t sectionSize = itr->second.m_size;
+    if (getRegion(itr->second.m_offset, sectionSize, buffer, noteStart) != DBGUTIL_ERR_OK) {
+        return;
+    }
+
+    // NOTE: 32 and 64 bit note headers are identical, and name/descriptor are 4 bytes aligned
+    uint64_t pos = 0;
+    while (pos + sizeof(Elf64_Nhdr) <= sectionSize) {
+        Elf64_Nhdr* noteHdr = (Elf64_Nhdr*)(noteStart + pos);
+        uint64_t nameOffset = pos + sizeof(Elf64_Nhdr);
+        uint64_t descOffset = nameOffset + ((noteHdr->n_namesz + 3) & ~3u);
+        uint64_t nextOffset = descOffset + ((noteHdr->n_descsz + 3) & ~3u);
+        if (nextOffset > sectionSize) {
+            LOG_DEBUG(sLogger, "Invalid build id note in image %s", m_imagePath.c_str());
+            return;
+        }
+        if (noteHdr->n_type == NT_GNU_BUILD_ID && noteHdr->n_namesz == sizeof(ELF_NOTE_GNU) &&
+            memcmp(noteStart + nameOffset, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0) {
+            static const char hexDigits[] = "0123456789abcdef";
+            const unsigned char* desc = (const unsigned char*)(noteStart + descOffset);
+            m_buildId.clear();
+            for (uint32_t i = 0; i < noteHdr->n_descsz; ++i) {
+                m_buildId += hexDigits[desc[i] >> 4];
+                m_buildId += hexDigits[desc[i] & 0x0F];
+            }
+            LOG_DEBUG(sLogger, "Image %s build id: %s", m_imagePath.c_str(), m_buildId.c_str());
+            return;
         }
+        pos = nextOffset;
     }
 }
 
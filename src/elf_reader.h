@@ -29,11 +29,17 @@ private:
         Elf32_Ehdr m_hdr32;
         Elf64_Ehdr m_hdr64;
     } m_hdr;
+    // string and symbol tables point either into the mapped image, or into the buffers below
+    char* m_shStrTabStart;
+    uint64_t m_shStrTabSize;
+    char* m_strTabStart;
+    uint64_t m_strTabSize;
+    char* m_symTabStart;
+    uint64_t m_symTabSize;
+    uint64_t m_symEntrySize;
     std::vector<char> m_shStrTab;
     std::vector<char> m_strTab;
     std::vector<char> m_symTab;
-    uint64_t m_symTabSize;
-    uint64_t m_symEntrySize;
 
     DbgUtilErr verifyHeader();
     DbgUtilErr readElf();
@@ -62,7 +68,7 @@ private:
     DbgUtilErr buildSymInfoSet32(Elf32_Ehdr* hdr);
     DbgUtilErr buildSymInfoSet64(Elf64_Ehdr* hdr);
 
-    void buildSymInfoMap();
+    void readBuildId();
 
     void dumpSectionHeaders();
     void dumpSectionHeaders32();
@@ -26,6 +26,9 @@ public:
     /** @brief Retrieves the current offset of the stream. */
     inline size_t getOffset() const { return m_offset; }
 
+    /** @brief Retrieves the underlying buffer (the stream offset is relative to its start). */
+    inline const char* getBuffer() const { return m_bufRef; }
+
     /** @brief Resets the input stream (drops all buffers). */
     void reset() final {}
 
@@ -33,6 +33,17 @@ static void* sSelfLoadAddress = nullptr;
 
 LinuxModuleManager* LinuxModuleManager::sInstance = nullptr;
 
+// checks whether an address lies in one of the file mappings made by the library
+static bool isFileMapping(const std::vector<std::pair<uint64_t, uint64_t>>& fileMappings,
+                          uint64_t address) {
+    for (const std::pair<uint64_t, uint64_t>& entry : fileMappings) {
+        if (address >= entry.first && address < entry.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
 DbgUtilErr LinuxModuleManager::createInstance() {
     // initialize self module address
     Dl_info info = {};
@@ -83,9 +94,11 @@ DbgUtilErr LinuxModuleManager::getOsModuleByAddress(void* address, OsModuleInfo&
 DbgUtilErr LinuxModuleManager::refreshOsModuleList(void* address /* = nullptr */,
                                                    OsModuleInfo* moduleInfo /* = nullptr */) {
     // TODO: function too long, and also API is not good
-    // parse /proc/self/maps
+    // parse /proc/self/maps (image and symbol index files mapped by the symbol engine are listed
+    // there as well, but are not loaded modules)
     std::vector<std::string> lines;
-    DbgUtilErr rc = OsUtil::readEntireFileToLines("/proc/self/maps", lines);
+    std::vector<std::pair<uint64_t, uint64_t>> fileMappings;
+    DbgUtilErr rc = OsUtil::readMemoryMap(lines, fileMappings);
     if (rc != DBGUTIL_ERR_OK) {
         LOG_DEBUG(sLogger, "Failed to read /proc/self/maps: %s", errorToString(rc));
         return rc;
@@ -117,6 +130,10 @@ DbgUtilErr LinuxModuleManager::refreshOsModuleList(void* address /* = nullptr */
             // unrecognized line format, nevertheless we keep trying
             continue;
         }
+
+        if (isFileMapping(fileMappings, addrLo)) {
+            continue;
+        }
         LOG_DEBUG(sLogger, "Collected module info: %p-%p %s", (void*)addrLo, (void*)addrHi,
                   imagePath.c_str());
 
@@ -2,11 +2,17 @@
 
 #ifdef DBGUTIL_GCC
 
+#ifndef DBGUTIL_NO_LIBUNWIND
 #define UNW_LOCAL_ONLY
 #include <libunwind.h>
+#endif
 
 #include <cassert>
+#include <cstdint>
 
+#include "dbg_util_flags.h"
+#include "dbgutil_common.h"
+#include "dwarf_unwinder.h"
 #include "linux_stack_trace.h"
 #include "linux_thread_manager.h"
 #include "os_stack_trace_internal.h"
@@ -16,12 +22,230 @@
 #include "win32_stack_trace.h"
 #endif
 
+#if defined(DBGUTIL_LINUX) && (defined(__x86_64__) || defined(__aarch64__))
+#include <pthread.h>
+#include <ucontext.h>
+#define DBGUTIL_FP_UNWIND_SUPPORTED
+#endif
+
+#if defined(DBGUTIL_NO_LIBUNWIND) && !defined(DBGUTIL_DWARF_UNWIND_SUPPORTED)
+#error "Building without libunwind is supported only on Linux x86_64/aarch64"
+#endif
+
 #define DBGUTIL_GET_STACK_TRACE_REQUEST 1
 
 namespace dbgutil {
 
 LinuxStackTraceProvider* LinuxStackTraceProvider::sInstance = nullptr;
 
+#ifdef DBGUTIL_FP_UNWIND_SUPPORTED
+// stack bounds of the current thread, queried once per thread (zero high bound means not queried
+// yet, and an empty range means the query failed, such that no frame is ever read from the stack by
+// frame pointer unwinding or by the builtin unwinder)
+struct ThreadStackBounds {
+    uintptr_t m_low;
+    uintptr_t m_high;
+};
+static thread_local ThreadStackBounds sStackBounds = {0, 0};
+
+// the state of the caller of the last frame that passed validation, from which unwinding may be
+// resumed by other means (zero instruction pointer means no frame passed validation)
+struct FramePointerResumeState {
+    uintptr_t m_ip;
+    uintptr_t m_sp;
+    uintptr_t m_fp;
+};
+
+// retrieves the stack bounds of the current thread. Returns false if the bounds were not queried
+// yet, and querying is not allowed.
+static bool getThreadStackBounds(uintptr_t& low, uintptr_t& high, bool allowQuery) {
+    if (sStackBounds.m_high == 0) {
+        // NOTE: this is not async-signal-safe (may allocate memory), so it is never done when
+        // capturing raw stacks, but only when walking the stack of the current thread
+        if (!allowQuery) {
+            return false;
+        }
+        uintptr_t stackLow = 1;
+        uintptr_t stackHigh = 1;
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void* stackAddr = nullptr;
+            size_t stackSize = 0;
+            if (pthread_attr_getstack(&attr, &stackAddr, &stackSize) == 0) {
+                stackLow = (uintptr_t)stackAddr;
+                stackHigh = stackLow + stackSize;
+            }
+            pthread_attr_destroy(&attr);
+        }
+        sStackBounds.m_low = stackLow;
+        sStackBounds.m_high = stackHigh;
+    }
+    low = sStackBounds.m_low;
+    high = sStackBounds.m_high;
+    return true;
+}
+
+// retrieves the frame pointer register from a signal context (zero if not supported)
+static uintptr_t getContextFramePointer(void* context) {
+#if defined(__x86_64__)
+    return (uintptr_t)((ucontext_t*)context)->uc_mcontext.gregs[REG_RBP];
+#else
+    return (uintptr_t)((ucontext_t*)context)->uc_mcontext.regs[29];
+#endif
+}
+
+// walks the frame pointer chain, where each frame record consists of the saved frame pointer
+// followed by the return address. Returns false if a frame failed validation before the end of the
+// chain was reached (or before the frame handler requested to stop).
+template <typename F>
+static bool walkFramePointers(uintptr_t fp, F onFrame, FramePointerResumeState& resumeState,
+                              bool allowBoundsQuery) {
+    uintptr_t low = 0;
+    uintptr_t high = 0;
+    resumeState = {0, 0, 0};
+    if (!getThreadStackBounds(low, high, allowBoundsQuery)) {
+        return false;
+    }
+    uintptr_t prevFp = 0;
+    for (;;) {
+        // the outermost frame has a null frame pointer
+        if (fp == 0 && prevFp != 0) {
+            return true;
+        }
+        // a frame record must be aligned, lie entirely within the thread's stack, and be above the
+        // previous frame record (stack grows downwards), otherwise this is not a frame pointer
+        if ((fp & (sizeof(uintptr_t) - 1)) != 0 || fp < low || fp >= high ||
+            high - fp < 2 * sizeof(uintptr_t) || fp <= prevFp) {
+            return false;
+        }
+        const uintptr_t* frameRecord = (const uintptr_t*)fp;
+        uintptr_t ip = frameRecord[1];
+        if (ip == 0) {
+            return true;
+        }
+        // after returning, the stack pointer is right above the frame record, and the frame
+        // pointer register is restored from the frame record
+        resumeState.m_ip = ip;
+        resumeState.m_sp = fp + 2 * sizeof(uintptr_t);
+        resumeState.m_fp = frameRecord[0];
+        if (!onFrame((void*)ip)) {
+            return true;
+        }
+        prevFp = fp;
+        fp = frameRecord[0];
+    }
+}
+
+#ifndef DBGUTIL_NO_LIBUNWIND
+// continues unwinding with libunwind from the caller of the last frame that passed validation
+// (that frame itself was already reported). Returns false if not supported on this platform.
+template <typename F>
+static bool resumeLibunwind(const FramePointerResumeState& resumeState, F onFrame) {
+#if defined(__x86_64__)
+    unw_context_t unwContext;
+    unw_getcontext(&unwContext);
+    // the instruction pointer is set inside the call instruction, so that the right unwind
+    // information is found even if the call is the last instruction of its function
+    unwContext.uc_mcontext.gregs[REG_RIP] = (greg_t)(resumeState.m_ip - 1);
+    unwContext.uc_mcontext.gregs[REG_RSP] = (greg_t)resumeState.m_sp;
+    unwContext.uc_mcontext.gregs[REG_RBP] = (greg_t)resumeState.m_fp;
+    unw_cursor_t cursor;
+    if (unw_init_local(&cursor, &unwContext) == 0) {
+        while (unw_step(&cursor) > 0) {
+            unw_word_t ip = 0;
+            unw_get_reg(&cursor, UNW_REG_IP, &ip);
+            if (!onFrame((void*)ip)) {
+                break;
+            }
+        }
+    }
+    return true;
+#else
+    (void)resumeState;
+    (void)onFrame;
+    return false;
+#endif
+}
+#endif
+
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+// unwinds with the builtin unwinder, starting at the caller of the frame described by the given
+// context. If the builtin unwinder fails midway, unwinding continues with libunwind. Returns false
+// if nothing was reported (including the context frame itself), so that unwinding should restart
+// with libunwind (also when the stack bounds of the current thread are not known yet, and may not
+// be queried, as saved registers are read from the stack only within its bounds).
+template <typename F>
+static bool unwindDwarf(DwarfUnwindContext& context, F onFrame, bool allowRefresh,
+                        bool contextReported) {
+    uintptr_t low = 0;
+    uintptr_t high = 0;
+    if (!getThreadStackBounds(low, high, allowRefresh)) {
+        return contextReported;
+    }
+    context.m_stackLow = low;
+    context.m_stackHigh = high;
+    DwarfUnwinder* unwinder = DwarfUnwinder::getInstance();
+    bool reported = contextReported;
+    for (;;) {
+        DwarfUnwindResult result = unwinder->step(context, allowRefresh);
+        if (result == DwarfUnwindResult::DUR_END) {
+            return true;
+        }
+        if (result == DwarfUnwindResult::DUR_FAILED) {
+            break;
+        }
+        reported = true;
+        if (!onFrame((void*)context.m_ip)) {
+            return true;
+        }
+    }
+#ifndef DBGUTIL_NO_LIBUNWIND
+    if (reported) {
+        // the resumed instruction pointer is taken as a return address, unlike an exact one
+        uintptr_t ip = (uintptr_t)(context.m_exactIp ? context.m_ip + 1 : context.m_ip);
+        FramePointerResumeState resumeState = {ip,
+                                               (uintptr_t)context.m_regs[DWARF_UNWIND_SP_REG],
+                                               (uintptr_t)context.m_regs[DWARF_UNWIND_FP_REG]};
+        (void)resumeLibunwind(resumeState, onFrame);
+    }
+#endif
+    return reported;
+}
+#endif
+
+// unwinds by frame pointers starting at the given frame. Returns false if nothing was reported, so
+// that unwinding should restart by other means (also when the stack bounds of the current thread
+// are not known yet, and may not be queried).
+template <typename F>
+static bool unwindFramePointers(uintptr_t fp, F onFrame, bool useDwarfUnwinder, bool allowRefresh,
+                                bool allowBoundsQuery) {
+    FramePointerResumeState resumeState;
+    if (walkFramePointers(fp, onFrame, resumeState, allowBoundsQuery)) {
+        return true;
+    }
+    if (resumeState.m_ip == 0) {
+        return false;
+    }
+    // some frames were already reported, so if resuming is not supported, the stack trace is
+    // truncated at the last valid frame
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    if (useDwarfUnwinder) {
+        DwarfUnwindContext context;
+        DwarfUnwinder::initContext(context, resumeState.m_ip, resumeState.m_sp, resumeState.m_fp);
+        (void)unwindDwarf(context, onFrame, allowRefresh, true);
+        return true;
+    }
+#else
+    (void)useDwarfUnwinder;
+    (void)allowRefresh;
+#endif
+#ifndef DBGUTIL_NO_LIBUNWIND
+    (void)resumeLibunwind(resumeState, onFrame);
+#endif
+    return true;
+}
+#endif
+
 void LinuxStackTraceProvider::createInstance() {
     assert(sInstance == nullptr);
     sInstance = new (std::nothrow) LinuxStackTraceProvider();
@@ -40,6 +264,39 @@ void LinuxStackTraceProvider::destroyInstance() {
 }
 
 DbgUtilErr LinuxStackTraceProvider::walkStack(StackFrameListener* listener, void* context) {
+#if defined(DBGUTIL_FP_UNWIND_SUPPORTED) || defined(DBGUTIL_DWARF_UNWIND_SUPPORTED)
+    auto onFrame = [listener](void* frameAddress) {
+        listener->onStackFrame(frameAddress);
+        return true;
+    };
+#endif
+
+#ifdef DBGUTIL_FP_UNWIND_SUPPORTED
+    if (m_useFramePointers) {
+        // as with libunwind, the first reported frame is the caller of this function
+        uintptr_t fp = (context == nullptr) ? (uintptr_t)__builtin_frame_address(0)
+                                            : getContextFramePointer(context);
+        if (unwindFramePointers(fp, onFrame, m_useDwarfUnwinder, true, true)) {
+            return DBGUTIL_ERR_OK;
+        }
+    }
+#endif
+
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    if (m_useDwarfUnwinder) {
+        DwarfUnwindContext dwarfContext;
+        if (context == nullptr) {
+            DWARF_UNWIND_CAPTURE_CONTEXT(dwarfContext);
+        } else {
+            DwarfUnwinder::initContext(dwarfContext, context);
+        }
+        if (unwindDwarf(dwarfContext, onFrame, true, false)) {
+            return DBGUTIL_ERR_OK;
+        }
+    }
+#endif
+
+#ifndef DBGUTIL_NO_LIBUNWIND
     unw_context_t unw_context;
     if (context == nullptr) {
         unw_getcontext(&unw_context);
@@ -58,9 +315,88 @@ DbgUtilErr LinuxStackTraceProvider::walkStack(StackFrameListener* listener, void
         void* addr = (void*)ip;
         listener->onStackFrame(addr);
     }
+#endif
     return DBGUTIL_ERR_OK;
 }
 
+size_t LinuxStackTraceProvider::captureRawStack(void** frames, size_t maxFrames,
+                                                size_t skip /* = 0 */,
+                                                void* context /* = nullptr */) {
+    // NOTE: all unwinding state lives on the stack, so nothing here may allocate memory
+    if (maxFrames == 0) {
+        return 0;
+    }
+
+#if defined(DBGUTIL_FP_UNWIND_SUPPORTED) || defined(DBGUTIL_DWARF_UNWIND_SUPPORTED)
+    size_t fastCount = 0;
+    size_t fastSkip = skip;
+    auto onFrame = [frames, maxFrames, &fastCount, &fastSkip](void* frameAddress) {
+        if (fastSkip > 0) {
+            --fastSkip;
+            return true;
+        }
+        frames[fastCount++] = frameAddress;
+        return fastCount < maxFrames;
+    };
+#endif
+
+    // the module table of the builtin unwinder is not refreshed here, since that allocates memory.
+    // for the same reason, the stack bounds of the current thread are not queried here, so frame
+    // pointers and the builtin unwinder are used only after a stack walk on this thread has cached
+    // them.
+#ifdef DBGUTIL_FP_UNWIND_SUPPORTED
+    if (m_useFramePointers) {
+        uintptr_t fp = (context == nullptr) ? (uintptr_t)__builtin_frame_address(0)
+                                            : getContextFramePointer(context);
+        if (unwindFramePointers(fp, onFrame, m_useDwarfUnwinder, false, false)) {
+            return fastCount;
+        }
+    }
+#endif
+
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    if (m_useDwarfUnwinder) {
+        DwarfUnwindContext dwarfContext;
+        if (context == nullptr) {
+            DWARF_UNWIND_CAPTURE_CONTEXT(dwarfContext);
+        } else {
+            DwarfUnwinder::initContext(dwarfContext, context);
+        }
+        if (unwindDwarf(dwarfContext, onFrame, false, false)) {
+            return fastCount;
+        }
+    }
+#endif
+
+#ifdef DBGUTIL_NO_LIBUNWIND
+    return 0;
+#else
+    unw_context_t unw_context;
+    if (context == nullptr) {
+        unw_getcontext(&unw_context);
+        context = &unw_context;
+    }
+
+    unw_cursor_t cursor;
+    if (unw_init_local(&cursor, (unw_context_t*)context) != 0) {
+        return 0;
+    }
+
+    // as in walkStack(), the first step moves to the caller, so the calling frame is never skipped
+    size_t count = 0;
+    while (count < maxFrames && unw_step(&cursor) > 0) {
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        unw_word_t ip = 0;
+        unw_get_reg(&cursor, UNW_REG_IP, &ip);
+        frames[count++] = (void*)ip;
+    }
+    return count;
+#endif
+}
+
 DbgUtilErr LinuxStackTraceProvider::getThreadStackTrace(os_thread_id_t threadId,
                                                         RawStackTrace& stackTrace) {
     // for current thread do regular stack walking
@@ -98,6 +434,14 @@ DbgUtilErr LinuxStackTraceProvider::getThreadStackTrace(os_thread_id_t threadId,
 
 DbgUtilErr initLinuxStackTrace() {
     LinuxStackTraceProvider::createInstance();
+    if (getGlobalFlags() & DBGUTIL_FRAME_POINTER_UNWIND) {
+        LinuxStackTraceProvider::getInstance()->setFramePointerUnwind(true);
+    }
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    if (isDwarfUnwindEnabled()) {
+        LinuxStackTraceProvider::getInstance()->setDwarfUnwind(true);
+    }
+#endif
     setStackTraceProvider(LinuxStackTraceProvider::getInstance());
     return DBGUTIL_ERR_OK;
 }
@@ -35,11 +35,40 @@ public:
      */
     DbgUtilErr getThreadStackTrace(os_thread_id_t threadId, RawStackTrace& stackTrace) final;
 
+    /**
+     * @brief Captures a raw stack trace into a caller-provided array. Unwinding takes place
+     * directly into the array, and stops once the array is full. Since local unwinding with
+     * libunwind requires no heap allocation, this is async-signal-safe.
+     * @param[out] frames The array receiving the frame addresses (innermost first).
+     * @param maxFrames The array capacity.
+     * @param skip The number of innermost frames to skip (not counting the caller).
+     * @param context The call context. Pass null to capture current thread call stack.
+     * @return size_t The number of captured frames.
+     */
+    size_t captureRawStack(void** frames, size_t maxFrames, size_t skip = 0,
+                           void* context = nullptr) final;
+
+    /**
+     * @brief Configures whether stack unwinding follows the frame pointer chain (see @ref
+     * DBGUTIL_FRAME_POINTER_UNWIND). Has no effect on platforms where this is not supported.
+     */
+    inline void setFramePointerUnwind(bool enable) { m_useFramePointers = enable; }
+
+    /**
+     * @brief Configures whether stack unwinding uses the builtin DWARF unwinder rather than
+     * libunwind (see @ref DBGUTIL_BUILTIN_UNWIND). Has no effect on platforms where this is not
+     * supported.
+     */
+    inline void setDwarfUnwind(bool enable) { m_useDwarfUnwinder = enable; }
+
 private:
-    LinuxStackTraceProvider() {}
+    LinuxStackTraceProvider() : m_useFramePointers(false), m_useDwarfUnwinder(false) {}
     ~LinuxStackTraceProvider() final {}
 
     static LinuxStackTraceProvider* sInstance;
+
+    bool m_useFramePointers;
+    bool m_useDwarfUnwinder;
 };
 
 extern DbgUtilErr initLinuxStackTrace();
@@ -22,9 +22,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <regex>
+#include <system_error>
 #include <vector>
 
+#include "dbg_util_flags.h"
 #include "dbgutil_common.h"
 #include "dbgutil_log_imp.h"
 
@@ -35,6 +38,15 @@ namespace dbgutil {
 // read PE32 image and see if there is a symbol table and GNU debug sections). This is unrelated to
 // whether the application is running under MSYSTEM runtime environment or not. #ifdef DBGUTIL_MINGW
 
+// default number of threads used for prewarming module symbol data
+#define DBGUTIL_DEFAULT_PREWARM_THREADS 4u
+
+// maximum number of threads used for searching module symbols in parallel
+#define DBGUTIL_SYMBOL_SEARCH_THREADS 4u
+
+// batch size up to which the address sort order is kept on the stack
+#define DBGUTIL_BATCH_STACK_SIZE 256
+
 static Logger sLogger;
 
 LinuxSymbolEngine* LinuxSymbolEngine::sInstance = nullptr;
@@ -56,64 +68,85 @@ void LinuxSymbolEngine::destroyInstance() {
     sInstance = nullptr;
 }
 
-DbgUtilErr LinuxSymbolEngine::collectSymbolInfo(SymbolModuleData* symModData, void* symAddress,
-                                                SymbolInfo& symbolInfo) {
-    // get module details
+const char* SymbolModuleData::getDemangledName(const char* name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_demangleLock);
+        DemangledNameMap::const_iterator itr = m_demangledNameMap.find(name);
+        if (itr != m_demangledNameMap.end()) {
+            return itr->second;
+        }
+    }
+
+    // demangle outside of lock (two threads may demangle the same name concurrently, this is ok)
+    const char* demangledName = name;
+    int status = 0;
+    char* demangledBuf = abi::__cxa_demangle(name, nullptr, 0, &status);
+    if (status == 0 && demangledBuf != nullptr) {
+        const char* internedName = m_stringPool.intern(demangledBuf);
+        if (internedName != nullptr) {
+            demangledName = internedName;
+        }
+    }
+    free(demangledBuf);
+
+    std::unique_lock<std::shared_mutex> lock(m_demangleLock);
+    try {
+        m_demangledNameMap.insert(DemangledNameMap::value_type(name, demangledName));
+    } catch (std::bad_alloc&) {
+        // not remembered, name will be demangled again next time
+    }
+    return demangledName;
+}
+
+DbgUtilErr LinuxSymbolEngine::collectSymbolInfo(
+    SymbolModuleData* symModData, void* symAddress, SymbolInfoRef& symbolInfo,
+    SymbolDetail detail, DwarfUtil::SearchCache* searchCache /* = nullptr */) {
+    // NOTE: names are never copied, but rather point to the image reader's symbol table or the
+    // module's string pool, both of which live as long as the engine
     symbolInfo.m_moduleBaseAddress = symModData->m_moduleInfo.m_loadAddress;
-    symbolInfo.m_moduleName = symModData->m_moduleInfo.m_modulePath;
-    LOG_DEBUG(sLogger, "Symbol module image %s loaded at %p", symbolInfo.m_moduleName.c_str(),
-              symbolInfo.m_moduleBaseAddress);
-
-    // first search in binary image
-    // this way we can also get start address of symbol and compute byte offset
-    DbgUtilErr rc = symModData->m_imageReader->searchSymbol(
-        symAddress, symbolInfo.m_symbolSize, symbolInfo.m_symbolName, symbolInfo.m_fileName,
-        &symbolInfo.m_startAddress);
-    if (rc != DBGUTIL_ERR_OK) {
-        LOG_DEBUG(sLogger, "Failed to find symbol %p in binary image: %s", symAddress,
-                  errorToString(rc));
-    } else {
-        LOG_DEBUG(
-            sLogger,
-            "Found symbol %p info in binary image: symbol name=%s, file name=%s, start addr=%p",
-            symAddress, symbolInfo.m_symbolName.c_str(), symbolInfo.m_fileName.c_str(),
-            symbolInfo.m_startAddress);
-        symbolInfo.m_byteOffset = (uint64_t)symAddress - (uint64_t)symbolInfo.m_startAddress;
-    }
-
-    // next we go to dwarf data and try there
-    SymbolInfo symbolInfoDwarf = symbolInfo;
-    LOG_DEBUG(sLogger, "Searching for symbol %p at module %s base %p by relocation base %p",
-              symAddress, symModData->m_moduleInfo.m_modulePath.c_str(),
-              symModData->m_moduleInfo.m_loadAddress,
-              (void*)symModData->m_imageReader->getRelocationBase());
-    rc = symModData->m_dwarfUtil.searchSymbol(
-        symAddress, symbolInfoDwarf, (void*)symModData->m_imageReader->getRelocationBase());
-    if (rc == DBGUTIL_ERR_OK) {
-        LOG_DEBUG(sLogger, "Dwarf info: sym name %s, file %s, line %u",
-                  symbolInfoDwarf.m_symbolName.c_str(), symbolInfoDwarf.m_fileName.c_str(),
-                  symbolInfoDwarf.m_lineNumber);
-    }
-
-    // finally merge all missing data from the dwarf symbol info
-    symbolInfo.merge(symbolInfoDwarf);
+    if (detail & DBGUTIL_SYMBOL_DETAIL_MODULE) {
+        symbolInfo.m_moduleName = symModData->m_moduleInfo.m_modulePath.c_str();
+    }
+    LOG_DEBUG(sLogger, "Symbol module image %s loaded at %p",
+              symModData->m_moduleInfo.m_modulePath.c_str(), symbolInfo.m_moduleBaseAddress);
+
+    // first search in binary image and dwarf data
+    DbgUtilErr rc = symModData->searchSymbol(symAddress, symbolInfo, detail, searchCache);
 
     // although we should know from image reader that the symbol table is empty (so we can
     // distinguish whether this is a Windows native DLL or a MinGW DLL built by gcc/g++), we just
     // give it a shot anyway if some detail is missing (logically, this will cover more edge cases)
-    bool fromWin32SymHandler = false;
 #ifdef DBGUTIL_MINGW
-    if (rc != DBGUTIL_ERR_OK && rc == DBGUTIL_ERR_NOT_FOUND) {
-        rc = Win32SymbolEngine::getInstance()->getSymbolInfo(symAddress, symbolInfo);
+    if (rc == DBGUTIL_ERR_NOT_FOUND) {
+        // names are interned, since the Win32 symbol handler returns copies
+        SymbolInfo win32SymbolInfo;
+        rc = Win32SymbolEngine::getInstance()->getSymbolInfo(symAddress, win32SymbolInfo,
+                                                             detail);
         if (rc == DBGUTIL_ERR_OK) {
-            fromWin32SymHandler = true;
+            StringPool& stringPool = symModData->m_stringPool;
+            const char* name = stringPool.intern(win32SymbolInfo.m_symbolName.c_str());
+            const char* file = stringPool.intern(win32SymbolInfo.m_fileName.c_str());
+            if (name != nullptr) {
+                symbolInfo.m_symbolName = name;
+            }
+            if (file != nullptr) {
+                symbolInfo.m_fileName = file;
+            }
+            symbolInfo.m_startAddress = win32SymbolInfo.m_startAddress;
+            symbolInfo.m_byteOffset = win32SymbolInfo.m_byteOffset;
+            symbolInfo.m_lineNumber = win32SymbolInfo.m_lineNumber;
+            symbolInfo.m_columnIndex = win32SymbolInfo.m_columnIndex;
+            symbolInfo.m_symbolSize = win32SymbolInfo.m_symbolSize;
         }
     }
 #endif
 
 #ifdef DBGUTIL_LINUX
-    if (symbolInfo.m_symbolName.empty() || symbolInfo.m_moduleName.empty() ||
-        symbolInfo.m_moduleBaseAddress == nullptr) {
+    bool demangle = (detail & DBGUTIL_SYMBOL_DETAIL_DEMANGLE) != 0;
+    bool needSymbolName =
+        (detail & DBGUTIL_SYMBOL_DETAIL_FUNCTION) && *symbolInfo.m_symbolName == 0;
+    bool needModuleName = (detail & DBGUTIL_SYMBOL_DETAIL_MODULE) && *symbolInfo.m_moduleName == 0;
+    if (needSymbolName || needModuleName || symbolInfo.m_moduleBaseAddress == nullptr) {
         Dl_info dlinfo;
         if (dladdr(symAddress, &dlinfo) == 0) {
             LOG_DEBUG(sLogger, "Symbol at %p could not be matched with a loaded module",
@@ -121,44 +154,135 @@ DbgUtilErr LinuxSymbolEngine::collectSymbolInfo(SymbolModuleData* symModData, vo
         } else {
             LOG_DEBUG(sLogger, "dladdr() returned: module %s at %p, sym name %s", dlinfo.dli_fname,
                       dlinfo.dli_fbase, dlinfo.dli_sname);
-            if (symbolInfo.m_moduleName.empty()) {
-                symbolInfo.m_moduleName = dlinfo.dli_fname;
+            // NOTE: dladdr() names are interned, so that the demangled name cache can use them
+            if (needModuleName && dlinfo.dli_fname != nullptr) {
+                const char* moduleName = symModData->m_stringPool.intern(dlinfo.dli_fname);
+                if (moduleName != nullptr) {
+                    symbolInfo.m_moduleName = moduleName;
+                }
             }
             if (symbolInfo.m_moduleBaseAddress == nullptr) {
                 symbolInfo.m_moduleBaseAddress = dlinfo.dli_fbase;
             }
-
-            // we might be already able to get the symbol name from dlinfo
-            if (symbolInfo.m_symbolName.empty() && dlinfo.dli_sname != nullptr) {
-                symbolInfo.m_symbolName = dlinfo.dli_sname;
+            // names from the binary image are already demangled, but dladdr() names are not, so
+            // they are demangled through the module's demangled name cache
+            if (needSymbolName && dlinfo.dli_sname != nullptr) {
+                const char* name = symModData->m_stringPool.intern(dlinfo.dli_sname);
+                if (name != nullptr) {
+                    symbolInfo.m_symbolName = demangle ? symModData->getDemangledName(name) : name;
+                }
             }
         }
     }
 #endif
 
-    // if we found a symbol name, then try to demangle it
-    if (!symbolInfo.m_symbolName.empty() && !fromWin32SymHandler) {
-        int status;
-        char* demangledName =
-            abi::__cxa_demangle(symbolInfo.m_symbolName.c_str(), nullptr, 0, &status);
-        if (status == 0 && demangledName != nullptr) {
-            symbolInfo.m_symbolName = demangledName;
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Failed to get symbol %p info: %s", symAddress, errorToString(rc));
+    }
+    return rc;
+}
+
+DbgUtilErr LinuxSymbolEngine::resolveSymbol(void* symAddress, SymbolInfoRef& symbolInfo,
+                                            SymbolDetail detail, SymbolModuleData*& symModData,
+                                            DwarfUtil::SearchCache* searchCache /* = nullptr */) {
+    // check first in result cache if enabled (partial results are never cached)
+    bool useCache = m_symbolCache.isInitialized() && detail == DBGUTIL_SYMBOL_DETAIL_ALL;
+    DbgUtilErr rc = DBGUTIL_ERR_OK;
+    if (useCache && m_symbolCache.lookup(symAddress, symbolInfo, rc)) {
+        return rc;
+    }
+
+    // switch module only when leaving the current one
+    if (symModData == nullptr || !symModData->contains(symAddress)) {
+        if (searchCache != nullptr) {
+            searchCache->reset();
+        }
+        rc = getSymbolModuleByAddress(symAddress, symModData);
+        if (rc != DBGUTIL_ERR_OK) {
+            symModData = nullptr;
+            return rc;
         }
     }
 
-    if (rc != DBGUTIL_ERR_OK) {
-        LOG_DEBUG(sLogger, "Failed to get symbol %p info: %s", symAddress, errorToString(rc));
+    // now all threads can collect symbol data concurrently
+    rc = collectSymbolInfo(symModData, symAddress, symbolInfo, detail, searchCache);
+
+    // transient failures (e.g. out of memory) are not cached, so the next lookup tries again
+    if (useCache && (rc == DBGUTIL_ERR_OK || rc == DBGUTIL_ERR_NOT_FOUND)) {
+        m_symbolCache.insert(symAddress, symbolInfo, rc);
     }
     return rc;
 }
 
+// compact symbol information is either copied as is, or converted to full symbol information
+static inline void assignSymbolInfo(const SymbolInfoRef& source, SymbolInfoRef& target) {
+    target = source;
+}
+
+static inline void assignSymbolInfo(const SymbolInfoRef& source, SymbolInfo& target) {
+    source.toSymbolInfo(target);
+}
+
+template <typename T>
+DbgUtilErr LinuxSymbolEngine::resolveSymbolBatch(const void* const* addrs, size_t count,
+                                                 T* symbolInfos, SymbolDetail detail) {
+    if (count == 0) {
+        return DBGUTIL_ERR_OK;
+    }
+    if (addrs == nullptr || symbolInfos == nullptr) {
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+
+    // sort addresses, so that addresses of the same module and compilation unit are adjacent
+    // NOTE: the sort order of a typical stack trace is kept on the stack
+    size_t orderBuf[DBGUTIL_BATCH_STACK_SIZE];
+    std::vector<size_t> orderVec;
+    size_t* order = orderBuf;
+    if (count > DBGUTIL_BATCH_STACK_SIZE) {
+        orderVec.resize(count);
+        order = orderVec.data();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    std::sort(order, order + count, [addrs](size_t lhs, size_t rhs) {
+        return (uintptr_t)addrs[lhs] < (uintptr_t)addrs[rhs];
+    });
+
+    SymbolModuleData* symModData = nullptr;
+    DwarfUtil::SearchCache searchCache;
+    size_t prevIndex = SIZE_MAX;
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = order[i];
+        void* symAddress = const_cast<void*>(addrs[index]);
+
+        // duplicate addresses are resolved only once
+        if (prevIndex != SIZE_MAX && addrs[prevIndex] == symAddress) {
+            symbolInfos[index] = symbolInfos[prevIndex];
+            continue;
+        }
+        prevIndex = index;
+
+        // failing to resolve some of the addresses is not an error
+        SymbolInfoRef symbolInfo;
+        DbgUtilErr rc = resolveSymbol(symAddress, symbolInfo, detail, symModData, &searchCache);
+        if (rc == DBGUTIL_ERR_NOMEM) {
+            return rc;
+        }
+        assignSymbolInfo(symbolInfo, symbolInfos[index]);
+    }
+    return DBGUTIL_ERR_OK;
+}
+
 SymbolModuleData* LinuxSymbolEngine::findSymbolModule(void* address) {
-    // NOTE: assuming lock already taken!
+    // NOTE: no lock required, the published module set is immutable, and it is not reclaimed until
+    // the engine is destroyed, so lookups perform no shared writes at all
+    const SymbolModuleSet* symbolModuleSet = m_symbolModuleSet.load(std::memory_order_acquire);
     SymbolModuleData* symModData = nullptr;
-    SymbolModuleSet::iterator itr = std::lower_bound(
-        m_symbolModuleSet.begin(), m_symbolModuleSet.end(), address,
+    SymbolModuleSet::const_iterator itr = std::lower_bound(
+        symbolModuleSet->begin(), symbolModuleSet->end(), address,
         [](SymbolModuleData* symModData, void* address) { return (*symModData) < address; });
-    if (itr != m_symbolModuleSet.end() && (*itr)->contains(address)) {
+    if (itr != symbolModuleSet->end() && (*itr)->contains(address)) {
         symModData = *itr;
     }
     return symModData;
@@ -178,45 +302,119 @@ void LinuxSymbolEngine::prepareModuleData(
     }
 
     // now prepare dwarf stuff
+    (void)symModData->openDwarfData(symModData->m_moduleInfo.m_loadAddress);
 
-    // collect debug section references from image reader
-    symModData->m_imageReader->forEachSection(
-        ".debug", [symModData](const OsImageSection& section) {
-            LOG_DEBUG(sLogger, "Adding debug section: %s", section.m_name.c_str());
-            symModData->m_dwarfData.addSection(section.m_name.c_str(),
-                                               {section.m_start, section.m_size});
-            return true;  // continue traversing sections
-        });
-
-    // if all sections are present then parse initial dwarf data
-    if (!symModData->m_dwarfData.checkDebugSections()) {
-        LOG_DEBUG(sLogger, "Not all required debug sections found, skipping by dwarf");
-    } else {
-        rc = symModData->m_dwarfUtil.open(
-            symModData->m_dwarfData, symModData->m_moduleInfo.m_loadAddress,
-            symModData->m_imageReader->getIs64Bit(), symModData->m_imageReader->getIsExe());
-        if (rc != DBGUTIL_ERR_OK) {
-            LOG_DEBUG(sLogger, "Failed to open dwarf data: %s", errorToString(rc));
-        } else {
-            symModData->m_dwarfUtilValid = true;
+    // persist symbol index for the next process using the same image
+    if (rc == DBGUTIL_ERR_OK && symModData->m_imageReader->getSymbolIndex() == nullptr) {
+        queueSymbolIndex(symModData);
+    }
+}
+
+void LinuxSymbolEngine::queueSymbolIndex(SymbolModuleData* symModData) {
+    if (symModData->m_imageReader->getBuildId().empty() || SymbolIndex::getIndexDir().empty()) {
+        return;
+    }
+
+    // NOTE: the index is exported from image and debug data that are no longer modified after the
+    // module is prepared, so it can be written concurrently with lookups in the same module
+    std::unique_lock<std::mutex> lock(m_indexLock);
+    try {
+        if (!m_indexThread.joinable()) {
+            m_indexThread = std::thread(&LinuxSymbolEngine::indexWriterLoop, this);
         }
+        m_indexQueue.push_back(symModData);
+    } catch (std::exception& e) {
+        // write the index in the calling thread instead (the index is not required for lookups)
+        LOG_DEBUG(sLogger, "Failed to queue symbol index of module %s for writing: %s",
+                  symModData->m_moduleInfo.m_modulePath.c_str(), e.what());
+        lock.unlock();
+        saveSymbolIndex(symModData);
+        return;
     }
+    m_indexCv.notify_one();
 }
 
-DbgUtilErr LinuxSymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo) {
-    // search module with read-lock in already loaded modules
-    SymbolModuleData* symModData = nullptr;
-    {
-        std::shared_lock<std::shared_mutex> lock(m_lock);
-        symModData = findSymbolModule(symAddress);
+void LinuxSymbolEngine::indexWriterLoop() {
+    // pending index files are still written when stopping
+    std::unique_lock<std::mutex> lock(m_indexLock);
+    for (;;) {
+        m_indexCv.wait(lock, [this]() { return m_indexStopRequested || !m_indexQueue.empty(); });
+        if (m_indexQueue.empty()) {
+            break;
+        }
+        SymbolModuleData* symModData = m_indexQueue.back();
+        m_indexQueue.pop_back();
+        lock.unlock();
+        saveSymbolIndex(symModData);
+        lock.lock();
+    }
+}
+
+void LinuxSymbolEngine::saveSymbolIndex(SymbolModuleData* symModData) {
+    const std::string& buildId = symModData->m_imageReader->getBuildId();
+    if (buildId.empty()) {
+        return;
+    }
+    std::string indexDir = SymbolIndex::getIndexDir();
+    if (indexDir.empty()) {
+        return;
     }
 
-    // if the module exists then collect symbol info from there
-    // NOTE: we don't need global read-lock as the module object never changes nor gets deleted
+    OsImageReader* imageReader = symModData->m_imageReader;
+    SymbolIndexBuilder builder(imageReader->getIs64Bit(), imageReader->getIsExe(),
+                               imageReader->getRelocationBase());
+    imageReader->exportSymbols(builder);
+    if (symModData->m_dwarfUtilValid) {
+        symModData->m_dwarfUtil.exportCURanges(builder);
+    }
+    DbgUtilErr rc = builder.write(indexDir, buildId);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Failed to write symbol index of module %s: %s",
+                  symModData->m_moduleInfo.m_modulePath.c_str(), errorToString(rc));
+    }
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolInfo(
+    void* symAddress, SymbolInfo& symbolInfo,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    // resolve into a clean object, so that whatever the caller passed does not get merged
+    SymbolInfoRef symbolInfoRef;
+    SymbolModuleData* symModData = nullptr;
+    DbgUtilErr rc = resolveSymbol(symAddress, symbolInfoRef, detail, symModData);
+    symbolInfoRef.toSymbolInfo(symbolInfo);
+    return rc;
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolInfoBatch(
+    const void* const* addrs, size_t count, SymbolInfo* symbolInfos,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    return resolveSymbolBatch(addrs, count, symbolInfos, detail);
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolInfoRef(
+    void* symAddress, SymbolInfoRef& symbolInfo,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    SymbolModuleData* symModData = nullptr;
+    return resolveSymbol(symAddress, symbolInfo, detail, symModData);
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolInfoRefBatch(
+    const void* const* addrs, size_t count, SymbolInfoRef* symbolInfos,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    return resolveSymbolBatch(addrs, count, symbolInfos, detail);
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolModuleByAddress(void* address,
+                                                       SymbolModuleData*& symModData) {
+    // search module without any lock in already loaded modules
+    symModData = findSymbolModule(address);
+
+    // if the module exists then it can be used after it is ready
+    // NOTE: module objects never change (once ready) nor get deleted
     if (symModData != nullptr) {
-        // must with for module to be ready for use
+        // must wait for module to be ready for use
         symModData->waitReady();
-        return collectSymbolInfo(symModData, symAddress, symbolInfo);
+        return DBGUTIL_ERR_OK;
     }
 
     // module was not found, so we need to get the module info, setup an image reader, dwarf reader,
@@ -224,23 +422,20 @@ DbgUtilErr LinuxSymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbol
     // is ready.
 
     // first search in all system modules if address is relevant
-    LOG_DEBUG(sLogger, "Searching for symbol %p", symAddress);
+    LOG_DEBUG(sLogger, "Searching for symbol %p", address);
     OsModuleInfo moduleInfo;
-    DbgUtilErr rc = getModuleManager()->getModuleByAddress(symAddress, moduleInfo);
+    DbgUtilErr rc = getModuleManager()->getModuleByAddress(address, moduleInfo);
     if (rc != DBGUTIL_ERR_OK || moduleInfo.m_loadAddress == nullptr) {
-        LOG_DEBUG(sLogger, "Failed to find module for symbol %p: %s", symAddress,
-                  errorToString(rc));
-        return rc;
+        LOG_DEBUG(sLogger, "Failed to find module for symbol %p: %s", address, errorToString(rc));
+        return (rc != DBGUTIL_ERR_OK) ? rc : DBGUTIL_ERR_NOT_FOUND;
     }
 
     // insert an entry under write lock
-    symModData = getSymbolModule(moduleInfo, symAddress);
+    symModData = getSymbolModule(moduleInfo, address);
     if (symModData == nullptr) {
         return DBGUTIL_ERR_NOMEM;
     }
-
-    // now all threads can collect symbol data concurrently
-    return collectSymbolInfo(symModData, symAddress, symbolInfo);
+    return DBGUTIL_ERR_OK;
 }
 
 SymbolModuleData* LinuxSymbolEngine::getSymbolModule(const OsModuleInfo& moduleInfo,
@@ -248,7 +443,7 @@ SymbolModuleData* LinuxSymbolEngine::getSymbolModule(const OsModuleInfo& moduleI
     SymbolModuleData* symModData = nullptr;
     bool shouldWait = false;
     {
-        std::unique_lock<std::shared_mutex> lock(m_lock);
+        std::unique_lock<std::mutex> lock(m_lock);
         // handle race, in case another thread is doing the same thing
         symModData = findSymbolModule(address);
         if (symModData != nullptr) {
@@ -256,15 +451,16 @@ SymbolModuleData* LinuxSymbolEngine::getSymbolModule(const OsModuleInfo& moduleI
             // but we do this wait outside lock scope
             shouldWait = true;
         } else {
-            // insert a half-baked module (no race, we are under write lock)
+            // insert a half-baked module (no race, we are under lock)
             symModData = new (std::nothrow) SymbolModuleData();
             if (symModData == nullptr) {
                 return nullptr;
             }
             symModData->m_moduleInfo = moduleInfo;
-            m_symbolModuleSet.push_back(symModData);
-            std::sort(m_symbolModuleSet.begin(), m_symbolModuleSet.end(),
-                      SymbolModuleDataCompare());
+            if (!publishSymbolModule(symModData)) {
+                delete symModData;
+                return nullptr;
+            }
             // note entry is not ready yet, but other module data can be accessed while we
             // prepare the module info object
         }
@@ -280,64 +476,359 @@ SymbolModuleData* LinuxSymbolEngine::getSymbolModule(const OsModuleInfo& moduleI
     return symModData;
 }
 
-DbgUtilErr LinuxSymbolEngine::visitSymbols(const char* symbolRegex, const char* moduleNameRegex,
-                                           SymbolInfoVisitor* visitor) {
-    // we need to traverse now all other modules, while limiting modules
-    // according to regular expression, is provided. We stop traversing modules if symbol was found
+DbgUtilErr LinuxSymbolEngine::visitSymbols(
+    const char* symbolRegex, const char* moduleNameRegex, SymbolInfoVisitor* visitor,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
     LOG_DEBUG(sLogger, "Searching for symbol %s", symbolRegex);
 
+    // compile the symbol pattern once, so that patterns with a literal prefix are served by the
+    // name index of each module, instead of matching a regular expression against each symbol
+    SymbolPattern symbolPattern;
+    DbgUtilErr rc = symbolPattern.compile(symbolRegex);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Invalid symbol search pattern %s: %s", symbolRegex, errorToString(rc));
+        return rc;
+    }
+
     // first refresh module list
-    DbgUtilErr rc = getModuleManager()->refreshModuleList();
+    rc = getModuleManager()->refreshModuleList();
     if (rc != DBGUTIL_ERR_OK) {
         LOG_ERROR(sLogger, "Failed to refresh module list");
         return rc;
     }
 
-    // now traverse modules that match the module pattern
-    std::regex symbolPattern(symbolRegex);  // create once
-    std::regex modulePattern(moduleNameRegex);
-    rc = getModuleManager()->forEachModule([this, &symbolPattern, &modulePattern, visitor](
-                                               const OsModuleInfo& moduleInfo,
-                                               bool& shouldStop) -> DbgUtilErr {
-        DbgUtilErr rc = DBGUTIL_ERR_OK;
-        if (std::regex_match(moduleInfo.m_modulePath, modulePattern)) {
-            // search for symbol in module
+    // collect modules that match the module pattern
+    std::vector<OsModuleInfo> modules;
+    try {
+        std::regex modulePattern(moduleNameRegex != nullptr ? moduleNameRegex : ".*");
+        (void)getModuleManager()->forEachModule(
+            [&modules, &modulePattern](const OsModuleInfo& moduleInfo,
+                                       bool& /* shouldStop */) -> DbgUtilErr {
+                if (std::regex_match(moduleInfo.m_modulePath, modulePattern)) {
+                    modules.push_back(moduleInfo);
+                }
+                return DBGUTIL_ERR_OK;
+            });
+    } catch (std::regex_error& e) {
+        LOG_ERROR(sLogger, "Invalid module search pattern %s: %s", moduleNameRegex, e.what());
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to collect modules for symbol search, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
 
-            // insert an entry under write lock
+    // modules are loaded and searched in parallel, the visitor is called afterwards by the calling
+    // thread, in module order
+    size_t moduleCount = modules.size();
+    std::vector<SymbolModuleData*> symModules(moduleCount, nullptr);
+    std::vector<std::vector<uint32_t>> moduleMatches(moduleCount);
+    unsigned threads = std::min(std::thread::hardware_concurrency(), DBGUTIL_SYMBOL_SEARCH_THREADS);
+    threads = (unsigned)std::min((size_t)std::max(threads, 1u), std::max(moduleCount, (size_t)1));
+
+    std::atomic<size_t> nextModule(0);
+    std::atomic<DbgUtilErr> result(DBGUTIL_ERR_OK);
+    auto worker = [this, moduleCount, &modules, &symModules, &moduleMatches, &symbolPattern,
+                   &nextModule, &result]() {
+        for (;;) {
+            size_t index = nextModule.fetch_add(1, std::memory_order_relaxed);
+            if (index >= moduleCount) {
+                break;
+            }
+            const OsModuleInfo& moduleInfo = modules[index];
             SymbolModuleData* symModData = getSymbolModule(moduleInfo, moduleInfo.m_loadAddress);
             if (symModData == nullptr) {
-                return DBGUTIL_ERR_NOMEM;
+                result.store(DBGUTIL_ERR_NOMEM, std::memory_order_relaxed);
+                continue;
+            }
+            DbgUtilErr rc =
+                symModData->m_imageReader->searchSymbols(symbolPattern, moduleMatches[index]);
+            if (rc != DBGUTIL_ERR_OK) {
+                LOG_DEBUG(sLogger, "Failed to search symbols of module %s: %s",
+                          moduleInfo.m_modulePath.c_str(), errorToString(rc));
+                if (rc == DBGUTIL_ERR_NOMEM) {
+                    result.store(rc, std::memory_order_relaxed);
+                }
+                continue;
             }
-            rc = symModData->m_imageReader->forEachSymbol(
-                [this, symModData, visitor, &shouldStop, &symbolPattern](
-                    const char* symbolName, void* address, const char* fileName,
-                    uint64_t symbolSize, bool& innerShouldStop) -> DbgUtilErr {
-                    // check symbol matches pattern
-                    DbgUtilErr rc = DBGUTIL_ERR_OK;
-                    if (std::regex_match(symbolName, symbolPattern)) {
-                        // get full symbol info
-                        SymbolInfo symbolInfo;
-                        rc = collectSymbolInfo(symModData, address, symbolInfo);
-                        if (rc == DBGUTIL_ERR_OK) {
-                            rc = visitor->onSymbolInfo(symbolInfo, innerShouldStop);
-                            // stop also outer loop if needed
-                            shouldStop = innerShouldStop;
-                        }
-                    }
-                    return rc;
-                });
+            symModules[index] = symModData;
         }
+    };
+
+    // the calling thread participates as one of the workers
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        try {
+            workers.emplace_back(worker);
+        } catch (std::system_error& e) {
+            LOG_DEBUG(sLogger, "Failed to start symbol search thread, continuing with %zu: %s",
+                      workers.size() + 1, e.what());
+            break;
+        }
+    }
+    worker();
+    for (std::thread& workerThread : workers) {
+        workerThread.join();
+    }
+    rc = result.load(std::memory_order_relaxed);
+    if (rc != DBGUTIL_ERR_OK) {
         return rc;
-    });
+    }
 
+    // now collect full symbol info of all matching symbols
+    // NOTE: failure to collect some of the details (e.g. no debug information) is not an error
+    bool shouldStop = false;
+    for (size_t i = 0; i < moduleCount && !shouldStop; ++i) {
+        SymbolModuleData* symModData = symModules[i];
+        for (uint32_t symIndex : moduleMatches[i]) {
+            SymbolInfoRef symbolInfoRef;
+            void* address = symModData->m_imageReader->getSymbolAddress(symIndex);
+            rc = collectSymbolInfo(symModData, address, symbolInfoRef, detail);
+            if (rc == DBGUTIL_ERR_NOMEM) {
+                return rc;
+            }
+            SymbolInfo symbolInfo;
+            symbolInfoRef.toSymbolInfo(symbolInfo);
+            rc = visitor->onSymbolInfo(symbolInfo, shouldStop);
+            if (rc != DBGUTIL_ERR_OK) {
+                return rc;
+            }
+            if (shouldStop) {
+                break;
+            }
+        }
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr LinuxSymbolEngine::getSymbolCacheStats(SymbolCacheStats& stats) {
+    if (!m_symbolCache.isInitialized()) {
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    m_symbolCache.getStats(stats);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr LinuxSymbolEngine::enableSymbolCache(uint32_t capacityLog2) {
+    DbgUtilErr rc = m_symbolCache.initialize(capacityLog2);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Failed to initialize symbol cache: %s", errorToString(rc));
+    }
     return rc;
 }
 
-LinuxSymbolEngine::LinuxSymbolEngine() {}
+std::shared_future<DbgUtilErr> LinuxSymbolEngine::prewarm(const char* moduleRegex, unsigned threads,
+                                                          bool async) {
+    std::shared_ptr<std::promise<DbgUtilErr>> result =
+        std::make_shared<std::promise<DbgUtilErr>>();
+    std::shared_future<DbgUtilErr> resultFuture = result->get_future().share();
+
+    std::unique_lock<std::mutex> lock(m_prewarmLock);
+    if (m_prewarmInProgress.load(std::memory_order_acquire)) {
+        LOG_DEBUG(sLogger, "Symbol engine prewarm already in progress");
+        result->set_value(DBGUTIL_ERR_RESOURCE_BUSY);
+        return resultFuture;
+    }
+
+    // reap previous background prewarm, which has already finished
+    if (m_prewarmThread.joinable()) {
+        m_prewarmThread.join();
+    }
+
+    // collect all matching modules
+    DbgUtilErr rc = getModuleManager()->refreshModuleList();
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Failed to refresh module list");
+        result->set_value(rc);
+        return resultFuture;
+    }
+    bool filter = (moduleRegex != nullptr && *moduleRegex != 0);
+    m_prewarmModules.clear();
+    try {
+        std::regex modulePattern(filter ? moduleRegex : ".*");
+        rc = getModuleManager()->forEachModule(
+            [this, filter, &modulePattern](const OsModuleInfo& moduleInfo, bool&) -> DbgUtilErr {
+                if (moduleInfo.m_loadAddress != nullptr &&
+                    (!filter || std::regex_match(moduleInfo.m_modulePath, modulePattern))) {
+                    m_prewarmModules.push_back(moduleInfo);
+                }
+                return DBGUTIL_ERR_OK;
+            });
+    } catch (std::regex_error& e) {
+        LOG_ERROR(sLogger, "Invalid module prewarm pattern %s: %s", moduleRegex, e.what());
+        rc = DBGUTIL_ERR_INVALID_ARGUMENT;
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to collect modules for prewarm, out of memory");
+        rc = DBGUTIL_ERR_NOMEM;
+    }
+    if (rc != DBGUTIL_ERR_OK) {
+        m_prewarmModules.clear();
+        result->set_value(rc);
+        return resultFuture;
+    }
+    LOG_DEBUG(sLogger, "Prewarming %zu modules", m_prewarmModules.size());
+
+    m_prewarmModuleCount.store((uint32_t)m_prewarmModules.size(), std::memory_order_relaxed);
+    m_prewarmPreparedCount.store(0, std::memory_order_relaxed);
+    m_prewarmInProgress.store(true, std::memory_order_release);
+    if (!async) {
+        lock.unlock();
+        result->set_value(prewarmModules(threads));
+        return resultFuture;
+    }
+
+    // the background thread only coordinates the workers, and joins the prewarm pool
+    try {
+        m_prewarmThread =
+            std::thread([this, threads, result]() { result->set_value(prewarmModules(threads)); });
+    } catch (std::system_error& e) {
+        LOG_ERROR(sLogger, "Failed to start symbol engine prewarm thread: %s", e.what());
+        m_prewarmModules.clear();
+        m_prewarmInProgress.store(false, std::memory_order_release);
+        result->set_value(DBGUTIL_ERR_SYSTEM_FAILURE);
+    }
+    return resultFuture;
+}
+
+void LinuxSymbolEngine::getPrewarmProgress(SymbolPrewarmProgress& progress) {
+    progress.m_moduleCount = m_prewarmModuleCount.load(std::memory_order_relaxed);
+    progress.m_preparedCount = m_prewarmPreparedCount.load(std::memory_order_relaxed);
+    progress.m_inProgress = m_prewarmInProgress.load(std::memory_order_acquire);
+}
+
+DbgUtilErr LinuxSymbolEngine::prewarmModules(unsigned threads) {
+    // NOTE: module list does not change until prewarm is done
+    size_t moduleCount = m_prewarmModules.size();
+    if (threads == 0) {
+        threads = std::min(std::thread::hardware_concurrency(), DBGUTIL_DEFAULT_PREWARM_THREADS);
+    }
+    threads = (unsigned)std::min((size_t)std::max(threads, 1u), std::max(moduleCount, (size_t)1));
+
+    // each worker picks the next unprepared module, concurrent lookups of the same module
+    // either wait for the worker to finish, or are waited for by the worker
+    std::atomic<size_t> nextModule(0);
+    std::atomic<DbgUtilErr> result(DBGUTIL_ERR_OK);
+    auto worker = [this, moduleCount, &nextModule, &result]() {
+        for (;;) {
+            size_t index = nextModule.fetch_add(1, std::memory_order_relaxed);
+            if (index >= moduleCount) {
+                break;
+            }
+            const OsModuleInfo& moduleInfo = m_prewarmModules[index];
+            if (getSymbolModule(moduleInfo, moduleInfo.m_loadAddress) == nullptr) {
+                result.store(DBGUTIL_ERR_NOMEM, std::memory_order_relaxed);
+            }
+            m_prewarmPreparedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // the calling thread participates as one of the workers
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        try {
+            workers.emplace_back(worker);
+        } catch (std::system_error& e) {
+            LOG_DEBUG(sLogger, "Failed to start prewarm worker thread, continuing with %zu: %s",
+                      workers.size() + 1, e.what());
+            break;
+        }
+    }
+    worker();
+    for (std::thread& workerThread : workers) {
+        workerThread.join();
+    }
+
+    LOG_DEBUG(sLogger, "Prewarmed %zu modules using %zu threads", moduleCount,
+              workers.size() + 1);
+    m_prewarmModules.clear();
+    m_prewarmInProgress.store(false, std::memory_order_release);
+    return result.load(std::memory_order_relaxed);
+}
+
+bool LinuxSymbolEngine::publishSymbolModule(SymbolModuleData* symModData) {
+    // NOTE: assuming lock already taken!
+    const SymbolModuleSet* symbolModuleSet = m_symbolModuleSet.load(std::memory_order_relaxed);
+    SymbolModuleSet* newSymbolModuleSet = nullptr;
+    try {
+        newSymbolModuleSet = new SymbolModuleSet();
+        newSymbolModuleSet->reserve(symbolModuleSet->size() + 1);
+        SymbolModuleSet::const_iterator itr =
+            std::lower_bound(symbolModuleSet->begin(), symbolModuleSet->end(), symModData,
+                             SymbolModuleDataCompare());
+        newSymbolModuleSet->insert(newSymbolModuleSet->end(), symbolModuleSet->begin(), itr);
+        newSymbolModuleSet->push_back(symModData);
+        newSymbolModuleSet->insert(newSymbolModuleSet->end(), itr, symbolModuleSet->end());
+
+        // make room for retiring the current set in advance, so that nothing can fail after the
+        // new set is published
+        m_retiredModuleSets.reserve(m_retiredModuleSets.size() + 1);
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to publish symbol module %s, out of memory",
+                  symModData->m_moduleInfo.m_modulePath.c_str());
+        delete newSymbolModuleSet;
+        return false;
+    }
+    m_symbolModuleSet.store(newSymbolModuleSet, std::memory_order_release);
+    if (symbolModuleSet != &m_emptyModuleSet) {
+        m_retiredModuleSets.push_back(symbolModuleSet);
+    }
+    return true;
+}
+
+void LinuxSymbolEngine::reclaimModuleSets() {
+    for (const SymbolModuleSet* symbolModuleSet : m_retiredModuleSets) {
+        delete symbolModuleSet;
+    }
+    m_retiredModuleSets.clear();
+}
+
+LinuxSymbolEngine::LinuxSymbolEngine()
+    : m_symbolModuleSet(&m_emptyModuleSet),
+      m_prewarmModuleCount(0),
+      m_prewarmPreparedCount(0),
+      m_prewarmInProgress(false),
+      m_indexStopRequested(false) {}
+
+LinuxSymbolEngine::~LinuxSymbolEngine() {
+    // wait for background prewarm to finish
+    if (m_prewarmThread.joinable()) {
+        m_prewarmThread.join();
+    }
+
+    // wait for pending symbol index files to be written
+    {
+        std::unique_lock<std::mutex> lock(m_indexLock);
+        m_indexStopRequested = true;
+        m_indexCv.notify_one();
+    }
+    if (m_indexThread.joinable()) {
+        m_indexThread.join();
+    }
+    reclaimModuleSets();
+
+    // the current module set contains all modules ever published (each set extends the previous
+    // one), so releasing its modules closes all image readers, unmapping all module images
+    const SymbolModuleSet* symbolModuleSet = m_symbolModuleSet.load(std::memory_order_relaxed);
+    for (SymbolModuleData* symModData : *symbolModuleSet) {
+        delete symModData;
+    }
+    if (symbolModuleSet != &m_emptyModuleSet) {
+        delete symbolModuleSet;
+    }
+}
 
 DbgUtilErr initLinuxSymbolEngine() {
     registerLogger(sLogger, "linux_symbol_engine");
     LinuxSymbolEngine::createInstance();
+    uint32_t flags = getGlobalFlags();
+    if (flags & DBGUTIL_CACHE_SYMBOLS) {
+        DbgUtilErr rc = LinuxSymbolEngine::getInstance()->enableSymbolCache(
+            DBGUTIL_GET_SYMBOL_CACHE_CAPACITY(flags));
+        if (rc != DBGUTIL_ERR_OK) {
+            LinuxSymbolEngine::destroyInstance();
+            unregisterLogger(sLogger);
+            return rc;
+        }
+    }
     setSymbolEngine(LinuxSymbolEngine::getInstance());
     return DBGUTIL_ERR_OK;
 }
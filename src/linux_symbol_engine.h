@@ -5,39 +5,52 @@
 
 #ifdef DBGUTIL_GCC
 
+#include <atomic>
 #include <condition_variable>
+#include <future>
 #include <mutex>
 #include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "dwarf_util.h"
+#include "module_symbol_data.h"
 #include "os_image_reader.h"
 #include "os_module_manager.h"
 #include "os_symbol_engine.h"
+#include "string_pool.h"
+#include "symbol_cache.h"
 
 namespace dbgutil {
 
-// cached module data for symbol search
-struct SymbolModuleData {
+// cached module data for symbol search (module data lives as long as the engine)
+struct SymbolModuleData : public ModuleSymbolData {
     OsModuleInfo m_moduleInfo;
-    OsImageReader* m_imageReader;
-    DwarfData m_dwarfData;
-    DwarfUtil m_dwarfUtil;
-    bool m_dwarfUtilValid;
     std::mutex m_lock;
     std::condition_variable m_cv;
-    bool m_isReady;
+    std::atomic<bool> m_isReady;
 
-    SymbolModuleData() : m_imageReader(nullptr), m_dwarfUtilValid(false), m_isReady(false) {}
+    // demangled names keyed by (stable) mangled name pointer
+    typedef std::unordered_map<const char*, const char*> DemangledNameMap;
+    DemangledNameMap m_demangledNameMap;
+    std::shared_mutex m_demangleLock;
+
+    SymbolModuleData() : m_isReady(false) {}
 
     inline void setReady() {
         std::unique_lock<std::mutex> lock(m_lock);
-        m_isReady = true;
+        m_isReady.store(true, std::memory_order_release);
         m_cv.notify_all();
     }
 
     inline void waitReady() {
+        // fast path: once ready, module data never changes, so no locking is required
+        if (m_isReady.load(std::memory_order_acquire)) {
+            return;
+        }
         std::unique_lock<std::mutex> lock(m_lock);
-        m_cv.wait(lock, [this]() { return m_isReady; });
+        m_cv.wait(lock, [this]() { return m_isReady.load(std::memory_order_acquire); });
     }
 
     inline bool operator<(const SymbolModuleData& symModData) const {
@@ -47,6 +60,13 @@ struct SymbolModuleData {
     inline bool operator<(void* address) const { return m_moduleInfo < address; }
 
     inline bool contains(void* address) const { return m_moduleInfo.contains(address); }
+
+    /**
+     * @brief Retrieves the interned demangled name of a symbol. The mangled name must remain valid
+     * as long as the module data exists. If the name cannot be demangled, then it is returned as
+     * is. Each name is demangled only once.
+     */
+    const char* getDemangledName(const char* name);
 };
 
 struct SymbolModuleDataCompare {
@@ -73,35 +93,147 @@ public:
      * @brief Retrieves symbol debug information (platform independent API).
      * @param symAddress The symbol address.
      * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail. The result cache is used only when all details
+     * are requested.
      * @return Operation's result.
      */
-    DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo) final;
+    DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo,
+                             SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
+
+    /**
+     * @brief Retrieves symbol debug information for a batch of addresses (platform independent
+     * API). Addresses are sorted and deduplicated, such that each module is looked up once, and
+     * consecutive addresses in the same compilation unit share the same line program lookup.
+     * @param addrs The symbol addresses.
+     * @param count The number of addresses.
+     * @param[out] symbolInfos The resulting symbol information array.
+     * @param detail The required level of detail.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr getSymbolInfoBatch(const void* const* addrs, size_t count,
+                                  SymbolInfo* symbolInfos,
+                                  SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
+
+    /**
+     * @brief Retrieves compact symbol debug information by symbol address. All names point into
+     * the interned string pool of the containing module.
+     * @param symAddress The symbol address.
+     * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail.
+     * @return Operation's result.
+     */
+    DbgUtilErr getSymbolInfoRef(void* symAddress, SymbolInfoRef& symbolInfo,
+                                SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
+
+    /**
+     * @brief Retrieves compact symbol debug information for a batch of addresses, using the same
+     * address grouping as @ref getSymbolInfoBatch().
+     * @param addrs The symbol addresses.
+     * @param count The number of addresses.
+     * @param[out] symbolInfos The resulting symbol information array.
+     * @param detail The required level of detail.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr getSymbolInfoRefBatch(const void* const* addrs, size_t count,
+                                     SymbolInfoRef* symbolInfos,
+                                     SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
 
     /**
      * @brief Traverses all symbols having a name that matches a regular expression. This variant
      * can be used if @ref searchSymbols() may yield too many symbols at once.
      * @param visitor The thread visitor.
+     * @param detail The required level of detail of each visited symbol.
      * @return The operation result.
      */
     DbgUtilErr visitSymbols(const char* symbolRegex, const char* moduleNameRegex,
-                            SymbolInfoVisitor* visitor) final;
+                            SymbolInfoVisitor* visitor,
+                            SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
+
+    /**
+     * @brief Retrieves symbol lookup result cache statistics.
+     * @param[out] stats The cache statistics.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr getSymbolCacheStats(SymbolCacheStats& stats) final;
+
+    /**
+     * @brief Enables the symbol lookup result cache.
+     * @param capacityLog2 The cache capacity (log2 of number of entries). Zero means default.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr enableSymbolCache(uint32_t capacityLog2);
+
+    /**
+     * @brief Prepares symbol data of loaded modules ahead of time, using a small worker pool.
+     * @param moduleRegex Regular expression for limiting the prepared modules (null for all).
+     * @param threads The number of worker threads to use. Pass zero to select a default.
+     * @param async Specifies whether to return immediately and prepare modules in the background.
+     * @return A future holding the prewarm operation result.
+     */
+    std::shared_future<DbgUtilErr> prewarm(const char* moduleRegex, unsigned threads,
+                                           bool async) final;
+
+    /**
+     * @brief Retrieves the progress of the last (or current) prewarm operation.
+     * @param[out] progress The prewarm progress counters.
+     */
+    void getPrewarmProgress(SymbolPrewarmProgress& progress) final;
 
 private:
     LinuxSymbolEngine();
-    ~LinuxSymbolEngine() final {}
+    ~LinuxSymbolEngine() final;
 
     static LinuxSymbolEngine* sInstance;
 
+    // the module set is published as an immutable sorted array, so that lookups require no
+    // locking at all. inserting a module replaces the entire array under lock, and the previous
+    // array is retired until the engine is destroyed (by termDbgUtil()), since lookups may
+    // still be using it, and tracking readers would put a shared write on every lookup
+    // NOTE: modules are rarely loaded, so the retired arrays amount to little memory in practice
     typedef std::vector<SymbolModuleData*> SymbolModuleSet;
-    SymbolModuleSet m_symbolModuleSet;
-    std::shared_mutex m_lock;
-
+    SymbolModuleSet m_emptyModuleSet;
+    std::atomic<const SymbolModuleSet*> m_symbolModuleSet;
+    std::vector<const SymbolModuleSet*> m_retiredModuleSets;
+    std::mutex m_lock;
+    SymbolCache m_symbolCache;
+
+    // prewarm state (only one prewarm operation may run at a time)
+    std::mutex m_prewarmLock;
+    std::thread m_prewarmThread;
+    std::vector<OsModuleInfo> m_prewarmModules;
+    std::atomic<uint32_t> m_prewarmModuleCount;
+    std::atomic<uint32_t> m_prewarmPreparedCount;
+    std::atomic<bool> m_prewarmInProgress;
+
+    // symbol index files are written by a background thread, started on first use, so that the
+    // first lookup in a module does not wait for the index file to be written
+    std::mutex m_indexLock;
+    std::condition_variable m_indexCv;
+    std::vector<SymbolModuleData*> m_indexQueue;
+    std::thread m_indexThread;
+    bool m_indexStopRequested;
+
+    // all lookups resolve symbols in compact form, which full symbol information is converted from
     DbgUtilErr collectSymbolInfo(SymbolModuleData* symModData, void* symAddress,
-                                 SymbolInfo& symbolInfo);
+                                 SymbolInfoRef& symbolInfo, SymbolDetail detail,
+                                 DwarfUtil::SearchCache* searchCache = nullptr);
+    DbgUtilErr resolveSymbol(void* symAddress, SymbolInfoRef& symbolInfo, SymbolDetail detail,
+                             SymbolModuleData*& symModData,
+                             DwarfUtil::SearchCache* searchCache = nullptr);
+    template <typename T>
+    DbgUtilErr resolveSymbolBatch(const void* const* addrs, size_t count, T* symbolInfos,
+                                  SymbolDetail detail);
 
     SymbolModuleData* findSymbolModule(void* address);
+    bool publishSymbolModule(SymbolModuleData* symModData);
+    void reclaimModuleSets();
+    DbgUtilErr getSymbolModuleByAddress(void* address, SymbolModuleData*& symModData);
     SymbolModuleData* getSymbolModule(const OsModuleInfo& moduleInfo, void* address);
     void prepareModuleData(SymbolModuleData* symModData);
+    void queueSymbolIndex(SymbolModuleData* symModData);
+    void saveSymbolIndex(SymbolModuleData* symModData);
+    void indexWriterLoop();
+    DbgUtilErr prewarmModules(unsigned threads);
 };
 
 extern DbgUtilErr initLinuxSymbolEngine();
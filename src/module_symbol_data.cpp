@@ -0,0 +1,98 @@
+#include "module_symbol_data.h"
+
+#include "dbgutil_log_imp.h"
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+void ModuleSymbolData::initLogger() { registerLogger(sLogger, "module_symbol_data"); }
+void ModuleSymbolData::termLogger() { unregisterLogger(sLogger); }
+
+ModuleSymbolData::~ModuleSymbolData() {
+    if (m_imageReader != nullptr) {
+        m_imageReader->close();
+        delete m_imageReader;
+        m_imageReader = nullptr;
+    }
+}
+
+DbgUtilErr ModuleSymbolData::openDwarfData(void* moduleBase) {
+    // collect debug section references from image reader
+    m_imageReader->forEachSection(".debug", [this](const OsImageSection& section) {
+        LOG_DEBUG(sLogger, "Adding debug section: %s", section.m_name.c_str());
+        m_dwarfData.addSection(section.m_name.c_str(), {section.m_start, section.m_size});
+        return true;  // continue traversing sections
+    });
+
+    // if all sections are present then parse initial dwarf data
+    if (!m_dwarfData.checkDebugSections()) {
+        LOG_DEBUG(sLogger, "Not all required debug sections found, skipping by dwarf");
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    DbgUtilErr rc =
+        m_dwarfUtil.open(m_dwarfData, moduleBase, m_imageReader->getIs64Bit(),
+                         m_imageReader->getIsExe(), m_imageReader->getSymbolIndex());
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Failed to open dwarf data: %s", errorToString(rc));
+        return rc;
+    }
+    m_dwarfUtilValid = true;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr ModuleSymbolData::searchSymbol(void* symAddress, SymbolInfoRef& symbolInfo,
+                                          SymbolDetail detail,
+                                          DwarfUtil::SearchCache* searchCache /* = nullptr */) {
+    // first search in binary image
+    // this way we can also get start address of symbol and compute byte offset
+    DbgUtilErr rc = DBGUTIL_ERR_OK;
+    if (detail & DBGUTIL_SYMBOL_DETAIL_FUNCTION) {
+        const char* symbolName = nullptr;
+        const char* fileName = nullptr;
+        bool demangle = (detail & DBGUTIL_SYMBOL_DETAIL_DEMANGLE) != 0;
+        rc = m_imageReader->searchSymbol(symAddress, symbolInfo.m_symbolSize, symbolName,
+                                         fileName, &symbolInfo.m_startAddress, demangle);
+        if (rc != DBGUTIL_ERR_OK) {
+            LOG_DEBUG(sLogger, "Failed to find symbol %p in binary image: %s", symAddress,
+                      errorToString(rc));
+        } else {
+            symbolInfo.m_symbolName = symbolName;
+            symbolInfo.m_fileName = fileName;
+            LOG_DEBUG(
+                sLogger,
+                "Found symbol %p info in binary image: symbol name=%s, file name=%s, start addr=%p",
+                symAddress, symbolName, fileName, symbolInfo.m_startAddress);
+            symbolInfo.m_byteOffset = (uint64_t)symAddress - (uint64_t)symbolInfo.m_startAddress;
+        }
+    }
+
+    // next we go to dwarf data and merge all missing data
+    if (detail & (DBGUTIL_SYMBOL_DETAIL_FILE_LINE | DBGUTIL_SYMBOL_DETAIL_COLUMN)) {
+        if (!m_dwarfUtilValid) {
+            return DBGUTIL_ERR_NOT_FOUND;
+        }
+        void* relocationBase = (void*)m_imageReader->getRelocationBase();
+        LOG_DEBUG(sLogger, "Searching for symbol %p by relocation base %p", symAddress,
+                  relocationBase);
+        SymbolInfoRef symbolInfoDwarf;
+        rc = m_dwarfUtil.searchSymbol(symAddress, symbolInfoDwarf, m_stringPool, relocationBase,
+                                      searchCache);
+        if (rc == DBGUTIL_ERR_OK) {
+            LOG_DEBUG(sLogger, "Dwarf info: file %s, line %u", symbolInfoDwarf.m_fileName,
+                      symbolInfoDwarf.m_lineNumber);
+            if (symbolInfo.m_lineNumber == 0) {
+                symbolInfo.m_lineNumber = symbolInfoDwarf.m_lineNumber;
+            }
+            if (symbolInfo.m_columnIndex == 0 && (detail & DBGUTIL_SYMBOL_DETAIL_COLUMN)) {
+                symbolInfo.m_columnIndex = symbolInfoDwarf.m_columnIndex;
+            }
+            if (*symbolInfo.m_fileName == 0) {
+                symbolInfo.m_fileName = symbolInfoDwarf.m_fileName;
+            }
+        }
+    }
+    return rc;
+}
+
+}  // namespace dbgutil
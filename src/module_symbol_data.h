@@ -0,0 +1,60 @@
+#ifndef __MODULE_SYMBOL_DATA_H__
+#define __MODULE_SYMBOL_DATA_H__
+
+#include "dbg_util_err.h"
+#include "dwarf_util.h"
+#include "os_image_reader.h"
+#include "os_symbol_engine.h"
+#include "string_pool.h"
+
+namespace dbgutil {
+
+/**
+ * @brief Symbol data of a single module image (symbol table and DWARF debug information), used
+ * for resolving addresses of the module. This is shared by the live symbol engine and by the
+ * offline symbolizer, which differ only in how the image is located.
+ */
+struct ModuleSymbolData {
+    OsImageReader* m_imageReader;
+    DwarfData m_dwarfData;
+    DwarfUtil m_dwarfUtil;
+    bool m_dwarfUtilValid;
+
+    // interned strings referenced by compact symbol information (live as long as the module data)
+    StringPool m_stringPool;
+
+    ModuleSymbolData() : m_imageReader(nullptr), m_dwarfUtilValid(false) {}
+    ModuleSymbolData(const ModuleSymbolData&) = delete;
+    ModuleSymbolData(ModuleSymbolData&&) = delete;
+    ModuleSymbolData& operator=(const ModuleSymbolData&) = delete;
+    ~ModuleSymbolData();
+
+    static void initLogger();
+    static void termLogger();
+
+    /**
+     * @brief Opens the DWARF debug information of the module image, if the image has all the
+     * required debug sections. The image reader must be already open.
+     * @param moduleBase The module load address.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr openDwarfData(void* moduleBase);
+
+    /**
+     * @brief Searches for symbol information of an address within the module. The symbol table is
+     * searched first, and any missing details (source file, line and column) are then taken from
+     * the DWARF line information. Module details are not filled in. All names point into the
+     * symbol table of the image or into the string pool of the module.
+     * @param symAddress The symbol address.
+     * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail.
+     * @param searchCache Optional DWARF search state kept between consecutive searches.
+     * @return DbgUtilErr The operation result (of the last search made).
+     */
+    DbgUtilErr searchSymbol(void* symAddress, SymbolInfoRef& symbolInfo, SymbolDetail detail,
+                            DwarfUtil::SearchCache* searchCache = nullptr);
+};
+
+}  // namespace dbgutil
+
+#endif  // __MODULE_SYMBOL_DATA_H__
@@ -0,0 +1,224 @@
+#include "offline_symbolizer.h"
+
+#include <new>
+
+#include "dbgutil_log_imp.h"
+#include "module_symbol_data.h"
+#include "offline_symbolizer_internal.h"
+#include "os_image_reader.h"
+#include "os_util.h"
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+// module data loaded from disk, where the module base is the load address recorded in the
+// capturing process, so that frame addresses can be resolved exactly as in the live process
+struct OfflineModuleData : public ModuleSymbolData {
+    std::string m_imagePath;
+    void* m_moduleBase;
+
+    OfflineModuleData() : m_moduleBase(nullptr) {}
+};
+
+static const char* getBaseName(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return (pos == std::string::npos) ? path.c_str() : path.c_str() + pos + 1;
+}
+
+OfflineSymbolizer::OfflineSymbolizer() : m_allowBuildIdMismatch(false) {}
+
+OfflineSymbolizer::~OfflineSymbolizer() { clear(); }
+
+DbgUtilErr OfflineSymbolizer::addSearchDir(const char* dir) {
+    try {
+        m_searchDirs.push_back(dir);
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OfflineSymbolizer::addPathMapping(const char* fromPrefix, const char* toPrefix) {
+    try {
+        m_pathMappings.push_back({fromPrefix, toPrefix});
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+void OfflineSymbolizer::clear() {
+    for (auto& entry : m_moduleMap) {
+        delete entry.second;
+    }
+    m_moduleMap.clear();
+}
+
+DbgUtilErr OfflineSymbolizer::resolveRecord(const RawStackRecord& record, StackTrace& stackTrace,
+                                            SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    try {
+        // locate all modules first
+        std::vector<OfflineModuleData*> modules(record.m_modules.size(), nullptr);
+        for (size_t i = 0; i < record.m_modules.size(); ++i) {
+            modules[i] = getModuleData(record.m_modules[i]);
+        }
+
+        for (size_t i = 0; i < record.m_frames.size(); ++i) {
+            const RawStackFrame& frame = record.m_frames[i];
+            StackEntry stackEntry;
+            stackEntry.m_frameIndex = (uint32_t)i;
+            if (frame.m_moduleIndex >= record.m_modules.size()) {
+                stackEntry.m_frameAddress = (void*)frame.m_offset;
+                stackTrace.emplace_back(std::move(stackEntry));
+                continue;
+            }
+
+            // symbols are resolved exactly as by the live symbol engine, except for the fallback
+            // to the loader, which is meaningless for images of another process
+            const RawStackModule& module = record.m_modules[frame.m_moduleIndex];
+            void* symAddress = (void*)(module.m_loadAddress + frame.m_offset);
+            stackEntry.m_frameAddress = symAddress;
+            OfflineModuleData* modData = modules[frame.m_moduleIndex];
+            if (modData != nullptr) {
+                SymbolInfoRef symbolInfoRef;
+                (void)modData->searchSymbol(symAddress, symbolInfoRef, detail);
+                symbolInfoRef.toSymbolInfo(stackEntry.m_entryInfo);
+            }
+            stackEntry.m_entryInfo.m_moduleBaseAddress = (void*)module.m_loadAddress;
+            if (detail & DBGUTIL_SYMBOL_DETAIL_MODULE) {
+                stackEntry.m_entryInfo.m_moduleName = module.m_modulePath;
+            }
+            stackTrace.emplace_back(std::move(stackEntry));
+        }
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+OfflineModuleData* OfflineSymbolizer::getModuleData(const RawStackModule& module) {
+    // modules are unique by build identifier, but the load address may still differ between
+    // records, so a module loaded at another address is keyed separately
+    std::string key = module.m_buildId.empty() ? module.m_modulePath : module.m_buildId;
+    key += '@';
+    key += std::to_string(module.m_loadAddress);
+    ModuleMap::iterator itr = m_moduleMap.find(key);
+    if (itr != m_moduleMap.end()) {
+        return itr->second;
+    }
+
+    // failure is remembered as well, so that missing images are searched only once
+    OfflineModuleData* modData = loadModuleData(module);
+    try {
+        m_moduleMap.insert(ModuleMap::value_type(key, modData));
+    } catch (std::bad_alloc&) {
+        delete modData;
+        throw;
+    }
+    return modData;
+}
+
+OfflineModuleData* OfflineSymbolizer::loadModuleData(const RawStackModule& module) {
+    OfflineModuleData* modData = new (std::nothrow) OfflineModuleData();
+    if (modData == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate offline module data, out of memory");
+        return nullptr;
+    }
+    modData->m_moduleBase = (void*)module.m_loadAddress;
+    try {
+        if (searchModuleImage(modData, module)) {
+            return modData;
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to search image of module %s, out of memory",
+                  module.m_modulePath.c_str());
+    }
+    delete modData;
+    return nullptr;
+}
+
+bool OfflineSymbolizer::searchModuleImage(OfflineModuleData* modData,
+                                          const RawStackModule& module) {
+    // collect candidate image paths by search order
+    std::vector<std::string> paths;
+    const char* baseName = getBaseName(module.m_modulePath);
+    for (const std::string& dir : m_searchDirs) {
+        if (module.m_buildId.length() > 2) {
+            paths.push_back(dir + "/.build-id/" + module.m_buildId.substr(0, 2) + "/" +
+                            module.m_buildId.substr(2) + ".debug");
+        }
+        paths.push_back(dir + "/" + baseName);
+    }
+    std::string mappedPath = module.m_modulePath;
+    for (const auto& mapping : m_pathMappings) {
+        if (mappedPath.compare(0, mapping.first.length(), mapping.first) == 0) {
+            mappedPath = mapping.second + mappedPath.substr(mapping.first.length());
+            break;
+        }
+    }
+    paths.push_back(mappedPath);
+
+    for (const std::string& path : paths) {
+        if (OsUtil::fileExists(path.c_str()) == DBGUTIL_ERR_OK &&
+            openModuleImage(modData, path, module)) {
+            LOG_DEBUG(sLogger, "Module %s resolved from image %s", module.m_modulePath.c_str(),
+                      path.c_str());
+            return true;
+        }
+    }
+    LOG_WARN(sLogger, "Could not locate image of module %s (build id %s)",
+             module.m_modulePath.c_str(),
+             module.m_buildId.empty() ? "N/A" : module.m_buildId.c_str());
+    return false;
+}
+
+bool OfflineSymbolizer::openModuleImage(OfflineModuleData* modData, const std::string& path,
+                                        const RawStackModule& module) {
+    OsImageReader* imageReader = createImageReader();
+    if (imageReader == nullptr) {
+        LOG_ERROR(sLogger, "Failed to create image reader, out of memory");
+        return false;
+    }
+    // as with live symbol resolution, an image without a symbol table (e.g. a stripped system
+    // library) is still used if it is known to be the right one, since it may have debug sections
+    DbgUtilErr rc = imageReader->open(path.c_str(), modData->m_moduleBase);
+    if (rc != DBGUTIL_ERR_OK &&
+        (module.m_buildId.empty() || imageReader->getBuildId() != module.m_buildId)) {
+        LOG_DEBUG(sLogger, "Failed to open image file %s: %s", path.c_str(), errorToString(rc));
+        imageReader->close();
+        delete imageReader;
+        return false;
+    }
+    if (!module.m_buildId.empty() && imageReader->getBuildId() != module.m_buildId) {
+        if (!m_allowBuildIdMismatch) {
+            LOG_DEBUG(sLogger, "Skipping image file %s: build id %s does not match %s",
+                      path.c_str(), imageReader->getBuildId().c_str(), module.m_buildId.c_str());
+            imageReader->close();
+            delete imageReader;
+            return false;
+        }
+        LOG_WARN(sLogger, "Using image file %s for module %s despite build id mismatch",
+                 path.c_str(), module.m_modulePath.c_str());
+    }
+    modData->m_imagePath = path;
+    modData->m_imageReader = imageReader;
+    rc = modData->openDwarfData(modData->m_moduleBase);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "No dwarf data available in image file %s: %s", path.c_str(),
+                  errorToString(rc));
+    }
+    return true;
+}
+
+DbgUtilErr initOfflineSymbolizer() {
+    registerLogger(sLogger, "offline_symbolizer");
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr termOfflineSymbolizer() {
+    unregisterLogger(sLogger);
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
@@ -0,0 +1,16 @@
+#ifndef __OFFLINE_SYMBOLIZER_INTERNAL_H__
+#define __OFFLINE_SYMBOLIZER_INTERNAL_H__
+
+#include "dbg_util_err.h"
+
+namespace dbgutil {
+
+/** @brief Initializes the offline symbolizer logger. */
+extern DbgUtilErr initOfflineSymbolizer();
+
+/** @brief Terminates the offline symbolizer logger. */
+extern DbgUtilErr termOfflineSymbolizer();
+
+}  // namespace dbgutil
+
+#endif  // __OFFLINE_SYMBOLIZER_INTERNAL_H__
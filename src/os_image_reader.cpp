@@ -3,7 +3,18 @@
 #include <algorithm>
 #include <cassert>
 #include <cinttypes>
+#include <cstdlib>
 #include <cstring>
+#include <new>
+
+#ifdef DBGUTIL_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef DBGUTIL_GCC
+#include <cxxabi.h>
+#endif
 
 #include "dbgutil_log_imp.h"
 #include "os_util.h"
@@ -18,7 +29,18 @@ void OsImageReader::initLogger() { registerLogger(sLogger, "os_image_reader"); }
 void OsImageReader::termLogger() { unregisterLogger(sLogger); }
 
 OsImageReader::OsImageReader()
-    : m_fileSizeBytes(0), m_moduleBase(nullptr), m_is64Bit(false), m_isExe(false), m_relocBase(0) {}
+    : m_fileSizeBytes(0),
+      m_useMmap(false),
+      m_mappedImage(nullptr),
+      m_mappedSize(0),
+      m_moduleBase(nullptr),
+      m_is64Bit(false),
+      m_isExe(false),
+      m_relocBase(0),
+      m_symInfoMapValid(false),
+      m_symNameIndexValid(false) {}
+
+OsImageReader::~OsImageReader() { unmapImage(); }
 
 DbgUtilErr OsImageReader::open(const char* path, void* moduleBase) {
     m_imagePath = path;
@@ -29,11 +51,32 @@ DbgUtilErr OsImageReader::open(const char* path, void* moduleBase) {
     m_moduleBase = (char*)moduleBase;
     LOG_DEBUG(sLogger, "Processing binary image: %s", path);
 
+    // map image if required, but if this fails we can still use buffered reading
+    if (m_useMmap) {
+        rc = mapImage();
+        if (rc != DBGUTIL_ERR_OK) {
+            LOG_DEBUG(sLogger, "Failed to map image file %s, falling back to buffered reading: %s",
+                      path, errorToString(rc));
+        }
+    }
+
     rc = readImage();
     if (rc != DBGUTIL_ERR_OK) {
         m_fileReader.close();
+        return rc;
     }
-    return rc;
+
+    // build flat range index for address search (symbol table is sorted by now)
+    m_symRangeIndex.reserve(m_symInfoSet.size());
+    for (const OsSymbolInfo& symInfo : m_symInfoSet) {
+        m_symRangeIndex.addRange(symInfo.m_offset, symInfo.m_size);
+    }
+
+    // names are demangled on demand
+    // NOTE: without the demangled name cache, symbol names are reported as they appear in the
+    // symbol table, which is not a reason to fail opening the image
+    (void)buildDemangledNameCache();
+    return DBGUTIL_ERR_OK;
 }
 
 void OsImageReader::close() {
@@ -45,14 +88,100 @@ void OsImageReader::close() {
     m_moduleBase = nullptr;
     m_is64Bit = false;
     m_isExe = false;
+    m_relocBase = 0;
+    m_buildId.clear();
     m_symInfoSet.clear();
+    m_symRangeIndex.clear();
+    m_symInfoMap.clear();
+    m_symInfoMapValid.store(false, std::memory_order_relaxed);
     m_srcFileNames.clear();
+    m_symNamePool.clear();
+    m_demangledNames.reset();
+    m_demangledNamePool.clear();
+    m_symNameIndex.clear();
+    m_symNameIndexValid.store(false, std::memory_order_relaxed);
     m_sectionMap.clear();
+    m_materializedSectionMap.clear();
     resetData();
+    unmapImage();
+    m_symbolIndex.close();
+}
+
+void OsImageReader::exportSymbols(SymbolIndexBuilder& builder) {
+    // map each symbol to the name by which it can be searched (if any)
+    std::vector<const char*> mapNames(m_symInfoSet.size(), nullptr);
+    const SymInfoMap* symInfoMap = nullptr;
+    if (getSymInfoMap(symInfoMap) == DBGUTIL_ERR_OK) {
+        for (const SymInfoMap::value_type& entry : *symInfoMap) {
+            mapNames[entry.second - m_symInfoSet.data()] = entry.first;
+        }
+    }
+    for (size_t i = 0; i < m_symInfoSet.size(); ++i) {
+        const OsSymbolInfo& symInfo = m_symInfoSet[i];
+        builder.addSymbol(symInfo.m_offset, symInfo.m_size, symInfo.m_name, mapNames[i],
+                          symInfo.m_srcFileIndex);
+    }
+    for (const std::string& fileName : m_srcFileNames) {
+        builder.addSrcFile(fileName.c_str());
+    }
+}
+
+DbgUtilErr OsImageReader::loadSymbolIndex() {
+    if (m_buildId.empty()) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    std::string indexDir = SymbolIndex::getIndexDir();
+    if (indexDir.empty()) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    DbgUtilErr rc = m_symbolIndex.open(indexDir, m_buildId);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    if (m_symbolIndex.getIs64Bit() != m_is64Bit || m_symbolIndex.getIsExe() != m_isExe ||
+        m_symbolIndex.getRelocationBase() != m_relocBase) {
+        LOG_DEBUG(sLogger, "Symbol index of image %s does not match image header, ignoring",
+                  m_imagePath.c_str());
+        m_symbolIndex.close();
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+
+    // symbols are already sorted, and names are demangled on demand
+    // NOTE: names are not copied, they point to the mapped string pool of the index, and the name
+    // map is built from the index on the first search by name
+    uint32_t srcFileCount = m_symbolIndex.getSrcFileCount();
+    m_srcFileNames.reserve(srcFileCount);
+    for (uint32_t i = 0; i < srcFileCount; ++i) {
+        m_srcFileNames.push_back(m_symbolIndex.getSrcFile(i));
+    }
+    uint32_t symbolCount = m_symbolIndex.getSymbolCount();
+    m_symInfoSet.reserve(symbolCount);
+    for (uint32_t i = 0; i < symbolCount; ++i) {
+        const SymbolIndex::Symbol& symbol = m_symbolIndex.getSymbol(i);
+        m_symInfoSet.push_back({symbol.m_offset, symbol.m_size,
+                                m_symbolIndex.getString(symbol.m_nameOffset),
+                                symbol.m_srcFileIndex, 0});
+    }
+    LOG_DEBUG(sLogger, "Loaded %u symbols of image %s from symbol index", symbolCount,
+              m_imagePath.c_str());
+    return DBGUTIL_ERR_OK;
 }
 
 DbgUtilErr OsImageReader::searchSymbol(void* symAddress, uint32_t& symSize, std::string& symName,
                                        std::string& fileName, void** address) {
+    const char* symNameRef = nullptr;
+    const char* fileNameRef = nullptr;
+    DbgUtilErr rc = searchSymbol(symAddress, symSize, symNameRef, fileNameRef, address);
+    if (rc == DBGUTIL_ERR_OK) {
+        symName = symNameRef;
+        fileName = fileNameRef;
+    }
+    return rc;
+}
+
+DbgUtilErr OsImageReader::searchSymbol(void* symAddress, uint32_t& symSize, const char*& symName,
+                                       const char*& fileName, void** address,
+                                       bool demangle /* = true */) {
     // scan symbol table for relative address
     if (symAddress < m_moduleBase) {
         LOG_DEBUG(sLogger, "Attempt to search symbol %p in module starting at %p: out of range",
@@ -61,52 +190,224 @@ DbgUtilErr OsImageReader::searchSymbol(void* symAddress, uint32_t& symSize, std:
     }
     uint64_t symOff = (uint64_t)(((char*)symAddress) - ((char*)m_moduleBase));
     LOG_DEBUG(sLogger, "Searching for symbol %p at offset %u", symAddress, (unsigned)symOff);
-    SymInfoSet::iterator itr =
-        std::lower_bound(m_symInfoSet.begin(), m_symInfoSet.end(), symOff,
-                         [](const OsSymbolInfo& symInfo, uint64_t localSymOff) {
-                             // stop search when end point of interval surpasses searched offset
-                             return symInfo.m_offset + symInfo.m_size <= localSymOff;
-                         });
-
-    if (itr == m_symInfoSet.end()) {
+    size_t symIndex = m_symRangeIndex.findRange(symOff);
+    if (symIndex == DBGUTIL_RANGE_NOT_FOUND) {
         LOG_DEBUG(sLogger, "Symbol not found");
         return DBGUTIL_ERR_NOT_FOUND;
     }
 
-    const OsSymbolInfo& symInfo = *itr;
-    if (symInfo.contains(symOff)) {
-        symSize = symInfo.m_size;
-        symName = symInfo.m_name;
-        fileName = m_srcFileNames[symInfo.m_srcFileIndex];
-        *address = (void*)(m_moduleBase + symInfo.m_offset);
-        LOG_DEBUG(sLogger, "Found symbol %s at start address %p, file %s", symName.c_str(),
-                  *address, fileName.c_str());
-        return DBGUTIL_ERR_OK;
-    }
-    return DBGUTIL_ERR_NOT_FOUND;
+    const OsSymbolInfo& symInfo = m_symInfoSet[symIndex];
+    symSize = symInfo.m_size;
+    symName = demangle ? getDemangledName(symIndex) : symInfo.m_name;
+    fileName = m_srcFileNames[symInfo.m_srcFileIndex].c_str();
+    *address = (void*)(m_moduleBase + symInfo.m_offset);
+    LOG_DEBUG(sLogger, "Found symbol %s at start address %p, file %s", symName, *address,
+              fileName);
+    return DBGUTIL_ERR_OK;
 }
 
 DbgUtilErr OsImageReader::searchSymbol(const char* symbolName, void** symbolAddress) {
-    SymInfoMap::iterator itr = m_symInfoMap.find(symbolName);
-    if (itr == m_symInfoMap.end()) {
+    const SymInfoMap* symInfoMap = nullptr;
+    DbgUtilErr rc = getSymInfoMap(symInfoMap);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    SymInfoMap::const_iterator itr = symInfoMap->find(symbolName);
+    if (itr != symInfoMap->end()) {
+        *symbolAddress = (void*)(m_moduleBase + itr->second->m_offset);
+        return DBGUTIL_ERR_OK;
+    }
+
+    // not a mangled name, so search by demangled name
+    const SymbolNameIndex* symNameIndex = nullptr;
+    rc = getSymbolNameIndex(symNameIndex);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    uint32_t symIndex = 0;
+    if (!symNameIndex->findName(symbolName, symIndex)) {
         LOG_DEBUG(sLogger, "Symbol %s not found", symbolName);
         return DBGUTIL_ERR_NOT_FOUND;
     }
 
-    *symbolAddress = (void*)(m_moduleBase + itr->second->m_offset);
+    *symbolAddress = getSymbolAddress(symIndex);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsImageReader::searchSymbols(const SymbolPattern& pattern,
+                                        std::vector<uint32_t>& symIndices) {
+    const SymbolNameIndex* symNameIndex = nullptr;
+    DbgUtilErr rc = getSymbolNameIndex(symNameIndex);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    return symNameIndex->search(pattern, symIndices);
+}
+
+size_t OsImageReader::SymNameHash::operator()(const char* name) const {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (; *name != 0; ++name) {
+        hash ^= (uint8_t)*name;
+        hash *= 0x100000001B3ull;
+    }
+    return (size_t)hash;
+}
+
+DbgUtilErr OsImageReader::getSymInfoMap(const SymInfoMap*& symInfoMap) {
+    // NOTE: once built, the name map is immutable, so it can be searched without a lock
+    if (!m_symInfoMapValid.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(m_symInfoMapLock);
+        if (!m_symInfoMapValid.load(std::memory_order_relaxed)) {
+            DbgUtilErr rc = buildSymInfoMap();
+            if (rc != DBGUTIL_ERR_OK) {
+                return rc;
+            }
+            m_symInfoMapValid.store(true, std::memory_order_release);
+        }
+    }
+    symInfoMap = &m_symInfoMap;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsImageReader::buildSymInfoMap() {
+    // names are mapped as they appear in the symbol table (where the same name appears more than
+    // once, the first symbol wins), or as recorded in the symbol index, if loaded from one
+    try {
+        m_symInfoMap.reserve(m_symInfoSet.size());
+        for (size_t i = 0; i < m_symInfoSet.size(); ++i) {
+            const char* name = m_symInfoSet[i].m_name;
+            if (m_symbolIndex.isOpen()) {
+                uint32_t mapNameOffset = m_symbolIndex.getSymbol((uint32_t)i).m_mapNameOffset;
+                if (mapNameOffset == DBGUTIL_SYMBOL_INDEX_NO_NAME) {
+                    continue;
+                }
+                name = m_symbolIndex.getString(mapNameOffset);
+            }
+            m_symInfoMap.insert(SymInfoMap::value_type(name, &m_symInfoSet[i]));
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to build symbol name map, out of memory");
+        m_symInfoMap.clear();
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsImageReader::getSymbolNameIndex(const SymbolNameIndex*& symNameIndex) {
+    // NOTE: once built, the name index is immutable, so it can be searched without a lock
+    if (!m_symNameIndexValid.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(m_symNameIndexLock);
+        if (!m_symNameIndexValid.load(std::memory_order_relaxed)) {
+            DbgUtilErr rc = buildSymbolNameIndex();
+            if (rc != DBGUTIL_ERR_OK) {
+                return rc;
+            }
+            m_symNameIndexValid.store(true, std::memory_order_release);
+        }
+    }
+    symNameIndex = &m_symNameIndex;
+    return DBGUTIL_ERR_OK;
+}
+
+const char* OsImageReader::getDemangledName(size_t symIndex) const {
+    const char* name = m_symInfoSet[symIndex].m_name;
+    if (!m_demangledNames) {
+        // demangled name cache could not be allocated
+        return name;
+    }
+    const char* demangledName = m_demangledNames[symIndex].load(std::memory_order_acquire);
+    if (demangledName != nullptr) {
+        return demangledName;
+    }
+
+    // two threads may demangle the same name concurrently, but since demangled names are interned,
+    // both would store the same pointer, so no further synchronization is required
+    demangledName = name;
+#ifdef DBGUTIL_GCC
+    // only names with the Itanium ABI mangling prefix are demangled (otherwise a C symbol such as
+    // "i" would be demangled as a type name)
+    if (strncmp(name, "_Z", 2) != 0) {
+        m_demangledNames[symIndex].store(demangledName, std::memory_order_release);
+        return demangledName;
+    }
+    int status = 0;
+    char* demangledBuf = abi::__cxa_demangle(name, nullptr, 0, &status);
+    if (status == 0 && demangledBuf != nullptr) {
+        const char* internedName = m_demangledNamePool.intern(demangledBuf);
+        if (internedName == nullptr) {
+            // out of memory, don't cache, and try again next time
+            free(demangledBuf);
+            return name;
+        }
+        demangledName = internedName;
+    }
+    free(demangledBuf);
+#endif
+    m_demangledNames[symIndex].store(demangledName, std::memory_order_release);
+    return demangledName;
+}
+
+DbgUtilErr OsImageReader::buildDemangledNameCache() {
+    size_t symbolCount = m_symInfoSet.size();
+    m_demangledNames.reset(new (std::nothrow) std::atomic<const char*>[symbolCount]);
+    if (m_demangledNames == nullptr && symbolCount > 0) {
+        LOG_WARN(sLogger,
+                 "Failed to allocate demangled name cache for %zu symbols, out of memory (symbol "
+                 "names of image %s are not demangled)",
+                 symbolCount, m_imagePath.c_str());
+        return DBGUTIL_ERR_NOMEM;
+    }
+    for (size_t i = 0; i < symbolCount; ++i) {
+        m_demangledNames[i].store(nullptr, std::memory_order_relaxed);
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsImageReader::buildSymbolNameIndex() {
+    // each symbol is indexed by its mangled name, and also by its demangled name if it differs
+    // NOTE: patterns are matched against demangled names too, and their literal prefix is useful
+    // only if demangled names are sorted, so all mangled names are demangled here (names without
+    // the mangling prefix are skipped cheaply). This is a one-time cost, paid only by name searches
+    // and never by address lookups.
+    // NOTE: names are not copied, they point to the symbol table and the demangled name arena
+    try {
+        m_symNameIndex.reserve(m_symInfoSet.size() * 2);
+        for (size_t i = 0; i < m_symInfoSet.size(); ++i) {
+            const char* name = m_symInfoSet[i].m_name;
+            if (*name == 0) {
+                continue;
+            }
+            m_symNameIndex.addName(name, (uint32_t)i);
+            const char* demangledName = getDemangledName(i);
+            if (demangledName != name) {
+                m_symNameIndex.addName(demangledName, (uint32_t)i);
+            }
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to build symbol name index, out of memory");
+        m_symNameIndex.clear();
+        return DBGUTIL_ERR_NOMEM;
+    }
+    m_symNameIndex.build();
+    LOG_DEBUG(sLogger, "Built symbol name index of image %s with %zu names",
+              m_imagePath.c_str(), m_symNameIndex.size());
     return DBGUTIL_ERR_OK;
 }
 
 DbgUtilErr OsImageReader::getSection(const char* name, OsImageSection& section) {
-    OsSectionMap::const_iterator itr = m_sectionMap.find(name);
+    OsSectionMap::iterator itr = m_sectionMap.find(name);
     if (itr == m_sectionMap.end()) {
         return DBGUTIL_ERR_NOT_FOUND;
     }
-    section = itr->second;
-    if (section.m_start == nullptr) {
+    if (itr->second.m_start == nullptr) {
         // materialize section on-demand
-        return materializeSection(section);
+        DbgUtilErr rc = materializeSection(itr->second);
+        if (rc != DBGUTIL_ERR_OK) {
+            return rc;
+        }
     }
+    section = itr->second;
     return DBGUTIL_ERR_OK;
 }
 
@@ -136,6 +437,15 @@ DbgUtilErr OsImageReader::getSections(const char* prefix, std::vector<OsImageSec
 }
 
 DbgUtilErr OsImageReader::materializeSection(OsImageSection& section) {
+    // when image is mapped, the section points directly into the mapping
+    // NOTE: the address ranges table is always scanned entirely
+    if (m_mappedImage != nullptr) {
+        std::vector<char> unusedBuffer;
+        bool sequential = (section.m_name.compare(".debug_aranges") == 0);
+        return getRegion(section.m_offset, section.m_size, unusedBuffer, section.m_start,
+                         sequential);
+    }
+
     // first insert a mapping, so we can read data in-place into the buffer
     std::pair<MaterializedSectionMap::iterator, bool> itrRes = m_materializedSectionMap.insert(
         MaterializedSectionMap::value_type(section.m_name, SectionBuffer()));
@@ -164,6 +474,96 @@ DbgUtilErr OsImageReader::materializeSection(OsImageSection& section) {
     return DBGUTIL_ERR_OK;
 }
 
+DbgUtilErr OsImageReader::getRegion(uint64_t offset, uint64_t size, std::vector<char>& buffer,
+                                    char*& start, bool sequential /* = false */) {
+    if (m_mappedImage != nullptr) {
+        if (offset > m_mappedSize || size > m_mappedSize - offset) {
+            LOG_ERROR(sLogger,
+                      "Image file %s region at offset %" PRIu64 " of size %" PRIu64
+                      " exceeds file size %" PRIu64,
+                      m_imagePath.c_str(), offset, size, m_mappedSize);
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        start = m_mappedImage + offset;
+        if (sequential) {
+            adviseSequential(start, size);
+        }
+        return DBGUTIL_ERR_OK;
+    }
+
+    DbgUtilErr rc = m_fileReader.seek(offset);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    buffer.resize(size);
+    rc = m_fileReader.readFull(buffer.data(), size);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    start = buffer.data();
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsImageReader::mapImage() {
+#ifdef DBGUTIL_LINUX
+    int fd = -1;
+    DbgUtilErr rc = OsUtil::openFile(m_imagePath.c_str(), O_RDONLY, 0, fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    uint64_t fileSize = 0;
+    rc = OsUtil::getFileSize(fd, fileSize);
+    if (rc != DBGUTIL_ERR_OK) {
+        OsUtil::closeFile(fd);
+        return rc;
+    }
+    if (fileSize == 0) {
+        OsUtil::closeFile(fd);
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+
+    // NOTE: the mapping remains valid after the file is closed
+    void* mappedImage = nullptr;
+    rc = OsUtil::mapFile(fd, fileSize, mappedImage);
+    OsUtil::closeFile(fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Failed to map image file %s", m_imagePath.c_str());
+        return rc;
+    }
+    m_mappedImage = (char*)mappedImage;
+    m_mappedSize = fileSize;
+    LOG_DEBUG(sLogger, "Image file %s mapped at %p (%" PRIu64 " bytes)", m_imagePath.c_str(),
+              mappedImage, fileSize);
+    return DBGUTIL_ERR_OK;
+#else
+    return DBGUTIL_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+void OsImageReader::unmapImage() {
+#ifdef DBGUTIL_LINUX
+    if (m_mappedImage != nullptr) {
+        OsUtil::unmapFile(m_mappedImage, m_mappedSize);
+        m_mappedImage = nullptr;
+        m_mappedSize = 0;
+    }
+#endif
+}
+
+void OsImageReader::adviseSequential(char* start, uint64_t size) {
+#ifdef DBGUTIL_LINUX
+    // madvise() requires page aligned address
+    static const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t alignedStart = ((uint64_t)start) & ~(pageSize - 1);
+    size += ((uint64_t)start) - alignedStart;
+    if (madvise((void*)alignedStart, size, MADV_SEQUENTIAL) != 0 ||
+        madvise((void*)alignedStart, size, MADV_WILLNEED) != 0) {
+        LOG_DEBUG(sLogger, "Failed to advise sequential access for image file %s",
+                  m_imagePath.c_str());
+    }
+#endif
+}
+
 void setImageReaderFactory(OsImageReaderFactory* factory) {
     assert((factory != nullptr && sFactory == nullptr) ||
            (factory == nullptr && sFactory != nullptr));
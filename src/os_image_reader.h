@@ -1,11 +1,19 @@
 #ifndef __OS_IMAGE_READER_H__
 #define __OS_IMAGE_READER_H__
 
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 #include "buffered_file_reader.h"
 #include "dbgutil_common.h"
+#include "range_index.h"
+#include "string_pool.h"
+#include "symbol_index.h"
+#include "symbol_name_index.h"
 
 namespace dbgutil {
 
@@ -31,7 +39,7 @@ public:
     OsImageReader();
 
     /** @brief Destructor. */
-    virtual ~OsImageReader() {}
+    virtual ~OsImageReader();
 
     static void initLogger();
     static void termLogger();
@@ -61,7 +69,25 @@ public:
                                     std::string& fileName, void** address);
 
     /**
-     * @brief Searches for a symbol by name (exact match).
+     * @brief Searches for a symbol in the binary image file's symbol table, without copying names.
+     * All resulting names remain valid until the image reader is closed.
+     * @param symbolAddress The symbol address to search.
+     * @param[out] symSize The symbol size in bytes.
+     * @param[out] symbolName The name of the resulting symbol (if symbol was found).
+     * @param[out] fileName The file containing the symbol (if symbol was found).
+     * @param[out] address The actual start address of the symbol.
+     * @param demangle Specifies whether the resulting symbol name should be demangled (if
+     * possible), or rather returned as it appears in the symbol table.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr searchSymbol(void* symbolAddress, uint32_t& symSize, const char*& symbolName,
+                            const char*& fileName, void** address, bool demangle = true);
+
+    /**
+     * @brief Searches for a symbol by name (exact match). The name may be either the mangled name
+     * as it appears in the symbol table, or the demangled name. The name index (which requires
+     * demangling all mangled names once) is built only when a search by mangled name fails for the
+     * first time, and the mangled name map is built only on the first search by name.
      *
      * @param symbolName The symbol name to search.
      * @param[out] symbolAddress The resulting symbol address (valid only if found).
@@ -70,7 +96,23 @@ public:
     virtual DbgUtilErr searchSymbol(const char* symbolName, void** symbolAddress);
 
     /**
-     * @brief Visits all symbols in the image.
+     * @brief Searches for all symbols having a name (either mangled or demangled) that matches a
+     * pattern. The sorted name index is built on first use, after which any pattern with a literal
+     * prefix is resolved in logarithmic time. Safe for concurrent use.
+     * @param pattern The name pattern.
+     * @param[out] symIndices The indices of the matching symbols in the symbol table, in ascending
+     * order of address.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr searchSymbols(const SymbolPattern& pattern, std::vector<uint32_t>& symIndices);
+
+    /** @brief Retrieves the address of a symbol by its index in the symbol table. */
+    inline void* getSymbolAddress(size_t symIndex) const {
+        return (void*)(m_moduleBase + m_symInfoSet[symIndex].m_offset);
+    }
+
+    /**
+     * @brief Visits all symbols in the image. Symbol names are demangled (if possible).
      * @tparam F The visitor function type. Expected signature is: "DbgUtilErr f(const char*
      * symbolName, void* address, const char* fileName, uint64_t symbolSize, bool& shouldStop)".
      * @param f The visitor function.
@@ -79,10 +121,11 @@ public:
     inline DbgUtilErr forEachSymbol(F f) const {
         DbgUtilErr rc = DBGUTIL_ERR_OK;
         bool shouldStop = false;
-        for (const OsSymbolInfo& symInfo : m_symInfoSet) {
+        for (size_t i = 0; i < m_symInfoSet.size(); ++i) {
+            const OsSymbolInfo& symInfo = m_symInfoSet[i];
             void* address = (void*)(m_moduleBase + symInfo.m_offset);
             const char* fileName = m_srcFileNames[symInfo.m_srcFileIndex].c_str();
-            rc = f(symInfo.m_name.c_str(), address, fileName, symInfo.m_size, shouldStop);
+            rc = f(getDemangledName(i), address, fileName, symInfo.m_size, shouldStop);
             if (rc != DBGUTIL_ERR_OK || shouldStop) {
                 break;
             }
@@ -135,6 +178,42 @@ public:
     /** @brief Returns a relocation base suggested by the binary image. */
     inline uint64_t getRelocationBase() { return m_relocBase; }
 
+    /**
+     * @brief Configures whether the image file should be mapped into memory (Linux only). In this
+     * case sections point directly into a read-only private mapping of the image file, so that
+     * section pages are loaded only when actually accessed, rather than being copied into heap
+     * buffers. If mapping fails, the reader falls back to buffered reading. Must be called before
+     * @ref open().
+     */
+    inline void setUseMmap(bool useMmap) { m_useMmap = useMmap; }
+
+    /** @brief Queries whether the image file is mapped into memory. */
+    inline bool isMapped() const { return m_mappedImage != nullptr; }
+
+    /** @brief Retrieves the image build identifier as hex string (empty if there is none). */
+    inline const std::string& getBuildId() const { return m_buildId; }
+
+    /**
+     * @brief Retrieves the persistent symbol index from which the symbol table was loaded, or null
+     * if the symbol table was read from the image file.
+     */
+    inline const SymbolIndex* getSymbolIndex() const {
+        return m_symbolIndex.isOpen() ? &m_symbolIndex : nullptr;
+    }
+
+    /** @brief Adds the symbol table of the image to a symbol index. */
+    void exportSymbols(SymbolIndexBuilder& builder);
+
+    /**
+     * @brief Retrieves the demangled name of a symbol. Names are demangled on first use, and cached
+     * in an arena owned by the image reader, so each symbol is demangled at most once. If the name
+     * cannot be demangled (or the name cache could not be allocated when the image was opened),
+     * then the mangled name is returned. Safe for concurrent use.
+     * @param symIndex The index of the symbol in the symbol table.
+     * @return The demangled symbol name (valid until the image reader is closed).
+     */
+    const char* getDemangledName(size_t symIndex) const;
+
 protected:
     /** @brief Implement image reading. */
     virtual DbgUtilErr readImage() = 0;
@@ -145,12 +224,17 @@ protected:
     BufferedFileReader m_fileReader;
     std::string m_imagePath;
     uint64_t m_fileSizeBytes;
+    bool m_useMmap;
+    char* m_mappedImage;
+    uint64_t m_mappedSize;
     // the module base as loaded by process in memory
     char* m_moduleBase;
     bool m_is64Bit;
     bool m_isExe;
     // the image base as appears on image file
     uint64_t m_relocBase;
+    std::string m_buildId;
+    SymbolIndex m_symbolIndex;
 
     // we build an interval map of symbol offsets pointing to names, ordered by interval start
     // all intervals are not overlapping
@@ -161,8 +245,11 @@ protected:
         /** @var Size of symbol in bytes. */
         uint64_t m_size;
 
-        /** @var The name of the symbol. */
-        std::string m_name;
+        /**
+         * @var The name of the symbol (points into the symbol table, the symbol index, or the
+         * symbol name pool, so it is never copied per symbol).
+         */
+        const char* m_name;
 
         /** @var The index of the file containing the symbol. */
         uint32_t m_srcFileIndex;
@@ -186,10 +273,36 @@ protected:
 
     typedef std::vector<OsSymbolInfo> SymInfoSet;
     SymInfoSet m_symInfoSet;
-    typedef std::unordered_map<std::string, OsSymbolInfo*> SymInfoMap;
+    // flat address range index of the symbol table (parallel to m_symInfoSet)
+    RangeIndex m_symRangeIndex;
+    // symbol name map, keyed by mangled name (names are not copied), built on first search by name
+    struct SymNameHash {
+        size_t operator()(const char* name) const;
+    };
+    struct SymNameEquals {
+        inline bool operator()(const char* lhs, const char* rhs) const {
+            return strcmp(lhs, rhs) == 0;
+        }
+    };
+    typedef std::unordered_map<const char*, OsSymbolInfo*, SymNameHash, SymNameEquals> SymInfoMap;
     SymInfoMap m_symInfoMap;
+    std::atomic<bool> m_symInfoMapValid;
+    std::mutex m_symInfoMapLock;
     std::vector<std::string> m_srcFileNames;
 
+    // symbol names that do not appear as is in the image (e.g. short names in PE symbol tables)
+    StringPool m_symNamePool;
+
+    // lazily demangled names, indexed by symbol index (parallel to m_symInfoSet), where null
+    // denotes a name not demangled yet, and all demangled names are interned in a per-image arena
+    mutable std::unique_ptr<std::atomic<const char*>[]> m_demangledNames;
+    mutable StringPool m_demangledNamePool;
+
+    // sorted index of both mangled and demangled names, built on demand
+    SymbolNameIndex m_symNameIndex;
+    std::atomic<bool> m_symNameIndexValid;
+    std::mutex m_symNameIndexLock;
+
     typedef std::unordered_map<std::string, OsImageSection> OsSectionMap;
     OsSectionMap m_sectionMap;
 
@@ -198,6 +311,38 @@ protected:
     MaterializedSectionMap m_materializedSectionMap;
 
     DbgUtilErr materializeSection(OsImageSection& section);
+
+    /**
+     * @brief Loads the symbol table from the persistent symbol index of the image, if symbol index
+     * persistence is enabled and the image has a build identifier.
+     * @return E_OK If the symbol table was loaded from the symbol index.
+     * @return DbgUtilErr Any other error code, in which case the symbol table should be read from
+     * the image file.
+     */
+    DbgUtilErr loadSymbolIndex();
+
+    /**
+     * @brief Retrieves the data of an image file region. If the image is mapped, then the result
+     * points into the mapping, otherwise the region is read into the given buffer.
+     * @param offset The region offset within the image file.
+     * @param size The region size.
+     * @param buffer The buffer used in case the image is not mapped.
+     * @param[out] start The resulting region start.
+     * @param sequential Specifies whether the region is going to be scanned sequentially.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr getRegion(uint64_t offset, uint64_t size, std::vector<char>& buffer, char*& start,
+                         bool sequential = false);
+
+private:
+    DbgUtilErr buildDemangledNameCache();
+    DbgUtilErr getSymInfoMap(const SymInfoMap*& symInfoMap);
+    DbgUtilErr buildSymInfoMap();
+    DbgUtilErr getSymbolNameIndex(const SymbolNameIndex*& symNameIndex);
+    DbgUtilErr buildSymbolNameIndex();
+    DbgUtilErr mapImage();
+    void unmapImage();
+    void adviseSequential(char* start, uint64_t size);
 };
 
 /** @brief Abstract factory for creating image readers. */
@@ -211,8 +356,20 @@ public:
     /** @brief Creates the image reader. */
     virtual OsImageReader* createImageReader() = 0;
 
+    /**
+     * @brief Configures whether image readers created by this factory should map image files into
+     * memory (Linux only), instead of reading sections into heap buffers. Enabled by default.
+     */
+    inline void setUseMmap(bool useMmap) { m_useMmap = useMmap; }
+
+    /** @brief Queries whether image readers created by this factory map image files to memory. */
+    inline bool getUseMmap() const { return m_useMmap; }
+
 protected:
-    OsImageReaderFactory() {}
+    OsImageReaderFactory() : m_useMmap(true) {}
+
+private:
+    bool m_useMmap;
 };
 
 /** @brief Installs an image reader factory. */
@@ -222,7 +379,14 @@ extern void setImageReaderFactory(OsImageReaderFactory* factory);
 extern OsImageReaderFactory* getImageReaderFactory();
 
 /** @brief Creates an image reader. */
-inline OsImageReader* createImageReader() { return getImageReaderFactory()->createImageReader(); }
+inline OsImageReader* createImageReader() {
+    OsImageReaderFactory* factory = getImageReaderFactory();
+    OsImageReader* imageReader = factory->createImageReader();
+    if (imageReader != nullptr) {
+        imageReader->setUseMmap(factory->getUseMmap());
+    }
+    return imageReader;
+}
 
 }  // namespace dbgutil
 
@@ -25,6 +25,38 @@ DbgUtilErr OsStackTraceProvider::getStackTrace(void* context, RawStackTrace& sta
     return walkStack(&collector, context);
 }
 
+size_t OsStackTraceProvider::captureRawStack(void** frames, size_t maxFrames,
+                                             size_t skip /* = 0 */, void* context /* = nullptr */) {
+    struct StackFrameArrayCollector : public StackFrameListener {
+        StackFrameArrayCollector(void** frames, size_t maxFrames, size_t skip)
+            : m_frames(frames), m_maxFrames(maxFrames), m_skip(skip), m_count(0) {}
+        StackFrameArrayCollector(const StackFrameArrayCollector&) = delete;
+        StackFrameArrayCollector(StackFrameArrayCollector&&) = delete;
+        StackFrameArrayCollector& operator=(const StackFrameArrayCollector&) = delete;
+        ~StackFrameArrayCollector() final {}
+
+        void onStackFrame(void* frameAddress) final {
+            if (m_skip > 0) {
+                --m_skip;
+            } else if (m_count < m_maxFrames) {
+                m_frames[m_count++] = frameAddress;
+            }
+        }
+
+        void** m_frames;
+        size_t m_maxFrames;
+        size_t m_skip;
+        size_t m_count;
+    };
+
+    // the first frame reported by walkStack() is this function, which is not part of the result
+    StackFrameArrayCollector collector(frames, maxFrames, skip + 1);
+    if (walkStack(&collector, context) != DBGUTIL_ERR_OK) {
+        return 0;
+    }
+    return collector.m_count;
+}
+
 void setStackTraceProvider(OsStackTraceProvider* provider) {
     assert((provider != nullptr && sProvider == nullptr) ||
            (provider == nullptr && sProvider != nullptr));
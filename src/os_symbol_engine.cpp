@@ -2,12 +2,69 @@
 
 #include <cassert>
 
+#include "dwarf_util.h"
 #include "os_symbol_engine_internal.h"
+#include "string_pool.h"
+#include "symbol_index.h"
 
 namespace dbgutil {
 
 static OsSymbolEngine* sSymbolEngine = nullptr;
 
+// string pool used by symbol engines that do not manage their own interned strings
+static StringPool sStringPool;
+
+inline const char* internString(const std::string& str) {
+    const char* res = sStringPool.intern(str.c_str(), str.length());
+    return (res != nullptr) ? res : "";
+}
+
+DbgUtilErr OsSymbolEngine::getSymbolInfoRef(void* symAddress, SymbolInfoRef& symbolInfo,
+                                            SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    SymbolInfo fullSymbolInfo;
+    DbgUtilErr rc = getSymbolInfo(symAddress, fullSymbolInfo, detail);
+    symbolInfo.m_moduleBaseAddress = fullSymbolInfo.m_moduleBaseAddress;
+    symbolInfo.m_startAddress = fullSymbolInfo.m_startAddress;
+    symbolInfo.m_byteOffset = fullSymbolInfo.m_byteOffset;
+    symbolInfo.m_lineNumber = fullSymbolInfo.m_lineNumber;
+    symbolInfo.m_columnIndex = fullSymbolInfo.m_columnIndex;
+    symbolInfo.m_symbolSize = fullSymbolInfo.m_symbolSize;
+    symbolInfo.m_symbolName = internString(fullSymbolInfo.m_symbolName);
+    symbolInfo.m_fileName = internString(fullSymbolInfo.m_fileName);
+    symbolInfo.m_moduleName = internString(fullSymbolInfo.m_moduleName);
+    return rc;
+}
+
+DbgUtilErr OsSymbolEngine::getSymbolInfoRefBatch(
+    const void* const* addrs, size_t count, SymbolInfoRef* symbolInfos,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    if (count == 0) {
+        return DBGUTIL_ERR_OK;
+    }
+    if (addrs == nullptr || symbolInfos == nullptr) {
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        (void)getSymbolInfoRef(const_cast<void*>(addrs[i]), symbolInfos[i], detail);
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr OsSymbolEngine::getSymbolInfoBatch(
+    const void* const* addrs, size_t count, SymbolInfo* symbolInfos,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    if (count == 0) {
+        return DBGUTIL_ERR_OK;
+    }
+    if (addrs == nullptr || symbolInfos == nullptr) {
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        (void)getSymbolInfo(const_cast<void*>(addrs[i]), symbolInfos[i], detail);
+    }
+    return DBGUTIL_ERR_OK;
+}
+
 DbgUtilErr OsSymbolEngine::getSymbolInfo(const char* symbolName, const char* moduleNameRegex,
                                          SymbolInfo& symbolInfo) {
     std::list<SymbolInfo> symbolInfoList;
@@ -26,7 +83,8 @@ DbgUtilErr OsSymbolEngine::getSymbolInfo(const char* symbolName, const char* mod
 
 DbgUtilErr OsSymbolEngine::searchSymbols(const char* symbolRegex, const char* moduleNameRegex,
                                          std::list<SymbolInfo>& symbolInfoList,
-                                         size_t maxSymbolCount /* = SIZE_MAX */) {
+                                         size_t maxSymbolCount /* = SIZE_MAX */,
+                                         SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
     // use convenient lambda syntax
     return forEachSymbol(
         symbolRegex, moduleNameRegex,
@@ -37,7 +95,23 @@ DbgUtilErr OsSymbolEngine::searchSymbols(const char* symbolRegex, const char* mo
                 shouldStop = true;
             }
             return DBGUTIL_ERR_OK;
-        });
+        },
+        detail);
+}
+
+DbgUtilErr OsSymbolEngine::getSymbolCacheStats(SymbolCacheStats& /* stats */) {
+    return DBGUTIL_ERR_NOT_IMPLEMENTED;
+}
+
+std::shared_future<DbgUtilErr> OsSymbolEngine::prewarm(const char* /* moduleRegex */,
+                                                       unsigned /* threads */, bool /* async */) {
+    std::promise<DbgUtilErr> result;
+    result.set_value(DBGUTIL_ERR_NOT_IMPLEMENTED);
+    return result.get_future().share();
+}
+
+void OsSymbolEngine::getPrewarmProgress(SymbolPrewarmProgress& progress) {
+    progress = SymbolPrewarmProgress();
 }
 
 void setSymbolEngine(OsSymbolEngine* symbolEngine) {
@@ -51,4 +125,13 @@ OsSymbolEngine* getSymbolEngine() {
     return sSymbolEngine;
 }
 
+void setLineCacheBudget(size_t budgetBytes) { DwarfUtil::setLineCacheBudget(budgetBytes); }
+
+void setSymbolIndexDir(const char* indexDir) { SymbolIndex::setIndexDir(indexDir); }
+
+std::shared_future<DbgUtilErr> prewarmSymbolEngine(const char* moduleRegex, unsigned threads,
+                                                   bool async) {
+    return getSymbolEngine()->prewarm(moduleRegex, threads, async);
+}
+
 }  // namespace dbgutil
@@ -10,6 +10,8 @@
 #include <cinttypes>
 #include <climits>
 #include <cstring>
+#include <mutex>
+#include <new>
 
 #include "dbg_stack_trace.h"
 #include "dbgutil_log_imp.h"
@@ -17,6 +19,7 @@
 
 // headers required for dir/file API
 #ifndef DBGUTIL_WINDOWS
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -54,6 +57,10 @@ namespace dbgutil {
 
 static Logger sLogger;
 
+// file mappings made by the library itself (start and end address)
+static std::mutex sFileMappingLock;
+static std::vector<std::pair<uint64_t, uint64_t>> sFileMappings;
+
 void OsUtil::initLogger() { registerLogger(sLogger, "os_util"); }
 void OsUtil::termLogger() { unregisterLogger(sLogger); }
 
@@ -512,6 +519,60 @@ DbgUtilErr OsUtil::readEntireFileToLines(const char* path, std::vector<std::stri
     return DBGUTIL_ERR_OK;
 }
 
+#ifdef DBGUTIL_LINUX
+DbgUtilErr OsUtil::mapFile(int fd, uint64_t size, void*& address) {
+    // the mapping is made and registered under the lock, so that readMemoryMap() never sees it
+    // unregistered
+    std::unique_lock<std::mutex> lock(sFileMappingLock);
+    try {
+        sFileMappings.reserve(sFileMappings.size() + 1);
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to register file mapping, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    void* mappedFile = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mappedFile == MAP_FAILED) {
+        LOG_SYS_ERROR(sLogger, mmap, "Failed to map file of %" PRIu64 " bytes", size);
+        return DBGUTIL_ERR_SYSTEM_FAILURE;
+    }
+    sFileMappings.push_back({(uint64_t)mappedFile, (uint64_t)mappedFile + size});
+    address = mappedFile;
+    return DBGUTIL_ERR_OK;
+}
+
+void OsUtil::unmapFile(void* address, uint64_t size) {
+    std::unique_lock<std::mutex> lock(sFileMappingLock);
+    if (munmap(address, size) != 0) {
+        LOG_SYS_ERROR(sLogger, munmap, "Failed to unmap file at %p", address);
+    }
+    std::vector<std::pair<uint64_t, uint64_t>>::iterator itr = std::find_if(
+        sFileMappings.begin(), sFileMappings.end(),
+        [address](const std::pair<uint64_t, uint64_t>& entry) {
+            return entry.first == (uint64_t)address;
+        });
+    if (itr != sFileMappings.end()) {
+        sFileMappings.erase(itr);
+    }
+}
+
+DbgUtilErr OsUtil::readMemoryMap(std::vector<std::string>& lines,
+                                 std::vector<std::pair<uint64_t, uint64_t>>& fileMappings) {
+    std::unique_lock<std::mutex> lock(sFileMappingLock);
+    DbgUtilErr rc = readEntireFileToLines("/proc/self/maps", lines);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    try {
+        fileMappings = sFileMappings;
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to copy %zu file mappings, out of memory",
+                  sFileMappings.size());
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+#endif
+
 DbgUtilErr OsUtil::execCmd(const char* cmdLine, std::vector<char>& buf) {
 #ifdef DBGUTIL_WINDOWS
     FILE* output = _popen(cmdLine, "r");
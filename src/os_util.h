@@ -253,6 +253,37 @@ public:
      */
     static DbgUtilErr execCmd(const char* cmdLine, std::vector<char>& buf);
 
+#ifdef DBGUTIL_LINUX
+    /**
+     * @brief Maps an entire file read-only into memory, and registers the mapping as made by the
+     * library itself, so that it is not mistaken for a loaded module when parsing the process
+     * memory map (see @ref readMemoryMap()).
+     * @param fd The file descriptor (may be closed after the call).
+     * @param size The file size in bytes.
+     * @param[out] address The mapping start address.
+     * @return DbgUtilErr The operation result.
+     */
+    static DbgUtilErr mapFile(int fd, uint64_t size, void*& address);
+
+    /**
+     * @brief Unmaps a file previously mapped with @ref mapFile().
+     * @param address The mapping start address.
+     * @param size The mapping size in bytes.
+     */
+    static void unmapFile(void* address, uint64_t size);
+
+    /**
+     * @brief Reads the process memory map (/proc/self/maps) into lines, along with the file
+     * mappings made by the library at that time. Both are taken while no such mapping is being
+     * made or removed, so a library file mapping appearing in the lines is always reported.
+     * @param[out] lines The resulting memory map lines.
+     * @param[out] fileMappings The library file mappings (start and end address).
+     * @return DbgUtilErr The operation result.
+     */
+    static DbgUtilErr readMemoryMap(std::vector<std::string>& lines,
+                                    std::vector<std::pair<uint64_t, uint64_t>>& fileMappings);
+#endif
+
     /**
      * @brief Initializes a spin lock.
      * @param spinLock The spin lock to initialize.
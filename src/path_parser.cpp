@@ -207,6 +207,16 @@ DbgUtilErr PathParser::getFileName(const char* path, std::string& fileName) {
     return DBGUTIL_ERR_OK;
 }
 
+const char* PathParser::getFileNameRef(const char* path) {
+    const char* fileName = path;
+    for (const char* pos = path; *pos != 0; ++pos) {
+        if (strchr(DBGUTIL_PATH_SEP_CHARS, *pos) != nullptr) {
+            fileName = pos + 1;
+        }
+    }
+    return fileName;
+}
+
 DbgUtilErr PathParser::composePath(const char* basePath, const char* subPath, std::string& path,
                                    bool canonicalize /* = true */) {
     if (!canonicalize) {
@@ -113,6 +113,14 @@ public:
      */
     static DbgUtilErr getFileName(const char* path, std::string& fileName);
 
+    /**
+     * @brief Locates the bare file name within a path, without allocating memory.
+     * @param path The file or directory path.
+     * @return The bare file name, pointing into the given path (empty if the path ends with a path
+     * separator).
+     */
+    static const char* getFileNameRef(const char* path);
+
     /**
      * @brief Composes a path from two parts components with syntax check.
      * @param basePath The base path.
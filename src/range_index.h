@@ -0,0 +1,112 @@
+#ifndef __RANGE_INDEX_H__
+#define __RANGE_INDEX_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dbgutil {
+
+/** @def Denotes an address that is not contained by any range in a range index. */
+#define DBGUTIL_RANGE_NOT_FOUND ((size_t)-1)
+
+/**
+ * @brief A flat, sorted address range table. Range bounds are kept in two contiguous arrays
+ * (structure of arrays), so that a search touches only the range end array (8 bytes per range)
+ * rather than whole entries scattered across tree nodes. The search is a branchless binary search,
+ * which compiles into conditional moves, so the cost of each level is a single (mostly cached)
+ * memory load without branch mispredictions. The index is built once and is immutable afterwards,
+ * so it may be searched concurrently without locking. The caller keeps any per-range payload in an
+ * array parallel to the index.
+ */
+class RangeIndex {
+public:
+    RangeIndex() {}
+    RangeIndex(const RangeIndex&) = delete;
+    RangeIndex(RangeIndex&&) = delete;
+    RangeIndex& operator=(const RangeIndex&) = delete;
+    ~RangeIndex() {}
+
+    /** @brief Reserves space for the given amount of ranges. */
+    inline void reserve(size_t count) {
+        m_rangeStarts.reserve(count);
+        m_rangeEnds.reserve(count);
+    }
+
+    /**
+     * @brief Adds a range. Ranges must be added in ascending order of start address, and they are
+     * expected not to overlap.
+     * @param from The range start address.
+     * @param size The range size in bytes.
+     */
+    inline void addRange(uint64_t from, uint64_t size) {
+        m_rangeStarts.push_back(from);
+        m_rangeEnds.push_back(from + size);
+    }
+
+    /** @brief Releases excess capacity, after all ranges were added. */
+    inline void shrinkToFit() {
+        m_rangeStarts.shrink_to_fit();
+        m_rangeEnds.shrink_to_fit();
+    }
+
+    /** @brief Removes all ranges. */
+    inline void clear() {
+        m_rangeStarts.clear();
+        m_rangeEnds.clear();
+    }
+
+    /** @brief Retrieves the number of ranges. */
+    inline size_t size() const { return m_rangeEnds.size(); }
+
+    /** @brief Queries whether the index is empty. */
+    inline bool empty() const { return m_rangeEnds.empty(); }
+
+    /** @brief Retrieves the start address of a range. */
+    inline uint64_t getRangeStart(size_t index) const { return m_rangeStarts[index]; }
+
+    /** @brief Retrieves the size of a range. */
+    inline uint64_t getRangeSize(size_t index) const {
+        return m_rangeEnds[index] - m_rangeStarts[index];
+    }
+
+    /**
+     * @brief Searches for the range containing an address.
+     * @param address The address to search.
+     * @return The index of the first range whose end is beyond the address, if it contains the
+     * address, otherwise @ref DBGUTIL_RANGE_NOT_FOUND.
+     */
+    inline size_t findRange(uint64_t address) const {
+        size_t count = m_rangeEnds.size();
+        if (count == 0) {
+            return DBGUTIL_RANGE_NOT_FOUND;
+        }
+
+        // find first range whose end is beyond the address (upper bound over range ends)
+        const uint64_t* ends = m_rangeEnds.data();
+        const uint64_t* base = ends;
+        while (count > 1) {
+            size_t half = count / 2;
+            base = (base[half] <= address) ? base + half : base;
+            count -= half;
+        }
+        size_t index = (size_t)(base - ends) + (*base <= address ? 1 : 0);
+        if (index == m_rangeEnds.size() || m_rangeStarts[index] > address) {
+            return DBGUTIL_RANGE_NOT_FOUND;
+        }
+        return index;
+    }
+
+    /** @brief Retrieves the approximate memory usage (in bytes) of the index. */
+    inline size_t getMemoryUsage() const {
+        return (m_rangeStarts.capacity() + m_rangeEnds.capacity()) * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> m_rangeStarts;
+    std::vector<uint64_t> m_rangeEnds;
+};
+
+}  // namespace dbgutil
+
+#endif  // __RANGE_INDEX_H__
@@ -0,0 +1,299 @@
+#include "raw_stack_record.h"
+
+#ifdef DBGUTIL_LINUX
+#include <elf.h>
+#include <link.h>
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#include "dwarf_common.h"
+#include "dwarf_cursor.h"
+#include "os_module_manager.h"
+#include "os_util.h"
+
+// serialized record layout (all integers are unsigned LEB128, unless stated otherwise):
+//
+// header:  magic "DBGR" (4 bytes), format version (1 byte), payload length (4 bytes, LE)
+// payload: thread id, module count, modules, frame count, frames
+// module:  path length, path bytes, build id length, build id bytes (binary), load address
+// frame:   module index + 1 (zero means no module), offset (absolute address if no module)
+
+#define DBGUTIL_RAW_RECORD_MAGIC "DBGR"
+#define DBGUTIL_RAW_RECORD_MAGIC_SIZE 4
+#define DBGUTIL_RAW_RECORD_VERSION 1
+#define DBGUTIL_RAW_RECORD_HEADER_SIZE (DBGUTIL_RAW_RECORD_MAGIC_SIZE + 1 + 4)
+
+namespace dbgutil {
+
+#ifdef DBGUTIL_LINUX
+#if __SIZEOF_POINTER__ == 8
+#define DBGUTIL_ELF_CLASS ELFCLASS64
+#else
+#define DBGUTIL_ELF_CLASS ELFCLASS32
+#endif
+
+// build identifiers of loaded modules, keyed by load address, since reading them requires parsing
+// the program headers of the module
+struct ModuleBuildId {
+    std::string m_modulePath;
+    std::string m_buildId;
+};
+typedef std::unordered_map<uint64_t, ModuleBuildId> BuildIdMap;
+static BuildIdMap sBuildIdMap;
+static std::mutex sBuildIdLock;
+
+static void readNoteBuildId(const char* notes, uint64_t size, std::string& buildId) {
+    static const char hexDigits[] = "0123456789abcdef";
+    const char* end = notes + size;
+    while (notes + sizeof(ElfW(Nhdr)) <= end) {
+        const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr)*)notes;
+        const char* name = notes + sizeof(ElfW(Nhdr));
+        const unsigned char* desc = (const unsigned char*)(name + ((nhdr->n_namesz + 3) & ~3u));
+        if ((const char*)desc + nhdr->n_descsz > end) {
+            break;
+        }
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && strcmp(name, "GNU") == 0) {
+            buildId.clear();
+            for (uint32_t i = 0; i < nhdr->n_descsz; ++i) {
+                buildId += hexDigits[desc[i] >> 4];
+                buildId += hexDigits[desc[i] & 0x0F];
+            }
+            return;
+        }
+        notes = (const char*)desc + ((nhdr->n_descsz + 3) & ~3u);
+    }
+}
+
+// reads the build identifier from the loaded image of a module (no file access is required, since
+// the ELF header, program headers and notes are all mapped at the start of the module)
+static void readModuleBuildId(uint64_t loadAddress, std::string& buildId) {
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr)*)loadAddress;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != DBGUTIL_ELF_CLASS || ehdr->e_phentsize != sizeof(ElfW(Phdr)) ||
+        ehdr->e_phoff + ehdr->e_phnum * sizeof(ElfW(Phdr)) > pageSize) {
+        return;
+    }
+    const ElfW(Phdr)* phdrs = (const ElfW(Phdr)*)(loadAddress + ehdr->e_phoff);
+
+    // the load address corresponds to the lowest loadable segment
+    uint64_t minVaddr = UINT64_MAX;
+    for (uint32_t i = 0; i < ehdr->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_LOAD && phdrs[i].p_vaddr < minVaddr) {
+            minVaddr = phdrs[i].p_vaddr;
+        }
+    }
+    if (minVaddr == UINT64_MAX) {
+        return;
+    }
+    uint64_t bias = loadAddress - (minVaddr & ~(pageSize - 1));
+    for (uint32_t i = 0; i < ehdr->e_phnum && buildId.empty(); ++i) {
+        if (phdrs[i].p_type == PT_NOTE) {
+            readNoteBuildId((const char*)(bias + phdrs[i].p_vaddr), phdrs[i].p_memsz, buildId);
+        }
+    }
+}
+
+static void getModuleBuildId(const OsModuleInfo& moduleInfo, std::string& buildId) {
+    uint64_t loadAddress = (uint64_t)moduleInfo.m_loadAddress;
+    std::unique_lock<std::mutex> lock(sBuildIdLock);
+    BuildIdMap::iterator itr = sBuildIdMap.find(loadAddress);
+    if (itr != sBuildIdMap.end() && itr->second.m_modulePath == moduleInfo.m_modulePath) {
+        buildId = itr->second.m_buildId;
+        return;
+    }
+    readModuleBuildId(loadAddress, buildId);
+    sBuildIdMap[loadAddress] = {moduleInfo.m_modulePath, buildId};
+}
+#endif
+
+DbgUtilErr buildRawStackRecord(const RawStackTrace& rawStackTrace, RawStackRecord& record,
+                               os_thread_id_t threadId /* = 0 */) {
+    record.clear();
+    record.m_threadId = (threadId != 0) ? threadId : OsUtil::getCurrentThreadId();
+    try {
+        // stack traces typically span very few modules, so the module table is searched linearly
+        // before asking the module manager (which requires copying the module information)
+        std::vector<uint64_t> moduleEnds;
+        OsModuleInfo moduleInfo;
+        record.m_frames.resize(rawStackTrace.size());
+        for (size_t i = 0; i < rawStackTrace.size(); ++i) {
+            RawStackFrame& frame = record.m_frames[i];
+            uint64_t address = (uint64_t)rawStackTrace[i];
+            frame.m_moduleIndex = DBGUTIL_RAW_FRAME_NO_MODULE;
+            frame.m_offset = address;
+            for (uint32_t j = 0; j < record.m_modules.size(); ++j) {
+                if (address >= record.m_modules[j].m_loadAddress && address < moduleEnds[j]) {
+                    frame.m_moduleIndex = j;
+                    break;
+                }
+            }
+            if (frame.m_moduleIndex == DBGUTIL_RAW_FRAME_NO_MODULE) {
+                if (getModuleManager()->getModuleByAddress(rawStackTrace[i], moduleInfo) !=
+                    DBGUTIL_ERR_OK) {
+                    continue;
+                }
+                frame.m_moduleIndex = (uint32_t)record.m_modules.size();
+                record.m_modules.emplace_back();
+                RawStackModule& module = record.m_modules.back();
+                module.m_modulePath = moduleInfo.m_modulePath;
+                module.m_loadAddress = (uint64_t)moduleInfo.m_loadAddress;
+                moduleEnds.push_back(module.m_loadAddress + moduleInfo.m_size);
+#ifdef DBGUTIL_LINUX
+                getModuleBuildId(moduleInfo, module.m_buildId);
+#endif
+            }
+            frame.m_offset = address - record.m_modules[frame.m_moduleIndex].m_loadAddress;
+        }
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+static void readString(DwarfCursor& cursor, std::string& str) {
+    uint64_t length = cursor.readULEB128();
+    const char* data = cursor.readBlock(length);
+    if (data != nullptr) {
+        str.assign(data, (size_t)length);
+    }
+}
+
+static void writeBuildId(std::vector<char>& buffer, const std::string& buildId) {
+    // hex string is written in binary form (an odd trailing digit, if any, is discarded)
+    dwarfWriteULEB128(buffer, buildId.length() / 2);
+    for (size_t i = 0; i + 1 < buildId.length(); i += 2) {
+        char hex[3] = {buildId[i], buildId[i + 1], 0};
+        buffer.push_back((char)strtoul(hex, nullptr, 16));
+    }
+}
+
+static void readBuildId(DwarfCursor& cursor, std::string& buildId) {
+    static const char hexDigits[] = "0123456789abcdef";
+    uint64_t length = cursor.readULEB128();
+    const char* data = cursor.readBlock(length);
+    buildId.clear();
+    if (data != nullptr) {
+        for (uint64_t i = 0; i < length; ++i) {
+            unsigned char byte = (unsigned char)data[i];
+            buildId += hexDigits[byte >> 4];
+            buildId += hexDigits[byte & 0x0F];
+        }
+    }
+}
+
+DbgUtilErr serializeRawStackRecord(const RawStackRecord& record, std::vector<char>& buffer) {
+    size_t headerPos = buffer.size();
+    try {
+        buffer.insert(buffer.end(), DBGUTIL_RAW_RECORD_MAGIC,
+                      DBGUTIL_RAW_RECORD_MAGIC + DBGUTIL_RAW_RECORD_MAGIC_SIZE);
+        buffer.push_back((char)DBGUTIL_RAW_RECORD_VERSION);
+        buffer.resize(buffer.size() + 4);  // payload length, filled in later
+
+        size_t payloadPos = buffer.size();
+        dwarfWriteULEB128(buffer, record.m_threadId);
+        dwarfWriteULEB128(buffer, record.m_modules.size());
+        for (const RawStackModule& module : record.m_modules) {
+            dwarfWriteULEB128(buffer, module.m_modulePath.length());
+            buffer.insert(buffer.end(), module.m_modulePath.begin(), module.m_modulePath.end());
+            writeBuildId(buffer, module.m_buildId);
+            dwarfWriteULEB128(buffer, module.m_loadAddress);
+        }
+        dwarfWriteULEB128(buffer, record.m_frames.size());
+        for (const RawStackFrame& frame : record.m_frames) {
+            dwarfWriteULEB128(buffer, frame.m_moduleIndex == DBGUTIL_RAW_FRAME_NO_MODULE
+                                          ? 0
+                                          : (uint64_t)frame.m_moduleIndex + 1);
+            dwarfWriteULEB128(buffer, frame.m_offset);
+        }
+
+        uint64_t payloadLength = buffer.size() - payloadPos;
+        if (payloadLength > UINT32_MAX) {
+            buffer.resize(headerPos);
+            return DBGUTIL_ERR_RESOURCE_LIMIT;
+        }
+        for (uint32_t i = 0; i < 4; ++i) {
+            buffer[payloadPos - 4 + i] = (char)((payloadLength >> (8 * i)) & 0xFF);
+        }
+    } catch (std::bad_alloc&) {
+        buffer.resize(headerPos);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr deserializeRawStackRecord(const char* buffer, size_t length, RawStackRecord& record,
+                                     size_t& bytesRead) {
+    if (length < DBGUTIL_RAW_RECORD_HEADER_SIZE) {
+        return DBGUTIL_ERR_END_OF_STREAM;
+    }
+    if (memcmp(buffer, DBGUTIL_RAW_RECORD_MAGIC, DBGUTIL_RAW_RECORD_MAGIC_SIZE) != 0 ||
+        buffer[DBGUTIL_RAW_RECORD_MAGIC_SIZE] != DBGUTIL_RAW_RECORD_VERSION) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    uint64_t payloadLength = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        payloadLength |= ((uint64_t)(unsigned char)buffer[DBGUTIL_RAW_RECORD_MAGIC_SIZE + 1 + i])
+                         << (8 * i);
+    }
+    if (payloadLength > length - DBGUTIL_RAW_RECORD_HEADER_SIZE) {
+        return DBGUTIL_ERR_END_OF_STREAM;
+    }
+
+    // counts are checked against the bytes left, since each entry takes at least one byte
+    DwarfCursor cursor(buffer + DBGUTIL_RAW_RECORD_HEADER_SIZE, payloadLength);
+    record.clear();
+    try {
+        record.m_threadId = (os_thread_id_t)cursor.readULEB128();
+        uint64_t moduleCount = cursor.readULEB128();
+        if (!cursor.isValid() || moduleCount > cursor.getBytesLeft()) {
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        record.m_modules.resize((size_t)moduleCount);
+        for (RawStackModule& module : record.m_modules) {
+            readString(cursor, module.m_modulePath);
+            readBuildId(cursor, module.m_buildId);
+            module.m_loadAddress = cursor.readULEB128();
+        }
+
+        uint64_t frameCount = cursor.readULEB128();
+        if (!cursor.isValid() || frameCount > cursor.getBytesLeft()) {
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+        record.m_frames.resize((size_t)frameCount);
+        for (RawStackFrame& frame : record.m_frames) {
+            uint64_t moduleIndex = cursor.readULEB128();
+            frame.m_offset = cursor.readULEB128();
+            if (moduleIndex > moduleCount) {
+                return DBGUTIL_ERR_DATA_CORRUPT;
+            }
+            frame.m_moduleIndex =
+                (moduleIndex == 0) ? DBGUTIL_RAW_FRAME_NO_MODULE : (uint32_t)(moduleIndex - 1);
+        }
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    if (!cursor.isValid() || !cursor.empty()) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    bytesRead = DBGUTIL_RAW_RECORD_HEADER_SIZE + (size_t)payloadLength;
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr serializeRawStackTrace(const RawStackTrace& rawStackTrace, std::vector<char>& buffer,
+                                  os_thread_id_t threadId /* = 0 */) {
+    RawStackRecord record;
+    DbgUtilErr rc = buildRawStackRecord(rawStackTrace, record, threadId);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    return serializeRawStackRecord(record, buffer);
+}
+
+}  // namespace dbgutil
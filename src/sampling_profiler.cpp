@@ -0,0 +1,626 @@
+#include "sampling_profiler.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <new>
+
+#include "dbgutil_log_imp.h"
+#include "os_thread_manager.h"
+#include "sampling_profiler_internal.h"
+#include "stack_depot.h"
+
+#ifdef DBGUTIL_LINUX
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "dwarf_unwinder.h"
+
+// older glibc versions do not expose the target thread field of thread-directed timer signals
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// the CPU-time clock of another thread, as composed by pthread_getcpuclockid() (that requires a
+// pthread handle, whereas threads are enumerated here by system thread id)
+#define DBGUTIL_THREAD_CPU_CLOCK(tid) ((clockid_t)((~(clockid_t)(tid)) << 3) | 6)
+#endif
+
+// minimum number of samples buffered per thread until collected (must be a power of two), the
+// actual size is derived from the sampling rate, such that two collection periods are covered
+#define DBGUTIL_PROFILER_MIN_RING_SIZE 64
+
+// number of collected samples counted at once
+#define DBGUTIL_PROFILER_COLLECT_BATCH_SIZE 64
+
+// collection period, and the number of collections between thread scans
+#define DBGUTIL_PROFILER_COLLECT_PERIOD_MILLIS 20
+#define DBGUTIL_PROFILER_SCAN_PERIOD 5
+
+// maximum supported sampling rate (samples per second)
+#define DBGUTIL_PROFILER_MAX_RATE 10000
+
+// sampled thread slot index occupies the low 16 bits of the timer signal value
+#define DBGUTIL_PROFILER_SLOT_BITS 16
+#define DBGUTIL_PROFILER_SLOT_MASK ((1u << DBGUTIL_PROFILER_SLOT_BITS) - 1)
+#define DBGUTIL_PROFILER_MAX_GENERATION 0x7FFFu
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+static SamplingProfiler* sSamplingProfiler = nullptr;
+
+#ifdef DBGUTIL_LINUX
+// the running profiler (only one may run at a time, since the sampling signal is process-wide)
+static std::atomic<SamplingProfiler*> sActiveProfiler(nullptr);
+
+// number of signal handlers currently executing, so that stop() can wait for them to finish
+static std::atomic<uint32_t> sActiveHandlers(0);
+
+// the signal action replaced while the profiler is running
+static struct sigaction sPrevAction;
+
+// sampling state accessed by the signal handler (written only while sampling is disabled)
+static std::atomic<bool> sSampling(false);
+static ProfilerThreadSlot* sSampleSlots = nullptr;
+static uint32_t sSampleSlotCount = 0;
+static uint32_t sSampleMaxFrames = 0;
+static uint32_t sSampleRingSize = 0;
+static uint32_t sSampleGeneration = 0;
+
+// a sampled thread, with a single-producer single-consumer ring of captured samples: the signal
+// handler running on the sampled thread is the producer, and the collector thread is the consumer
+struct ProfilerThreadSlot {
+    os_thread_id_t m_threadId;
+    timer_t m_timer;
+    std::atomic<bool> m_active;
+    std::atomic<uint32_t> m_writePos;
+    std::atomic<uint32_t> m_readPos;
+    std::atomic<uint64_t> m_droppedCount;
+    uint64_t m_collectedDropCount;
+    uint32_t* m_frameCounts;
+    void** m_frames;
+
+    ProfilerThreadSlot()
+        : m_threadId(0),
+          m_timer(nullptr),
+          m_active(false),
+          m_writePos(0),
+          m_readPos(0),
+          m_droppedCount(0),
+          m_collectedDropCount(0),
+          m_frameCounts(nullptr),
+          m_frames(nullptr) {}
+    ProfilerThreadSlot(const ProfilerThreadSlot&) = delete;
+    ProfilerThreadSlot(ProfilerThreadSlot&&) = delete;
+    ProfilerThreadSlot& operator=(const ProfilerThreadSlot&) = delete;
+    ~ProfilerThreadSlot() {
+        delete[] m_frameCounts;
+        delete[] m_frames;
+    }
+};
+
+// retrieves the instruction pointer from a signal context
+static void* getContextIp(void* context) {
+#if defined(__x86_64__)
+    return (void*)((ucontext_t*)context)->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+    return (void*)((ucontext_t*)context)->uc_mcontext.pc;
+#elif defined(__i386__)
+    return (void*)((ucontext_t*)context)->uc_mcontext.gregs[REG_EIP];
+#else
+    (void)context;
+    return nullptr;
+#endif
+}
+
+static void takeSample(int sampleKey, void* context) {
+    // NOTE: this runs in a signal handler on the sampled thread, so nothing here may allocate
+    // memory or take locks
+    if (!sSampling.load(std::memory_order_seq_cst)) {
+        return;
+    }
+    // signals of timers from a previous run are discarded by generation
+    uint32_t slotIndex = ((uint32_t)sampleKey) & DBGUTIL_PROFILER_SLOT_MASK;
+    uint32_t generation = ((uint32_t)sampleKey) >> DBGUTIL_PROFILER_SLOT_BITS;
+    if (generation != sSampleGeneration || slotIndex >= sSampleSlotCount) {
+        return;
+    }
+    ProfilerThreadSlot& slot = sSampleSlots[slotIndex];
+    if (!slot.m_active.load(std::memory_order_acquire) ||
+        slot.m_threadId != (os_thread_id_t)syscall(SYS_gettid)) {
+        return;
+    }
+
+    uint32_t writePos = slot.m_writePos.load(std::memory_order_relaxed);
+    uint32_t readPos = slot.m_readPos.load(std::memory_order_acquire);
+    if (writePos - readPos >= sSampleRingSize) {
+        slot.m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t entryIndex = writePos & (sSampleRingSize - 1);
+    void** frames = slot.m_frames + (size_t)entryIndex * sSampleMaxFrames;
+
+    // unwinding from a signal context starts at the caller of the interrupted function, so the
+    // interrupted instruction itself is recorded first
+    frames[0] = getContextIp(context);
+    size_t frameCount = 1 + captureRawStack(frames + 1, sSampleMaxFrames - 1, 0, context);
+    slot.m_frameCounts[entryIndex] = (uint32_t)frameCount;
+    slot.m_writePos.store(writePos + 1, std::memory_order_release);
+}
+
+static void sampleSignalHandler(int sigNum, siginfo_t* sigInfo, void* context) {
+    (void)sigNum;
+    // ignore anything other than profiler timers (e.g. SIGPROF sent with kill())
+    if (sigInfo->si_code != SI_TIMER) {
+        return;
+    }
+    int savedErrno = errno;
+    sActiveHandlers.fetch_add(1, std::memory_order_seq_cst);
+    takeSample(sigInfo->si_value.sival_int, context);
+    sActiveHandlers.fetch_sub(1, std::memory_order_seq_cst);
+    errno = savedErrno;
+}
+
+#endif
+
+SamplingProfiler::SamplingProfiler()
+    : m_running(false),
+      m_slots(nullptr),
+      m_maxThreads(0),
+      m_maxFrames(0),
+      m_samplingPeriodNanos(0),
+      m_ringSize(0),
+      m_generation(0),
+      m_collectorThreadId(0),
+      m_stopRequested(false),
+      m_sampleCount(0),
+      m_droppedCount(0),
+      m_threadCount(0) {}
+
+SamplingProfiler::~SamplingProfiler() { (void)stop(); }
+
+#ifdef DBGUTIL_LINUX
+DbgUtilErr SamplingProfiler::start(
+    uint32_t samplingRate /* = DBGUTIL_PROFILER_DEFAULT_RATE */,
+    uint32_t maxFrames /* = DBGUTIL_PROFILER_DEFAULT_MAX_FRAMES */,
+    uint32_t maxThreads /* = DBGUTIL_PROFILER_DEFAULT_MAX_THREADS */) {
+    if (samplingRate == 0 || samplingRate > DBGUTIL_PROFILER_MAX_RATE) {
+        LOG_ERROR(sLogger, "Invalid sampling rate %u (expecting 1-%u samples per second)",
+                  samplingRate, (unsigned)DBGUTIL_PROFILER_MAX_RATE);
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    // the first frame of each sample is the interrupted instruction, so at least one more is needed
+    if (maxFrames < 2) {
+        LOG_ERROR(sLogger, "Invalid maximum frame count %u (expecting at least 2)", maxFrames);
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    if (maxThreads == 0 || maxThreads > DBGUTIL_PROFILER_SLOT_MASK) {
+        LOG_ERROR(sLogger, "Invalid maximum thread count %u (expecting 1-%u)", maxThreads,
+                  DBGUTIL_PROFILER_SLOT_MASK);
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> stateLock(m_stateLock);
+    if (m_running) {
+        LOG_ERROR(sLogger, "Cannot start sampling profiler, already running");
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    SamplingProfiler* activeProfiler = nullptr;
+    if (!sActiveProfiler.compare_exchange_strong(activeProfiler, this)) {
+        LOG_ERROR(sLogger, "Cannot start sampling profiler, another profiler is already running");
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+
+    m_slots = new (std::nothrow) ProfilerThreadSlot[maxThreads];
+    if (m_slots == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate %u sampled thread slots, out of memory",
+                  maxThreads);
+        sActiveProfiler.store(nullptr);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    m_maxThreads = maxThreads;
+    m_maxFrames = maxFrames;
+    m_samplingPeriodNanos = 1000000000ull / samplingRate;
+    m_ringSize = getRingSize(samplingRate);
+    m_generation = (m_generation % DBGUTIL_PROFILER_MAX_GENERATION) + 1;
+    m_threadSlotMap.clear();
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_stackCounts.clear();
+        m_sampleCount = 0;
+        m_droppedCount = 0;
+        m_threadCount = 0;
+        m_stopRequested = false;
+    }
+
+    struct sigaction sa = {};
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_sigaction = sampleSignalHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &sPrevAction) != 0) {
+        LOG_SYS_ERROR(sLogger, sigaction, "Failed to register sampling signal handler");
+        releaseSlots();
+        sActiveProfiler.store(nullptr);
+        return DBGUTIL_ERR_SYSTEM_FAILURE;
+    }
+    sSampleSlots = m_slots;
+    sSampleSlotCount = m_maxThreads;
+    sSampleMaxFrames = m_maxFrames;
+    sSampleRingSize = m_ringSize;
+    sSampleGeneration = m_generation;
+    sSampling.store(true, std::memory_order_seq_cst);
+
+    // threads are picked up by the collector thread
+    try {
+        m_collector = std::thread(&SamplingProfiler::collectorLoop, this);
+    } catch (std::exception& e) {
+        LOG_ERROR(sLogger, "Failed to start sampling profiler collector thread: %s", e.what());
+        sSampling.store(false, std::memory_order_seq_cst);
+        (void)sigaction(SIGPROF, &sPrevAction, nullptr);
+        releaseSlots();
+        sActiveProfiler.store(nullptr);
+        return DBGUTIL_ERR_SYSTEM_FAILURE;
+    }
+    m_running = true;
+    LOG_DEBUG(sLogger, "Sampling profiler started at %u samples per second", samplingRate);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr SamplingProfiler::stop() {
+    std::unique_lock<std::mutex> stateLock(m_stateLock);
+    if (!m_running) {
+        return DBGUTIL_ERR_OK;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_stopRequested = true;
+        m_cv.notify_one();
+    }
+    m_collector.join();
+
+    // disable sampling and delete all timers, then wait for signal handlers still executing, so
+    // that the remaining samples can be safely drained, and sampled thread slots released
+    sSampling.store(false, std::memory_order_seq_cst);
+    for (uint32_t i = 0; i < m_maxThreads; ++i) {
+        if (m_slots[i].m_active.load(std::memory_order_relaxed)) {
+            (void)timer_delete(m_slots[i].m_timer);
+        }
+    }
+    while (sActiveHandlers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    collectSamples();
+    sSampleSlots = nullptr;
+    sSampleSlotCount = 0;
+    releaseSlots();
+    // the last sampled thread count is kept for snapshots taken after stopping
+    m_threadSlotMap.clear();
+
+    // signals sent by deleted timers are no longer pending, so the previous action may be restored
+    if (sigaction(SIGPROF, &sPrevAction, nullptr) != 0) {
+        LOG_SYS_ERROR(sLogger, sigaction, "Failed to restore previous sampling signal handler");
+    }
+    sActiveProfiler.store(nullptr);
+    m_running = false;
+    LOG_DEBUG(sLogger, "Sampling profiler stopped");
+    return DBGUTIL_ERR_OK;
+}
+#else
+DbgUtilErr SamplingProfiler::start(uint32_t /* samplingRate */, uint32_t /* maxFrames */,
+                                   uint32_t /* maxThreads */) {
+    LOG_ERROR(sLogger, "Sampling profiler is not supported on this platform");
+    return DBGUTIL_ERR_NOT_IMPLEMENTED;
+}
+
+DbgUtilErr SamplingProfiler::stop() { return DBGUTIL_ERR_OK; }
+#endif
+
+bool SamplingProfiler::isRunning() {
+    std::unique_lock<std::mutex> stateLock(m_stateLock);
+    return m_running;
+}
+
+DbgUtilErr SamplingProfiler::getSnapshot(ProfileSnapshot& snapshot, bool reset /* = false */) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    try {
+        snapshot.m_stacks.clear();
+        snapshot.m_stacks.reserve(m_stackCounts.size());
+        for (const auto& entry : m_stackCounts) {
+            snapshot.m_stacks.push_back({entry.first, entry.second});
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to take profile snapshot of %zu stacks, out of memory",
+                  m_stackCounts.size());
+        return DBGUTIL_ERR_NOMEM;
+    }
+    snapshot.m_sampleCount = m_sampleCount;
+    snapshot.m_droppedCount = m_droppedCount;
+    snapshot.m_threadCount = m_threadCount;
+    if (reset) {
+        m_stackCounts.clear();
+        m_sampleCount = 0;
+        m_droppedCount = 0;
+    }
+    lock.unlock();
+
+    // ties are ordered by stack id, so that the report is stable
+    std::sort(snapshot.m_stacks.begin(), snapshot.m_stacks.end(),
+              [](const ProfileStackCount& lhs, const ProfileStackCount& rhs) {
+                  return lhs.m_sampleCount > rhs.m_sampleCount ||
+                         (lhs.m_sampleCount == rhs.m_sampleCount && lhs.m_stackId < rhs.m_stackId);
+              });
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr SamplingProfiler::formatReport(const ProfileSnapshot& snapshot, std::string& report,
+                                          uint32_t maxStacks /* = 0 */,
+                                          StackEntryFormatter* formatter /* = nullptr */) {
+    DefaultStackEntryFormatter defaultFormatter;
+    if (formatter == nullptr) {
+        formatter = &defaultFormatter;
+    }
+    size_t reportCount = snapshot.m_stacks.size();
+    if (maxStacks != 0 && maxStacks < reportCount) {
+        reportCount = maxStacks;
+    }
+
+    char line[256];
+    try {
+        snprintf(line, sizeof(line),
+                 "Profile of %" PRIu64 " samples (%" PRIu64 " dropped), %zu unique stacks, %u "
+                 "threads\n",
+                 snapshot.m_sampleCount, snapshot.m_droppedCount, snapshot.m_stacks.size(),
+                 snapshot.m_threadCount);
+        report = line;
+        for (size_t i = 0; i < reportCount; ++i) {
+            const ProfileStackCount& stackCount = snapshot.m_stacks[i];
+            double percent = snapshot.m_sampleCount == 0
+                                 ? 0.0
+                                 : (100.0 * stackCount.m_sampleCount) / snapshot.m_sampleCount;
+            snprintf(line, sizeof(line), "\n%" PRIu64 " samples (%.2f%%), stack id %u:\n",
+                     stackCount.m_sampleCount, percent, stackCount.m_stackId);
+            report += line;
+
+            // symbolization takes place only here
+            RawStackTrace rawStackTrace;
+            StackTrace stackTrace;
+            DbgUtilErr rc = getStackDepot()->getStack(stackCount.m_stackId, rawStackTrace);
+            if (rc == DBGUTIL_ERR_OK) {
+                rc = resolveRawStackTrace(rawStackTrace, stackTrace);
+            }
+            if (rc != DBGUTIL_ERR_OK) {
+                LOG_WARN(sLogger, "Failed to resolve sampled stack %u: %s", stackCount.m_stackId,
+                         errorToString(rc));
+                report += "    <stack unavailable>\n";
+                continue;
+            }
+            for (const StackEntry& stackEntry : stackTrace) {
+                report += "    ";
+                report += formatter->formatStackEntry(stackEntry);
+                report += "\n";
+            }
+        }
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to format profile report, out of memory");
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+#ifdef DBGUTIL_LINUX
+void SamplingProfiler::collectorLoop() {
+    m_collectorThreadId = getCurrentThreadId();
+    uint32_t iteration = 0;
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (!m_stopRequested) {
+        lock.unlock();
+        if (iteration++ % DBGUTIL_PROFILER_SCAN_PERIOD == 0) {
+            scanThreads();
+        }
+        collectSamples();
+        lock.lock();
+        m_cv.wait_for(lock, std::chrono::milliseconds(DBGUTIL_PROFILER_COLLECT_PERIOD_MILLIS),
+                      [this]() { return m_stopRequested; });
+    }
+}
+
+void SamplingProfiler::scanThreads() {
+#ifdef DBGUTIL_DWARF_UNWIND_SUPPORTED
+    // the builtin unwinder does not refresh its module table during sampling, so it is done here
+    if (isDwarfUnwindEnabled()) {
+        (void)DwarfUnwinder::getInstance()->syncModuleTable();
+    }
+#endif
+
+    std::vector<os_thread_id_t> threadIds;
+    visitThreadIds([&threadIds](os_thread_id_t threadId) { threadIds.push_back(threadId); });
+    std::sort(threadIds.begin(), threadIds.end());
+
+    // stop sampling threads that have exited
+    for (auto itr = m_threadSlotMap.begin(); itr != m_threadSlotMap.end();) {
+        if (!std::binary_search(threadIds.begin(), threadIds.end(), itr->first)) {
+            stopThreadSampling(itr->second);
+            itr = m_threadSlotMap.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+
+    // start sampling new threads, except for the collector thread itself
+    for (os_thread_id_t threadId : threadIds) {
+        if (threadId != m_collectorThreadId &&
+            m_threadSlotMap.find(threadId) == m_threadSlotMap.end()) {
+            (void)startThreadSampling(threadId);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_threadCount = (uint32_t)m_threadSlotMap.size();
+}
+
+bool SamplingProfiler::startThreadSampling(os_thread_id_t threadId) {
+    uint32_t slotIndex = 0;
+    while (slotIndex < m_maxThreads &&
+           m_slots[slotIndex].m_active.load(std::memory_order_relaxed)) {
+        ++slotIndex;
+    }
+    if (slotIndex == m_maxThreads) {
+        LOG_WARN(sLogger, "Cannot sample thread %" PRItid ", maximum of %u threads reached",
+                 threadId, m_maxThreads);
+        return false;
+    }
+    ProfilerThreadSlot& slot = m_slots[slotIndex];
+    if (slot.m_frames == nullptr) {
+        slot.m_frameCounts = new (std::nothrow) uint32_t[m_ringSize];
+        slot.m_frames = new (std::nothrow) void*[(size_t)m_ringSize * m_maxFrames];
+        if (slot.m_frameCounts == nullptr || slot.m_frames == nullptr) {
+            delete[] slot.m_frameCounts;
+            delete[] slot.m_frames;
+            slot.m_frameCounts = nullptr;
+            slot.m_frames = nullptr;
+            LOG_ERROR(sLogger, "Failed to allocate sample buffer for thread %" PRItid
+                      ", out of memory", threadId);
+            return false;
+        }
+    }
+
+    // the timer signal is directed at the sampled thread, and measures its CPU time
+    struct sigevent sev = {};
+    memset(&sev, 0, sizeof(struct sigevent));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_value.sival_int = (int)((m_generation << DBGUTIL_PROFILER_SLOT_BITS) | slotIndex);
+    sev.sigev_notify_thread_id = (pid_t)threadId;
+    if (timer_create(DBGUTIL_THREAD_CPU_CLOCK(threadId), &sev, &slot.m_timer) != 0) {
+        // the thread may have just exited
+        int sysErr = errno;
+        LOG_DEBUG(sLogger, "Failed to create sampling timer for thread %" PRItid ": %d (%s)",
+                  threadId, sysErr, sysErrorToStr(sysErr));
+        return false;
+    }
+    slot.m_threadId = threadId;
+    slot.m_writePos.store(0, std::memory_order_relaxed);
+    slot.m_readPos.store(0, std::memory_order_relaxed);
+    slot.m_droppedCount.store(0, std::memory_order_relaxed);
+    slot.m_collectedDropCount = 0;
+    slot.m_active.store(true, std::memory_order_release);
+
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = (time_t)(m_samplingPeriodNanos / 1000000000ull);
+    spec.it_interval.tv_nsec = (long)(m_samplingPeriodNanos % 1000000000ull);
+    spec.it_value = spec.it_interval;
+    if (timer_settime(slot.m_timer, 0, &spec, nullptr) != 0) {
+        LOG_SYS_ERROR(sLogger, timer_settime, "Failed to arm sampling timer for thread %" PRItid,
+                      threadId);
+        slot.m_active.store(false, std::memory_order_relaxed);
+        (void)timer_delete(slot.m_timer);
+        return false;
+    }
+    m_threadSlotMap[threadId] = slotIndex;
+    return true;
+}
+
+void SamplingProfiler::stopThreadSampling(uint32_t slotIndex) {
+    // the thread has exited, so no signal handler can be executing on its behalf
+    ProfilerThreadSlot& slot = m_slots[slotIndex];
+    (void)timer_delete(slot.m_timer);
+    collectSlotSamples(slot);
+    slot.m_active.store(false, std::memory_order_release);
+}
+
+void SamplingProfiler::collectSamples() {
+    for (uint32_t i = 0; i < m_maxThreads; ++i) {
+        if (m_slots[i].m_active.load(std::memory_order_relaxed)) {
+            collectSlotSamples(m_slots[i]);
+        }
+    }
+}
+
+void SamplingProfiler::collectSlotSamples(ProfilerThreadSlot& slot) {
+    uint64_t droppedCount = slot.m_droppedCount.load(std::memory_order_relaxed);
+    uint64_t newDropCount = droppedCount - slot.m_collectedDropCount;
+    slot.m_collectedDropCount = droppedCount;
+
+    // stacks are interned without holding the lock, and counted in batches, so that the ring slots
+    // are released to the signal handler as soon as possible
+    uint32_t stackIds[DBGUTIL_PROFILER_COLLECT_BATCH_SIZE];
+    uint32_t readPos = slot.m_readPos.load(std::memory_order_relaxed);
+    uint32_t writePos = slot.m_writePos.load(std::memory_order_acquire);
+    do {
+        uint32_t stackIdCount = 0;
+        while (readPos != writePos && stackIdCount < DBGUTIL_PROFILER_COLLECT_BATCH_SIZE) {
+            uint32_t entryIndex = readPos & (m_ringSize - 1);
+            void** frames = slot.m_frames + (size_t)entryIndex * m_maxFrames;
+            stackIds[stackIdCount++] =
+                getStackDepot()->putStack(frames, slot.m_frameCounts[entryIndex]);
+            ++readPos;
+        }
+        slot.m_readPos.store(readPos, std::memory_order_release);
+        if (stackIdCount == 0 && newDropCount == 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_lock);
+        for (uint32_t i = 0; i < stackIdCount; ++i) {
+            if (stackIds[i] == DBGUTIL_INVALID_STACK_ID) {
+                ++newDropCount;
+            } else {
+                ++m_stackCounts[stackIds[i]];
+                ++m_sampleCount;
+            }
+        }
+        m_droppedCount += newDropCount;
+        newDropCount = 0;
+    } while (readPos != writePos);
+}
+
+uint32_t SamplingProfiler::getRingSize(uint32_t samplingRate) {
+    // the collector thread may be delayed, so samples of two collection periods are buffered
+    uint64_t sampleCount = 2ull * samplingRate * DBGUTIL_PROFILER_COLLECT_PERIOD_MILLIS / 1000;
+    uint32_t ringSize = DBGUTIL_PROFILER_MIN_RING_SIZE;
+    while (ringSize < sampleCount) {
+        ringSize <<= 1;
+    }
+    return ringSize;
+}
+
+void SamplingProfiler::releaseSlots() {
+    delete[] m_slots;
+    m_slots = nullptr;
+    m_maxThreads = 0;
+}
+#endif
+
+SamplingProfiler* getSamplingProfiler() { return sSamplingProfiler; }
+
+DbgUtilErr initSamplingProfiler() {
+    registerLogger(sLogger, "sampling_profiler");
+    // the global profiler allocates resources only when started
+    sSamplingProfiler = new (std::nothrow) SamplingProfiler();
+    if (sSamplingProfiler == nullptr) {
+        LOG_ERROR(sLogger, "Failed to create global sampling profiler, out of memory");
+        unregisterLogger(sLogger);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr termSamplingProfiler() {
+    if (sSamplingProfiler != nullptr) {
+        // stops sampling if still running
+        delete sSamplingProfiler;
+        sSamplingProfiler = nullptr;
+    }
+    unregisterLogger(sLogger);
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
@@ -0,0 +1,16 @@
+#ifndef __SAMPLING_PROFILER_INTERNAL_H__
+#define __SAMPLING_PROFILER_INTERNAL_H__
+
+#include "dbg_util_err.h"
+
+namespace dbgutil {
+
+/** @brief Initializes the sampling profiler logger and creates the global sampling profiler. */
+extern DbgUtilErr initSamplingProfiler();
+
+/** @brief Stops and destroys the global sampling profiler, and terminates its logger. */
+extern DbgUtilErr termSamplingProfiler();
+
+}  // namespace dbgutil
+
+#endif  // __SAMPLING_PROFILER_INTERNAL_H__
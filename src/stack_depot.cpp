@@ -0,0 +1,353 @@
+#include "stack_depot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "dbgutil_log_imp.h"
+#include "stack_depot_internal.h"
+
+// number of stack identifiers per node page (identifiers are mapped to nodes by a two-level table)
+#define DBGUTIL_STACK_DEPOT_PAGE_BITS 12
+#define DBGUTIL_STACK_DEPOT_PAGE_SIZE (1u << DBGUTIL_STACK_DEPOT_PAGE_BITS)
+
+// size of arena blocks (larger stacks get a block of their own)
+#define DBGUTIL_STACK_DEPOT_BLOCK_SIZE (1024 * 1024)
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+static StackDepot* sStackDepot = nullptr;
+
+// a stored stack, immediately followed by its frames (immutable once published)
+struct StackDepot::StackNode {
+    StackNode* m_next;
+    uint64_t m_hash;
+    uint32_t m_stackId;
+    uint32_t m_frameCount;
+
+    inline void** getFrames() { return (void**)(this + 1); }
+    inline void* const* getFrames() const { return (void* const*)(this + 1); }
+
+    inline bool isSameStack(uint64_t hash, void* const* frames, size_t frameCount) const {
+        return m_hash == hash && m_frameCount == frameCount &&
+               (frameCount == 0 || memcmp(getFrames(), frames, frameCount * sizeof(void*)) == 0);
+    }
+};
+
+// an arena block, immediately followed by its data
+struct StackDepot::ArenaBlock {
+    ArenaBlock* m_next;
+    size_t m_size;
+    std::atomic<size_t> m_used;
+
+    inline char* getData() { return (char*)(this + 1); }
+};
+
+static inline uint64_t hashFrames(void* const* frames, size_t frameCount) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ (uint64_t)frameCount;
+    for (size_t i = 0; i < frameCount; ++i) {
+        hash ^= (uint64_t)(uintptr_t)frames[i];
+        hash *= 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+StackDepot::StackDepot(uint32_t bucketCount /* = DBGUTIL_STACK_DEPOT_DEFAULT_BUCKETS */,
+                       uint32_t maxStacks /* = DBGUTIL_STACK_DEPOT_DEFAULT_MAX_STACKS */)
+    : m_bucketCount(1),
+      m_maxStacks(std::max(maxStacks, 1u)),
+      m_pageCount(0),
+      m_initialized(false),
+      m_buckets(nullptr),
+      m_nodePages(nullptr),
+      m_currBlock(nullptr),
+      m_nextStackId(0),
+      m_discardedCount(0),
+      m_frameCount(0),
+      m_droppedCount(0),
+      m_arenaBytes(0) {
+    while (m_bucketCount < bucketCount && m_bucketCount < (1u << 31)) {
+        m_bucketCount <<= 1;
+    }
+    m_pageCount = (m_maxStacks + DBGUTIL_STACK_DEPOT_PAGE_SIZE - 1) / DBGUTIL_STACK_DEPOT_PAGE_SIZE;
+}
+
+StackDepot::~StackDepot() {
+    ArenaBlock* block = m_currBlock.load(std::memory_order_relaxed);
+    while (block != nullptr) {
+        ArenaBlock* next = block->m_next;
+        block->~ArenaBlock();
+        delete[] (char*)block;
+        block = next;
+    }
+    if (m_nodePages != nullptr) {
+        for (uint32_t i = 0; i < m_pageCount; ++i) {
+            delete[] m_nodePages[i].load(std::memory_order_relaxed);
+        }
+        delete[] m_nodePages;
+    }
+    delete[] m_buckets;
+}
+
+uint32_t StackDepot::putStack(void* const* frames, size_t frameCount) {
+    if (frameCount > UINT32_MAX || !ensureInitialized()) {
+        onDropped("invalid stack or out of memory");
+        return DBGUTIL_INVALID_STACK_ID;
+    }
+
+    // search without locks first, since most stacks are already stored
+    uint64_t hash = hashFrames(frames, frameCount);
+    std::atomic<StackNode*>& bucket = m_buckets[hash & (m_bucketCount - 1)];
+    StackNode* head = bucket.load(std::memory_order_acquire);
+    for (StackNode* node = head; node != nullptr; node = node->m_next) {
+        if (node->isSameStack(hash, frames, frameCount)) {
+            return node->m_stackId;
+        }
+    }
+
+    // new stack
+    uint32_t stackId = m_nextStackId.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (stackId > m_maxStacks || stackId == 0) {
+        m_nextStackId.store(m_maxStacks, std::memory_order_relaxed);
+        onDropped("stack depot is full");
+        return DBGUTIL_INVALID_STACK_ID;
+    }
+    StackNode* newNode = allocNode(frameCount);
+    if (newNode == nullptr) {
+        m_discardedCount.fetch_add(1, std::memory_order_relaxed);
+        onDropped("out of memory");
+        return DBGUTIL_INVALID_STACK_ID;
+    }
+
+    // the node must be complete before it becomes visible by identifier, since the arena memory is
+    // not initialized, and readers may look up identifiers before the node is published in its
+    // bucket (the release store in setNode() publishes these writes)
+    newNode->m_hash = hash;
+    newNode->m_stackId = stackId;
+    newNode->m_frameCount = (uint32_t)frameCount;
+    newNode->m_next = nullptr;
+    if (frameCount > 0) {
+        memcpy(newNode->getFrames(), frames, frameCount * sizeof(void*));
+    }
+    if (!setNode(stackId, newNode)) {
+        m_discardedCount.fetch_add(1, std::memory_order_relaxed);
+        onDropped("out of memory");
+        return DBGUTIL_INVALID_STACK_ID;
+    }
+
+    // publish the node, but if another thread inserted the same stack in the meantime, its
+    // identifier is used instead (the new node is then left unused in the arena)
+    for (;;) {
+        newNode->m_next = head;
+        StackNode* prevHead = head;
+        if (bucket.compare_exchange_weak(head, newNode, std::memory_order_release,
+                                         std::memory_order_acquire)) {
+            m_frameCount.fetch_add(frameCount, std::memory_order_relaxed);
+            return stackId;
+        }
+        for (StackNode* node = head; node != prevHead; node = node->m_next) {
+            if (node->isSameStack(hash, frames, frameCount)) {
+                (void)setNode(stackId, nullptr);
+                m_discardedCount.fetch_add(1, std::memory_order_relaxed);
+                return node->m_stackId;
+            }
+        }
+    }
+}
+
+bool StackDepot::getStack(uint32_t stackId, void* const*& frames, size_t& frameCount) const {
+    const StackNode* node = getNode(stackId);
+    if (node == nullptr) {
+        return false;
+    }
+    frames = node->getFrames();
+    frameCount = node->m_frameCount;
+    return true;
+}
+
+DbgUtilErr StackDepot::getStack(uint32_t stackId, RawStackTrace& rawStackTrace) const {
+    const StackNode* node = getNode(stackId);
+    if (node == nullptr) {
+        return DBGUTIL_ERR_NOT_FOUND;
+    }
+    try {
+        rawStackTrace.assign(node->getFrames(), node->getFrames() + node->m_frameCount);
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to copy stack %u of %u frames, out of memory", stackId,
+                  node->m_frameCount);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+void StackDepot::getStats(StackDepotStats& stats) const {
+    uint64_t allocatedIds =
+        std::min(m_nextStackId.load(std::memory_order_relaxed), m_maxStacks);
+    stats.m_stackCount = allocatedIds - m_discardedCount.load(std::memory_order_relaxed);
+    stats.m_frameCount = m_frameCount.load(std::memory_order_relaxed);
+    stats.m_droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+    stats.m_bucketCount = m_bucketCount;
+    stats.m_usedBucketCount = 0;
+    stats.m_maxChainLength = 0;
+    stats.m_arenaBytes = m_arenaBytes.load(std::memory_order_relaxed);
+    stats.m_usedArenaBytes = 0;
+    if (!m_initialized.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_bucketCount; ++i) {
+        uint64_t chainLength = 0;
+        for (const StackNode* node = m_buckets[i].load(std::memory_order_acquire);
+             node != nullptr; node = node->m_next) {
+            ++chainLength;
+            stats.m_usedArenaBytes += sizeof(StackNode) + node->m_frameCount * sizeof(void*);
+        }
+        if (chainLength > 0) {
+            ++stats.m_usedBucketCount;
+            stats.m_maxChainLength = std::max(stats.m_maxChainLength, chainLength);
+        }
+    }
+}
+
+bool StackDepot::ensureInitialized() {
+    if (m_initialized.load(std::memory_order_acquire)) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(m_initLock);
+    if (m_initialized.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    m_buckets = new (std::nothrow) std::atomic<StackNode*>[m_bucketCount];
+    if (m_buckets == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate stack depot hash table of %u buckets, out of memory",
+                  m_bucketCount);
+        return false;
+    }
+    m_nodePages = new (std::nothrow) std::atomic<std::atomic<StackNode*>*>[m_pageCount];
+    if (m_nodePages == nullptr) {
+        LOG_ERROR(sLogger, "Failed to allocate stack depot page table of %u pages, out of memory",
+                  m_pageCount);
+        delete[] m_buckets;
+        m_buckets = nullptr;
+        return false;
+    }
+    for (uint32_t i = 0; i < m_bucketCount; ++i) {
+        m_buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < m_pageCount; ++i) {
+        m_nodePages[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_initialized.store(true, std::memory_order_release);
+    return true;
+}
+
+bool StackDepot::setNode(uint32_t stackId, StackNode* node) {
+    uint32_t index = stackId - 1;
+    std::atomic<std::atomic<StackNode*>*>& pageRef =
+        m_nodePages[index >> DBGUTIL_STACK_DEPOT_PAGE_BITS];
+    std::atomic<StackNode*>* page = pageRef.load(std::memory_order_acquire);
+    if (page == nullptr) {
+        // node pages are installed by compare-and-swap, and the losing thread deletes its page
+        std::atomic<StackNode*>* newPage =
+            new (std::nothrow) std::atomic<StackNode*>[DBGUTIL_STACK_DEPOT_PAGE_SIZE];
+        if (newPage == nullptr) {
+            LOG_ERROR(sLogger, "Failed to allocate stack depot page, out of memory");
+            return false;
+        }
+        for (uint32_t i = 0; i < DBGUTIL_STACK_DEPOT_PAGE_SIZE; ++i) {
+            newPage[i].store(nullptr, std::memory_order_relaxed);
+        }
+        if (pageRef.compare_exchange_strong(page, newPage, std::memory_order_acq_rel)) {
+            page = newPage;
+        } else {
+            delete[] newPage;
+        }
+    }
+    page[index & (DBGUTIL_STACK_DEPOT_PAGE_SIZE - 1)].store(node, std::memory_order_release);
+    return true;
+}
+
+const StackDepot::StackNode* StackDepot::getNode(uint32_t stackId) const {
+    if (stackId == DBGUTIL_INVALID_STACK_ID || stackId > m_maxStacks ||
+        !m_initialized.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    uint32_t index = stackId - 1;
+    const std::atomic<StackNode*>* page =
+        m_nodePages[index >> DBGUTIL_STACK_DEPOT_PAGE_BITS].load(std::memory_order_acquire);
+    if (page == nullptr) {
+        return nullptr;
+    }
+    return page[index & (DBGUTIL_STACK_DEPOT_PAGE_SIZE - 1)].load(std::memory_order_acquire);
+}
+
+StackDepot::StackNode* StackDepot::allocNode(size_t frameCount) {
+    // nodes are allocated back to back, so alignment is kept by the node and block header sizes
+    static_assert(sizeof(StackNode) % sizeof(void*) == 0, "Unaligned stack node size");
+    static_assert(sizeof(ArenaBlock) % sizeof(void*) == 0, "Unaligned arena block size");
+    size_t size = sizeof(StackNode) + frameCount * sizeof(void*);
+    for (;;) {
+        ArenaBlock* block = m_currBlock.load(std::memory_order_acquire);
+        if (block != nullptr) {
+            size_t offset = block->m_used.fetch_add(size, std::memory_order_relaxed);
+            if (offset + size <= block->m_size) {
+                return (StackNode*)(block->getData() + offset);
+            }
+        }
+
+        // current block is exhausted, so a new block is installed by compare-and-swap (the rest of
+        // the current block is left unused)
+        size_t blockSize = std::max(size, (size_t)DBGUTIL_STACK_DEPOT_BLOCK_SIZE);
+        char* buffer = new (std::nothrow) char[sizeof(ArenaBlock) + blockSize];
+        if (buffer == nullptr) {
+            LOG_ERROR(sLogger, "Failed to allocate stack depot arena block of %zu bytes",
+                      blockSize);
+            return nullptr;
+        }
+        ArenaBlock* newBlock = new (buffer) ArenaBlock();
+        newBlock->m_next = block;
+        newBlock->m_size = blockSize;
+        newBlock->m_used.store(size, std::memory_order_relaxed);
+        if (m_currBlock.compare_exchange_strong(block, newBlock, std::memory_order_acq_rel)) {
+            m_arenaBytes.fetch_add(blockSize, std::memory_order_relaxed);
+            return (StackNode*)newBlock->getData();
+        }
+        newBlock->~ArenaBlock();
+        delete[] buffer;
+    }
+}
+
+void StackDepot::onDropped(const char* reason) {
+    // only the first drop is reported, since this may happen at a high rate
+    if (m_droppedCount.fetch_add(1, std::memory_order_relaxed) == 0) {
+        LOG_WARN(sLogger, "Failed to store stack in stack depot: %s", reason);
+    }
+}
+
+StackDepot* getStackDepot() { return sStackDepot; }
+
+DbgUtilErr initStackDepot() {
+    registerLogger(sLogger, "stack_depot");
+    // the global depot allocates memory only on first use
+    sStackDepot = new (std::nothrow) StackDepot();
+    if (sStackDepot == nullptr) {
+        LOG_ERROR(sLogger, "Failed to create global stack depot, out of memory");
+        unregisterLogger(sLogger);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr termStackDepot() {
+    if (sStackDepot != nullptr) {
+        delete sStackDepot;
+        sStackDepot = nullptr;
+    }
+    unregisterLogger(sLogger);
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
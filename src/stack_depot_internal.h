@@ -0,0 +1,16 @@
+#ifndef __STACK_DEPOT_INTERNAL_H__
+#define __STACK_DEPOT_INTERNAL_H__
+
+#include "dbg_util_err.h"
+
+namespace dbgutil {
+
+/** @brief Initializes the stack depot logger and creates the global stack depot. */
+extern DbgUtilErr initStackDepot();
+
+/** @brief Destroys the global stack depot and terminates the stack depot logger. */
+extern DbgUtilErr termStackDepot();
+
+}  // namespace dbgutil
+
+#endif  // __STACK_DEPOT_INTERNAL_H__
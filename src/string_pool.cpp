@@ -0,0 +1,123 @@
+#include "string_pool.h"
+
+#include <mutex>
+#include <new>
+
+namespace dbgutil {
+
+// strings larger than this are given a dedicated chunk, so that chunk space is not wasted
+#define DBGUTIL_STRING_POOL_MAX_SHARED_LENGTH (DBGUTIL_STRING_POOL_CHUNK_SIZE / 4)
+
+size_t StringPool::StringRefHash::operator()(const StringRef& strRef) const {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < strRef.m_length; ++i) {
+        hash ^= (uint8_t)strRef.m_str[i];
+        hash *= 0x100000001B3ull;
+    }
+    return (size_t)hash;
+}
+
+StringPool::StringPool() : m_chunkPos(nullptr), m_chunkLeft(0), m_chunkBytes(0) {}
+
+StringPool::~StringPool() {
+    for (char* chunk : m_chunks) {
+        delete[] chunk;
+    }
+    m_chunks.clear();
+}
+
+const char* StringPool::intern(const char* str, size_t length) {
+    if (length == 0) {
+        return "";
+    }
+
+    // search first under read lock, this is the common case
+    StringRef strRef = {str, length};
+    {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        StringSet::const_iterator itr = m_stringSet.find(strRef);
+        if (itr != m_stringSet.end()) {
+            return itr->m_str;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_lock);
+    // check again, another thread may have interned the same string meanwhile
+    StringSet::const_iterator itr = m_stringSet.find(strRef);
+    if (itr != m_stringSet.end()) {
+        return itr->m_str;
+    }
+    char* internedStr = allocString(str, length);
+    if (internedStr == nullptr) {
+        return nullptr;
+    }
+    try {
+        m_stringSet.insert({internedStr, length});
+    } catch (std::bad_alloc&) {
+        // string remains in the chunk but will not be found again, this is harmless
+        return nullptr;
+    }
+    return internedStr;
+}
+
+size_t StringPool::getMemoryUsage() {
+    std::shared_lock<std::shared_mutex> lock(m_lock);
+    return m_chunkBytes + m_stringSet.size() * (sizeof(StringRef) + sizeof(void*)) +
+           m_stringSet.bucket_count() * sizeof(void*);
+}
+
+void StringPool::clear() {
+    std::unique_lock<std::shared_mutex> lock(m_lock);
+    m_stringSet.clear();
+    for (char* chunk : m_chunks) {
+        delete[] chunk;
+    }
+    m_chunks.clear();
+    m_chunkPos = nullptr;
+    m_chunkLeft = 0;
+    m_chunkBytes = 0;
+}
+
+char* StringPool::allocString(const char* str, size_t length) {
+    size_t size = length + 1;
+    char* res = nullptr;
+    if (size > DBGUTIL_STRING_POOL_MAX_SHARED_LENGTH) {
+        res = newChunk(size);
+        if (res == nullptr) {
+            return nullptr;
+        }
+    } else {
+        if (size > m_chunkLeft) {
+            char* chunk = newChunk(DBGUTIL_STRING_POOL_CHUNK_SIZE);
+            if (chunk == nullptr) {
+                return nullptr;
+            }
+            m_chunkPos = chunk;
+            m_chunkLeft = DBGUTIL_STRING_POOL_CHUNK_SIZE;
+        }
+        res = m_chunkPos;
+        m_chunkPos += size;
+        m_chunkLeft -= size;
+    }
+    memcpy(res, str, length);
+    res[length] = 0;
+    return res;
+}
+
+char* StringPool::newChunk(size_t size) {
+    char* chunk = new (std::nothrow) char[size];
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    try {
+        m_chunks.push_back(chunk);
+    } catch (std::bad_alloc&) {
+        delete[] chunk;
+        return nullptr;
+    }
+    m_chunkBytes += size;
+    return chunk;
+}
+
+}  // namespace dbgutil
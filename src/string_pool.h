@@ -0,0 +1,80 @@
+#ifndef __STRING_POOL_H__
+#define __STRING_POOL_H__
+
+#include <cstdint>
+#include <cstring>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace dbgutil {
+
+/** @def The size of each memory chunk allocated by the string pool. */
+#define DBGUTIL_STRING_POOL_CHUNK_SIZE (64 * 1024)
+
+/**
+ * @brief A thread-safe pool of interned, null-terminated strings. Strings are copied into large
+ * memory chunks that are never released until the pool is destroyed, so the returned pointers
+ * remain valid (and may be compared for equality) for the entire life time of the pool. Looking up
+ * a string that is already interned does not allocate any memory.
+ */
+class StringPool {
+public:
+    StringPool();
+    StringPool(const StringPool&) = delete;
+    StringPool(StringPool&&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    ~StringPool();
+
+    /**
+     * @brief Interns a string.
+     * @param str The string to intern (need not be null-terminated).
+     * @param length The string length.
+     * @return The interned null-terminated string, or null if ran out of memory.
+     */
+    const char* intern(const char* str, size_t length);
+
+    /** @brief Interns a null-terminated string. */
+    inline const char* intern(const char* str) { return intern(str, strlen(str)); }
+
+    /** @brief Retrieves the approximate memory usage (in bytes) of the pool. */
+    size_t getMemoryUsage();
+
+    /**
+     * @brief Releases all interned strings. The caller must ensure that no previously returned
+     * pointers are used afterwards.
+     */
+    void clear();
+
+private:
+    struct StringRef {
+        const char* m_str;
+        size_t m_length;
+    };
+
+    struct StringRefHash {
+        size_t operator()(const StringRef& strRef) const;
+    };
+
+    struct StringRefEquals {
+        inline bool operator()(const StringRef& lhs, const StringRef& rhs) const {
+            return lhs.m_length == rhs.m_length &&
+                   memcmp(lhs.m_str, rhs.m_str, lhs.m_length) == 0;
+        }
+    };
+
+    typedef std::unordered_set<StringRef, StringRefHash, StringRefEquals> StringSet;
+    StringSet m_stringSet;
+    std::vector<char*> m_chunks;
+    char* m_chunkPos;
+    size_t m_chunkLeft;
+    size_t m_chunkBytes;
+    std::shared_mutex m_lock;
+
+    char* allocString(const char* str, size_t length);
+    char* newChunk(size_t size);
+};
+
+}  // namespace dbgutil
+
+#endif  // __STRING_POOL_H__
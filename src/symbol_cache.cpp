@@ -0,0 +1,134 @@
+#include "symbol_cache.h"
+
+#include <new>
+
+namespace dbgutil {
+
+// maximum number of slots probed before giving up
+#define DBGUTIL_SYMBOL_CACHE_MAX_PROBE 16
+
+SymbolCache::SymbolCache()
+    : m_table(nullptr),
+      m_capacityLog2(0),
+      m_capacity(0),
+      m_maxEntryCount(0),
+      m_entryCount(0) {
+    for (StatStripe& stripe : m_statStripes) {
+        stripe.m_hitCount.store(0, std::memory_order_relaxed);
+        stripe.m_missCount.store(0, std::memory_order_relaxed);
+    }
+}
+
+SymbolCache::StatStripe& SymbolCache::getStatStripe() {
+    // each thread is assigned a stripe on first use, in round-robin order
+    static std::atomic<uint32_t> sNextStripe(0);
+    static thread_local uint32_t sStripeIndex =
+        sNextStripe.fetch_add(1, std::memory_order_relaxed) &
+        (DBGUTIL_SYMBOL_CACHE_STAT_STRIPES - 1);
+    return m_statStripes[sStripeIndex];
+}
+
+DbgUtilErr SymbolCache::initialize(uint32_t capacityLog2) {
+    if (m_table != nullptr) {
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    if (capacityLog2 == 0) {
+        capacityLog2 = DBGUTIL_SYMBOL_CACHE_DEFAULT_CAPACITY_LOG2;
+    } else if (capacityLog2 < DBGUTIL_SYMBOL_CACHE_MIN_CAPACITY_LOG2) {
+        capacityLog2 = DBGUTIL_SYMBOL_CACHE_MIN_CAPACITY_LOG2;
+    } else if (capacityLog2 > DBGUTIL_SYMBOL_CACHE_MAX_CAPACITY_LOG2) {
+        capacityLog2 = DBGUTIL_SYMBOL_CACHE_MAX_CAPACITY_LOG2;
+    }
+
+    uint64_t capacity = ((uint64_t)1) << capacityLog2;
+    m_table = new (std::nothrow) std::atomic<Entry*>[capacity];
+    if (m_table == nullptr) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+    for (uint64_t i = 0; i < capacity; ++i) {
+        m_table[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_capacityLog2 = capacityLog2;
+    m_capacity = capacity;
+    // keep load factor below 75% to avoid long probe sequences
+    m_maxEntryCount = capacity - capacity / 4;
+    return DBGUTIL_ERR_OK;
+}
+
+void SymbolCache::destroy() {
+    if (m_table != nullptr) {
+        for (uint64_t i = 0; i < m_capacity; ++i) {
+            delete m_table[i].load(std::memory_order_relaxed);
+        }
+        delete[] m_table;
+        m_table = nullptr;
+    }
+    m_capacityLog2 = 0;
+    m_capacity = 0;
+    m_maxEntryCount = 0;
+    m_entryCount.store(0, std::memory_order_relaxed);
+}
+
+bool SymbolCache::lookup(void* address, SymbolInfoRef& symbolInfo, DbgUtilErr& result) {
+    uint64_t mask = m_capacity - 1;
+    uint64_t index = hashAddress(address);
+    for (uint32_t i = 0; i < DBGUTIL_SYMBOL_CACHE_MAX_PROBE; ++i) {
+        const Entry* entry = m_table[(index + i) & mask].load(std::memory_order_acquire);
+        if (entry == nullptr) {
+            // entries are never removed, so an empty slot terminates the probe sequence
+            break;
+        }
+        if (entry->m_address == address) {
+            symbolInfo = entry->m_symbolInfo;
+            result = entry->m_result;
+            getStatStripe().m_hitCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    getStatStripe().m_missCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SymbolCache::insert(void* address, const SymbolInfoRef& symbolInfo, DbgUtilErr result) {
+    if (m_entryCount.load(std::memory_order_relaxed) >= m_maxEntryCount) {
+        return;
+    }
+
+    Entry* newEntry = new (std::nothrow) Entry{address, result, symbolInfo};
+    if (newEntry == nullptr) {
+        return;
+    }
+
+    uint64_t mask = m_capacity - 1;
+    uint64_t index = hashAddress(address);
+    for (uint32_t i = 0; i < DBGUTIL_SYMBOL_CACHE_MAX_PROBE; ++i) {
+        std::atomic<Entry*>& slot = m_table[(index + i) & mask];
+        Entry* entry = slot.load(std::memory_order_acquire);
+        if (entry == nullptr) {
+            if (slot.compare_exchange_strong(entry, newEntry, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                m_entryCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            // lost the race for this slot, entry now points to the winner
+        }
+        if (entry->m_address == address) {
+            // already cached by another thread
+            break;
+        }
+    }
+    delete newEntry;
+}
+
+void SymbolCache::getStats(SymbolCacheStats& stats) const {
+    stats.m_capacity = m_capacity;
+    stats.m_entryCount = m_entryCount.load(std::memory_order_relaxed);
+    stats.m_hitCount = 0;
+    stats.m_missCount = 0;
+    for (const StatStripe& stripe : m_statStripes) {
+        stats.m_hitCount += stripe.m_hitCount.load(std::memory_order_relaxed);
+        stats.m_missCount += stripe.m_missCount.load(std::memory_order_relaxed);
+    }
+}
+
+}  // namespace dbgutil
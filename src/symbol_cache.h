@@ -0,0 +1,109 @@
+#ifndef __SYMBOL_CACHE_H__
+#define __SYMBOL_CACHE_H__
+
+#include <atomic>
+#include <cstdint>
+
+#include "dbg_util_err.h"
+#include "os_symbol_engine.h"
+
+namespace dbgutil {
+
+/** @def The default symbol cache capacity (log2 of number of entries). */
+#define DBGUTIL_SYMBOL_CACHE_DEFAULT_CAPACITY_LOG2 14
+
+/** @def The minimum symbol cache capacity (log2 of number of entries). */
+#define DBGUTIL_SYMBOL_CACHE_MIN_CAPACITY_LOG2 8
+
+/** @def The maximum symbol cache capacity (log2 of number of entries). */
+#define DBGUTIL_SYMBOL_CACHE_MAX_CAPACITY_LOG2 20
+
+/** @def The number of hit/miss counter stripes (must be a power of two). */
+#define DBGUTIL_SYMBOL_CACHE_STAT_STRIPES 16
+
+/**
+ * @brief A fixed capacity address to symbol information cache. The cache is an open-addressed
+ * hash table of atomic pointers to immutable entries. Entries are inserted only into empty slots
+ * and are never replaced nor removed until the cache is destroyed, so lookups require no locking at
+ * all. When the cache is full (or the probe limit is reached), new results are simply not cached.
+ * Symbol information is kept in compact form, so the cache must not outlive the string pools that
+ * the cached names point to.
+ */
+class SymbolCache {
+public:
+    SymbolCache();
+    SymbolCache(const SymbolCache&) = delete;
+    SymbolCache(SymbolCache&&) = delete;
+    SymbolCache& operator=(const SymbolCache&) = delete;
+    ~SymbolCache() { destroy(); }
+
+    /**
+     * @brief Initializes the cache.
+     * @param capacityLog2 The cache capacity given as log2 of the number of entries. The value is
+     * clamped to the allowed range. Zero selects the default capacity.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr initialize(uint32_t capacityLog2);
+
+    /** @brief Releases all cache resources. Not thread-safe. */
+    void destroy();
+
+    /** @brief Queries whether the cache is initialized. */
+    inline bool isInitialized() const { return m_table != nullptr; }
+
+    /**
+     * @brief Searches for cached symbol information by address.
+     * @param address The symbol address.
+     * @param[out] symbolInfo The cached symbol information.
+     * @param[out] result The cached result of the original symbol lookup.
+     * @return True if the address was found in the cache.
+     */
+    bool lookup(void* address, SymbolInfoRef& symbolInfo, DbgUtilErr& result);
+
+    /**
+     * @brief Caches symbol information of an address. If the address is already cached, or there
+     * is no room in the cache, then the call has no effect.
+     * @param address The symbol address.
+     * @param symbolInfo The symbol information to cache.
+     * @param result The result of the symbol lookup (only final results, either success or not
+     * found, should be cached).
+     */
+    void insert(void* address, const SymbolInfoRef& symbolInfo, DbgUtilErr result);
+
+    /** @brief Retrieves cache statistics. */
+    void getStats(SymbolCacheStats& stats) const;
+
+private:
+    struct Entry {
+        void* m_address;
+        DbgUtilErr m_result;
+        SymbolInfoRef m_symbolInfo;
+    };
+
+    std::atomic<Entry*>* m_table;
+    uint32_t m_capacityLog2;
+    uint64_t m_capacity;
+    uint64_t m_maxEntryCount;
+    std::atomic<uint64_t> m_entryCount;
+
+    // hit/miss counters are striped by thread, each stripe padded to a cache line, so that
+    // concurrent lookups do not contend on a single shared counter (summed by getStats()). padding
+    // is used instead of alignas(), since over-aligned allocation requires C++17.
+    struct StatStripe {
+        std::atomic<uint64_t> m_hitCount;
+        std::atomic<uint64_t> m_missCount;
+        char m_padding[64 - 2 * sizeof(std::atomic<uint64_t>)];
+    };
+    StatStripe m_statStripes[DBGUTIL_SYMBOL_CACHE_STAT_STRIPES];
+
+    StatStripe& getStatStripe();
+
+    inline uint64_t hashAddress(void* address) const {
+        // fibonacci hashing, take the high bits
+        return (((uint64_t)address) * 0x9E3779B97F4A7C15ull) >> (64 - m_capacityLog2);
+    }
+};
+
+}  // namespace dbgutil
+
+#endif  // __SYMBOL_CACHE_H__
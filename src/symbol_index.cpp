@@ -0,0 +1,408 @@
+#include "symbol_index.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef DBGUTIL_LINUX
+#include <unistd.h>
+#endif
+
+#ifdef DBGUTIL_WINDOWS
+#include <process.h>
+#endif
+
+#include "dbgutil_log_imp.h"
+#include "os_util.h"
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+// index file magic
+static const char sIndexMagic[8] = {'D', 'B', 'G', 'U', 'I', 'D', 'X', '\0'};
+
+// byte order mark, used to reject index files written on a machine with different byte order
+#define DBGUTIL_SYMBOL_INDEX_BOM 0x01020304u
+
+// maximum build identifier length (hex string)
+#define DBGUTIL_SYMBOL_INDEX_MAX_BUILD_ID 64
+
+// index flags
+#define DBGUTIL_SYMBOL_INDEX_FLAG_64BIT 0x0001u
+#define DBGUTIL_SYMBOL_INDEX_FLAG_EXE 0x0002u
+#define DBGUTIL_SYMBOL_INDEX_FLAG_CU_RANGES 0x0004u
+
+// index file header, followed by symbol table, compilation unit range table, source file table
+// and string pool (in this order, all 8 bytes aligned)
+struct IndexHeader {
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_byteOrderMark;
+    uint32_t m_flags;
+    uint32_t m_buildIdLength;
+    uint64_t m_relocBase;
+    uint32_t m_symbolCount;
+    uint32_t m_srcFileCount;
+    uint32_t m_cuRangeCount;
+    uint32_t m_reserved;
+    uint64_t m_symbolsOffset;
+    uint64_t m_cuRangesOffset;
+    uint64_t m_srcFilesOffset;
+    uint64_t m_stringPoolOffset;
+    uint64_t m_stringPoolSize;
+    char m_buildId[DBGUTIL_SYMBOL_INDEX_MAX_BUILD_ID];
+};
+
+static std::mutex sIndexDirLock;
+static std::string sIndexDir;
+
+inline uint64_t alignUp8(uint64_t value) { return (value + 7) & ~((uint64_t)7); }
+
+void SymbolIndex::initLogger() { registerLogger(sLogger, "symbol_index"); }
+void SymbolIndex::termLogger() { unregisterLogger(sLogger); }
+
+void SymbolIndex::setIndexDir(const char* indexDir) {
+    std::unique_lock<std::mutex> lock(sIndexDirLock);
+    sIndexDir = (indexDir == nullptr) ? "" : indexDir;
+}
+
+std::string SymbolIndex::getIndexDir() {
+    std::unique_lock<std::mutex> lock(sIndexDirLock);
+    return sIndexDir;
+}
+
+std::string SymbolIndex::getIndexPath(const std::string& indexDir, const std::string& buildId) {
+    std::string path = indexDir;
+    if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+        path += '/';
+    }
+    path += buildId;
+    path += DBGUTIL_SYMBOL_INDEX_EXT;
+    return path;
+}
+
+SymbolIndex::SymbolIndex()
+    : m_mappedIndex(nullptr),
+      m_mappedSize(0),
+      m_symbols(nullptr),
+      m_symbolCount(0),
+      m_srcFileOffsets(nullptr),
+      m_srcFileCount(0),
+      m_cuRanges(nullptr),
+      m_cuRangeCount(0),
+      m_stringPool(nullptr) {}
+
+DbgUtilErr SymbolIndex::open(const std::string& indexDir, const std::string& buildId) {
+#ifdef DBGUTIL_LINUX
+    if (isOpen()) {
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    std::string path = getIndexPath(indexDir, buildId);
+    DbgUtilErr rc = OsUtil::fileExists(path.c_str());
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    int fd = -1;
+    rc = OsUtil::openFile(path.c_str(), O_RDONLY, 0, fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+    uint64_t fileSize = 0;
+    rc = OsUtil::getFileSize(fd, fileSize);
+    if (rc != DBGUTIL_ERR_OK) {
+        OsUtil::closeFile(fd);
+        return rc;
+    }
+    if (fileSize < sizeof(IndexHeader)) {
+        OsUtil::closeFile(fd);
+        LOG_DEBUG(sLogger, "Symbol index file %s too small", path.c_str());
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+
+    // NOTE: the mapping remains valid after the file is closed
+    void* mappedIndex = nullptr;
+    rc = OsUtil::mapFile(fd, fileSize, mappedIndex);
+    OsUtil::closeFile(fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_ERROR(sLogger, "Failed to map symbol index file %s", path.c_str());
+        return rc;
+    }
+    m_mappedIndex = (char*)mappedIndex;
+    m_mappedSize = fileSize;
+
+    rc = validate(buildId);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Rejecting invalid symbol index file %s: %s", path.c_str(),
+                  errorToString(rc));
+        close();
+        return rc;
+    }
+    LOG_DEBUG(sLogger,
+              "Loaded symbol index file %s (%u symbols, %u source files, %u address ranges)",
+              path.c_str(), m_symbolCount, m_srcFileCount, m_cuRangeCount);
+    return DBGUTIL_ERR_OK;
+#else
+    return DBGUTIL_ERR_NOT_IMPLEMENTED;
+#endif
+}
+
+void SymbolIndex::close() {
+#ifdef DBGUTIL_LINUX
+    if (m_mappedIndex != nullptr) {
+        OsUtil::unmapFile(m_mappedIndex, m_mappedSize);
+    }
+#endif
+    m_mappedIndex = nullptr;
+    m_mappedSize = 0;
+    m_symbols = nullptr;
+    m_symbolCount = 0;
+    m_srcFileOffsets = nullptr;
+    m_srcFileCount = 0;
+    m_cuRanges = nullptr;
+    m_cuRangeCount = 0;
+    m_stringPool = nullptr;
+}
+
+bool SymbolIndex::getIs64Bit() const {
+    return (((const IndexHeader*)m_mappedIndex)->m_flags & DBGUTIL_SYMBOL_INDEX_FLAG_64BIT) != 0;
+}
+
+bool SymbolIndex::getIsExe() const {
+    return (((const IndexHeader*)m_mappedIndex)->m_flags & DBGUTIL_SYMBOL_INDEX_FLAG_EXE) != 0;
+}
+
+uint64_t SymbolIndex::getRelocationBase() const {
+    return ((const IndexHeader*)m_mappedIndex)->m_relocBase;
+}
+
+bool SymbolIndex::hasCURanges() const {
+    return (((const IndexHeader*)m_mappedIndex)->m_flags & DBGUTIL_SYMBOL_INDEX_FLAG_CU_RANGES) !=
+           0;
+}
+
+DbgUtilErr SymbolIndex::validate(const std::string& buildId) {
+    const IndexHeader* hdr = (const IndexHeader*)m_mappedIndex;
+    if (memcmp(hdr->m_magic, sIndexMagic, sizeof(sIndexMagic)) != 0 ||
+        hdr->m_byteOrderMark != DBGUTIL_SYMBOL_INDEX_BOM) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    if (hdr->m_version != DBGUTIL_SYMBOL_INDEX_VERSION) {
+        return DBGUTIL_ERR_NOT_IMPLEMENTED;
+    }
+
+    // the build id is part of the file name, but we verify it anyway
+    if (hdr->m_buildIdLength != buildId.length() ||
+        hdr->m_buildIdLength > DBGUTIL_SYMBOL_INDEX_MAX_BUILD_ID ||
+        memcmp(hdr->m_buildId, buildId.c_str(), buildId.length()) != 0) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+
+    // verify all tables are within file bounds and aligned
+    uint64_t symbolsSize = ((uint64_t)hdr->m_symbolCount) * sizeof(Symbol);
+    uint64_t cuRangesSize = ((uint64_t)hdr->m_cuRangeCount) * sizeof(CURange);
+    uint64_t srcFilesSize = ((uint64_t)hdr->m_srcFileCount) * sizeof(uint32_t);
+    if (hdr->m_symbolsOffset != alignUp8(sizeof(IndexHeader)) ||
+        hdr->m_cuRangesOffset != alignUp8(hdr->m_symbolsOffset + symbolsSize) ||
+        hdr->m_srcFilesOffset != alignUp8(hdr->m_cuRangesOffset + cuRangesSize) ||
+        hdr->m_stringPoolOffset != alignUp8(hdr->m_srcFilesOffset + srcFilesSize) ||
+        hdr->m_stringPoolSize == 0 || hdr->m_stringPoolSize > UINT32_MAX ||
+        hdr->m_stringPoolOffset + hdr->m_stringPoolSize != m_mappedSize) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+
+    m_symbols = (const Symbol*)(m_mappedIndex + hdr->m_symbolsOffset);
+    m_symbolCount = hdr->m_symbolCount;
+    m_cuRanges = (const CURange*)(m_mappedIndex + hdr->m_cuRangesOffset);
+    m_cuRangeCount = hdr->m_cuRangeCount;
+    m_srcFileOffsets = (const uint32_t*)(m_mappedIndex + hdr->m_srcFilesOffset);
+    m_srcFileCount = hdr->m_srcFileCount;
+    m_stringPool = m_mappedIndex + hdr->m_stringPoolOffset;
+
+    // the string pool ends with a terminating null, so checking string offsets is sufficient
+    uint32_t stringPoolSize = (uint32_t)hdr->m_stringPoolSize;
+    if (m_stringPool[stringPoolSize - 1] != 0) {
+        return DBGUTIL_ERR_DATA_CORRUPT;
+    }
+    for (uint32_t i = 0; i < m_srcFileCount; ++i) {
+        if (m_srcFileOffsets[i] >= stringPoolSize) {
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+    }
+    for (uint32_t i = 0; i < m_symbolCount; ++i) {
+        const Symbol& symbol = m_symbols[i];
+        if (symbol.m_nameOffset >= stringPoolSize ||
+            (symbol.m_mapNameOffset != DBGUTIL_SYMBOL_INDEX_NO_NAME &&
+             symbol.m_mapNameOffset >= stringPoolSize) ||
+            (symbol.m_srcFileIndex >= m_srcFileCount && m_srcFileCount > 0)) {
+            return DBGUTIL_ERR_DATA_CORRUPT;
+        }
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+SymbolIndexBuilder::SymbolIndexBuilder(bool is64Bit, bool isExe, uint64_t relocBase)
+    : m_is64Bit(is64Bit), m_isExe(isExe), m_relocBase(relocBase), m_hasCURanges(false) {
+    // reserve offset zero for the empty string
+    m_stringPool.push_back(0);
+    m_stringMap.insert(std::unordered_map<std::string, uint32_t>::value_type("", 0));
+}
+
+void SymbolIndexBuilder::addSymbol(uint64_t offset, uint64_t size, const char* name,
+                                   const char* mapName, uint32_t srcFileIndex) {
+    uint32_t nameOffset = internString(name);
+    uint32_t mapNameOffset =
+        (mapName == nullptr) ? DBGUTIL_SYMBOL_INDEX_NO_NAME : internString(mapName);
+    m_symbols.push_back({offset, size, nameOffset, mapNameOffset, srcFileIndex, 0});
+}
+
+void SymbolIndexBuilder::addSrcFile(const char* fileName) {
+    m_srcFileOffsets.push_back(internString(fileName));
+}
+
+void SymbolIndexBuilder::addCURange(uint64_t from, uint64_t size, uint64_t debugInfoOffset) {
+    m_cuRanges.push_back({from, size, debugInfoOffset});
+}
+
+uint32_t SymbolIndexBuilder::internString(const char* str) {
+    std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> itrRes =
+        m_stringMap.insert(
+            std::unordered_map<std::string, uint32_t>::value_type(str, m_stringPool.size()));
+    if (itrRes.second) {
+        size_t len = itrRes.first->first.length();
+        m_stringPool.insert(m_stringPool.end(), str, str + len + 1);
+    }
+    return itrRes.first->second;
+}
+
+DbgUtilErr SymbolIndexBuilder::write(const std::string& indexDir, const std::string& buildId) {
+    if (buildId.empty() || buildId.length() > DBGUTIL_SYMBOL_INDEX_MAX_BUILD_ID) {
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    if (m_stringPool.size() > UINT32_MAX || m_symbols.size() > UINT32_MAX ||
+        m_srcFileOffsets.size() > UINT32_MAX || m_cuRanges.size() > UINT32_MAX) {
+        LOG_DEBUG(sLogger, "Symbol index too large, not writing index for build id %s",
+                  buildId.c_str());
+        return DBGUTIL_ERR_NOT_IMPLEMENTED;
+    }
+
+    // make sure the index directory exists
+    DbgUtilErr rc = OsUtil::dirExists(indexDir.c_str());
+    if (rc == DBGUTIL_ERR_NOT_FOUND) {
+        rc = OsUtil::createDir(indexDir.c_str());
+        if (rc == DBGUTIL_ERR_ALREADY_EXISTS) {
+            rc = DBGUTIL_ERR_OK;
+        }
+    }
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Symbol index directory %s cannot be used: %s", indexDir.c_str(),
+                  errorToString(rc));
+        return rc;
+    }
+
+    // prepare header
+    IndexHeader hdr = {};
+    memcpy(hdr.m_magic, sIndexMagic, sizeof(sIndexMagic));
+    hdr.m_version = DBGUTIL_SYMBOL_INDEX_VERSION;
+    hdr.m_byteOrderMark = DBGUTIL_SYMBOL_INDEX_BOM;
+    hdr.m_flags = (m_is64Bit ? DBGUTIL_SYMBOL_INDEX_FLAG_64BIT : 0) |
+                  (m_isExe ? DBGUTIL_SYMBOL_INDEX_FLAG_EXE : 0) |
+                  (m_hasCURanges ? DBGUTIL_SYMBOL_INDEX_FLAG_CU_RANGES : 0);
+    hdr.m_buildIdLength = (uint32_t)buildId.length();
+    memcpy(hdr.m_buildId, buildId.c_str(), buildId.length());
+    hdr.m_relocBase = m_relocBase;
+    hdr.m_symbolCount = (uint32_t)m_symbols.size();
+    hdr.m_cuRangeCount = (uint32_t)m_cuRanges.size();
+    hdr.m_srcFileCount = (uint32_t)m_srcFileOffsets.size();
+    hdr.m_symbolsOffset = alignUp8(sizeof(IndexHeader));
+    hdr.m_cuRangesOffset =
+        alignUp8(hdr.m_symbolsOffset + m_symbols.size() * sizeof(SymbolIndex::Symbol));
+    hdr.m_srcFilesOffset =
+        alignUp8(hdr.m_cuRangesOffset + m_cuRanges.size() * sizeof(SymbolIndex::CURange));
+    hdr.m_stringPoolOffset =
+        alignUp8(hdr.m_srcFilesOffset + m_srcFileOffsets.size() * sizeof(uint32_t));
+    hdr.m_stringPoolSize = m_stringPool.size();
+
+    // write to a temporary file first, so that the index file appears atomically
+    // NOTE: the index directory may be shared by several processes, so the temporary file name is
+    // made unique by both process and thread id
+#ifdef DBGUTIL_WINDOWS
+    uint64_t processId = (uint64_t)_getpid();
+#else
+    uint64_t processId = (uint64_t)getpid();
+#endif
+    std::string path = SymbolIndex::getIndexPath(indexDir, buildId);
+    std::string tmpPath = path + "." + std::to_string(processId) + "." +
+                          std::to_string(OsUtil::getCurrentThreadId()) + ".tmp";
+    int fd = -1;
+    rc = OsUtil::openFile(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644, fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        return rc;
+    }
+
+    static const char padding[8] = {};
+    uint64_t pos = sizeof(IndexHeader);
+    rc = writeData(fd, &hdr, sizeof(IndexHeader));
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, padding, hdr.m_symbolsOffset - pos);
+        pos = hdr.m_symbolsOffset + m_symbols.size() * sizeof(SymbolIndex::Symbol);
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, m_symbols.data(), m_symbols.size() * sizeof(SymbolIndex::Symbol));
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, padding, hdr.m_cuRangesOffset - pos);
+        pos = hdr.m_cuRangesOffset + m_cuRanges.size() * sizeof(SymbolIndex::CURange);
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, m_cuRanges.data(), m_cuRanges.size() * sizeof(SymbolIndex::CURange));
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, padding, hdr.m_srcFilesOffset - pos);
+        pos = hdr.m_srcFilesOffset + m_srcFileOffsets.size() * sizeof(uint32_t);
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, m_srcFileOffsets.data(), m_srcFileOffsets.size() * sizeof(uint32_t));
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, padding, hdr.m_stringPoolOffset - pos);
+    }
+    if (rc == DBGUTIL_ERR_OK) {
+        rc = writeData(fd, m_stringPool.data(), m_stringPool.size());
+    }
+    OsUtil::closeFile(fd);
+    if (rc != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Failed to write symbol index file %s: %s", tmpPath.c_str(),
+                  errorToString(rc));
+        OsUtil::deleteFile(tmpPath.c_str());
+        return rc;
+    }
+
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_SYS_ERROR(sLogger, rename, "Failed to rename symbol index file %s to %s",
+                      tmpPath.c_str(), path.c_str());
+        OsUtil::deleteFile(tmpPath.c_str());
+        return DBGUTIL_ERR_SYSTEM_FAILURE;
+    }
+    LOG_DEBUG(sLogger, "Written symbol index file %s (%u symbols, %u source files, %u ranges)",
+              path.c_str(), hdr.m_symbolCount, hdr.m_srcFileCount, hdr.m_cuRangeCount);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr SymbolIndexBuilder::writeData(int fd, const void* data, size_t length) {
+    const char* buf = (const char*)data;
+    while (length > 0) {
+        size_t bytesWritten = 0;
+        DbgUtilErr rc = OsUtil::writeFile(fd, buf, length, bytesWritten);
+        if (rc != DBGUTIL_ERR_OK) {
+            return rc;
+        }
+        buf += bytesWritten;
+        length -= bytesWritten;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
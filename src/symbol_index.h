@@ -0,0 +1,197 @@
+#ifndef __SYMBOL_INDEX_H__
+#define __SYMBOL_INDEX_H__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dbg_util_err.h"
+
+namespace dbgutil {
+
+/** @def Symbol index file name extension. */
+#define DBGUTIL_SYMBOL_INDEX_EXT ".dbgidx"
+
+/** @def Symbol index file format version. */
+#define DBGUTIL_SYMBOL_INDEX_VERSION 2
+
+/** @def Marks a symbol that does not participate in the symbol name map. */
+#define DBGUTIL_SYMBOL_INDEX_NO_NAME UINT32_MAX
+
+/**
+ * @brief A persistent symbol index of a binary image, stored in a cache directory and keyed by the
+ * image build identifier. The index contains the sorted function table, the names used for symbol
+ * name search (as they appear in the symbol table, demangling is deferred to first use), source
+ * file names and the compilation unit address range table. All strings are interned in a single
+ * string pool. The index file is mapped into memory when loaded, so that identical processes share
+ * the same physical pages.
+ */
+class SymbolIndex {
+public:
+    SymbolIndex();
+    SymbolIndex(const SymbolIndex&) = delete;
+    SymbolIndex(SymbolIndex&&) = delete;
+    SymbolIndex& operator=(const SymbolIndex&) = delete;
+    ~SymbolIndex() { close(); }
+
+    static void initLogger();
+    static void termLogger();
+
+    /**
+     * @brief Configures the directory in which symbol index files are stored. Pass null or empty
+     * string to disable symbol index persistence (the default).
+     */
+    static void setIndexDir(const char* indexDir);
+
+    /** @brief Retrieves the directory in which symbol index files are stored. */
+    static std::string getIndexDir();
+
+    /** @brief Composes the path of the symbol index file of an image. */
+    static std::string getIndexPath(const std::string& indexDir, const std::string& buildId);
+
+    /** @brief Symbol entry as stored in the index file. */
+    struct Symbol {
+        /** @var Offset of symbol relative to start of image. */
+        uint64_t m_offset;
+
+        /** @var Size of symbol in bytes. */
+        uint64_t m_size;
+
+        /** @var Offset of the symbol name in the string pool. */
+        uint32_t m_nameOffset;
+
+        /**
+         * @var Offset of the name used for symbol name search in the string pool, or @ref
+         * DBGUTIL_SYMBOL_INDEX_NO_NAME if the symbol does not participate in name search.
+         */
+        uint32_t m_mapNameOffset;
+
+        /** @var The index of the source file containing the symbol. */
+        uint32_t m_srcFileIndex;
+
+        /** @var Reserved for alignment. */
+        uint32_t m_reserved;
+    };
+
+    /** @brief Compilation unit address range entry as stored in the index file. */
+    struct CURange {
+        uint64_t m_from;
+        uint64_t m_size;
+        uint64_t m_debugInfoOffset;
+    };
+
+    /**
+     * @brief Loads the symbol index file of an image.
+     * @param indexDir The directory containing symbol index files.
+     * @param buildId The build identifier of the image.
+     * @return E_OK If the index was loaded.
+     * @return E_NOT_FOUND If there is no index for the image.
+     * @return E_DATA_CORRUPT If the index file is corrupt.
+     * @return DbgUtilErr Any other error code.
+     */
+    DbgUtilErr open(const std::string& indexDir, const std::string& buildId);
+
+    /** @brief Unmaps the symbol index file. */
+    void close();
+
+    /** @brief Queries whether the symbol index is loaded. */
+    inline bool isOpen() const { return m_mappedIndex != nullptr; }
+
+    /** @brief Queries whether the indexed image is a 64 bit image. */
+    bool getIs64Bit() const;
+
+    /** @brief Queries whether the indexed image is an executable image. */
+    bool getIsExe() const;
+
+    /** @brief Retrieves the relocation base of the indexed image. */
+    uint64_t getRelocationBase() const;
+
+    /** @brief Queries whether the index contains the compilation unit address range table. */
+    bool hasCURanges() const;
+
+    inline uint32_t getSymbolCount() const { return m_symbolCount; }
+    inline const Symbol& getSymbol(uint32_t index) const { return m_symbols[index]; }
+
+    inline uint32_t getSrcFileCount() const { return m_srcFileCount; }
+    inline const char* getSrcFile(uint32_t index) const {
+        return getString(m_srcFileOffsets[index]);
+    }
+
+    inline uint32_t getCURangeCount() const { return m_cuRangeCount; }
+    inline const CURange& getCURange(uint32_t index) const { return m_cuRanges[index]; }
+
+    /** @brief Retrieves a string from the string pool. */
+    inline const char* getString(uint32_t offset) const { return m_stringPool + offset; }
+
+private:
+    char* m_mappedIndex;
+    uint64_t m_mappedSize;
+    const Symbol* m_symbols;
+    uint32_t m_symbolCount;
+    const uint32_t* m_srcFileOffsets;
+    uint32_t m_srcFileCount;
+    const CURange* m_cuRanges;
+    uint32_t m_cuRangeCount;
+    const char* m_stringPool;
+
+    DbgUtilErr validate(const std::string& buildId);
+};
+
+/** @brief Collects symbol index data and writes the symbol index file. */
+class SymbolIndexBuilder {
+public:
+    SymbolIndexBuilder(bool is64Bit, bool isExe, uint64_t relocBase);
+    SymbolIndexBuilder(const SymbolIndexBuilder&) = delete;
+    SymbolIndexBuilder(SymbolIndexBuilder&&) = delete;
+    SymbolIndexBuilder& operator=(const SymbolIndexBuilder&) = delete;
+    ~SymbolIndexBuilder() {}
+
+    /**
+     * @brief Adds a symbol (symbols are expected to be added in ascending offset order).
+     * @param offset The symbol offset relative to start of image.
+     * @param size The symbol size in bytes.
+     * @param name The symbol name.
+     * @param mapName The name used for symbol name search, or null if the symbol does not
+     * participate in name search.
+     * @param srcFileIndex The index of the source file containing the symbol.
+     */
+    void addSymbol(uint64_t offset, uint64_t size, const char* name, const char* mapName,
+                   uint32_t srcFileIndex);
+
+    /** @brief Adds a source file name. */
+    void addSrcFile(const char* fileName);
+
+    /** @brief Adds a compilation unit address range (in ascending address order). */
+    void addCURange(uint64_t from, uint64_t size, uint64_t debugInfoOffset);
+
+    /** @brief Marks that the index contains the compilation unit address range table. */
+    inline void setHasCURanges() { m_hasCURanges = true; }
+
+    /**
+     * @brief Writes the symbol index file. The file is first written under a temporary name and
+     * then renamed, so that concurrent readers never observe a partially written file.
+     * @param indexDir The directory containing symbol index files (created if missing).
+     * @param buildId The build identifier of the image.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr write(const std::string& indexDir, const std::string& buildId);
+
+private:
+    bool m_is64Bit;
+    bool m_isExe;
+    uint64_t m_relocBase;
+    bool m_hasCURanges;
+    std::vector<SymbolIndex::Symbol> m_symbols;
+    std::vector<uint32_t> m_srcFileOffsets;
+    std::vector<SymbolIndex::CURange> m_cuRanges;
+    std::vector<char> m_stringPool;
+    std::unordered_map<std::string, uint32_t> m_stringMap;
+
+    uint32_t internString(const char* str);
+    DbgUtilErr writeData(int fd, const void* data, size_t length);
+};
+
+}  // namespace dbgutil
+
+#endif  // __SYMBOL_INDEX_H__
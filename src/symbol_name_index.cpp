@@ -0,0 +1,223 @@
+#include "symbol_name_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <new>
+
+namespace dbgutil {
+
+// ECMAScript special characters (outside of bracket expressions)
+static inline bool isRegexSpecialChar(char c) { return strchr("^$\\.*+?()[]{}|", c) != nullptr; }
+
+// checks whether a regular expression contains an alternation (at any nesting level)
+static bool hasAlternation(const char* regex) {
+    for (const char* p = regex; *p != 0; ++p) {
+        if (*p == '\\' && p[1] != 0) {
+            ++p;
+        } else if (*p == '|') {
+            return true;
+        }
+    }
+    return false;
+}
+
+DbgUtilErr SymbolPattern::compile(const char* regex) {
+    m_prefix.clear();
+    m_glob.clear();
+
+    // translate the regular expression into a glob pattern, as long as it contains only literals,
+    // "." and ".*" (regex_match() matches the entire name, so leading '^' and trailing '$' are
+    // redundant), and collect the literal prefix on the way
+    std::string glob;
+    bool reducible = true;
+    bool prefixDone = false;
+    const char* p = regex;
+    if (*p == '^') {
+        ++p;
+    }
+    while (*p != 0) {
+        if (*p == '$' && p[1] == 0) {
+            break;
+        }
+        if (*p == '.') {
+            prefixDone = true;
+            if (p[1] == '*' || p[1] == '+') {
+                // lazy quantifiers make no difference when matching the entire name
+                glob += (p[1] == '*') ? "*" : "?*";
+                p += (p[2] == '?') ? 3 : 2;
+            } else if (p[1] == '?' || p[1] == '{') {
+                reducible = false;
+                break;
+            } else {
+                glob += '?';
+                ++p;
+            }
+            continue;
+        }
+
+        // character class escapes and back references are not literals
+        char literal = *p;
+        if (*p == '\\') {
+            if (p[1] == 0 || isalnum((unsigned char)p[1]) || p[1] == '_') {
+                reducible = false;
+                break;
+            }
+            literal = p[1];
+            p += 2;
+        } else if (isRegexSpecialChar(*p)) {
+            reducible = false;
+            break;
+        } else {
+            ++p;
+        }
+
+        // a literal that may repeat zero times does not belong to the prefix
+        if (*p == '*' || *p == '?' || *p == '{') {
+            reducible = false;
+            break;
+        }
+        if (!prefixDone) {
+            m_prefix += literal;
+        }
+        if (*p == '+' || literal == '*' || literal == '?') {
+            // repeated literals, and literal wildcard characters, cannot be expressed as glob
+            reducible = false;
+            break;
+        }
+        glob += literal;
+    }
+
+    if (!reducible) {
+        // the literal prefix of an alternation is not necessarily a prefix of all matches
+        if (hasAlternation(regex)) {
+            m_prefix.clear();
+        }
+        m_kind = SymbolPatternKind::SPK_REGEX;
+        try {
+            m_regex.assign(regex);
+        } catch (std::regex_error&) {
+            return DBGUTIL_ERR_INVALID_ARGUMENT;
+        } catch (std::bad_alloc&) {
+            return DBGUTIL_ERR_NOMEM;
+        }
+        return DBGUTIL_ERR_OK;
+    }
+    return compileGlob(glob.c_str());
+}
+
+DbgUtilErr SymbolPattern::compileGlob(const char* glob) {
+    size_t prefixLength = strcspn(glob, "*?");
+    m_prefix.assign(glob, prefixLength);
+    const char* suffix = glob + prefixLength;
+    if (*suffix == 0) {
+        m_kind = SymbolPatternKind::SPK_EXACT;
+        m_glob.clear();
+    } else if (strcmp(suffix, "*") == 0) {
+        m_kind = SymbolPatternKind::SPK_PREFIX;
+        m_glob.clear();
+    } else {
+        m_kind = SymbolPatternKind::SPK_GLOB;
+        m_glob = suffix;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+bool SymbolPattern::matches(const char* name, bool prefixMatched /* = false */) const {
+    if (!prefixMatched && strncmp(name, m_prefix.c_str(), m_prefix.size()) != 0) {
+        return false;
+    }
+    const char* suffix = name + m_prefix.size();
+    switch (m_kind) {
+        case SymbolPatternKind::SPK_EXACT:
+            return *suffix == 0;
+
+        case SymbolPatternKind::SPK_PREFIX:
+            return true;
+
+        case SymbolPatternKind::SPK_GLOB:
+            return matchGlob(suffix, m_glob.c_str());
+
+        case SymbolPatternKind::SPK_REGEX:
+        default:
+            return std::regex_match(name, m_regex);
+    }
+}
+
+bool SymbolPattern::matchGlob(const char* name, const char* glob) {
+    // on mismatch backtrack to the last '*', and let it consume one more character
+    const char* starGlob = nullptr;
+    const char* starName = nullptr;
+    while (*name != 0) {
+        if (*glob == '*') {
+            starGlob = ++glob;
+            starName = name;
+        } else if (*glob == '?' || *glob == *name) {
+            ++glob;
+            ++name;
+        } else if (starGlob != nullptr) {
+            glob = starGlob;
+            name = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (*glob == '*') {
+        ++glob;
+    }
+    return *glob == 0;
+}
+
+void SymbolNameIndex::build() {
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        int res = strcmp(lhs.m_name, rhs.m_name);
+        return res < 0 || (res == 0 && lhs.m_symIndex < rhs.m_symIndex);
+    });
+    m_entries.shrink_to_fit();
+}
+
+size_t SymbolNameIndex::lowerBound(const char* prefix) const {
+    std::vector<Entry>::const_iterator itr = std::lower_bound(
+        m_entries.begin(), m_entries.end(), prefix,
+        [](const Entry& entry, const char* prefix) { return strcmp(entry.m_name, prefix) < 0; });
+    return (size_t)(itr - m_entries.begin());
+}
+
+bool SymbolNameIndex::findName(const char* name, uint32_t& symIndex) const {
+    size_t index = lowerBound(name);
+    if (index == m_entries.size() || strcmp(m_entries[index].m_name, name) != 0) {
+        return false;
+    }
+    symIndex = m_entries[index].m_symIndex;
+    return true;
+}
+
+DbgUtilErr SymbolNameIndex::search(const SymbolPattern& pattern,
+                                   std::vector<uint32_t>& symIndices) const {
+    // only names sharing the literal prefix of the pattern are candidates, and these are adjacent
+    const std::string& prefix = pattern.getPrefix();
+    size_t index = prefix.empty() ? 0 : lowerBound(prefix.c_str());
+    try {
+        for (; index < m_entries.size(); ++index) {
+            const char* name = m_entries[index].m_name;
+            if (strncmp(name, prefix.c_str(), prefix.size()) != 0) {
+                break;
+            }
+            if (pattern.matches(name, true)) {
+                symIndices.push_back(m_entries[index].m_symIndex);
+            } else if (pattern.getKind() == SymbolPatternKind::SPK_EXACT) {
+                // exact matches are sorted before all other names sharing the prefix
+                break;
+            }
+        }
+    } catch (std::bad_alloc&) {
+        return DBGUTIL_ERR_NOMEM;
+    }
+
+    // a symbol may match by several names
+    std::sort(symIndices.begin(), symIndices.end());
+    symIndices.erase(std::unique(symIndices.begin(), symIndices.end()), symIndices.end());
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
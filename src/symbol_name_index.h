@@ -0,0 +1,159 @@
+#ifndef __SYMBOL_NAME_INDEX_H__
+#define __SYMBOL_NAME_INDEX_H__
+
+#include <cstdint>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "dbgutil_common.h"
+
+namespace dbgutil {
+
+/** @enum Symbol name pattern kinds, in ascending order of evaluation cost. */
+enum class SymbolPatternKind : uint32_t {
+    /** @var The pattern is a literal name. */
+    SPK_EXACT,
+
+    /** @var The pattern is a literal prefix followed by any suffix. */
+    SPK_PREFIX,
+
+    /** @var The pattern consists of literals and wildcards only (glob '*' and '?'). */
+    SPK_GLOB,
+
+    /** @var The pattern is a full regular expression. */
+    SPK_REGEX
+};
+
+/**
+ * @brief A symbol name pattern compiled from a regular expression. Since most symbol searches use
+ * simple patterns, the regular expression is reduced (when possible) to an exact name, a literal
+ * prefix, or a glob pattern, all of which are matched without std::regex. Otherwise, the longest
+ * literal prefix of the regular expression (if any) is still used to narrow down the candidate
+ * names, and std::regex is evaluated only against the candidates. A compiled pattern is immutable
+ * and may be matched concurrently.
+ */
+class SymbolPattern {
+public:
+    SymbolPattern() : m_kind(SymbolPatternKind::SPK_REGEX) {}
+    SymbolPattern(const SymbolPattern&) = delete;
+    SymbolPattern(SymbolPattern&&) = delete;
+    SymbolPattern& operator=(const SymbolPattern&) = delete;
+    ~SymbolPattern() {}
+
+    /**
+     * @brief Compiles a regular expression (ECMAScript syntax, matched against the entire name).
+     * @param regex The regular expression.
+     * @return DbgUtilErr The operation result (invalid argument if the regular expression is
+     * malformed).
+     */
+    DbgUtilErr compile(const char* regex);
+
+    /**
+     * @brief Compiles a glob pattern, where '*' matches any sequence of characters, and '?'
+     * matches any single character.
+     * @param glob The glob pattern.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr compileGlob(const char* glob);
+
+    /** @brief Retrieves the pattern kind. */
+    inline SymbolPatternKind getKind() const { return m_kind; }
+
+    /** @brief Retrieves the literal prefix all matching names share (may be empty). */
+    inline const std::string& getPrefix() const { return m_prefix; }
+
+    /**
+     * @brief Matches a name against the pattern.
+     * @param name The name to match.
+     * @param prefixMatched Specifies whether the name is already known to start with the literal
+     * prefix of the pattern, in which case the prefix is not compared again.
+     * @return True if the name matches the pattern.
+     */
+    bool matches(const char* name, bool prefixMatched = false) const;
+
+private:
+    SymbolPatternKind m_kind;
+    std::string m_prefix;
+
+    // glob suffix following the literal prefix (for glob patterns)
+    std::string m_glob;
+
+    // the full regular expression (for regular expression patterns)
+    std::regex m_regex;
+
+    static bool matchGlob(const char* name, const char* glob);
+};
+
+/**
+ * @brief A sorted symbol name index. Each symbol may be indexed by several names (e.g. both
+ * mangled and demangled names), and names are not copied, so they must outlive the index. Exact and
+ * prefix queries take O(log n + k), where k is the number of names sharing the literal prefix of
+ * the pattern. The index is built once and is immutable afterwards, so it may be searched
+ * concurrently without locking.
+ */
+class SymbolNameIndex {
+public:
+    SymbolNameIndex() {}
+    SymbolNameIndex(const SymbolNameIndex&) = delete;
+    SymbolNameIndex(SymbolNameIndex&&) = delete;
+    SymbolNameIndex& operator=(const SymbolNameIndex&) = delete;
+    ~SymbolNameIndex() {}
+
+    /** @brief Reserves space for the given amount of names. */
+    inline void reserve(size_t count) { m_entries.reserve(count); }
+
+    /**
+     * @brief Adds a name to the index. Names are sorted only when @ref build() is called.
+     * @param name The symbol name.
+     * @param symIndex The index of the named symbol in the symbol table.
+     */
+    inline void addName(const char* name, uint32_t symIndex) {
+        m_entries.push_back({name, symIndex});
+    }
+
+    /** @brief Sorts the index after all names were added. */
+    void build();
+
+    /** @brief Removes all names. */
+    inline void clear() { m_entries.clear(); }
+
+    /** @brief Retrieves the number of indexed names. */
+    inline size_t size() const { return m_entries.size(); }
+
+    /** @brief Retrieves the approximate memory usage (in bytes) of the index. */
+    inline size_t getMemoryUsage() const { return m_entries.capacity() * sizeof(Entry); }
+
+    /**
+     * @brief Searches for a name (exact match).
+     * @param name The name to search.
+     * @param[out] symIndex The index of the named symbol (valid only if found). If several symbols
+     * have the same name, then the one with the lowest symbol index is returned.
+     * @return True if the name was found.
+     */
+    bool findName(const char* name, uint32_t& symIndex) const;
+
+    /**
+     * @brief Searches for all symbols having a name matching a pattern.
+     * @param pattern The pattern to match.
+     * @param[out] symIndices The indices of the matching symbols in ascending order, each appearing
+     * once, even if matched by several names.
+     * @return DbgUtilErr The operation result.
+     */
+    DbgUtilErr search(const SymbolPattern& pattern, std::vector<uint32_t>& symIndices) const;
+
+private:
+    struct Entry {
+        const char* m_name;
+        uint32_t m_symIndex;
+    };
+    std::vector<Entry> m_entries;
+
+    // finds the first name not less than the given prefix
+    size_t lowerBound(const char* prefix) const;
+};
+
+}  // namespace dbgutil
+
+#endif  // __SYMBOL_NAME_INDEX_H__
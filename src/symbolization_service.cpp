@@ -0,0 +1,251 @@
+#include "symbolization_service.h"
+
+#include <new>
+#include <system_error>
+
+#include "dbgutil_log_imp.h"
+#include "os_util.h"
+#include "symbolization_service_internal.h"
+
+namespace dbgutil {
+
+static Logger sLogger;
+
+SymbolizationService::SymbolizationService()
+    : m_queueHead(0),
+      m_queueCount(0),
+      m_running(false),
+      m_stopping(false),
+      m_overflowPolicy(SymbolizationOverflowPolicy::SOP_BLOCK),
+      m_skip(0),
+      m_filter(nullptr),
+      m_formatter(nullptr),
+      m_detail(DBGUTIL_SYMBOL_DETAIL_ALL),
+      m_droppedCount(0),
+      m_inlineCount(0) {}
+
+SymbolizationService::~SymbolizationService() { (void)stop(); }
+
+DbgUtilErr SymbolizationService::start(
+    uint32_t threadCount /* = DBGUTIL_SYMBOLIZATION_DEFAULT_THREADS */,
+    uint32_t queueSize /* = DBGUTIL_SYMBOLIZATION_DEFAULT_QUEUE_SIZE */,
+    SymbolizationOverflowPolicy overflowPolicy /* = SymbolizationOverflowPolicy::SOP_BLOCK */,
+    int skip /* = 0 */, StackEntryFilter* filter /* = nullptr */,
+    StackEntryFormatter* formatter /* = nullptr */,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
+    if (threadCount == 0 || queueSize == 0) {
+        LOG_ERROR(sLogger, "Invalid symbolization service parameters: %u threads, queue size %u",
+                  threadCount, queueSize);
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_running || !m_workers.empty()) {
+        LOG_ERROR(sLogger, "Cannot start symbolization service, already running");
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    // workers being joined by stop() may still use the queue, which stop() clears afterwards
+    if (m_stopping) {
+        LOG_ERROR(sLogger, "Cannot start symbolization service, still stopping");
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+
+    // the entire queue is allocated up front, so that submission does not allocate memory
+    try {
+        m_queue.resize(queueSize);
+    } catch (std::bad_alloc&) {
+        LOG_ERROR(sLogger, "Failed to allocate symbolization request queue of size %u", queueSize);
+        return DBGUTIL_ERR_NOMEM;
+    }
+    m_queueHead = 0;
+    m_queueCount = 0;
+    m_overflowPolicy = overflowPolicy;
+    m_skip = skip;
+    m_filter = filter;
+    m_formatter = formatter;
+    m_detail = detail;
+    m_stopping = false;
+    m_running = true;
+
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        try {
+            m_workers.emplace_back(&SymbolizationService::workerLoop, this);
+        } catch (std::system_error& e) {
+            LOG_ERROR(sLogger, "Failed to start symbolization worker thread: %s", e.what());
+            break;
+        }
+    }
+    if (m_workers.empty()) {
+        m_running = false;
+        m_queue.clear();
+        return DBGUTIL_ERR_SYSTEM_FAILURE;
+    }
+    LOG_DEBUG(sLogger, "Symbolization service started with %zu threads, queue size %u",
+              m_workers.size(), queueSize);
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr SymbolizationService::stop() {
+    std::vector<std::thread> workers;
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (!m_running) {
+            return DBGUTIL_ERR_INVALID_STATE;
+        }
+        m_running = false;
+        m_stopping = true;
+        workers.swap(m_workers);
+    }
+
+    // wake up all workers (to drain the queue and exit), and all blocked submitters (to give up)
+    m_notEmptyCV.notify_all();
+    m_notFullCV.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // start() is rejected until here
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_queue.clear();
+    m_stopping = false;
+    LOG_DEBUG(sLogger, "Symbolization service stopped");
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr SymbolizationService::submit(RawStackTrace& rawStackTrace,
+                                        SymbolizationListener* listener,
+                                        os_thread_id_t threadId /* = 0 */) {
+    if (listener == nullptr) {
+        return DBGUTIL_ERR_INVALID_ARGUMENT;
+    }
+    return submitRequest(rawStackTrace, threadId, listener, nullptr);
+}
+
+DbgUtilErr SymbolizationService::submit(RawStackTrace& rawStackTrace,
+                                        std::future<SymbolizedStackTrace>& result,
+                                        os_thread_id_t threadId /* = 0 */) {
+    std::promise<SymbolizedStackTrace> promise;
+    std::future<SymbolizedStackTrace> future = promise.get_future();
+    DbgUtilErr rc = submitRequest(rawStackTrace, threadId, nullptr, &promise);
+    if (rc == DBGUTIL_ERR_OK) {
+        result = std::move(future);
+    }
+    return rc;
+}
+
+DbgUtilErr SymbolizationService::submitRequest(RawStackTrace& rawStackTrace,
+                                               os_thread_id_t threadId,
+                                               SymbolizationListener* listener,
+                                               std::promise<SymbolizedStackTrace>* promise) {
+    // the thread id is captured now, since formatting takes place in another thread
+    if (threadId == 0) {
+        threadId = OsUtil::getCurrentThreadId();
+    }
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (!m_running) {
+        return DBGUTIL_ERR_INVALID_STATE;
+    }
+    if (m_queueCount == m_queue.size()) {
+        if (m_overflowPolicy == SymbolizationOverflowPolicy::SOP_DROP) {
+            m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return DBGUTIL_ERR_RESOURCE_LIMIT;
+        }
+        if (m_overflowPolicy == SymbolizationOverflowPolicy::SOP_INLINE) {
+            lock.unlock();
+            m_inlineCount.fetch_add(1, std::memory_order_relaxed);
+            symbolize(rawStackTrace, threadId, listener, promise);
+            rawStackTrace.clear();
+            return DBGUTIL_ERR_OK;
+        }
+        m_notFullCV.wait(lock, [this]() { return m_queueCount < m_queue.size() || !m_running; });
+        if (!m_running) {
+            return DBGUTIL_ERR_INVALID_STATE;
+        }
+    }
+
+    // the raw stack trace buffer is exchanged with the (already processed) buffer of the slot
+    Request& request = m_queue[(m_queueHead + m_queueCount) % m_queue.size()];
+    request.m_rawStackTrace.swap(rawStackTrace);
+    request.m_threadId = threadId;
+    request.m_listener = listener;
+    request.m_hasPromise = (promise != nullptr);
+    if (promise != nullptr) {
+        request.m_promise = std::move(*promise);
+    }
+    ++m_queueCount;
+    lock.unlock();
+
+    rawStackTrace.clear();
+    m_notEmptyCV.notify_one();
+    return DBGUTIL_ERR_OK;
+}
+
+void SymbolizationService::symbolize(RawStackTrace& rawStackTrace, os_thread_id_t threadId,
+                                     SymbolizationListener* listener,
+                                     std::promise<SymbolizedStackTrace>* promise) {
+    SymbolizedStackTrace result;
+    result.m_threadId = threadId;
+    try {
+        result.m_result = resolveRawStackTrace(rawStackTrace, result.m_stackTrace, m_detail);
+        if (result.m_result == DBGUTIL_ERR_OK) {
+            result.m_text =
+                stackTraceToString(result.m_stackTrace, m_skip, m_filter, m_formatter, threadId);
+        }
+    } catch (std::bad_alloc&) {
+        result.m_result = DBGUTIL_ERR_NOMEM;
+    }
+    if (result.m_result != DBGUTIL_ERR_OK) {
+        LOG_DEBUG(sLogger, "Failed to symbolize stack trace of thread %" PRItid ": %s", threadId,
+                  errorToString(result.m_result));
+    }
+
+    if (listener != nullptr) {
+        listener->onStackTraceSymbolized(result);
+    } else if (promise != nullptr) {
+        promise->set_value(std::move(result));
+    }
+}
+
+void SymbolizationService::workerLoop() {
+    // each worker keeps a raw stack trace buffer, which is exchanged with the buffer of the next
+    // request, so that buffers circulate between submitting threads and workers
+    RawStackTrace rawStackTrace;
+    std::promise<SymbolizedStackTrace> promise;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_notEmptyCV.wait(lock, [this]() { return m_queueCount > 0 || m_stopping; });
+        if (m_queueCount == 0) {
+            // stopping, and queue is drained
+            break;
+        }
+        Request& request = m_queue[m_queueHead];
+        rawStackTrace.swap(request.m_rawStackTrace);
+        os_thread_id_t threadId = request.m_threadId;
+        SymbolizationListener* listener = request.m_listener;
+        bool hasPromise = request.m_hasPromise;
+        if (hasPromise) {
+            promise = std::move(request.m_promise);
+            request.m_hasPromise = false;
+        }
+        m_queueHead = (m_queueHead + 1) % m_queue.size();
+        --m_queueCount;
+        lock.unlock();
+        m_notFullCV.notify_one();
+
+        symbolize(rawStackTrace, threadId, listener, hasPromise ? &promise : nullptr);
+        rawStackTrace.clear();
+    }
+}
+
+DbgUtilErr initSymbolizationService() {
+    registerLogger(sLogger, "symbolization_service");
+    return DBGUTIL_ERR_OK;
+}
+
+DbgUtilErr termSymbolizationService() {
+    unregisterLogger(sLogger);
+    return DBGUTIL_ERR_OK;
+}
+
+}  // namespace dbgutil
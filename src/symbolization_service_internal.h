@@ -0,0 +1,16 @@
+#ifndef __SYMBOLIZATION_SERVICE_INTERNAL_H__
+#define __SYMBOLIZATION_SERVICE_INTERNAL_H__
+
+#include "dbg_util_err.h"
+
+namespace dbgutil {
+
+/** @brief Initializes the symbolization service logger. */
+extern DbgUtilErr initSymbolizationService();
+
+/** @brief Terminates the symbolization service logger. */
+extern DbgUtilErr termSymbolizationService();
+
+}  // namespace dbgutil
+
+#endif  // __SYMBOLIZATION_SERVICE_INTERNAL_H__
@@ -334,9 +334,14 @@ DbgUtilErr Win32PEReader::buildSymTab() {
                     symSize = itr->second;
                 }
 
-                // insert symbol
+                // insert symbol (names are interned, since short names are not null-terminated)
+                const char* symName = m_symNamePool.intern(name.c_str(), name.length());
+                if (symName == nullptr) {
+                    LOG_ERROR(sLogger, "Failed to build symbol table, out of memory");
+                    return DBGUTIL_ERR_NOMEM;
+                }
                 m_symInfoSet.push_back(
-                    {symOffset, symSize, name, srcFileIndex, sym.SectionNumber - 1});
+                    {symOffset, symSize, symName, srcFileIndex, sym.SectionNumber - 1});
                 LOG_DIAG(sLogger, "Found function: %s, %u-%u, %s", name.c_str(),
                          (unsigned)symOffset, (unsigned)(symOffset + symSize),
                          m_srcFileNames[srcFileIndex].c_str());
@@ -369,7 +374,7 @@ DbgUtilErr Win32PEReader::buildSymTab() {
             }
         }
         LOG_DEBUG(sLogger, "Function at %p - %p %s", (void*)symInfo.m_offset,
-                  (void*)(symInfo.m_offset + symInfo.m_size), symInfo.m_name.c_str());
+                  (void*)(symInfo.m_offset + symInfo.m_size), symInfo.m_name);
     }
 
     return DBGUTIL_ERR_OK;
@@ -143,7 +143,9 @@ static void initStackFrame(const CONTEXT& context, STACKFRAME64& stackFrame) {
 #endif
 
 // this implementation is available also for MinGW, as it might interact with non-gcc modules
-DbgUtilErr Win32SymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo) {
+DbgUtilErr Win32SymbolEngine::getSymbolInfo(
+    void* symAddress, SymbolInfo& symbolInfo,
+    SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
     // prepare symbol info struct
     const int MAX_NAME_LEN = 1024;
     IMAGEHLP_SYMBOL64* sym = (IMAGEHLP_SYMBOL64*)malloc(sizeof(IMAGEHLP_SYMBOL64) + MAX_NAME_LEN);
@@ -161,9 +163,12 @@ DbgUtilErr Win32SymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbol
         return DBGUTIL_ERR_SYSTEM_FAILURE;
     }
 
-    // un-decorate symbol name
+    // un-decorate symbol name (if required)
     std::vector<char> nameBuf(MAX_NAME_LEN);
-    DWORD nameLen = UnDecorateSymbolName(sym->Name, &nameBuf[0], MAX_NAME_LEN, UNDNAME_COMPLETE);
+    DWORD nameLen = 0;
+    if (detail & DBGUTIL_SYMBOL_DETAIL_DEMANGLE) {
+        nameLen = UnDecorateSymbolName(sym->Name, &nameBuf[0], MAX_NAME_LEN, UNDNAME_COMPLETE);
+    }
     if (nameLen == 0) {
         LOG_SYS_ERROR(sLogger, SymGetSymFromAddr64, "Failed to get undecorated name for %s",
                       sym->Name);
@@ -172,11 +177,12 @@ DbgUtilErr Win32SymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbol
         symbolInfo.m_symbolName = std::string(&nameBuf[0], nameLen);
     }
 
-    // get file/line info
+    // get file/line info (if required)
     DWORD offsetFromSymbol = 0;
     IMAGEHLP_LINE64 lineInfo = {};
     lineInfo.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
-    if (SymGetLineFromAddr64(m_processHandle, (DWORD64)symAddress, &offsetFromSymbol, &lineInfo)) {
+    if ((detail & (DBGUTIL_SYMBOL_DETAIL_FILE_LINE | DBGUTIL_SYMBOL_DETAIL_COLUMN)) &&
+        SymGetLineFromAddr64(m_processHandle, (DWORD64)symAddress, &offsetFromSymbol, &lineInfo)) {
         symbolInfo.m_fileName = lineInfo.FileName;
         symbolInfo.m_lineNumber = lineInfo.LineNumber;
         symbolInfo.m_startAddress = (void*)lineInfo.Address;
@@ -189,7 +195,8 @@ DbgUtilErr Win32SymbolEngine::getSymbolInfo(void* symAddress, SymbolInfo& symbol
 }
 
 DbgUtilErr Win32SymbolEngine::visitSymbols(const char* symbolRegex, const char* moduleNameRegex,
-                                           SymbolInfoVisitor* visitor) {
+                                           SymbolInfoVisitor* visitor,
+                                           SymbolDetail detail /* = DBGUTIL_SYMBOL_DETAIL_ALL */) {
     // currently unsupported
     return DBGUTIL_ERR_NOT_IMPLEMENTED;
 }
@@ -31,17 +31,21 @@ public:
      * @brief Retrieves symbol debug information (platform independent API).
      * @param symAddress The symbol address.
      * @param[out] symbolInfo The symbol information.
+     * @param detail The required level of detail.
      */
-    DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo) final;
+    DbgUtilErr getSymbolInfo(void* symAddress, SymbolInfo& symbolInfo,
+                             SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
 
     /**
      * @brief Traverses all symbols having a name that matches a regular expression. This variant
      * can be used if @ref searchSymbols() may yield too many symbols at once.
      * @param visitor The thread visitor.
+     * @param detail The required level of detail of each visited symbol.
      * @return The operation result.
      */
     DbgUtilErr visitSymbols(const char* symbolRegex, const char* moduleNameRegex,
-                            SymbolInfoVisitor* visitor) final;
+                            SymbolInfoVisitor* visitor,
+                            SymbolDetail detail = DBGUTIL_SYMBOL_DETAIL_ALL) final;
 
     /**
      * @brief Dumps core file.
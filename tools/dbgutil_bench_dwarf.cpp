@@ -0,0 +1,212 @@
+// dbgutil-bench-dwarf: measures the decoding throughput of DWARF primitives, comparing the stream
+// based reader (FixedInputStream with the DWARF_READ_* macros) with the pointer based DwarfCursor.
+// The input is synthetic, with value sizes distributed roughly as in real line programs and debug
+// information entries (mostly single byte LEB128 values).
+// NOTE: this tool uses internal headers and symbols of the library, so it is not built on Windows.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dbg_util.h"
+#include "dwarf_common.h"
+#include "dwarf_cursor.h"
+#include "fixed_input_stream.h"
+#include "serializable.h"
+
+using namespace dbgutil;
+
+#define BENCH_DEFAULT_VALUE_COUNT (4 * 1024 * 1024)
+#define BENCH_DEFAULT_ROUNDS 5
+
+// each record mimics a line program instruction: opcode, address advance, line advance, operand
+struct BenchInput {
+    std::vector<uint8_t> m_ulebData;
+    std::vector<uint8_t> m_slebData;
+    std::vector<uint8_t> m_recordData;
+    size_t m_valueCount;
+};
+
+static uint64_t sRandState = 0x9E3779B97F4A7C15ull;
+
+static uint64_t nextRand() {
+    // xorshift64, so that runs are reproducible
+    sRandState ^= sRandState << 13;
+    sRandState ^= sRandState >> 7;
+    sRandState ^= sRandState << 17;
+    return sRandState;
+}
+
+static uint64_t nextValue() {
+    // 70% single byte, 20% two bytes, 10% three to five bytes
+    uint64_t selector = nextRand() % 10;
+    uint64_t value = nextRand();
+    if (selector < 7) {
+        return value & 0x7F;
+    }
+    if (selector < 9) {
+        return value & 0x3FFF;
+    }
+    return value & 0x3FFFFFFFFull;
+}
+
+static void buildInput(BenchInput& input, size_t valueCount) {
+    input.m_valueCount = valueCount;
+    for (size_t i = 0; i < valueCount; ++i) {
+        uint64_t value = nextValue();
+        dwarfWriteULEB128(input.m_ulebData, value);
+        dwarfWriteSLEB128(input.m_slebData, (nextRand() & 1) ? (int64_t)value : -(int64_t)value);
+
+        input.m_recordData.push_back((uint8_t)(nextRand() & 0xFF));
+        dwarfWriteULEB128(input.m_recordData, value);
+        dwarfWriteSLEB128(input.m_recordData, (int64_t)(nextRand() % 64) - 32);
+        uint32_t operand = (uint32_t)nextRand();
+        uint8_t operandBytes[sizeof(uint32_t)];
+        memcpy(operandBytes, &operand, sizeof(uint32_t));
+        input.m_recordData.insert(input.m_recordData.end(), operandBytes,
+                                  operandBytes + sizeof(uint32_t));
+    }
+}
+
+static DbgUtilErr decodeULEB128Stream(const BenchInput& input, uint64_t& sum) {
+    FixedInputStream is((const char*)input.m_ulebData.data(), input.m_ulebData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        uint64_t value = 0;
+        DWARF_READ_ULEB128(is, value);
+        sum += value;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+static DbgUtilErr decodeULEB128Cursor(const BenchInput& input, uint64_t& sum) {
+    DwarfCursor cursor((const char*)input.m_ulebData.data(), input.m_ulebData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        sum += cursor.readULEB128();
+    }
+    return cursor.getResult();
+}
+
+static DbgUtilErr decodeSLEB128Stream(const BenchInput& input, uint64_t& sum) {
+    FixedInputStream is((const char*)input.m_slebData.data(), input.m_slebData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        int64_t value = 0;
+        DWARF_READ_SLEB128(is, value);
+        sum += (uint64_t)value;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+static DbgUtilErr decodeSLEB128Cursor(const BenchInput& input, uint64_t& sum) {
+    DwarfCursor cursor((const char*)input.m_slebData.data(), input.m_slebData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        sum += (uint64_t)cursor.readSLEB128();
+    }
+    return cursor.getResult();
+}
+
+static DbgUtilErr decodeRecordStream(const BenchInput& input, uint64_t& sum) {
+    FixedInputStream is((const char*)input.m_recordData.data(), input.m_recordData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        uint8_t opcode = 0;
+        uint64_t addressAdvance = 0;
+        int64_t lineAdvance = 0;
+        uint32_t operand = 0;
+        DBGUTIL_DESERIALIZE_INT8(is, opcode);
+        DWARF_READ_ULEB128(is, addressAdvance);
+        DWARF_READ_SLEB128(is, lineAdvance);
+        DBGUTIL_DESERIALIZE_INT32(is, operand);
+        sum += opcode + addressAdvance + (uint64_t)lineAdvance + operand;
+    }
+    return DBGUTIL_ERR_OK;
+}
+
+static DbgUtilErr decodeRecordCursor(const BenchInput& input, uint64_t& sum) {
+    DwarfCursor cursor((const char*)input.m_recordData.data(), input.m_recordData.size());
+    for (size_t i = 0; i < input.m_valueCount; ++i) {
+        uint8_t opcode = cursor.readU8();
+        uint64_t addressAdvance = cursor.readULEB128();
+        int64_t lineAdvance = cursor.readSLEB128();
+        uint32_t operand = cursor.readU32();
+        sum += opcode + addressAdvance + (uint64_t)lineAdvance + operand;
+    }
+    return cursor.getResult();
+}
+
+typedef DbgUtilErr (*DecodeFunc)(const BenchInput& input, uint64_t& sum);
+
+// runs a decoder several times, and reports the best round in nanoseconds per value
+static bool runDecoder(DecodeFunc decodeFunc, const BenchInput& input, unsigned rounds,
+                       double& bestNanos, uint64_t& sum) {
+    bestNanos = 0;
+    for (unsigned i = 0; i < rounds; ++i) {
+        sum = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        DbgUtilErr rc = decodeFunc(input, sum);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        if (rc != DBGUTIL_ERR_OK) {
+            fprintf(stderr, "Decoding failed: %s\n", errorToString(rc));
+            return false;
+        }
+        double nanos = std::chrono::duration<double, std::nano>(end - start).count();
+        if (i == 0 || nanos < bestNanos) {
+            bestNanos = nanos;
+        }
+    }
+    bestNanos /= (double)input.m_valueCount;
+    return true;
+}
+
+static bool compareDecoders(const char* name, DecodeFunc streamFunc, DecodeFunc cursorFunc,
+                            const BenchInput& input, size_t dataSize, unsigned rounds) {
+    double streamNanos = 0;
+    double cursorNanos = 0;
+    uint64_t streamSum = 0;
+    uint64_t cursorSum = 0;
+    if (!runDecoder(streamFunc, input, rounds, streamNanos, streamSum) ||
+        !runDecoder(cursorFunc, input, rounds, cursorNanos, cursorSum)) {
+        return false;
+    }
+    if (streamSum != cursorSum) {
+        fprintf(stderr, "%s: decoded values differ\n", name);
+        return false;
+    }
+    double bytesPerValue = (double)dataSize / (double)input.m_valueCount;
+    printf("%-8s stream %6.2f ns/value (%7.1f MB/s), cursor %6.2f ns/value (%7.1f MB/s), x%.1f\n",
+           name, streamNanos, bytesPerValue * 1000.0 / streamNanos, cursorNanos,
+           bytesPerValue * 1000.0 / cursorNanos, streamNanos / cursorNanos);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3 || (argc > 1 && strcmp(argv[1], "-h") == 0)) {
+        fprintf(stderr, "Usage: %s [value count] [rounds]\n", argv[0]);
+        return 1;
+    }
+    size_t valueCount = (argc > 1) ? strtoull(argv[1], nullptr, 10) : BENCH_DEFAULT_VALUE_COUNT;
+    unsigned rounds = (argc > 2) ? (unsigned)strtoul(argv[2], nullptr, 10) : BENCH_DEFAULT_ROUNDS;
+    if (valueCount == 0 || rounds == 0) {
+        fprintf(stderr, "Value count and rounds must be positive\n");
+        return 1;
+    }
+
+    DbgUtilErr rc = initDbgUtil(nullptr, nullptr, LS_FATAL);
+    if (rc != DBGUTIL_ERR_OK) {
+        fprintf(stderr, "Failed to initialize dbgutil: %s\n", errorToString(rc));
+        return 1;
+    }
+
+    BenchInput input;
+    buildInput(input, valueCount);
+    printf("Decoding %zu values, best of %u rounds\n", valueCount, rounds);
+    bool res = compareDecoders("ULEB128", decodeULEB128Stream, decodeULEB128Cursor, input,
+                               input.m_ulebData.size(), rounds) &&
+               compareDecoders("SLEB128", decodeSLEB128Stream, decodeSLEB128Cursor, input,
+                               input.m_slebData.size(), rounds) &&
+               compareDecoders("record", decodeRecordStream, decodeRecordCursor, input,
+                               input.m_recordData.size(), rounds);
+
+    termDbgUtil();
+    return res ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// dbgutil-symbolize: resolves serialized raw stack trace records (see raw_stack_record.h) in bulk
+// from binary images on disk, and prints the resulting stack traces to the standard output.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "dbg_stack_trace.h"
+#include "dbg_util.h"
+#include "offline_symbolizer.h"
+#include "raw_stack_record.h"
+
+using namespace dbgutil;
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] <record file>...\n"
+            "Options:\n"
+            "  -d <dir>          Search module images in the given directory (repeatable)\n"
+            "  -m <from>=<to>    Replace recorded module path prefix (repeatable)\n"
+            "  -a                Allow using module images with mismatching build id\n"
+            "  -v                Report warnings (e.g. module images that could not be found)\n"
+            "  -h                Print this help message\n",
+            program);
+}
+
+static bool readFile(const char* path, std::vector<char>& buffer) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+static int symbolizeFile(OfflineSymbolizer& symbolizer, const char* path) {
+    std::vector<char> buffer;
+    if (!readFile(path, buffer)) {
+        fprintf(stderr, "Failed to read record file %s\n", path);
+        return 1;
+    }
+
+    RawStackRecord record;
+    StackTrace stackTrace;
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        size_t bytesRead = 0;
+        DbgUtilErr rc =
+            deserializeRawStackRecord(buffer.data() + offset, buffer.size() - offset, record,
+                                      bytesRead);
+        if (rc != DBGUTIL_ERR_OK) {
+            fprintf(stderr, "Failed to read record at offset %zu of file %s: %s\n", offset, path,
+                    errorToString(rc));
+            return 1;
+        }
+        offset += bytesRead;
+
+        stackTrace.clear();
+        rc = symbolizer.resolveRecord(record, stackTrace);
+        if (rc != DBGUTIL_ERR_OK) {
+            fprintf(stderr, "Failed to resolve record at offset %zu of file %s: %s\n", offset,
+                    path, errorToString(rc));
+            return 1;
+        }
+        std::string text = stackTraceToString(stackTrace, 0, nullptr, nullptr, record.m_threadId);
+        fwrite(text.c_str(), 1, text.length(), stdout);
+        fputc('\n', stdout);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<const char*> searchDirs;
+    std::vector<std::pair<std::string, std::string>> pathMappings;
+    std::vector<const char*> files;
+    bool allowMismatch = false;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if ((strcmp(arg, "-d") == 0 || strcmp(arg, "-m") == 0) && i + 1 < argc) {
+            const char* value = argv[++i];
+            if (arg[1] == 'd') {
+                searchDirs.push_back(value);
+                continue;
+            }
+            const char* sep = strchr(value, '=');
+            if (sep == nullptr) {
+                fprintf(stderr, "Invalid path mapping: %s\n", value);
+                return 1;
+            }
+            pathMappings.push_back({std::string(value, sep - value), std::string(sep + 1)});
+        } else if (strcmp(arg, "-a") == 0) {
+            allowMismatch = true;
+        } else if (strcmp(arg, "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(arg, "-h") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg[0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // errors are reported by the tool itself, and library messages are of interest only if verbose
+    DbgUtilErr rc = verbose ? initDbgUtil(nullptr, DBGUTIL_DEFAULT_LOG_HANDLER, LS_WARN)
+                            : initDbgUtil(nullptr, nullptr, LS_FATAL);
+    if (rc != DBGUTIL_ERR_OK) {
+        fprintf(stderr, "Failed to initialize dbgutil: %s\n", errorToString(rc));
+        return 1;
+    }
+
+    int res = 0;
+    {
+        OfflineSymbolizer symbolizer;
+        symbolizer.setAllowBuildIdMismatch(allowMismatch);
+        for (const char* dir : searchDirs) {
+            symbolizer.addSearchDir(dir);
+        }
+        for (const auto& mapping : pathMappings) {
+            symbolizer.addPathMapping(mapping.first.c_str(), mapping.second.c_str());
+        }
+        for (const char* file : files) {
+            if (symbolizeFile(symbolizer, file) != 0) {
+                res = 1;
+            }
+        }
+    }
+
+    termDbgUtil();
+    return res;
+}